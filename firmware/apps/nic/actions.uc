@@ -14,6 +14,11 @@
 #include <nic_basic/nic_stats.h>
 
 #include "app_config_instr.h"
+#include "app_config_acl.h"
+#include "app_config_meter.h"
+#include "app_config_rfs.h"
+#include "app_config_sample.h"
+#include "maps/cmsg_map_types.h"
 #include "protocols.h"
 
 #include <passert.uc>
@@ -23,9 +28,20 @@
 #include "ebpf.uc"
 #include "app_mac_lkup.h"
 #include "mem_lkup.uc"
+#include "actions_profile.uc"
+#ifdef NIC_FLOW_CACHE
+    #include "flow_cache.uc"
+#endif
 
 
 .alloc_mem __actions_sriov_keys lmem me 32 64
+/* One 64B flow tuple per worker context (contexts 0, 2, 4 and 6), the
+ * INSTR_RSS hash input of the Toeplitz and symmetric modes */
+.alloc_mem __actions_tuple lmem me 256 256
+/* One 64B copy of the header words per worker context, see
+ * __actions_hdr_cache() */
+.alloc_mem __actions_hdr_cache lmem me 256 256
+#define ACTIONS_HDR_CACHE_MAC_wrd   10
 
 .reg global volatile g_mac_lkup_addr[2]
 
@@ -34,6 +50,13 @@
 .xfer_order $__actions
 .reg volatile __actions_t_idx
 
+/* Segment prefetch issued by INSTR_CHAIN, see __actions_chain() */
+.sig volatile __actions_sig_chain
+.addr __actions_sig_chain 15
+.reg volatile __actions_chain_pending
+.reg_addr __actions_chain_pending 27 B
+.set __actions_chain_pending
+
 mem_lkup_init_hash_tbl(_mac_lkup_tbl, imem0, MAC_LKUP_NUM_BUCKETS, MAC_LKUP_BUCKET_SZ)
 mem_lkup_init_hash_addr(g_mac_lkup_addr, _mac_lkup_tbl, HASH_OP_CAMR48_64B, 0, MAC_LKUP_NUM_BUCKETS, MAC_LKUP_BUCKET_SZ)
 
@@ -101,6 +124,58 @@ mem_lkup_init_hash_addr(g_mac_lkup_addr, _mac_lkup_tbl, HASH_OP_CAMR48_64B, 0, M
 #endm
 
 
+/* Wait for a segment prefetch that is still in flight before $__actions
+ * is reloaded, so that it can neither overwrite the new list nor leave
+ * __actions_sig_chain set for the next INSTR_CHAIN join. */
+#macro __actions_chain_sync()
+.begin
+    alu[--, --, B, __actions_chain_pending]
+    beq[end#]
+    ctx_arb[__actions_sig_chain], defer[1]
+        immed[__actions_chain_pending, 0]
+end#:
+.end
+#endm
+
+
+/* INSTR_CHAIN: continue with the segment in the other half of $__actions,
+ * after waiting for it if it was prefetched (J), and refill the half just
+ * executed with the segment at CLS ADDR (F). */
+#macro __actions_chain()
+.begin
+    .reg chain_args
+    .reg fetch_addr
+
+    alu[chain_args, 0, +16, *$index]
+
+    /* start of the half holding this instruction */
+    .reg_addr __actions_t_idx 28 B
+    alu[__actions_t_idx, __actions_t_idx, AND~, ((NIC_INSTR_SEG * 4) - 1)]
+
+    br_bclr[chain_args, BF_L(INSTR_CHAIN_JOIN_bf), fetch#]
+    br_signal[__actions_sig_chain, joined#]
+    ctx_arb[__actions_sig_chain]
+joined#:
+    immed[__actions_chain_pending, 0]
+
+fetch#:
+    br_bclr[chain_args, BF_L(INSTR_CHAIN_FETCH_bf), switch#]
+    alu[fetch_addr, chain_args, AND~, ((NIC_INSTR_SEG * 4) - 1)]
+    br_bset[__actions_t_idx, log2(NIC_INSTR_SEG * 4), fetch_hi#], defer[1]
+        immed[__actions_chain_pending, 1]
+    cls[read, $__actions[0], 0, fetch_addr, NIC_INSTR_SEG], sig_done[__actions_sig_chain]
+    br[switch#]
+fetch_hi#:
+    cls[read, $__actions[NIC_INSTR_SEG], 0, fetch_addr, NIC_INSTR_SEG], sig_done[__actions_sig_chain]
+
+switch#:
+    .reg_addr __actions_t_idx 28 B
+    alu[__actions_t_idx, __actions_t_idx, XOR, (NIC_INSTR_SEG * 4)]
+    __actions_restore_t_idx()
+.end
+#endm
+
+
 #macro __actions_rx_wire(out_pkt_vec)
 .begin
     .reg rx_args
@@ -123,6 +198,128 @@ mem_lkup_init_hash_addr(g_mac_lkup_addr, _mac_lkup_tbl, HASH_OP_CAMR48_64B, 0, M
 #endm
 
 
+/* Header words read by INSTR_VEB_LOOKUP, INSTR_ACL and INSTR_RSS, and used
+ * by INSTR_CHECKSUM, INSTR_POP_VLAN and INSTR_PUSH_VLAN if present. The
+ * first of these actions reads them from the packet, the others from LM,
+ * so the packet cache hashmap_ops and the RSS key or RFS bucket reads
+ * overwrite no longer has to be refilled for them. PV_HDR_CACHED_bf flags
+ * the copy as that of the packet, pv_init_nbi and pv_init_nfd clear it:
+ *
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +---------------------------------------------------------------+
+ *    0  |                INSTR_ACL key word, not cached                 |
+ *       +---------------------------------------------------------------+
+ *  1-4  |        Inner source IP address, IPv4 in word 1, else 0        |
+ *       +---------------------------------------------------------------+
+ *  5-8  |     Inner destination IP address, IPv4 in word 5, else 0      |
+ *       +-------------------------------+-------------------------------+
+ *    9  |         Source port           |       Destination port        |
+ *       +-------------------------------+-------------------------------+
+ *   10  |               0               |       MAC DST [47:32]         |
+ *       +-------------------------------+-------------------------------+
+ *   11  |                       MAC DST [31:0]                          |
+ *       +---------------------------------------------------------------+
+ *   12  |                       MAC SRC [47:16]                         |
+ *       +-------------------------------+-------------------------------+
+ *   13  |       MAC SRC [15:0]          |               0               |
+ *       +-------------------------------+-------------------------------+
+ *
+ * Words 0 to 9 are the INSTR_ACL key, so INSTR_ACL looks up the copy
+ * itself. The ports are zero unless PV_PROTO is TCP or UDP, as for the
+ * key. The MAC words are those pv_seek(0) reads, as INSTR_VEB_LOOKUP used
+ * them. The VLAN ID and the protocol stay in the packet vector.
+ *
+ * Leaves the LM address of the copy in out_addr and ACTIVE_LM_ADDR_3,
+ * the hashmap scratch index, ready for use. T_INDEX has to be restored if
+ * the words were read.
+ */
+#macro __actions_hdr_cache(out_addr, in_pkt_vec)
+.begin
+    .reg data
+    .reg l3_offset
+    .reg l4_offset
+    .reg proto_delta
+
+    immed[out_addr, __actions_hdr_cache]
+    br_bclr[BF_AL(in_pkt_vec, PV_HDR_CACHED_bf), read#], defer[2]
+        alu[out_addr, out_addr, OR, t_idx_ctx, >>2]
+        local_csr_wr[ACTIVE_LM_ADDR_3, out_addr]
+    br[end#], defer[2]
+        nop
+        nop
+
+read#:
+    bits_set__sz1(BF_AL(in_pkt_vec, PV_HDR_CACHED_bf), BF_MASK(PV_HDR_CACHED_bf)) ; PV_HDR_CACHED_bf
+
+    /* Ports of TCP and UDP only, not of fragments or other protocols */
+    immed[data, 0]
+    br_bset[BF_A(in_pkt_vec, PV_PROTO_bf), 2, ports#]
+    bitfield_extract__sz1(l4_offset, BF_AML(in_pkt_vec, PV_HEADER_OFFSET_INNER_L4_bf)) ; PV_HEADER_OFFSET_INNER_L4_bf
+    beq[ports#]
+
+    pv_seek(in_pkt_vec, l4_offset)
+
+    byte_align_be[--, *$index++]
+    byte_align_be[data, *$index++]
+
+ports#:
+    alu[*l$index3[NIC_ACL_KEY_PORTS_wrd], --, B, data]
+
+    pv_seek(in_pkt_vec, 0)
+
+    alu[*l$index3[ACTIONS_HDR_CACHE_MAC_wrd], 0, +16, *$index++]
+    alu[*l$index3[(ACTIONS_HDR_CACHE_MAC_wrd + 1)], --, B, *$index++]
+    alu[*l$index3[(ACTIONS_HDR_CACHE_MAC_wrd + 2)], --, B, *$index++]
+    alu[data, --, B, *$index, >>16]
+    alu[*l$index3[(ACTIONS_HDR_CACHE_MAC_wrd + 3)], --, B, data, <<16]
+
+    bitfield_extract__sz1(l3_offset, BF_AML(in_pkt_vec, PV_HEADER_OFFSET_INNER_IP_bf)) ; PV_HEADER_OFFSET_INNER_IP_bf
+    beq[no_l3#]
+
+    alu[l3_offset, l3_offset, +, (8 + 2)] // 8 bytes of IP header, 2 bytes seek align
+    alu[proto_delta, (1 << 2), AND, BF_A(in_pkt_vec, PV_PROTO_bf), <<1] // 4 bytes extra for IPv4
+    alu[l3_offset, l3_offset, +, proto_delta]
+    pv_seek(in_pkt_vec, l3_offset, PV_SEEK_PAD_INCLUDED)
+
+    byte_align_be[--, *$index++]
+    br_bset[BF_A(in_pkt_vec, PV_PROTO_bf), 1, ipv4#] // branch if IPv4
+
+    #define_eval LOOP (0)
+    #while (LOOP < 8)
+        byte_align_be[data, *$index++]
+        alu[*l$index3[(NIC_ACL_KEY_SRC_wrd + LOOP)], --, B, data]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    br[end#]
+
+ipv4#:
+    byte_align_be[data, *$index++]
+    alu[*l$index3[NIC_ACL_KEY_SRC_wrd], --, B, data]
+    byte_align_be[data, *$index++]
+    alu[*l$index3[NIC_ACL_KEY_DST_wrd], --, B, data]
+    #define_eval LOOP (1)
+    #while (LOOP < 4)
+        alu[*l$index3[(NIC_ACL_KEY_SRC_wrd + LOOP)], --, B, 0]
+        alu[*l$index3[(NIC_ACL_KEY_DST_wrd + LOOP)], --, B, 0]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    br[end#]
+
+no_l3#:
+    #define_eval LOOP (0)
+    #while (LOOP < 8)
+        alu[*l$index3[(NIC_ACL_KEY_SRC_wrd + LOOP)], --, B, 0]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+
+end#:
+.end
+#endm
+
+
 /* VEB lookup key:
  * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
  *       +-----------------------+-------+-------------------------------+
@@ -136,6 +333,12 @@ mem_lkup_init_hash_addr(g_mac_lkup_addr, _mac_lkup_tbl, HASH_OP_CAMR48_64B, 0, M
 .begin
     .reg ins_addr[2]
     .reg key_addr
+    #ifdef NIC_FLOW_CACHE
+        .reg cache_addr
+        .reg cache_key[2]
+        .reg cache_tag[3]
+    #endif
+    .reg hdr_addr
     .reg mac_hi
     .reg mac_lo
     .reg port_mac[2]
@@ -151,7 +354,11 @@ mem_lkup_init_hash_addr(g_mac_lkup_addr, _mac_lkup_tbl, HASH_OP_CAMR48_64B, 0, M
     __actions_read_end()
 
     br_bset[BF_AL(in_pkt_vec, PV_MAC_DST_MC_bf), end#]
-    pv_seek(in_pkt_vec, 0, PV_SEEK_DEFAULT, mac_match_check#)
+
+    /* Read the headers here, the lists of VEB entries rarely do without
+     * them and hashmap_ops overwrites the packet cache */
+    __actions_hdr_cache(hdr_addr, in_pkt_vec)
+    br[mac_match_check#]
 
 veb_error#:
     pv_stats_update(in_pkt_vec, RX_ERROR_VEB, DROP_LABEL)
@@ -170,8 +377,29 @@ veb_lookup#:
     bitfield_extract(vlan_id, BF_AML(in_pkt_vec, PV_VLAN_ID_bf))
     alu[vlan_id, --, B, vlan_id, <<20]
 
-    alu[*l$index0++, vlan_id, +16, *$index++]
-    alu[*l$index0, --, B, *$index]
+    #ifdef NIC_FLOW_CACHE
+        alu[cache_key[0], vlan_id, +16, *l$index3[ACTIONS_HDR_CACHE_MAC_wrd]]
+        alu[cache_key[1], --, B, *l$index3[(ACTIONS_HDR_CACHE_MAC_wrd + 1)]]
+        alu[*l$index0++, --, B, cache_key[0]]
+        alu[*l$index0, --, B, cache_key[1]]
+
+        /* A hit skips the map lookup and leaves the packet cache valid */
+        flow_cache_lookup(cache_addr, cache_tag, cache_key, veb_map_lookup#, veb_cache_stale#)
+        br[done#], defer[2]
+            .reg_addr __actions_t_idx 28 B
+            alu[__actions_t_idx, t_idx_ctx, OR, &$__actions[0], <<2]
+            nop
+
+veb_cache_stale#:
+        /* $__actions no longer holds the list this action is part of, so
+         * a map miss must not continue with it */
+        immed[port_mac[1], 1]
+
+veb_map_lookup#:
+    #else
+        alu[*l$index0++, vlan_id, +16, *l$index3[ACTIONS_HDR_CACHE_MAC_wrd]]
+        alu[*l$index0, --, B, *l$index3[(ACTIONS_HDR_CACHE_MAC_wrd + 1)]]
+    #endif
 
     #define HASHMAP_RXFR_COUNT 4
     #define MAP_RDXR $__pv_pkt_data
@@ -195,19 +423,29 @@ veb_hit#:
     //Load a new set of instructions as pointed by the returned address.
     //Note that from this point on the original instructions list is overwritten and
     //we no longer process instructions from current list.
+    __actions_chain_sync()
     ov_start(OV_LENGTH)
     ov_set_use(OV_LENGTH, 16, OVF_SUBTRACT_ONE)
     ov_clean()
     mem[read32, $__actions[0], ins_addr[0], <<8, ins_addr[1], max_16], indirect_ref, sig_done[sig_read]
 
-    ctx_arb[sig_read], defer[2], br[done#]
-        .reg_addr __actions_t_idx 28 B
-        alu[__actions_t_idx, t_idx_ctx, OR, &$__actions[0], <<2]
-        nop
+    #ifdef NIC_FLOW_CACHE
+        ctx_arb[sig_read]
+        flow_cache_insert(cache_addr, cache_tag)
+        br[done#], defer[2]
+            .reg_addr __actions_t_idx 28 B
+            alu[__actions_t_idx, t_idx_ctx, OR, &$__actions[0], <<2]
+            nop
+    #else
+        ctx_arb[sig_read], defer[2], br[done#]
+            .reg_addr __actions_t_idx 28 B
+            alu[__actions_t_idx, t_idx_ctx, OR, &$__actions[0], <<2]
+            nop
+    #endif
 
 mac_match_check#:
-    alu[mac_hi, port_mac[0], XOR, *$index++]
-    alu[mac_lo, port_mac[1], XOR, *$index--]
+    alu[mac_hi, port_mac[0], XOR, *l$index3[ACTIONS_HDR_CACHE_MAC_wrd]]
+    alu[mac_lo, port_mac[1], XOR, *l$index3[(ACTIONS_HDR_CACHE_MAC_wrd + 1)]]
     alu[--, mac_lo, OR, mac_hi, <<16]
     bne[veb_lookup#]
 
@@ -276,10 +514,11 @@ end#:
 
     //Read rest of action list from a new address
     alu[act_addr, $mac_lkup[0], AND~, 1, <<MAC_LKUP_IN_USE_bit]
+    __actions_chain_sync()
     ov_start(OV_LENGTH)
     ov_set_use(OV_LENGTH, 16, OVF_SUBTRACT_ONE)
     ov_clean()
-    cls[read, $__actions[0], 0, act_addr, max_16], indirect_ref, defer[2], ctx_swap[sig_actions]
+    cls[read, $__actions[0], __pkt_io_act_bank, act_addr, max_16], indirect_ref, defer[2], ctx_swap[sig_actions]
         .reg_addr __actions_t_idx 28 B
         alu[__actions_t_idx, t_idx_ctx, OR, &$__actions[0], <<2]
         nop
@@ -324,10 +563,11 @@ end#:
 
     //Read rest of action list from a new address
     alu[act_addr, $mac_lkup[0], AND~, 1, <<MAC_LKUP_IN_USE_bit]
+    __actions_chain_sync()
     ov_start(OV_LENGTH)
     ov_set_use(OV_LENGTH, 16, OVF_SUBTRACT_ONE)
     ov_clean()
-    cls[read, $__actions[0], 0, act_addr, max_16], indirect_ref, defer[2], ctx_swap[sig_actions]
+    cls[read, $__actions[0], __pkt_io_act_bank, act_addr, max_16], indirect_ref, defer[2], ctx_swap[sig_actions]
         .reg_addr __actions_t_idx 28 B
         alu[__actions_t_idx, t_idx_ctx, OR, &$__actions[0], <<2]
         nop
@@ -367,28 +607,99 @@ end#:
 #endm
 
 
+/* One input bit of a Toeplitz hash: if bit BIT of in_data, counting from
+ * the MSB, is set XOR in the 32 bit key window that starts at bit BIT of
+ * in_k0 and continues in in_k1 */
+#macro __actions_toeplitz_bit(io_hash, in_data, in_k0, in_k1, BIT)
+.begin
+    .reg window
+
+    br_bclr[in_data, (31 - BIT), skip#], defer[1]
+    #if (BIT == 0)
+        alu[window, --, B, in_k0]
+    #else
+        dbl_shf[window, in_k0, in_k1, >>(32 - BIT)]
+    #endif
+    alu[io_hash, io_hash, XOR, window]
+skip#:
+.end
+#endm
+
+
+/* Turn the table index bits of an RSS instruction into the address of the
+ * table in CLS, or its offset in the CTM table */
+#macro __actions_rss_table_addr(io_rss_table_addr)
+    #ifdef NIC_RSS_TBL_CTM
+        alu[io_rss_table_addr, --, B, io_rss_table_addr, <<(LOG2(NIC_RSS_TBL_ENTRIES) - BF_L(INSTR_RSS_TABLE_IDX_bf))]
+    #else
+        passert(NIC_RSS_TBL_ADDR, "POWER_OF_2")
+        passert(LOG2(NIC_RSS_TBL_ADDR), "GT", BF_M(INSTR_RSS_TABLE_IDX_bf))
+        alu[io_rss_table_addr, io_rss_table_addr, OR, 1, <<(log2(NIC_RSS_TBL_ADDR))]
+    #endif
+#endm
+
+
+/* Read the RSS table entry of the hash at *l$index2 to the top byte of
+ * out_row, moving index 2 past the hash, which stays as metadata */
+#macro __actions_rss_table_read(out_row, io_rss_table_addr, in_sig)
+.begin
+    .reg rss_table_idx
+
+#ifdef NIC_RSS_TBL_CTM
+    alu[rss_table_idx, --, B, *l$index2++, <<(32 - LOG2(NIC_RSS_TBL_ENTRIES))]
+    alu[rss_table_idx, io_rss_table_addr, OR, rss_table_idx, >>(32 - LOG2(NIC_RSS_TBL_ENTRIES))]
+    immed[io_rss_table_addr, (NIC_RSS_TBL >> 16), <<(16 - 8)]
+    mem[read8, out_row, io_rss_table_addr, <<8, rss_table_idx, 1], sig_done[in_sig]
+#else
+    alu[rss_table_idx, (NFP_NET_CFG_RSS_ITBL_SZ - 1), AND, *l$index2++]
+    cls[read, out_row, io_rss_table_addr, rss_table_idx, 1], sig_done[in_sig]
+#endif
+.end
+#endm
+
+
 #macro __actions_rss(in_pkt_vec)
 .begin
-    .reg args[2]
+    .reg age
+    .reg args[3]
     .reg data
+    .reg dst
+    .reg flow_id
+    .reg hash
     .reg hash_type
+    .reg hdr_addr
+    .reg k0
+    .reg k1
+    .reg key_base
     .reg l3_offset
     .reg l4_offset
     .reg l4_data
     .reg max_queue
+    .reg now
+    .reg num_words
     .reg process_l4
     .reg proto_delta
     .reg proto_shf
     .reg queue
+    .reg rfs_addr
+    .reg rfs_base
+    .reg rfs_tag
+    .reg rfs_way
     .reg rss_table_addr
-    .reg rss_table_idx
+    .reg src
+    .reg tuple_addr
     .reg write $metadata
+    .reg write $rfs_entry[NIC_RFS_ENTRY_LW]
+    .xfer_order $rfs_entry
     .reg read $rss_tbl_row
+    .sig rfs_sig
+    .sig rss_key_sig
     .sig rss_tbl_sig
 
     __actions_read_begin()
     __actions_read(args[0])
     __actions_read(args[1])
+    __actions_read(args[2])
     __actions_read_end()
 
     br_bset[BF_AL(in_pkt_vec, PV_QUEUE_SELECTED_bf), queue_selected#]
@@ -397,16 +708,15 @@ begin#:
     bitfield_extract__sz1(l3_offset, BF_AML(in_pkt_vec, PV_HEADER_OFFSET_INNER_IP_bf)) ; PV_HEADER_OFFSET_INNER_IP_bf
     beq[end#] // unknown L3
 
-    /* Read and cache L4 data first because seeking might context swap. The
-     * additional branch later to skip L4 when not required is cheaper than
-     * waiting for CRC instruction latencies to save and restore CRC state.
-     * The l4_offset is used as discriminator for processing L4. It is zero
+    /* The l4_offset is used as discriminator for processing L4. It is zero
      * in the packet vector if L4 is unrecognized and we set it to zero here
      * by masking out the bits if L4 is not configured for the packet. Note,
      * L4 will also be skipped for fragments since PV_PROTO is 7, effectively
      * disabling L4 by shifting the 4 configuration bits out of the register.
+     * The additional branch later to skip L4 when not required is cheaper
+     * than waiting for CRC instruction latencies to save and restore CRC
+     * state.
      */
-    .set l4_data
     bitfield_extract(process_l4, BF_AML(args, INSTR_RSS_CFG_PROTO_bf)) ; INSTR_RSS_CFG_PROTO_bf
     alu[hash_type, BF_A(in_pkt_vec, PV_PROTO_bf), B, 1] ; PV_PROTO_bf
     alu[process_l4, 1, AND~, process_l4, >>indirect] // 1 if L4 is disabled for proto
@@ -414,31 +724,29 @@ begin#:
     passert(BF_L(PV_HEADER_OFFSET_INNER_L4_bf), "EQ", 0)
     /* extract non-zero l4_offset if and only if L4 is valid and it is enabled */
     alu[l4_offset, BF_A(in_pkt_vec, PV_HEADER_OFFSET_INNER_L4_bf), AND, process_l4, >>(31 - BF_M(PV_HEADER_OFFSET_INNER_L4_bf))] ; PV_HEADER_OFFSET_INNER_L4_bf
-    beq[process_l3#], defer[3]
-        alu[l3_offset, l3_offset, +, (8 + 2)] // 8 bytes of IP header, 2 bytes seek align
-        alu[proto_delta, (1 << 2), AND, BF_A(in_pkt_vec, PV_PROTO_bf), <<1] // 4 bytes extra for IPv4
-        alu[l3_offset, l3_offset, +, proto_delta]
 
-    pv_seek(in_pkt_vec, l4_offset)
+    /* Reading the headers might context swap, so do it before setting up
+     * any CRC state */
+    __actions_hdr_cache(hdr_addr, in_pkt_vec)
 
-    byte_align_be[--, *$index++]
-    byte_align_be[l4_data, *$index++]
-
-process_l3#:
-    pv_seek(in_pkt_vec, l3_offset, PV_SEEK_PAD_INCLUDED)
+    /* Toeplitz and symmetric hashes work on a copy of the tuple, both
+     * flags are in the low byte of word 2 */
+    br!=byte[BF_A(args, INSTR_RSS_TOEPLITZ_bf), 0, 0, hash_tuple#], defer[1]
+        alu[l4_data, --, B, *l$index3[NIC_ACL_KEY_PORTS_wrd]]
 
     local_csr_wr[CRC_REMAINDER, BF_A(args, INSTR_RSS_KEY_bf)]
-    byte_align_be[--, *$index++]
-    byte_align_be[data, *$index++]
-    br_bset[BF_A(in_pkt_vec, PV_PROTO_bf), 1, process_l4#], defer[3] // branch if IPv4, 2 words hashed
-        crc_be[crc_32, --, data]
-        byte_align_be[data, *$index++]
-        crc_be[crc_32, --, data]
-
-    // hash 6 more words for IPv6
-    #define_eval LOOP (0)
-    #while (LOOP < 6)
-        byte_align_be[data, *$index++]
+    alu[data, --, B, *l$index3[NIC_ACL_KEY_SRC_wrd]]
+    br_bclr[BF_A(in_pkt_vec, PV_PROTO_bf), 1, crc_ipv6#], defer[1] // branch if IPv6, 8 words hashed
+        alu[dst, --, B, *l$index3[NIC_ACL_KEY_DST_wrd]]
+    crc_be[crc_32, --, data]
+    br[process_l4#], defer[1]
+        crc_be[crc_32, --, dst]
+
+crc_ipv6#:
+    crc_be[crc_32, --, data]
+    #define_eval LOOP (1)
+    #while (LOOP < 8)
+        alu[data, --, B, *l$index3[(NIC_ACL_KEY_SRC_wrd + LOOP)]]
         crc_be[crc_32, --, data]
         #define_eval LOOP (LOOP + 1)
     #endloop
@@ -459,16 +767,16 @@ process_l4#:
 
 skip_l4#:
     passert(BF_L(INSTR_RSS_TABLE_IDX_bf), "EQ", LOG2(NFP_NET_CFG_RSS_ITBL_SZ))
-    passert(NIC_RSS_TBL_ADDR, "POWER_OF_2")
-    passert(LOG2(NIC_RSS_TBL_ADDR), "GT", BF_M(INSTR_RSS_TABLE_IDX_bf))
-    alu[rss_table_addr, rss_table_addr, OR, 1, <<(log2(NIC_RSS_TBL_ADDR))]
+    __actions_rss_table_addr(rss_table_addr)
 
     local_csr_rd[CRC_REMAINDER]
     immed[*l$index2, 0]
 
-    /* Select queue = rss_tbl[hash % NFP_NET_CFG_RSS_ITBL_SZ] */
-    alu[rss_table_idx, (NFP_NET_CFG_RSS_ITBL_SZ - 1), AND, *l$index2++]
-    cls[read, $rss_tbl_row, rss_table_addr, rss_table_idx, 1], sig_done[rss_tbl_sig]
+hashed#:
+    br_bset[BF_AL(args, INSTR_RSS_RFS_bf), rfs#], defer[1]
+        alu[hash, --, B, *l$index2]
+
+    __actions_rss_table_read($rss_tbl_row, rss_table_addr, rss_tbl_sig)
     ctx_arb[rss_tbl_sig], defer[2], br[finalize#]
         pv_meta_push_type__sz1(in_pkt_vec, hash_type)
         bits_set__sz1(BF_AL(in_pkt_vec, PV_TX_HOST_RX_RSS_bf), 1)
@@ -482,11 +790,216 @@ queue_selected#:
     br[begin#], defer[1]
         pv_set_queue_offset__sz1(in_pkt_vec, 0)
 
+rfs#:
+    /* Read the bucket of the flow along with the RSS table entry, to the
+     * packet cache like the Toeplitz key, and take the flow ID from the
+     * tuple in the header cache meanwhile */
+    __actions_rss_table_read($rss_tbl_row, rss_table_addr, rss_tbl_sig)
+    pv_invalidate_cache(in_pkt_vec)
+    alu[flow_id, --, ~B, 0]
+    local_csr_wr[CRC_REMAINDER, flow_id]
+    alu[rfs_tag, BF_MASK(INSTR_RSS_TABLE_IDX_bf), AND, BF_A(args, INSTR_RSS_TABLE_IDX_bf), >>BF_L(INSTR_RSS_TABLE_IDX_bf)]
+    alu[rfs_addr, hash, XOR, rfs_tag]
+    alu[rfs_addr, --, B, rfs_addr, <<(32 - NIC_RFS_BUCKET_BITS)]
+    alu[rfs_addr, --, B, rfs_addr, >>(32 - NIC_RFS_BUCKET_BITS - NIC_RFS_BUCKET_SHF)]
+    passert(NIC_ACL_KEY_PORTS_wrd, "EQ", (NIC_ACL_KEY_SRC_wrd + 8))
+    #define_eval LOOP (NIC_ACL_KEY_SRC_wrd)
+    #while (LOOP <= NIC_ACL_KEY_PORTS_wrd)
+        alu[data, --, B, *l$index3[LOOP]]
+        crc_be[crc_iscsi, --, data], bit_swap
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    move(rfs_base, ((_nic_rfs_tbl >> 8) & 0xffffffff))
+    mem[read32, $__pv_pkt_data[0], rfs_base, <<8, rfs_addr, NIC_RFS_BUCKET_LW], sig_done[rfs_sig]
+
+    alu[rfs_tag, rfs_tag, OR, 1, <<(NIC_RFS_VALID_bit - NIC_RFS_TBL_shf)]
+    local_csr_rd[CRC_REMAINDER]
+    immed[flow_id, 0]
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[now, 0]
+    alu[now, --, B, now, >>NIC_RFS_STAMP_SHF]
+    pv_meta_push_type__sz1(in_pkt_vec, hash_type)
+    bits_set__sz1(BF_AL(in_pkt_vec, PV_TX_HOST_RX_RSS_bf), 1)
+    ctx_arb[rss_tbl_sig, rfs_sig]
+
+    /* A miss keeps the queue of the RSS table */
+    #define_eval LOOP (0)
+    #while (LOOP < NIC_RFS_WAYS)
+        alu[data, --, B, $__pv_pkt_data[((LOOP * NIC_RFS_ENTRY_LW) + 1)]]
+        alu[--, hash, XOR, $__pv_pkt_data[(LOOP * NIC_RFS_ENTRY_LW)]]
+        bne[rfs_next/**/LOOP#]
+        alu[--, flow_id, XOR, $__pv_pkt_data[((LOOP * NIC_RFS_ENTRY_LW) + NIC_RFS_FLOW_ID_wrd)]]
+        bne[rfs_next/**/LOOP#]
+        alu[--, rfs_tag, XOR, data, >>NIC_RFS_TBL_shf]
+        beq[rfs_hit#], defer[1]
+            immed[rfs_way, (LOOP * NIC_RFS_ENTRY_SZ)]
+rfs_next/**/LOOP#:
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    br[finalize#]
+
+rfs_hit#:
+    /* Expired entries miss, queues beyond the vNIC are left to RSS */
+    alu[age, now, -, data]
+    ld_field_w_clr[age, 0011, age]
+    alu[--, --, B, age, >>NIC_RFS_TIMEOUT_SHF]
+    bne[finalize#]
+    ld_field_w_clr[queue, 0001, data, >>NIC_RFS_QUEUE_shf]
+    bitfield_extract__sz1(max_queue, BF_AML(args, INSTR_RSS_MAX_QUEUE_bf))
+    alu[--, max_queue, -, queue]
+    blo[finalize#]
+
+    /* Refresh the stamp once every NIC_RFS_TOUCH */
+    alu[--, --, B, age, >>NIC_RFS_TOUCH_SHF]
+    beq[rfs_queue#]
+    alu[rfs_addr, rfs_addr, +, rfs_way]
+    ld_field[data, 0011, now]
+    alu[$rfs_entry[0], --, B, hash]
+    alu[$rfs_entry[1], --, B, data]
+    alu[$rfs_entry[2], --, B, flow_id]
+    immed[$rfs_entry[3], 0]
+    mem[write32, $rfs_entry[0], rfs_base, <<8, rfs_addr, NIC_RFS_ENTRY_LW], ctx_swap[rfs_sig]
+
+rfs_queue#:
+    __actions_restore_t_idx()
+
+    br_bset[BF_AL(args, INSTR_RSS_V1_META_bf), end#], defer[1]
+        ld_field[BF_A(in_pkt_vec, PV_QUEUE_OFFSET_bf), 0001, queue] ; PV_QUEUE_OFFSET_bf
+
+    br[end#], defer[1]
+        pv_meta_push_type__sz1(in_pkt_vec, NFP_NET_META_HASH) // RSSv2
+
+hash_tuple#:
+    /* Copy the addresses and ports to LM in hash order, the symmetric mode
+     * puts the lower port and the lower address first */
+    immed[tuple_addr, __actions_tuple]
+    alu[tuple_addr, tuple_addr, OR, t_idx_ctx, >>2]
+    local_csr_wr[ACTIVE_LM_ADDR_0, tuple_addr]
+
+    br_bclr[BF_AL(args, INSTR_RSS_SYMMETRIC_bf), tuple_l3#]
+    alu[src, --, B, l4_data, >>16]
+    ld_field_w_clr[dst, 0011, l4_data]
+    alu[--, dst, -, src]
+    bhs[tuple_l3#]
+    alu[l4_data, --, B, l4_data, >>rot16]
+
+tuple_l3#:
+    br_bset[BF_A(in_pkt_vec, PV_PROTO_bf), 1, tuple_ipv4#], defer[1] // branch if IPv4
+        immed[num_words, 2]
+
+    #define_eval LOOP (0)
+    #while (LOOP < 8)
+        alu[*l$index0[LOOP], --, B, *l$index3[(NIC_ACL_KEY_SRC_wrd + LOOP)]]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    alu[*l$index0[8], --, B, l4_data]
+    alu[hash_type, hash_type, +, 1]
+    br_bclr[BF_AL(args, INSTR_RSS_SYMMETRIC_bf), tuple_l4#], defer[1]
+        immed[num_words, 8]
+
+    /* Compare the addresses from the most significant word */
+    #define_eval LOOP (0)
+    #while (LOOP < 4)
+        alu[src, --, B, *l$index0[LOOP]]
+        alu[dst, --, B, *l$index0[(LOOP + 4)]]
+        alu[--, dst, -, src]
+        blo[tuple_ipv6_swap#]
+        bne[tuple_l4#]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    br[tuple_l4#]
+
+tuple_ipv6_swap#:
+    #define_eval LOOP (0)
+    #while (LOOP < 4)
+        alu[src, --, B, *l$index0[LOOP]]
+        alu[dst, --, B, *l$index0[(LOOP + 4)]]
+        alu[*l$index0[LOOP], --, B, dst]
+        alu[*l$index0[(LOOP + 4)], --, B, src]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    br[tuple_l4#]
+
+tuple_ipv4#:
+    alu[src, --, B, *l$index3[NIC_ACL_KEY_SRC_wrd]]
+    alu[dst, --, B, *l$index3[NIC_ACL_KEY_DST_wrd]]
+    br_bclr[BF_AL(args, INSTR_RSS_SYMMETRIC_bf), tuple_ipv4_write#]
+    alu[--, dst, -, src]
+    bhs[tuple_ipv4_write#]
+    alu[data, --, B, src]
+    alu[src, --, B, dst]
+    alu[dst, --, B, data]
+tuple_ipv4_write#:
+    alu[*l$index0[0], --, B, src]
+    alu[*l$index0[1], --, B, dst]
+    alu[*l$index0[2], --, B, l4_data]
+
+tuple_l4#:
+    br=byte[l4_offset, 0, 0, tuple_hash#]
+    alu[num_words, num_words, +, 1]
+    alu[proto_shf, BF_A(in_pkt_vec, PV_PROTO_bf), AND, 1]
+    alu[proto_delta, proto_shf, B, 3]
+    alu[proto_delta, --, B, proto_delta, <<indirect]
+    alu[hash_type, hash_type, +, proto_delta]
+
+tuple_hash#:
+    br_bset[BF_AL(args, INSTR_RSS_TOEPLITZ_bf), toeplitz#]
+
+    local_csr_wr[CRC_REMAINDER, BF_A(args, INSTR_RSS_KEY_bf)]
+crc_tuple#:
+    alu[data, --, B, *l$index0++]
+    alu[num_words, num_words, -, 1]
+    bne[crc_tuple#], defer[1]
+        crc_be[crc_32, --, data]
+
+    br[skip_l4#], defer[1]
+        alu[rss_table_addr, BF_A(args, INSTR_RSS_TABLE_IDX_bf), AND, BF_MASK(INSTR_RSS_TABLE_IDX_bf), <<BF_L(INSTR_RSS_TABLE_IDX_bf)]
+
+toeplitz#:
+    /* Read the key of the table to the packet cache, walk it with T_INDEX
+     * and the tuple with LM index 0 */
+    pv_invalidate_cache(in_pkt_vec)
+    alu[k0, BF_MASK(INSTR_RSS_TABLE_IDX_bf), AND, BF_A(args, INSTR_RSS_TABLE_IDX_bf), >>BF_L(INSTR_RSS_TABLE_IDX_bf)]
+    alu[k0, --, B, k0, <<(log2(NIC_RSS_KEY_STRIDE))]
+    move(key_base, NIC_RSS_KEY_TBL_ADDR)
+    cls[read, $__pv_pkt_data[0], key_base, k0, NIC_RSS_KEY_LW], ctx_swap[rss_key_sig]
+
+    alu[k0, t_idx_ctx, OR, &$__pv_pkt_data[0], <<2]
+    local_csr_wr[T_INDEX, k0]
+    immed[hash, 0]
+    nop
+    nop
+    alu[k1, --, B, *$index++]
+
+toeplitz_word#:
+    alu[k0, --, B, k1]
+    alu[k1, --, B, *$index++]
+    alu[data, --, B, *l$index0++]
+    #define_eval LOOP (0)
+    #while (LOOP < 32)
+        __actions_toeplitz_bit(hash, data, k0, k1, LOOP)
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    alu[num_words, num_words, -, 1]
+    bne[toeplitz_word#]
+
+    alu[rss_table_addr, BF_A(args, INSTR_RSS_TABLE_IDX_bf), AND, BF_MASK(INSTR_RSS_TABLE_IDX_bf), <<BF_L(INSTR_RSS_TABLE_IDX_bf)]
+    br[hashed#], defer[2]
+        __actions_rss_table_addr(rss_table_addr)
+        alu[*l$index2, --, B, hash]
+
 finalize#:
     __actions_restore_t_idx()
 
     br_bset[BF_AL(args, INSTR_RSS_V1_META_bf), end#], defer[1]
-        /* CLS doesn't provide read8, required byte is in the top 8 bits */
+        /* CLS doesn't provide read8, required byte is in the top 8 bits,
+         * as it is for a CTM read8 */
         ld_field[BF_A(in_pkt_vec, PV_QUEUE_OFFSET_bf), 0001, $rss_tbl_row, >>24]; PV_QUEUE_OFFSET_bf
 
     pv_meta_push_type__sz1(in_pkt_vec, NFP_NET_META_HASH) // RSSv2
@@ -496,19 +1009,54 @@ end#:
 #endm
 
 
+/* out_flags is 3 if the checksum in_field of the packet matches in_csum,
+ * calculated by __actions_checksum, else 2. The sender may send a zero
+ * checksum as 0xffff, in_csum never is 0xffff. */
+#macro __actions_csum_match(out_flags, in_csum, in_field)
+.begin
+    .reg diff
+
+    alu[diff, in_csum, XOR, in_field]
+    alu[diff, --, B, diff, <<16]
+    beq[end#], defer[1]
+        immed[out_flags, 3]
+
+    alu[diff, diff, +, 1, <<16]
+    bne[end#], defer[1]
+        immed[out_flags, 2]
+    alu[--, --, B, in_csum, <<16]
+    bne[end#]
+    immed[out_flags, 3]
+
+end#:
+.end
+#endm
+
+
+/* State bits of __actions_checksum beyond those of INSTR_CHECKSUM: the
+ * pending validations of the inner L4 and L3 checksums, and the mark of
+ * the work that validates rather than updates a checksum */
+#define ACTIONS_CSUM_VALIDATING     5
+#define ACTIONS_CSUM_VAL_L4         6
+#define ACTIONS_CSUM_VAL_L3         7
+
+
 #macro __actions_checksum(in_pkt_vec)
 .begin
+    .reg ahead
     .reg available_words
     .reg buf_offset
     .reg carries
     .reg cbs
     .reg checksum
+    .reg crc
     .reg csum_complete
     .reg csum_offset
     .reg data
     .reg data_history
     .reg data_len
     .reg encap
+    .reg field
     .reg idx
     .reg ihl
     .reg include_mask
@@ -532,10 +1080,13 @@ end#:
     .reg shift
     .reg split_offset
     .reg state
+    .reg tibi
     .reg tmp
     .reg work
     .reg zero_padded
     .reg write $checksum
+    .sig sig_half0
+    .sig sig_half1
     .sig sig_read
     .sig sig_write
 
@@ -549,10 +1100,40 @@ end#:
     __actions_read(state, 0xffff)
 
     passert(BF_L(PV_CSUM_OFFLOAD_bf), "EQ", 0)
-    alu[msk, BF_A(in_pkt_vec, PV_CSUM_OFFLOAD_bf), OR, 1, <<BF_L(INSTR_CSUM_META_bf)]
+    passert(BF_L(INSTR_CSUM_VAL_bf), "EQ", 4)
+    passert(BF_L(INSTR_CSUM_SCTP_bf), "EQ", 5)
+    passert(BF_L(INSTR_CSUM_META_bf), "EQ", 8)
+    // the S bit, like c, is kept if the host requested the L4 checksum
+    alu[tmp, 0xf, AND, BF_A(in_pkt_vec, PV_CSUM_OFFLOAD_bf)]
+    alu[msk, tmp, OR, 0x11, <<4]
+    alu[msk, msk, OR, tmp, <<BF_L(INSTR_CSUM_SCTP_bf)]
     alu[state, state, AND, msk]
     beq[end#]
 
+    // SCTP has a CRC32c in place of the L4 checksum and is parsed as an
+    // unknown L4 of a packet that is not tunnelled
+    alu[tmp, BF_A(in_pkt_vec, PV_PROTO_bf), AND, (PROTO_FRAG | (7 << PROTO_ENCAP_SHF))]
+    alu[--, tmp, XOR, PROTO_L4_UNKNOWN]
+    bne[not_sctp#]
+    alu[--, state, AND, ((1 << BF_L(INSTR_CSUM_SCTP_bf)) | (1 << BF_L(INSTR_CSUM_VAL_bf)) | (1 << BF_L(INSTR_CSUM_OL4_bf)))]
+    bne[sctp#]
+
+not_sctp#:
+    // the MAC takes care of the other checksums if only S is set
+    alu[state, state, AND~, 1, <<BF_L(INSTR_CSUM_SCTP_bf)]
+    beq[end#]
+
+    // only the inner headers of tunnelled packets are validated
+    br_bclr[state, BF_L(INSTR_CSUM_VAL_bf), sum#]
+    br=byte[BF_A(in_pkt_vec, PV_PROTO_bf), 0, PROTO_UNKNOWN, no_validate#]
+    alu[--, (7 << PROTO_ENCAP_SHF), AND, BF_A(in_pkt_vec, PV_PROTO_bf)]
+    bne[sum#]
+
+no_validate#:
+    alu[state, state, AND~, 1, <<BF_L(INSTR_CSUM_VAL_bf)]
+    beq[end#]
+
+sum#:
     immed[checksum, 0]
     immed[carries, 0]
 
@@ -577,6 +1158,14 @@ w/**/LOOP_UNROLL#:
     alu[carries, carries, +carry, 0] // accumulate carries that would be lost to looping construct alu[]s
 
 start#:
+    // stream aligned 64B chunks while at least two remain
+    alu[tmp, remaining_words, -, iteration_words]
+    alu[--, tmp, -, (2 * 16)]
+    blt[seek#]
+    alu[--, offset, AND, 0x3f]
+    beq[stream#]
+
+seek#:
     pv_seek(idx, in_pkt_vec, offset, PV_SEEK_PAD_INCLUDED, --)
 
     alu[remaining_words, remaining_words, -, iteration_words]
@@ -597,6 +1186,55 @@ consume_available#:
         alu[iteration_bytes, --, B, iteration_words, <<2]
         alu[offset, offset, +, iteration_bytes]
 
+stream#:
+    // the chunks alternate between the halves of the packet cache, the next
+    // one read while the other half is summed
+    pv_read_ahead(in_pkt_vec, offset, 0, sig_half0, seek#)
+    br[stream_half0#], defer[3]
+        pv_invalidate_cache(in_pkt_vec)
+        alu[remaining_words, --, B, tmp]
+        immed[iteration_words, 0]
+
+#define_eval _CSUM_HALF (0)
+#while (_CSUM_HALF < 2)
+    #define_eval _CSUM_OTHER (1 - _CSUM_HALF)
+stream_half/**/_CSUM_HALF#:
+    alu[--, remaining_words, -, (2 * 16)]
+    blt[sum_half/**/_CSUM_HALF#], defer[1]
+        immed[ahead, 0]
+
+    alu[ahead, offset, +, 64]
+    pv_read_ahead(in_pkt_vec, ahead, _CSUM_OTHER, sig_half/**/_CSUM_OTHER, no_ahead_half/**/_CSUM_HALF#)
+    br[sum_half/**/_CSUM_HALF#]
+
+no_ahead_half/**/_CSUM_HALF#:
+    immed[ahead, 0]
+
+sum_half/**/_CSUM_HALF#:
+    ctx_arb[sig_half/**/_CSUM_HALF]
+    alu[tibi, t_idx_ctx, OR, (_CSUM_HALF * 64)]
+    local_csr_wr[T_INDEX_BYTE_INDEX, tibi]
+    alu[remaining_words, remaining_words, -, 16]
+    nop
+    alu[offset, offset, +, 64]
+    #define_eval LOOP (0)
+    #while (LOOP < 16)
+        alu[checksum, checksum, +carry, *$index++]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    alu[carries, carries, +carry, 0]
+
+    // continue with the chunk read ahead, if any, else seek
+    alu[--, --, B, ahead]
+    bne[stream_half/**/_CSUM_OTHER#]
+    br[start#]
+
+    #define_eval _CSUM_HALF (_CSUM_HALF + 1)
+#endloop
+#undef _CSUM_OTHER
+#undef _CSUM_HALF
+
 update_l4_csum#:
     // finalize pending checksum
     alu[checksum, checksum, +carry, 0]
@@ -604,6 +1242,30 @@ update_l4_csum#:
     // extract work from state
     alu[work, --, B, state, >>24]
 
+    // inner addresses from the header copy if an action has read it
+    br_bclr[work, BF_L(INSTR_CSUM_IL4_bf), seek_l3#]
+    br_bclr[BF_AL(in_pkt_vec, PV_HDR_CACHED_bf), seek_l3#]
+
+    immed[tmp, __actions_hdr_cache]
+    alu[tmp, tmp, OR, t_idx_ctx, >>2]
+    local_csr_wr[ACTIVE_LM_ADDR_3, tmp]
+
+    alu[checksum, --, ~B, checksum]
+    alu[checksum, csum_complete, +, checksum]
+    alu[checksum, checksum, +carry, l4_len]
+    alu[checksum, checksum, +carry, l4_proto]
+
+    // IPv4 addresses are followed by zeros
+#define_eval LOOP (0)
+#while (LOOP < 7)
+    alu[checksum, checksum, +carry, *l$index3[(NIC_ACL_KEY_SRC_wrd + LOOP)]]
+#define_eval LOOP (LOOP + 1)
+#endloop
+    br[write_csum#], defer[1]
+        alu[checksum, checksum, +carry, *l$index3[(NIC_ACL_KEY_SRC_wrd + LOOP)]]
+#undef LOOP
+
+seek_l3#:
     // seek to L3 source address for pseudo-header
     pv_seek(in_pkt_vec, ip_offset)
 
@@ -655,6 +1317,14 @@ check_work#:
     alu[work, state, AND, (1 << BF_L(INSTR_CSUM_OL3_bf))]
     bne[process_l3#]
 
+    alu[work, state, AND, (1 << ACTIONS_CSUM_VAL_L4)]
+    bne[validate_l4#]
+
+    alu[work, state, AND, (1 << ACTIONS_CSUM_VAL_L3)]
+    bne[validate_l3#]
+
+    br_bset[state, BF_L(INSTR_CSUM_VAL_bf), validate#]
+
     // no more work
     __actions_restore_t_idx()
     pv_invalidate_cache(in_pkt_vec)
@@ -663,6 +1333,25 @@ check_work#:
         alu[*l$index2++, --, B, csum_complete]
         pv_meta_push_type__sz1(in_pkt_vec, NFP_NET_META_CSUM)
 
+validate#:
+    // the checksums of the innermost headers, once any updates are done
+    br_bset[BF_AL(in_pkt_vec, PV_PROTO_L4_UNKNOWN_bf), validate_ipv4#], defer[1]
+        alu[state, state, AND~, 1, <<BF_L(INSTR_CSUM_VAL_bf)]
+    alu[state, state, OR, 1, <<ACTIONS_CSUM_VAL_L4]
+
+validate_ipv4#:
+    br_bclr[BF_AL(in_pkt_vec, PV_PROTO_IPV4_bf), check_work#]
+    br[check_work#], defer[1]
+        alu[state, state, OR, 1, <<ACTIONS_CSUM_VAL_L3]
+
+validate_l4#:
+    br[process_l4#], defer[1]
+        alu[work, work, OR, ((1 << ACTIONS_CSUM_VALIDATING) | (1 << BF_L(INSTR_CSUM_IL4_bf)))]
+
+validate_l3#:
+    br[process_l3#], defer[1]
+        alu[work, work, OR, ((1 << ACTIONS_CSUM_VALIDATING) | (1 << BF_L(INSTR_CSUM_IL3_bf)))]
+
 process_l4#:
     // determine L4 offset (inner / outer)
     alu[shift, 16, AND~, work, <<(4 - BF_L(INSTR_CSUM_IL4_bf))] // 16 if outer, else 0
@@ -759,7 +1448,8 @@ write_csum#:
     alu[tmp, tmp, +16, checksum] // top half-word is 16-bit carry, bottom is checksum
     alu[checksum, --, B, tmp, <<16] // move checksum to top half-word
     alu[checksum, checksum, +, tmp] // add carry to checksum
-    alu[checksum, --, ~B, checksum, >>16]
+    br_bset[work, ACTIONS_CSUM_VALIDATING, validated#], defer[1]
+        alu[checksum, --, ~B, checksum, >>16]
 
     br_bclr[BF_AL(in_pkt_vec, PV_CTM_ALLOCATED_bf), write_mu#], defer[3]
         alu[$checksum, --, B, checksum, <<16]
@@ -784,10 +1474,200 @@ write_mu#:
         alu[csum_complete, csum_complete, +16, checksum]
         alu[csum_complete, csum_complete, +carry, 0]
 
+validated#:
+    // the packet keeps its checksum, put it back into csum_complete
+    alu[field, --, ~B, neg_csum_field]
+    alu[csum_complete, csum_complete, +16, field]
+    alu[csum_complete, csum_complete, +carry, 0]
+    br_bset[work, BF_L(INSTR_CSUM_IL3_bf), validated_l3#], defer[1]
+        alu[state, state, AND~, work]
+
+    // a zero UDP checksum was not calculated by the sender
+    br_bclr[BF_AL(in_pkt_vec, PV_PROTO_UDP_bf), validated_l4#]
+    alu[--, --, B, field, <<16]
+    beq[check_work#]
+
+validated_l4#:
+    // 2 if checked, 3 if also correct, at the TCP flags or the UDP flags
+    // two bits below
+    alu[shift, (1 << 1), AND, BF_A(in_pkt_vec, PV_PROTO_bf), <<1] // 2 if UDP, else 0
+    alu[shift, BF_L(PV_TX_HOST_I_CSUM_TCP_OK_bf), -, shift]
+    __actions_csum_match(tmp, checksum, field)
+    alu[--, shift, OR, 0]
+    br[check_work#], defer[1]
+        alu[BF_A(in_pkt_vec, PV_TX_HOST_I_TCP_bf), BF_A(in_pkt_vec, PV_TX_HOST_I_TCP_bf), OR, tmp, <<indirect]
+
+validated_l3#:
+    passert(BF_L(PV_TX_HOST_I_IP4_bf), "EQ", (BF_L(PV_TX_HOST_I_CSUM_IP4_OK_bf) + 1))
+    __actions_csum_match(tmp, checksum, field)
+    br[check_work#], defer[1]
+        alu[BF_A(in_pkt_vec, PV_TX_HOST_I_IP4_bf), BF_A(in_pkt_vec, PV_TX_HOST_I_IP4_bf), OR, tmp, <<BF_L(PV_TX_HOST_I_CSUM_IP4_OK_bf)]
+
 invalid_offset#:
     br[check_work#], defer[1]
         alu[state, state, AND~, work]
 
+sctp#:
+    // SCTP directly after the IP header, IPv6 extension headers are not
+    // followed
+    bitfield_extract__sz1(ip_offset, BF_AML(in_pkt_vec, PV_HEADER_OFFSET_INNER_IP_bf)) ; PV_HEADER_OFFSET_INNER_IP_bf
+    beq[sctp_done#]
+
+    pv_seek(in_pkt_vec, ip_offset)
+    byte_align_be[--, *$index++]
+    byte_align_be[data, *$index++]
+    br_bclr[BF_AL(in_pkt_vec, PV_PROTO_IPV4_bf), sctp_ipv6#], defer[1]
+        byte_align_be[tmp, *$index++]
+
+    byte_align_be[tmp, *$index++]
+    br!=byte[tmp, IPV4_PROTOCOL_BYTE, IP_PROTOCOL_SCTP, sctp_done#], defer[2]
+        alu[ihl, (0xf << 2), AND, data, >>(BF_L(IPV4_HEAD_LEN_bf) - 2)]
+        alu[l4_len, 0, +16, data]
+    br[sctp_len#], defer[2]
+        alu[l4_len, l4_len, -, ihl]
+        alu[l4_offset, ip_offset, +, ihl]
+
+sctp_ipv6#:
+    br!=byte[tmp, IPV6_NEXT_HEADER_BYTE, IP_PROTOCOL_SCTP, sctp_done#], defer[2]
+        alu[l4_len, --, B, tmp, >>BF_L(IPV6_PAYLOAD_LENGTH_bf)]
+        alu[l4_offset, ip_offset, +, IPV6_HDR_SIZE]
+
+sctp_len#:
+    // SCTP pads its chunks to whole words, anything else is left to the host
+    alu[--, l4_len, AND, 3]
+    bne[sctp_done#]
+    alu[remaining_words, l4_len, -, SCTP_HDR_SIZE]
+    blt[sctp_done#]
+    pv_get_length(pkt_len, in_pkt_vec)
+    alu[tmp, l4_offset, +, l4_len]
+    alu[--, pkt_len, -, tmp]
+    blt[sctp_done#]
+    alu[offset, l4_offset, +, 2]
+    alu[--, offset, AND, 3]
+    bne[sctp_done#]
+
+    // the CRC covers the common header with a zero checksum, followed by
+    // the chunks
+    pv_seek(in_pkt_vec, offset, PV_SEEK_PAD_INCLUDED)
+    alu[crc, --, ~B, 0]
+    local_csr_wr[CRC_REMAINDER, crc]
+    alu[data, --, B, *$index++]
+    alu[tmp, --, B, *$index++]
+    alu[field, --, B, *$index++]
+    crc_be[crc_iscsi, --, data], bit_swap
+    crc_be[crc_iscsi, --, tmp], bit_swap
+    immed[data, 0]
+    crc_be[crc_iscsi, --, data], bit_swap
+    alu[remaining_words, --, B, remaining_words, >>2]
+    alu[offset, offset, +, SCTP_HDR_SIZE]
+
+sctp_next#:
+    // the CRC unit is shared by the contexts, keep the remainder in crc
+    // while pv_seek might swap out, it trails the last crc_be[]
+    nop
+    nop
+    local_csr_rd[CRC_REMAINDER]
+    immed[crc, 0]
+    alu[--, --, B, remaining_words]
+    beq[sctp_crc#]
+
+    pv_seek(idx, in_pkt_vec, offset, PV_SEEK_PAD_INCLUDED, --)
+    local_csr_wr[CRC_REMAINDER, crc]
+
+    alu[available_words, 32, -, idx]
+    alu[--, available_words, -, remaining_words]
+    bmi[sctp_consume#]
+
+    alu[idx, 32, -, remaining_words]
+
+sctp_consume#:
+    jump[idx, c0#], targets[c0#,  c1#,  c2#,  c3#,  c4#,  c5#,  c6#,  c7#,
+                            c8#,  c9#,  c10#, c11#, c12#, c13#, c14#, c15#,
+                            c16#, c17#, c18#, c19#, c20#, c21#, c22#, c23#,
+                            c24#, c25#, c26#, c27#, c28#, c29#, c30#, c31#], defer[3]
+        alu[iteration_words, 32, -, idx]
+        alu[remaining_words, remaining_words, -, iteration_words]
+        alu[iteration_bytes, --, B, iteration_words, <<2]
+
+#define_eval LOOP_UNROLL (0)
+#while (LOOP_UNROLL < 32)
+c/**/LOOP_UNROLL#:
+    crc_be[crc_iscsi, --, *$index++], bit_swap
+    #define_eval LOOP_UNROLL (LOOP_UNROLL + 1)
+#endloop
+#undef LOOP_UNROLL
+
+    br[sctp_next#], defer[1]
+        alu[offset, offset, +, iteration_bytes]
+
+sctp_crc#:
+    // the remainder is of the bytes in reflected bit order, the checksum
+    // is its complement reflected, stored least significant byte first,
+    // which leaves the bits of each byte to reverse
+    move(msk, 0x55555555)
+    alu[tmp, msk, AND, crc, >>1]
+    alu[crc, crc, AND, msk]
+    alu[crc, tmp, OR, crc, <<1]
+    move(msk, 0x33333333)
+    alu[tmp, msk, AND, crc, >>2]
+    alu[crc, crc, AND, msk]
+    alu[crc, tmp, OR, crc, <<2]
+    move(msk, 0x0f0f0f0f)
+    alu[tmp, msk, AND, crc, >>4]
+    alu[crc, crc, AND, msk]
+    alu[crc, tmp, OR, crc, <<4]
+
+    alu[--, state, AND, ((1 << BF_L(INSTR_CSUM_SCTP_bf)) | (1 << BF_L(INSTR_CSUM_OL4_bf)))]
+    bne[sctp_write#], defer[1]
+        alu[crc, --, ~B, crc]
+
+    // validated, reported like a TCP checksum
+    alu[--, crc, XOR, field]
+    bne[sctp_done#], defer[1]
+        alu[BF_A(in_pkt_vec, PV_TX_HOST_SCTP_bf), BF_A(in_pkt_vec, PV_TX_HOST_SCTP_bf), OR, 1, <<BF_L(PV_TX_HOST_SCTP_bf)]
+    br[sctp_done#], defer[1]
+        alu[BF_A(in_pkt_vec, PV_TX_HOST_CSUM_SCTP_OK_bf), BF_A(in_pkt_vec, PV_TX_HOST_CSUM_SCTP_OK_bf), OR, 1, <<BF_L(PV_TX_HOST_CSUM_SCTP_OK_bf)]
+
+sctp_write#:
+    // in halves, which like the 16 bit checksums never straddle the split
+    // of the packet between CTM and MU
+    alu[csum_offset, l4_offset, +, SCTP_CHECKSUM_OFFS]
+    immed[iteration_words, 2]
+
+sctp_write_half#:
+    br_bclr[BF_AL(in_pkt_vec, PV_CTM_ALLOCATED_bf), sctp_write_mu#], defer[2]
+        alu[$checksum, --, B, crc]
+        alu[buf_offset, csum_offset, +16, BF_A(in_pkt_vec, PV_OFFSET_bf)]
+
+    bitfield_extract__sz1(cbs, BF_AML(in_pkt_vec, PV_CBS_bf)) ; PV_CBS_bf
+    alu[split_offset, cbs, B, 1, <<8]
+    alu[split_offset, --, B, split_offset, <<indirect]
+    alu[--, split_offset, -, buf_offset]
+    ble[sctp_write_mu#]
+
+    mem[write8, $checksum, BF_A(in_pkt_vec, PV_CTM_ADDR_bf), csum_offset, 2], ctx_swap[sig_write]
+    br[sctp_written_half#]
+
+sctp_write_mu#:
+    alu[mu_addr, --, B, BF_A(in_pkt_vec, PV_MU_ADDR_bf), <<(31 - BF_M(PV_MU_ADDR_bf))]
+    mem[write8, $checksum, mu_addr, <<8, buf_offset, 2], ctx_swap[sig_write]
+
+sctp_written_half#:
+    alu[iteration_words, iteration_words, -, 1]
+    bne[sctp_write_half#], defer[2]
+        alu[csum_offset, csum_offset, +, 2]
+        alu[crc, --, B, crc, <<16]
+
+sctp_written#:
+    pv_invalidate_cache(in_pkt_vec)
+
+sctp_done#:
+    // nothing else to update or validate at L4
+    alu[state, state, AND~, ((1 << BF_L(INSTR_CSUM_SCTP_bf)) | (1 << BF_L(INSTR_CSUM_VAL_bf)) | (1 << BF_L(INSTR_CSUM_OL4_bf)))]
+    bne[sum#]
+    __actions_restore_t_idx()
+    br[end#]
+
 last_bits#:
     alu[last_bits, (3 << 3), AND, data_len, <<3]
     beq[finalize#]
@@ -813,6 +1693,44 @@ end#:
 #endm
 
 
+/* Read the Ethernet addresses of the packet at in_addr_hi/in_addr_lo to
+ * out_mac[0..2], from the header copy if an action has read it. */
+#macro __actions_mac_read(out_mac, in_pkt_vec, in_addr_hi, in_addr_lo)
+.begin
+    .reg lm_addr
+    .reg mac[4]
+    .sig sig_read
+
+    br_bclr[BF_AL(in_pkt_vec, PV_HDR_CACHED_bf), read#], defer[2]
+        immed[lm_addr, __actions_hdr_cache]
+        alu[lm_addr, lm_addr, OR, t_idx_ctx, >>2]
+
+    local_csr_wr[ACTIVE_LM_ADDR_3, lm_addr]
+    nop
+    nop
+    nop
+    #define_eval LOOP (0)
+    #while (LOOP < 4)
+        alu[mac[LOOP], --, B, *l$index3[(ACTIONS_HDR_CACHE_MAC_wrd + LOOP)]]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    dbl_shf[out_mac[0], mac[0], mac[1], >>16]
+    br[end#], defer[2]
+        dbl_shf[out_mac[1], mac[1], mac[2], >>16]
+        dbl_shf[out_mac[2], mac[2], mac[3], >>16]
+
+read#:
+    mem[read32, $__pv_pkt_data[0], in_addr_hi, <<8, in_addr_lo, 3], ctx_swap[sig_read]
+    alu[out_mac[0], --, B, $__pv_pkt_data[0]]
+    alu[out_mac[1], --, B, $__pv_pkt_data[1]]
+    alu[out_mac[2], --, B, $__pv_pkt_data[2]]
+
+end#:
+.end
+#endm
+
+
 #macro __actions_pop_vlan(io_pkt_vec)
 .begin
     .reg msk
@@ -823,18 +1741,13 @@ end#:
     .reg write $mac[3]
     .xfer_order $mac
     .sig sig_write
-    .sig sig_read
 
     __actions_read()
 
     pv_get_base_addr(addr_hi, addr_lo, io_pkt_vec)
-    mem[read32, $__pv_pkt_data[0], addr_hi, <<8, addr_lo, 3], ctx_swap[sig_read], defer[2]
-        alu[addr_lo, addr_lo, +, 4]
-	    pv_invalidate_cache(io_pkt_vec)
-
-    alu[$mac[0], --, B, $__pv_pkt_data[0]]
-    alu[$mac[1], --, B, $__pv_pkt_data[1]]
-    alu[$mac[2], --, B, $__pv_pkt_data[2]]
+    __actions_mac_read($mac, io_pkt_vec, addr_hi, addr_lo)
+    alu[addr_lo, addr_lo, +, 4]
+    pv_invalidate_cache(io_pkt_vec)
 
     mem[write32, $mac[0], addr_hi, <<8, addr_lo, 3], ctx_swap[sig_write], defer[2]
         alu[BF_A(io_pkt_vec, PV_LENGTH_bf), BF_A(io_pkt_vec, PV_LENGTH_bf), -, 4]
@@ -877,18 +1790,13 @@ end#:
     .reg write $mac[4]
     .xfer_order $mac
     .sig sig_write
-    .sig sig_read
 
     __actions_read(vlan_tag, 0xffff)
 
     pv_get_base_addr(addr_hi, addr_lo, io_pkt_vec)
-    mem[read32, $__pv_pkt_data[0], addr_hi, <<8, addr_lo, 3], ctx_swap[sig_read], defer[2]
-        alu[addr_lo, addr_lo, -, 4]
-	    pv_invalidate_cache(io_pkt_vec)
-
-    alu[$mac[0], --, B, $__pv_pkt_data[0]]
-    alu[$mac[1], --, B, $__pv_pkt_data[1]]
-    alu[$mac[2], --, B, $__pv_pkt_data[2]]
+    __actions_mac_read($mac, io_pkt_vec, addr_hi, addr_lo)
+    alu[addr_lo, addr_lo, -, 4]
+    pv_invalidate_cache(io_pkt_vec)
     alu[$mac[3], vlan_tag, or, 0x81, <<24]
 
     mem[write32, $mac[0], addr_hi, <<8, addr_lo, 4], ctx_swap[sig_write], defer[2]
@@ -922,20 +1830,413 @@ end#:
 #endm
 
 
+/* out_credit = (in_elapsed * in_rate) >> NIC_METER_RATE_SHF, saturated to
+ * 32 bits */
+#macro __actions_meter_credit(out_credit, in_elapsed, in_rate)
+.begin
+    .reg prod_hi
+    .reg prod_lo
+
+    mul_step[in_elapsed, in_rate], 32x32_start
+    mul_step[in_elapsed, in_rate], 32x32_step1
+    mul_step[in_elapsed, in_rate], 32x32_step2
+    mul_step[in_elapsed, in_rate], 32x32_step3
+    mul_step[in_elapsed, in_rate], 32x32_step4
+    mul_step[prod_lo, --], 32x32_last
+    mul_step[prod_hi, --], 32x32_last2
+
+    alu[--, --, B, prod_hi, >>NIC_METER_RATE_SHF]
+    beq[end#], defer[1]
+        dbl_shf[out_credit, prod_hi, prod_lo, >>NIC_METER_RATE_SHF]
+    alu[out_credit, --, ~B, 0]
+
+end#:
+.end
+#endm
+
+
+/* Set the outer IP DSCP of a yellow packet to the DSCP field of in_args.
+ * The IPv4 header checksum is updated incrementally (RFC 1624), packets
+ * without an outer IP header are left alone. */
+#macro __actions_meter_mark(in_pkt_vec, in_args)
+.begin
+    .reg addr_hi
+    .reg addr_lo
+    .reg dscp
+    .reg ip_w0
+    .reg ip_w1
+    .reg ip_w2
+    .reg l3_offset
+    .reg m_new
+    .reg sum
+    .reg tmp
+    .reg write $ip[3]
+    .xfer_order $ip
+    .sig sig_write
+
+    bitfield_extract__sz1(l3_offset, BF_AML(in_pkt_vec, PV_HEADER_OFFSET_OUTER_IP_bf)) ; PV_HEADER_OFFSET_OUTER_IP_bf
+    beq[end#]
+
+    pv_seek(in_pkt_vec, l3_offset)
+
+    byte_align_be[--, *$index++]
+    byte_align_be[ip_w0, *$index++]
+    byte_align_be[ip_w1, *$index++]
+    byte_align_be[ip_w2, *$index++]
+
+    pv_get_base_addr(addr_hi, addr_lo, in_pkt_vec)
+    alu[addr_lo, addr_lo, +, l3_offset]
+    alu[dscp, BF_MASK(INSTR_METER_DSCP_bf), AND, in_args, >>BF_L(INSTR_METER_DSCP_bf)]
+
+    alu[tmp, --, B, ip_w0, >>28]
+    alu[--, tmp, -, 6]
+    beq[ipv6#]
+    alu[--, tmp, -, 4]
+    bne[done#]
+
+    /* IPv4 DSCP is bits 23:18, HC' = ~(~HC + ~m + m') where m is the
+     * first 16 bit word of the header */
+    alu[tmp, ip_w0, AND~, 0x3f, <<18]
+    alu[tmp, tmp, OR, dscp, <<18]
+    alu[$ip[0], --, B, tmp]
+    alu[$ip[1], --, B, ip_w1]
+    alu[m_new, --, B, tmp, >>16]
+    alu[tmp, --, ~B, ip_w2]
+    alu[sum, 0, +16, tmp]
+    alu[tmp, --, ~B, ip_w0, >>16]
+    alu[sum, sum, +16, tmp]
+    alu[sum, sum, +, m_new]
+    alu[tmp, --, B, sum, >>16]
+    alu[sum, tmp, +16, sum]
+    alu[tmp, --, B, sum, >>16]
+    alu[sum, tmp, +16, sum]
+    alu[tmp, --, ~B, sum]
+    ld_field[ip_w2, 0011, tmp]
+    alu[$ip[2], --, B, ip_w2]
+
+    mem[write8, $ip[0], addr_hi, <<8, addr_lo, 12], ctx_swap[sig_write]
+    br[done#]
+
+ipv6#:
+    /* IPv6 DSCP is bits 27:22 */
+    alu[tmp, ip_w0, AND~, 0x3f, <<22]
+    alu[$ip[0], tmp, OR, dscp, <<22]
+    mem[write8, $ip[0], addr_hi, <<8, addr_lo, 4], ctx_swap[sig_write]
+
+done#:
+    pv_invalidate_cache(in_pkt_vec)
+    __actions_restore_t_idx()
+
+end#:
+.end
+#endm
+
+
+/* INSTR_METER: police the packet with a _nic_meter_tbl entry, see
+ * app_config_meter.h. Red packets, and yellow packets if M is clear,
+ * branch to DROP_LABEL. */
+#macro __actions_meter(in_pkt_vec, DROP_LABEL)
+.begin
+    .reg addr_hi
+    .reg addr_lo
+    .reg args
+    .reg credit_c
+    .reg credit_p
+    .reg elapsed
+    .reg len
+    .reg now
+    .reg rate
+    .reg tmp
+    .reg read $cfg[4] // PBS, CBS, PIR, CIR
+    .xfer_order $cfg
+    .reg $deficit[2]
+    .xfer_order $deficit
+    .reg $ts
+    .sig sig_cfg
+    .sig sig_meter
+
+    __actions_read(args, 0xffff)
+
+    passert(NIC_METER_DP_wrd, "EQ", 0)
+    passert(NIC_METER_DC_wrd, "EQ", 1)
+    passert(NIC_METER_PBS_wrd, "EQ", 4)
+
+    br_bclr[args, BF_L(INSTR_METER_QUEUE_bf), entry#], defer[1]
+        alu[addr_lo, args, AND, BF_MASK(INSTR_METER_INDEX_bf)]
+    alu[addr_lo, BF_MASK(INSTR_METER_INDEX_bf), AND, BF_A(in_pkt_vec, PV_QUEUE_IN_bf), >>BF_L(PV_QUEUE_IN_bf)] ; PV_QUEUE_IN_bf
+
+entry#:
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[now, 0]
+    move(addr_hi, ((_nic_meter_tbl >> 8) & 0xffffffff))
+    alu[addr_lo, --, B, addr_lo, <<NIC_METER_ENTRY_SHF]
+
+    /* Take the ticks since the last packet, and the configuration */
+    alu[$ts, --, B, now]
+    alu[tmp, addr_lo, +, (NIC_METER_TS_wrd * 4)]
+    mem[swap, $ts, addr_hi, <<8, tmp, 1], sig_done[sig_meter]
+    alu[tmp, addr_lo, +, (NIC_METER_PBS_wrd * 4)]
+    mem[read32, $cfg[0], addr_hi, <<8, tmp, 4], sig_done[sig_cfg]
+    pv_get_length(len, in_pkt_vec)
+    ctx_arb[sig_meter, sig_cfg], defer[1]
+        alu[len, --, B, len, <<NIC_METER_FRAC_SHF]
+
+    alu[elapsed, now, -, $ts]
+    beq[add#]
+    alu[--, 0xff, -, elapsed, >>NIC_METER_SKEW_SHF]
+    beq[add#]
+
+    /* Drain both buckets */
+    alu[rate, --, B, $cfg[2]]
+    __actions_meter_credit(credit_p, elapsed, rate)
+    alu[rate, --, B, $cfg[3]]
+    __actions_meter_credit(credit_c, elapsed, rate)
+    alu[--, credit_p, OR, credit_c]
+    beq[add#]
+    alu[$deficit[0], --, B, credit_p]
+    alu[$deficit[1], --, B, credit_c]
+    mem[test_subsat, $deficit[0], addr_hi, <<8, addr_lo, 2], ctx_swap[sig_meter]
+
+add#:
+    /* Add the packet to both, the write transfer registers keep the
+     * length for the undo below */
+    alu[$deficit[0], --, B, len]
+    alu[$deficit[1], --, B, len]
+    mem[test_add, $deficit[0], addr_hi, <<8, addr_lo, 2], ctx_swap[sig_meter]
+
+    alu[tmp, $deficit[0], +, len]
+    alu[--, $cfg[0], -, tmp]
+    blo[red#]
+    alu[tmp, $deficit[1], +, len]
+    alu[--, $cfg[1], -, tmp]
+    bhs[end#]
+    br_bclr[args, BF_L(INSTR_METER_MARK_bf), red#]
+
+    /* Yellow */
+    alu[tmp, addr_lo, +, (NIC_METER_DC_wrd * 4)]
+    mem[sub, $deficit[1], addr_hi, <<8, tmp, 1], ctx_swap[sig_meter]
+    __actions_meter_mark(in_pkt_vec, args)
+    br[end#]
+
+red#:
+    mem[sub, $deficit[0], addr_hi, <<8, addr_lo, 2], ctx_swap[sig_meter]
+    br[DROP_LABEL]
+
+end#:
+.end
+#endm
+
+
+/* Send the head of the packet to the control vNIC if the pseudo random
+ * number is within the threshold, see app_config_sample.h. The sample
+ * shares the buffer like a multicast TX_HOST, the packet continues. */
+#macro __actions_sample(io_pkt_vec)
+.begin
+    .reg addr_hi
+    .reg addr_lo
+    .reg bls
+    .reg buf_sz
+    .reg cntr
+    .reg len
+    .reg offset
+    .reg rand
+    .reg snaplen
+    .reg thresh
+    .reg tmp
+    .reg read $nfd_credits
+    .reg write $hdr[4]
+    .xfer_order $hdr
+    .reg write $nfd_desc[4]
+    .xfer_order $nfd_desc
+    .sig sig_hdr
+    .sig sig_nfd
+
+    __actions_read(snaplen, 0xffff)
+    __actions_read(thresh)
+    local_csr_rd[PSEUDO_RANDOM_NUMBER]
+    immed[rand, 0]
+    alu[--, thresh, -, rand]
+    blo[end#]
+
+    move(cntr, ((_nic_sample_cntrs >> 8) & 0xffffffff))
+    bitfield_extract(offset, BF_AML(io_pkt_vec, PV_OFFSET_bf))
+    alu[--, offset, -, NIC_SAMPLE_MIN_OFFSET]
+    blo[no_room#]
+
+    alu[addr_hi, --, B, ((__NFD_DIRECT_ACCESS | NFD_PCIE_ISL_BASE) + NIC_PCI), <<24]
+    immed[addr_lo, (NFD_CTRL_QUEUE << log2(NFD_OUT_ATOMICS_SZ))]
+    ov_single(OV_IMMED8, 1)
+    mem[test_subsat_imm, $nfd_credits, addr_hi, <<8, addr_lo, 1], indirect_ref, ctx_swap[sig_nfd]
+    alu[--, --, B, $nfd_credits]
+    beq[no_credit#]
+
+    /* Share the buffer with the original */
+    bitfield_extract__sz1(bls, BF_AML(io_pkt_vec, PV_BLS_bf)) ; PV_BLS_bf
+    br=byte[bls, 0, 3, resend#]
+    pv_multicast_init(io_pkt_vec, bls, resend#)
+resend#:
+    pv_multicast_resend(io_pkt_vec)
+
+    pv_get_length(len, io_pkt_vec)
+    alu[--, snaplen, -, len]
+    blo[header#]
+    alu[snaplen, --, B, len]
+
+header#:
+    immed[tmp, ((CMSG_TYPE_SAMPLE << 8) | CMSG_MAP_VERSION), <<16]
+    alu[$hdr[0], tmp, OR, BF_A(io_pkt_vec, PV_QUEUE_IN_bf), >>BF_L(PV_QUEUE_IN_bf)] ; PV_QUEUE_IN_bf
+    alu[$hdr[1], NIC_SAMPLE_PAD_SZ, OR, len, <<16]
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[tmp, 0]
+    alu[$hdr[2], --, B, tmp]
+    alu[$hdr[3], --, B, 0]
+    pv_get_base_addr(addr_hi, addr_lo, io_pkt_vec)
+    alu[addr_lo, addr_lo, -, NIC_SAMPLE_HEADROOM]
+    mem[write32, $hdr[0], addr_hi, <<8, addr_lo, 4], sig_done[sig_hdr]
+
+    /* The message starts NIC_SAMPLE_HEADROOM bytes before the packet, in
+     * the cmsg_reply format: no metadata, no offload flags */
+    immed[addr_lo, nfd_out_ring_info]
+    #ifdef PV_MULTI_PCI
+        alu[addr_lo, addr_lo, OR, NIC_PCI, <<(log2(NFD_OUT_RING_INFO_ITEM_SZ))]
+    #endif
+    local_csr_wr[ACTIVE_LM_ADDR_0, addr_lo]
+    alu[buf_sz, snaplen, +, NIC_SAMPLE_HEADROOM]
+    pv_get_nfd_host_desc($nfd_desc, io_pkt_vec, NIC_SAMPLE_HEADROOM)
+    pv_update_nfd_desc_queue($nfd_desc, io_pkt_vec, buf_sz, 0, NFD_CTRL_QUEUE)
+    alu[$nfd_desc[NFD_OUT_FLAGS_wrd], --, B, 0]
+
+    alu[addr_hi, *l$index0, AND, 0xff, <<24]
+    ld_field_w_clr[addr_lo, 0011, *l$index0]
+    ctx_arb[sig_hdr]
+    mem[qadd_work, $nfd_desc[0], addr_hi, <<8, addr_lo, 4], sig_done[sig_nfd]
+    mem[incr64, --, cntr, <<8, (NIC_SAMPLE_CNTR_TX * 8)]
+    ctx_arb[sig_nfd], br[end#]
+
+no_credit#:
+    mem[incr64, --, cntr, <<8, (NIC_SAMPLE_CNTR_NO_CREDIT * 8)]
+    br[end#]
+
+no_room#:
+    mem[incr64, --, cntr, <<8, (NIC_SAMPLE_CNTR_NO_ROOM * 8)]
+
+end#:
+.end
+#endm
+
+
+/* Look the inner 5-tuple up in the ACL_TID hashmap and apply the action
+ * of the matching rule, see app_config_acl.h. Misses pass. */
+#macro __actions_acl(io_pkt_vec, DROP_LABEL)
+.begin
+    .reg action
+    .reg args
+    .reg cntr
+    .reg data
+    .reg flags
+    .reg key_addr
+    .reg l3_offset
+    .reg max_queue
+    .reg proto
+    .reg queue
+    .reg tid
+    .reg val_addr[2]
+    .reg vlan_id
+    .reg read $acl_val
+    .sig sig_read
+
+    __actions_read_begin()
+    __actions_read(args, 0xffff)
+    __actions_read(flags)
+    __actions_read_end()
+
+    bitfield_extract__sz1(l3_offset, BF_AML(io_pkt_vec, PV_HEADER_OFFSET_INNER_IP_bf)) ; PV_HEADER_OFFSET_INNER_IP_bf
+    beq[end#] // unknown L3
+
+    /* The header copy is the key, other protocols and fragments (bit 2 of
+     * PV_PROTO) keyed without ports, all but the first word */
+    __actions_hdr_cache(key_addr, io_pkt_vec)
+
+    alu[proto, BF_A(io_pkt_vec, PV_PROTO_bf), AND, NIC_ACL_PROTO_MASK]
+    br_bclr[flags, BF_L(INSTR_ACL_VLAN_bf), key_table#], defer[1]
+        alu[data, --, B, args, >>BF_L(INSTR_ACL_TABLE_bf)]
+    bitfield_extract__sz1(vlan_id, BF_AML(io_pkt_vec, PV_VLAN_ID_bf)) ; PV_VLAN_ID_bf
+    alu[proto, proto, OR, vlan_id, <<NIC_ACL_KEY_VLAN_shf]
+
+key_table#:
+    alu[*l$index3[0], proto, OR, data, <<NIC_ACL_KEY_TABLE_shf]
+    alu[tid, --, B, ACL_TID]
+
+    #define HASHMAP_RXFR_COUNT 16
+    #define MAP_RDXR $__pv_pkt_data
+    // hashmap_ops will overwrite the packet cache, we MUST invalidate
+    pv_invalidate_cache(io_pkt_vec)
+    hashmap_ops(tid,
+                key_addr,
+                --,
+                HASHMAP_OP_LOOKUP,
+                miss#, // ACL_TID not allocated
+                miss#,
+                HASHMAP_RTN_ADDR,
+                --,
+                --,
+                val_addr,
+                swap)
+    #undef MAP_RDXR
+    #undef HASHMAP_RXFR_COUNT
+
+    /* The value is stored as written by the host, like the key */
+    mem[read32_swap, $acl_val, val_addr[0], <<8, val_addr[1], 1], ctx_swap[sig_read]
+    alu[action, --, B, $acl_val, >>NIC_ACL_ACT_shf]
+    alu[queue, NIC_ACL_QUEUE_msk, AND, $acl_val]
+
+    move(cntr, ((_nic_acl_cntrs >> 8) & 0xffffffff))
+    alu[action, action, AND, (NIC_ACL_CNTRS - 1)]
+    alu[data, --, B, action, <<3]
+    mem[incr64, --, cntr, <<8, data]
+
+    alu[--, action, -, NIC_ACL_ACT_DROP]
+    beq[DROP_LABEL]
+    alu[--, action, -, NIC_ACL_ACT_STEER]
+    bne[miss#]
+
+    /* Steering beyond the queues of the vNIC leaves the choice to RSS */
+    alu[max_queue, args, AND, BF_MASK(INSTR_ACL_MAX_QUEUE_bf)]
+    alu[--, max_queue, -, queue]
+    blo[miss#]
+    pv_set_queue_offset__sz1(io_pkt_vec, queue)
+    bits_set__sz1(BF_AL(io_pkt_vec, PV_QUEUE_SELECTED_bf), 1)
+
+miss#:
+    __actions_restore_t_idx()
+
+end#:
+.end
+#endm
+
+
+#macro actions_init()
+    immed[__actions_chain_pending, 0]
+    actions_profile_init()
+#endm
+
+
 #macro actions_load(in_act_addr)
 .begin
     .reg pkt_vec_addr
     .sig sig_actions
 
+    __actions_chain_sync()
     ov_start(OV_LENGTH)
     ov_set_use(OV_LENGTH, 16, OVF_SUBTRACT_ONE)
     ov_clean()
-    cls[read, $__actions[0], 0, in_act_addr, max_16], indirect_ref, defer[2], ctx_swap[sig_actions]
+    cls[read, $__actions[0], __pkt_io_act_bank, in_act_addr, max_16], indirect_ref, defer[2], ctx_swap[sig_actions]
         .reg_addr __actions_t_idx 28 B
         alu[__actions_t_idx, t_idx_ctx, OR, &$__actions[0], <<2]
         alu[pkt_vec_addr, (PV_META_BASE_wrd * 4), OR, t_idx_ctx, >>(8 - log2((PV_SIZE_LW * 4 * PV_MAX_CLONES), 1))]
 
     pv_reset(pkt_vec_addr, in_act_addr, __actions_t_idx, (NIC_MAX_INSTR *4))
+    actions_profile_start()
 
 .end
 #endm
@@ -948,28 +2249,24 @@ end#:
     .reg tx_args
 
 next#:
+    /* The opcode field holds the offset of the handler from
+     * default_drop#, generated at build time from the .list file by
+     * parse_list.py (see cfg_act_map in app_config_tables.c), so dispatch
+     * is a single jump. A pipelined action falls through from
+     * __actions_next() into the handler that follows in code store; keep
+     * non-handler code out of the handler block below. */
     alu[jump_idx, --, B, *$index, >>INSTR_OPCODE_LSB]
-    jump[jump_idx, ins_0#], targets[ins_0#, ins_1#, ins_2#, ins_3#, ins_4#, ins_5#, ins_6#, ins_7#, ins_8#, ins_9#, ins_10#, ins_11#, ins_12#, ins_13#, ins_14#, ins_15#, ins_16#, ins_17#, ins_18#]
-
-    ins_0#: br[drop_act#]
-    ins_1#: br[rx_wire#]
-    ins_2#: br[mac_dst_match#]
-    ins_3#: br[checksum#]
-    ins_4#: br[rss#]
-    ins_5#: br[tx_host#]
-    ins_6#: br[rx_host#]
-    ins_7#: br[tx_wire#]
-    ins_8#: br[cmsg#]
-    ins_9#: br[ebpf#]
-    ins_10#: br[pop_vlan#]
-    ins_11#: br[push_vlan#]
-    ins_12#: br[mac_src_match#]
-    ins_13#: br[veb_lookup#]
-    ins_14#: br[pkt_pop#]
-    ins_15#: br[pkt_push#]
-    ins_16#: br[tx_vlan#]
-    ins_17#: br[l2_switch_wire#]
-    ins_18#: br[l2_switch_host#]
+    jump[jump_idx, default_drop#], targets[default_drop#, default_rx_wire#, default_rx_host#, drop_act#, rx_wire#, mac_dst_match#, checksum#, rss#, tx_host#, rx_host#, tx_wire#, cmsg#, ebpf#, pop_vlan#, push_vlan#, mac_src_match#, veb_lookup#, pkt_pop#, pkt_push#, tx_vlan#, l2_switch_wire#, l2_switch_host#, chain#, meter#, sample#, acl#]
+
+    /* Fixed offsets used by the default NIC_CFG_INSTR_TBL lists, which
+     * are initialised before the handler offsets are known, see
+     * INSTR_DEFAULT_DROP in app_config_instr.h */
+default_drop#:
+    br[drop_act#]
+default_rx_wire#:
+    br[rx_wire#]
+default_rx_host#:
+    br[rx_host#]
 
 error_pkt_stack#:
     pv_stats_update(io_pkt_vec, ERROR_PKT_STACK, drop#)
@@ -977,87 +2274,130 @@ error_pkt_stack#:
 drop_mismatch#:
     pv_stats_update(io_pkt_vec, RX_DISCARD_ADDR, drop#)
 
+drop_meter#:
+drop_acl#:
+    pv_stats_update(io_pkt_vec, RX_DISCARD_ACT, drop#)
+
 drop_act#:
+    __actions_profile(INSTR_DROP)
     pv_stats_update(io_pkt_vec, RX_DISCARD_ACT, drop#)
 
 rx_wire#:
+    __actions_profile(INSTR_RX_WIRE)
     __actions_rx_wire(io_pkt_vec)
     __actions_next()
 
 mac_dst_match#:
+    __actions_profile(INSTR_DST_MAC_MATCH)
     __actions_dst_mac_match(io_pkt_vec, drop_mismatch#)
     __actions_next()
 
+acl#:
+    __actions_profile(INSTR_ACL)
+    __actions_acl(io_pkt_vec, drop_acl#)
+    __actions_next()
+
 checksum#:
+    __actions_profile(INSTR_CHECKSUM)
     __actions_checksum(io_pkt_vec)
     __actions_next()
 
 rss#:
+    __actions_profile(INSTR_RSS)
     __actions_rss(io_pkt_vec)
     __actions_next()
 
+sample#:
+    __actions_profile(INSTR_SAMPLE)
+    __actions_sample(io_pkt_vec)
+    __actions_next()
+
 tx_host#:
+    __actions_profile(INSTR_TX_HOST)
     __actions_read(tx_args, 0xffff)
     pkt_io_tx_host(io_pkt_vec, tx_args, EGRESS_LABEL)
     __actions_restore_t_idx()
     __actions_next()
 
 rx_host#:
+    __actions_profile(INSTR_RX_HOST)
     __actions_rx_host(io_pkt_vec, drop#)
     __actions_next()
 
 tx_wire#:
+    __actions_profile(INSTR_TX_WIRE)
     __actions_read(tx_args, 0xffff)
     pkt_io_tx_wire(io_pkt_vec, tx_args, EGRESS_LABEL)
     __actions_restore_t_idx()
     __actions_next()
 
 pop_vlan#:
+    __actions_profile(INSTR_POP_VLAN)
     __actions_pop_vlan(io_pkt_vec)
     __actions_next()
 
 push_vlan#:
+    __actions_profile(INSTR_PUSH_VLAN)
     __actions_push_vlan(io_pkt_vec)
     __actions_next()
 
 mac_src_match#:
+    __actions_profile(INSTR_SRC_MAC_MATCH)
     __actions_src_mac_match(io_pkt_vec, drop_mismatch#)
     __actions_next()
 
+meter#:
+    __actions_profile(INSTR_METER)
+    __actions_meter(io_pkt_vec, drop_meter#)
+    __actions_next()
+
 veb_lookup#:
+    __actions_profile(INSTR_VEB_LOOKUP)
     __actions_veb_lookup(io_pkt_vec, drop#)
     __actions_next()
 
 pkt_pop#:
+    __actions_profile(INSTR_POP_PKT)
     __actions_read()
     pv_pop(io_pkt_vec, error_pkt_stack#)
     __actions_next()
 
 pkt_push#:
+    __actions_profile(INSTR_PUSH_PKT)
     __actions_read()
     pv_push(io_pkt_vec, error_pkt_stack#)
     __actions_restore_t_idx()
     __actions_next()
 
 tx_vlan#:
+    __actions_profile(INSTR_TX_VLAN)
     __actions_read()
     pkt_io_tx_vlan(io_pkt_vec, EGRESS_LABEL)
 
 cmsg#:
+    __actions_profile(INSTR_CMSG)
     cmsg_desc_workq($__pkt_io_gro_meta, io_pkt_vec, EGRESS_LABEL)
 
 ebpf#:
+    __actions_profile(INSTR_EBPF)
     __actions_read(ebpf_addr, 0xffff)
     ebpf_call(io_pkt_vec, ebpf_addr)
 
 l2_switch_wire#:
+    __actions_profile(INSTR_L2_SWITCH_WIRE)
     __actions_l2_switch_wire(io_pkt_vec, drop_mismatch#)
     __actions_next()
 
 l2_switch_host#:
+    __actions_profile(INSTR_L2_SWITCH_HOST)
     __actions_l2_switch_host(io_pkt_vec)
     __actions_next()
 
+chain#:
+    __actions_profile(INSTR_CHAIN)
+    __actions_chain()
+    __actions_next()
+
 .end
 #endm
 
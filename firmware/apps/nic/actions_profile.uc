@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc.  All rights reserved.
+ *
+ * @file   actions_profile.uc
+ * @brief  Per action handler invocation and cycle counters
+ *
+ * When built with ACTIONS_PROFILE_ENABLE, every action handler in
+ * actions_execute() counts its invocations and the TIMESTAMP_LOW ticks
+ * (16 ME cycles each) spent until the next handler or the end of the
+ * packet. The counters are kept in local memory, shared by the contexts of
+ * the ME, and are added to the exported _actions_profile table from the
+ * epoch handler in pkt_io_rx(), at most once every
+ * (1 << ACTIONS_PROFILE_FLUSH_SHF) ticks. scripts/actions_profile.py
+ * decodes the table.
+ *
+ * _actions_profile holds ACTIONS_PROFILE_ME_SZ bytes per ME, indexed by
+ * ((island & 7) << 4 | ME master ID). Each ME has a pair of 64 bit
+ * counters per action opcode (INSTR_*):
+ *
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +---------------------------------------------------------------+
+ *    0  |                   Invocations (low word)                      |
+ *       +---------------------------------------------------------------+
+ *    1  |                   Invocations (high word)                     |
+ *       +---------------------------------------------------------------+
+ *    2  |                 TIMESTAMP_LOW ticks (low word)                |
+ *       +---------------------------------------------------------------+
+ *    3  |                 TIMESTAMP_LOW ticks (high word)               |
+ *       +---------------------------------------------------------------+
+ *
+ * Each context times its own handlers, the slot and start time of the
+ * running handler are context-relative registers. A handler is counted
+ * when it completes, and its ticks include the time its context spends
+ * swapped out. The local memory copy uses l$index0, which the
+ * handlers only use after setting it up themselves.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _ACTIONS_PROFILE_UC
+#define _ACTIONS_PROFILE_UC
+
+#include <stdmac.uc>
+#include <passert.uc>
+
+#include "app_config_instr.h"
+
+/* Profiled opcodes, INSTR_ACL is the last one */
+#define ACTIONS_PROFILE_OPS         (INSTR_ACL + 1)
+#define ACTIONS_PROFILE_ME_SZ       512
+#define ACTIONS_PROFILE_FLUSH_SHF   16
+
+#ifdef ACTIONS_PROFILE_ENABLE
+
+passert(((ACTIONS_PROFILE_OPS + 1) / 2 * 2 * 16), "LE", ACTIONS_PROFILE_ME_SZ)
+
+/* Counters in LM, the slot after the last opcode absorbs the time between
+ * the end of a packet and the first handler of the next one. The last
+ * word holds the TIMESTAMP_LOW of the last flush. */
+#define ACTIONS_PROFILE_LM_SZ       256
+#define ACTIONS_PROFILE_LM_IDLE     (ACTIONS_PROFILE_OPS * 8)
+#define ACTIONS_PROFILE_LM_FLUSH    (ACTIONS_PROFILE_LM_SZ - 4)
+
+passert((ACTIONS_PROFILE_LM_IDLE + 16), "LE", ACTIONS_PROFILE_LM_FLUSH)
+
+#define ACTIONS_PROFILE_ME_IDX      (((__ISLAND & 0x7) << 4) | (__MEID & 0xf))
+#define ACTIONS_PROFILE_ME_ADDR     (_actions_profile + \
+                                     (ACTIONS_PROFILE_ME_IDX * \
+                                      ACTIONS_PROFILE_ME_SZ))
+
+.alloc_mem _actions_profile_lm lmem me ACTIONS_PROFILE_LM_SZ \
+    ACTIONS_PROFILE_LM_SZ
+.alloc_mem _actions_profile emem global (128 * ACTIONS_PROFILE_ME_SZ) 256
+
+/* LM address of the counters of the handler this context is running and
+ * the TIMESTAMP_LOW at which it started */
+.reg volatile __actions_profile_slot
+.reg volatile __actions_profile_ts
+
+#endif
+
+
+/* Clear the counters and start the flush interval, the counters are
+ * shared by all contexts and cleared by context 0 */
+#macro actions_profile_init()
+#ifdef ACTIONS_PROFILE_ENABLE
+.begin
+    .reg loop
+
+    immed[__actions_profile_slot, (_actions_profile_lm + ACTIONS_PROFILE_LM_IDLE)]
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[__actions_profile_ts, 0]
+
+    .if (ctx() == 0)
+        local_csr_wr[ACTIVE_LM_ADDR_0, _actions_profile_lm]
+        immed[loop, (ACTIONS_PROFILE_LM_FLUSH / 4)]
+        nop
+        nop
+    clear_loop#:
+        alu[loop, loop, -, 1]
+        bne[clear_loop#], defer[1]
+            alu[*l$index0++, --, B, 0]
+        alu[*l$index0, --, B, __actions_profile_ts]
+    .endif
+.end
+#endif
+#endm
+
+
+/* Start timing a new packet, the time until the first handler is
+ * accounted to the idle slot */
+#macro actions_profile_start()
+#ifdef ACTIONS_PROFILE_ENABLE
+    immed[__actions_profile_slot, (_actions_profile_lm + ACTIONS_PROFILE_LM_IDLE)]
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[__actions_profile_ts, 0]
+#endif
+#endm
+
+
+/* Complete the running handler and start timing the handler for opcode
+ * IN_OP, place at the entry of each handler in actions_execute() */
+#macro __actions_profile(IN_OP)
+#ifdef ACTIONS_PROFILE_ENABLE
+.begin
+    .reg delta
+    .reg now
+
+    local_csr_wr[ACTIVE_LM_ADDR_0, __actions_profile_slot]
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[now, 0]
+    alu[delta, now, -, __actions_profile_ts]
+    alu[__actions_profile_ts, --, B, now]
+    alu[*l$index0, *l$index0, +, 1]
+    alu[*l$index0[1], *l$index0[1], +, delta]
+    immed[__actions_profile_slot, (_actions_profile_lm + (IN_OP * 8))]
+.end
+#endif
+#endm
+
+
+/* Complete the running handler at the end of a packet */
+#macro actions_profile_end()
+#ifdef ACTIONS_PROFILE_ENABLE
+    __actions_profile(ACTIONS_PROFILE_OPS)
+#endif
+#endm
+
+
+/* Add the counters of this ME to _actions_profile and clear them, if
+ * the flush interval has passed. The counters are cleared as they are
+ * copied, so handlers completing on other contexts while this context
+ * waits for the writes are counted in the next flush. */
+#macro actions_profile_flush()
+#ifdef ACTIONS_PROFILE_ENABLE
+.begin
+    .reg addr_hi
+    .reg addr_lo
+    .reg elapsed
+    .reg loop
+    .reg now
+    .reg write $cntr[8]
+    .xfer_order $cntr
+    .sig sig_flush
+
+    local_csr_wr[ACTIVE_LM_ADDR_0, (_actions_profile_lm + ACTIONS_PROFILE_LM_FLUSH)]
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[now, 0]
+    move(addr_hi, ((ACTIONS_PROFILE_ME_ADDR >> 8) & 0xffffffff))
+    alu[elapsed, now, -, *l$index0]
+    alu[--, --, B, elapsed, >>ACTIONS_PROFILE_FLUSH_SHF]
+    beq[end#]
+
+    alu[*l$index0, --, B, now]
+    local_csr_wr[ACTIVE_LM_ADDR_0, _actions_profile_lm]
+    immed[loop, ((ACTIONS_PROFILE_OPS + 1) / 2)]
+    immed[addr_lo, 0]
+    nop
+
+flush_loop#:
+    alu[$cntr[0], --, B, *l$index0]
+    alu[*l$index0++, --, B, 0]
+    alu[$cntr[2], --, B, *l$index0]
+    alu[*l$index0++, --, B, 0]
+    alu[$cntr[4], --, B, *l$index0]
+    alu[*l$index0++, --, B, 0]
+    alu[$cntr[6], --, B, *l$index0]
+    alu[*l$index0++, --, B, 0]
+    immed[$cntr[1], 0]
+    immed[$cntr[3], 0]
+    immed[$cntr[5], 0]
+    immed[$cntr[7], 0]
+    mem[add64, $cntr[0], addr_hi, <<8, addr_lo, 4], defer[1], ctx_swap[sig_flush]
+        alu[loop, loop, -, 1]
+    bne[flush_loop#], defer[1]
+        alu[addr_lo, addr_lo, +, 32]
+
+end#:
+.end
+#endif
+#endm
+
+#endif
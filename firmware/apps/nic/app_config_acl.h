@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file          apps/nic/app_config_acl.h
+ * @brief         Stateless 5-tuple access control list used by INSTR_ACL
+ *
+ * INSTR_ACL looks the inner 5-tuple of a packet up in the ACL_TID hashmap
+ * (see maps/cmsg_map_types.h), which the map ME allocates at start up.
+ * Rules are added, replaced, removed and listed with the CMSG_TYPE_MAP_*
+ * control messages used for eBPF maps, with ACL_TID as the map id. Key
+ * and value are given as 32 bit words in host byte order:
+ *
+ * Key
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +-------------------------------+-----------------------+-+-----+
+ *    0  |          ACL table            |        VLAN ID        |0|Proto|
+ *       +-------------------------------+-----------------------+-+-----+
+ *  1-4  |                        Source address                         |
+ *       +---------------------------------------------------------------+
+ *  5-8  |                     Destination address                       |
+ *       +-------------------------------+-------------------------------+
+ *    9  |         Source port           |       Destination port        |
+ *       +-------------------------------+-------------------------------+
+ *
+ * Value
+ *       +---------------+-------------------------------+---------------+
+ *    0  |    Action     |               0               |     Queue     |
+ *       +---------------+-------------------------------+---------------+
+ *    1  |                           Reserved                            |
+ *       +---------------------------------------------------------------+
+ *
+ * The ACL table is that of the vNIC, from nic_acl_cfg, so vNICs may keep
+ * separate rule sets or share one. INSTR_ACL has 10 bits for it, so tables
+ * run from 1 to NIC_ACL_MAX_TABLE: a larger table in nic_acl_cfg leaves
+ * the vNIC without an ACL and counts in cfg_error_acl_cntr, and adding a
+ * rule for one fails with CMSG_RC_ERR_MAP_PARSE. Proto is the parsed inner protocol,
+ * PV_PROTO & 7: NIC_ACL_PROTO_*. An IPv4 key has the source address in
+ * word 1, the destination address in word 5 and the other address words
+ * zero. The ports are zero unless the protocol is TCP or UDP, so that a
+ * fragment or a packet of another protocol matches on its addresses.
+ *
+ * The VLAN ID is zero unless the vNIC sets NIC_ACL_CFG_VLAN, in which case
+ * it is PV_VLAN_ID, that of the outer tag or NULL_VLAN (0xfff) for an
+ * untagged packet. All rules of such a vNIC then match on the VLAN, as
+ * the flow director of other NICs does with a global mask, so a flow can
+ * be pinned to a queue per VLAN (ethtool -N ... vlan).
+ *
+ * A hit drops the packet, passes it on unchanged or steers it to a queue
+ * of the vNIC, overriding RSS, by setting PV_QUEUE_OFFSET and
+ * PV_QUEUE_SELECTED. Steering rules are thus the ntuple filters of
+ * ethtool -N. Steering to a queue beyond the last one enabled passes the
+ * packet to RSS instead. Packets without an inner IP header and misses
+ * pass. _nic_acl_cntrs counts the hits of each action.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _APP_CONFIG_ACL_H_
+#define _APP_CONFIG_ACL_H_
+
+#define NIC_ACL_KEY_LW          10
+#define NIC_ACL_KEY_SZ          (NIC_ACL_KEY_LW * 4)
+#define NIC_ACL_VALUE_LW        2
+#define NIC_ACL_VALUE_SZ        (NIC_ACL_VALUE_LW * 4)
+#define NIC_ACL_MAX_ENTRIES     0x10000
+#define NIC_ACL_MAX_TABLE       0x3ff
+
+#define NIC_ACL_KEY_TABLE_shf   16
+#define NIC_ACL_KEY_VLAN_shf    4
+#define NIC_ACL_KEY_SRC_wrd     1
+#define NIC_ACL_KEY_DST_wrd     5
+#define NIC_ACL_KEY_PORTS_wrd   9
+
+/* Key protocol classes, PROTO_* in pv.uc without the outer headers */
+#define NIC_ACL_PROTO_IPV6_TCP      0
+#define NIC_ACL_PROTO_IPV6_UDP      1
+#define NIC_ACL_PROTO_IPV4_TCP      2
+#define NIC_ACL_PROTO_IPV4_UDP      3
+#define NIC_ACL_PROTO_IPV6_OTHER    4
+#define NIC_ACL_PROTO_IPV6_FRAG     5
+#define NIC_ACL_PROTO_IPV4_OTHER    6
+#define NIC_ACL_PROTO_IPV4_FRAG     7
+#define NIC_ACL_PROTO_MASK          7
+
+/* Value word 0 */
+#define NIC_ACL_ACT_shf         24
+#define NIC_ACL_QUEUE_msk       0xff
+
+#define NIC_ACL_ACT_PASS        0
+#define NIC_ACL_ACT_DROP        1
+#define NIC_ACL_ACT_STEER       2
+
+/* nic_acl_cfg flags */
+#define NIC_ACL_CFG_VLAN        (1 << 0)    /* Key on the VLAN ID */
+
+/* 64 bit counters in _nic_acl_cntrs, indexed by action */
+#define NIC_ACL_CNTRS           4
+
+#if defined(__NFP_LANG_ASM)
+
+    .alloc_mem _nic_acl_cntrs emem global (NIC_ACL_CNTRS * 8) 256
+
+#elif defined(__NFP_LANG_MICROC)
+
+    __asm
+    {
+        .alloc_mem _nic_acl_cntrs emem global (NIC_ACL_CNTRS * 8) 256
+    }
+
+#endif
+
+#if !defined(__NFP_LANG_ASM)
+
+#if !defined(__NFP_LANG_MICROC)
+#include <stdint.h>
+#endif
+
+/**
+ * ACL of a vNIC, written by the host to the exported nic_acl_cfg table
+ * and applied on the next reconfiguration or NIC_CFG_RELOAD. A zero
+ * table disables the lookup.
+ */
+struct nic_acl_cfg {
+    uint32_t table;         /* 1 to NIC_ACL_MAX_TABLE */
+    uint32_t flags;         /* NIC_ACL_CFG_* */
+    uint32_t reserved[2];
+};
+
+#endif
+
+#endif /* _APP_CONFIG_ACL_H_ */
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file          apps/nic/app_config_csum.h
+ * @brief         Per vNIC checksum work beyond that of the MAC, done by
+ *                INSTR_CHECKSUM
+ *
+ * The MAC checks and fills in the outer IPv4, TCP and UDP checksums. With
+ * NIC_CSUM_CFG_RX_VALIDATE the wire ingress lists of a PF also validate,
+ * in software, the inner checksums of tunnelled packets and the CRC32c
+ * of SCTP packets (CHECKSUM V). With NIC_CSUM_CFG_TX_SCTP the host
+ * ingress lists of a PF or VF fill in the CRC32c of SCTP packets the host
+ * asked a checksum for (CHECKSUM S). Both are off by default, as every
+ * packet of such a list pays the dispatch of the CHECKSUM action, and
+ * a tunnelled packet with V a sum over its whole payload.
+ *
+ * The SCTP result is reported with the TCP flags of the RX descriptor,
+ * PCIE_DESC_RX_TCP_CSUM and PCIE_DESC_RX_TCP_CSUM_OK, the driver takes
+ * either L4 flag as a valid L4 checksum. See the TX host flags in pv.uc.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _APP_CONFIG_CSUM_H_
+#define _APP_CONFIG_CSUM_H_
+
+/* nic_csum_cfg flags */
+#define NIC_CSUM_CFG_RX_VALIDATE    (1 << 0)    /* Inner and SCTP on RX */
+#define NIC_CSUM_CFG_TX_SCTP        (1 << 1)    /* SCTP CRC32c on TX */
+
+#if !defined(__NFP_LANG_ASM)
+
+#if !defined(__NFP_LANG_MICROC)
+#include <stdint.h>
+#endif
+
+/**
+ * Checksum work of a vNIC, written by the host to the exported
+ * nic_csum_cfg table and applied on the next reconfiguration or
+ * NIC_CFG_RELOAD.
+ */
+struct nic_csum_cfg {
+    uint32_t flags;         /* NIC_CSUM_CFG_* */
+    uint32_t reserved[3];
+};
+
+#endif
+
+#endif /* _APP_CONFIG_CSUM_H_ */
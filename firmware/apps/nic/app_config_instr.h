@@ -10,33 +10,100 @@
 #ifndef _APP_CONFIG_INSTR_H_
 #define _APP_CONFIG_INSTR_H_
 
+/* The opcode enumeration and the INSTR_*_bf field definitions below are
+ * also consumed by the host side action interpreter model (host/src), which
+ * has no access to the SDK headers. */
+#if defined(__NFP_LANG_ASM) || defined(__NFP_LANG_MICROC)
 #include <kernel/nfp_net_ctrl.h>
 #include <vnic/shared/nfd.h>
+#endif
 
 #define NUM_PCIE_Q          64      // number of queues configured per PCIe
 #define NUM_PCIE_Q_PER_PORT NFD_MAX_PF_QUEUES // nr queues cfg per port
 #define NIC_MAX_INSTR       16      // max number of instructions in table
+#define NIC_INSTR_SEG       (NIC_MAX_INSTR / 2) // words per chained segment
+#define NIC_MAX_INSTR_CHAIN 64      // max words of a list using INSTR_CHAIN
 
 #define NIC_CFG_INSTR_TBL_ADDR 0x00
 #define NIC_CFG_INSTR_TBL_SIZE 32768
 
+/* Entries of each RSS indirection table, NFP_NET_CFG_RSS_ITBL_SZ to 512.
+ * The driver writes NFP_NET_CFG_RSS_ITBL_SZ entries, upd_rss_table()
+ * extends them to larger tables. Larger tables do not fit in CLS next to
+ * the action lists, they are kept in the CTM of each worker island. The
+ * tier is chosen at build time, all tables of a build are in one of them. */
+#ifndef NIC_RSS_TBL_ENTRIES
+#define NIC_RSS_TBL_ENTRIES NFP_NET_CFG_RSS_ITBL_SZ
+#endif
+#if (NIC_RSS_TBL_ENTRIES > 512) || \
+    (NIC_RSS_TBL_ENTRIES & (NIC_RSS_TBL_ENTRIES - 1))
+#error "NIC_RSS_TBL_ENTRIES must be a power of 2 up to 512"
+#endif
+#if (NIC_RSS_TBL_ENTRIES > NFP_NET_CFG_RSS_ITBL_SZ)
+#define NIC_RSS_TBL_CTM
+#endif
+
 #define RSS_TBL_SIZE_LW     (NFP_NET_CFG_RSS_ITBL_SZ / 4)
-#define NIC_RSS_TBL_SIZE    (NFP_NET_CFG_RSS_ITBL_SZ * NS_PLATFORM_NUM_PORTS * NFD_MAX_ISL)
+#define NIC_RSS_TBL_SIZE    (NIC_RSS_TBL_ENTRIES * NS_PLATFORM_NUM_PORTS * NFD_MAX_ISL)
 #define NIC_RSS_TBL_ADDR    NIC_CFG_INSTR_TBL_SIZE
+#ifdef NIC_RSS_TBL_CTM
+#define NIC_RSS_TBL_CLS_SIZE 0
+#else
+#define NIC_RSS_TBL_CLS_SIZE NIC_RSS_TBL_SIZE
+#endif
 
 #define VLAN_TO_VNICS_MAP_TBL_SIZE ((1<<12) * 8)
 
 /* For host ports,
  *   use 0 to NIC_HOST_MAX_ENTRIES-1
  * For wire ports,
- *   use NIC_HOST_MAX_ENTRIES .. NIC_WIRE_MAX_ENTRIES+NIC_HOST_MAX_ENTRIES*/
+ *   use NIC_HOST_MAX_ENTRIES .. NIC_WIRE_MAX_ENTRIES+NIC_HOST_MAX_ENTRIES
+ * The remaining entries hold the continuation of lists longer than
+ * NIC_MAX_INSTR words, allocated NIC_INSTR_EXT_BLOCKS entries at a time
+ * per port or VEB list (see cfg_act_chain() in app_config_tables.c).
+ *
+ * The host and wire entries are double buffered: bank 0 is at the start
+ * of NIC_CFG_INSTR_TBL and bank 1 is NIC_CFG_INSTR_BANK1, after the RSS
+ * table. Workers read the bank selected by bit 0 of NN register
+ * NIC_INSTR_BANK_NN_IDX, reloaded on every epoch (see pkt_io_rx). The app
+ * master writes the other bank and switches banks once all writes for a
+ * reconfiguration are done (see cfg_act_commit()). The RSS tables and
+ * keys and the VXLAN port table are not banked, they are still written in
+ * place. */
+#define NIC_INSTR_BANK_SIZE   (((1 << 8) + NS_PLATFORM_NUM_PORTS) * \
+                               NIC_MAX_INSTR * 4)
+#define NIC_INSTR_BANK1_ADDR  (NIC_RSS_TBL_ADDR + NIC_RSS_TBL_CLS_SIZE)
+#define NIC_INSTR_BANK_NN_IDX 126
+
+/* Toeplitz keys, the NFP_NET_CFG_RSS_KEY of each RSS table, after bank 1 */
+#define NIC_RSS_KEY_LW        (NFP_NET_CFG_RSS_KEY_SZ / 4)
+#define NIC_RSS_KEY_STRIDE    64
+#define NIC_RSS_KEY_TBL_SIZE  (NIC_RSS_KEY_STRIDE * NS_PLATFORM_NUM_PORTS * \
+                               NFD_MAX_ISL)
+#define NIC_RSS_KEY_TBL_ADDR  (NIC_INSTR_BANK1_ADDR + NIC_INSTR_BANK_SIZE)
+
+#define NIC_INSTR_EXT_BLOCKS  ((NIC_MAX_INSTR_CHAIN / NIC_MAX_INSTR) - 1)
+#define NIC_INSTR_EXT_BASE    NIC_INSTR_BANK_SIZE
+#define NIC_INSTR_EXT_SLOTS   ((NIC_CFG_INSTR_TBL_SIZE - NIC_INSTR_EXT_BASE) \
+                               / (NIC_INSTR_EXT_BLOCKS * NIC_MAX_INSTR * 4))
+
 #if defined(__NFP_LANG_ASM)
 
     .alloc_mem NIC_CFG_INSTR_TBL cls+NIC_CFG_INSTR_TBL_ADDR \
                 island NIC_CFG_INSTR_TBL_SIZE addr40
 
+    #ifdef NIC_RSS_TBL_CTM
+    .alloc_mem NIC_RSS_TBL ctm island NIC_RSS_TBL_SIZE 65536
+    #else
     .alloc_mem NIC_RSS_TBL cls+NIC_RSS_TBL_ADDR \
                 island NIC_RSS_TBL_SIZE addr40
+    #endif
+
+    .alloc_mem NIC_CFG_INSTR_BANK1 cls+NIC_INSTR_BANK1_ADDR \
+                island NIC_INSTR_BANK_SIZE addr40
+
+    .alloc_mem NIC_RSS_KEY_TBL cls+NIC_RSS_KEY_TBL_ADDR \
+                island NIC_RSS_KEY_TBL_SIZE addr40
 
     .alloc_mem _vf_vlan_cache ctm island VLAN_TO_VNICS_MAP_TBL_SIZE 65536
 
@@ -51,11 +118,30 @@
             island NIC_CFG_INSTR_TBL_SIZE addr40
     }
 
+    #ifdef NIC_RSS_TBL_CTM
+    __asm
+    {
+        .alloc_mem NIC_RSS_TBL ctm island NIC_RSS_TBL_SIZE 65536
+    }
+    #else
     __asm
     {
         .alloc_mem NIC_RSS_TBL cls + NIC_RSS_TBL_ADDR \
             island NIC_RSS_TBL_SIZE addr40
     }
+    #endif
+
+    __asm
+    {
+        .alloc_mem NIC_CFG_INSTR_BANK1 cls + NIC_INSTR_BANK1_ADDR \
+            island NIC_INSTR_BANK_SIZE addr40
+    }
+
+    __asm
+    {
+        .alloc_mem NIC_RSS_KEY_TBL cls + NIC_RSS_KEY_TBL_ADDR \
+            island NIC_RSS_KEY_TBL_SIZE addr40
+    }
 
     __asm
     {
@@ -69,18 +155,14 @@
     }
 
 #endif
-/* Instructions in the worker (actions.uc) should follow the exact same order
- * as in enum used by app config below.
- * The pipeline bit in the instruction_format is set when previous and
- * current instruction follows each other. This eliminates a branch/jmp by the
- * worker.
- *      i0#: br[drop#]
- *      i1#: br[mtu#]
- *      i2#: br[mac#]
- *      i3#: br[rss#]
- *      i4#: br[checksum_complete#]
- *      i5#: br[tx_host#]
- *      i6#: br[tx_wire#]
+/* The enum below names the actions for the app master. The opcode field
+ * written to NIC_CFG_INSTR_TBL is not the enum value but the offset of the
+ * action handler in actions_execute (actions.uc) from its jump base, taken
+ * from the datapath .list file at build time (cfg_act_map). Handlers may be
+ * placed in any order.
+ * The pipeline bit in the instruction_format is set when the handler of the
+ * current instruction directly follows the handler of the previous one in
+ * code store. This eliminates a branch/jmp by the worker.
  */
 #if defined(__NFP_LANG_ASM)
     #define    INSTR_DROP              0
@@ -102,7 +184,11 @@
     #define    INSTR_TX_VLAN           16
     #define    INSTR_L2_SWITCH_WIRE    17
     #define    INSTR_L2_SWITCH_HOST    18
-#elif defined(__NFP_LANG_MICROC)
+    #define    INSTR_CHAIN             19
+    #define    INSTR_METER             20
+    #define    INSTR_SAMPLE            21
+    #define    INSTR_ACL               22
+#else
 enum instruction_ops {
     INSTR_DROP = 0,
     INSTR_RX_WIRE,
@@ -122,16 +208,15 @@ enum instruction_ops {
     INSTR_PUSH_PKT,
     INSTR_TX_VLAN,
     INSTR_L2_SWITCH_WIRE,
-    INSTR_L2_SWITCH_HOST
+    INSTR_L2_SWITCH_HOST,
+    INSTR_CHAIN,
+    INSTR_METER,
+    INSTR_SAMPLE,
+    INSTR_ACL
 };
+#endif
 
-/* this maping will eventually be replaced at build time with actual offsets
- *
- * - required to be in monotonically increasing order of relative action
- *   addresses as they appear in ME code store
- * - additional entry at end denotes length of the last action (as if another
- *   action follows)
- */
+#if defined(__NFP_LANG_MICROC)
 
 /* Instruction format of NIC_CFG_INSTR_TBL table.
  *
@@ -148,10 +233,13 @@ enum instruction_ops {
  * INSTR_RX_WIRE:
  * Bit \  3 3 2 2 2 2 2 2 2 2 2 2 1 1 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0
  * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
- *       +-----------------------------+-+-----+-------------+-----+-+-+-+
- *    0  |              1              |P|  0  |VXLAN_NN_IDX |VXLAN|G|N|C|
- *       +-----------------------------+-+-----+-------------+-----+-+-+-+
+ *       +-----------------------------+-+-+-+-+-------------+-----+-+-+-+
+ *    0  |              1              |P|U|M|I|VXLAN_NN_IDX |VXLAN|G|N|C|
+ *       +-----------------------------+-+-+-+-+-------------+-----+-+-+-+
  *
+ *       U = Parse MPLS over UDP (port 6635)
+ *       M = Parse IP after MPLS labels other than the explicit null labels
+ *       I = Parse IP payloads of GRE, GENEVE and GTP-U (port 2152)
  *       VXLAN_NN_IDX = NN base of VXLAN port table
  *       VXLAN = Number of VXLAN ports
  *       G = Parse GENEVE
@@ -199,26 +287,39 @@ enum instruction_ops {
  *    0  |              4              |P|u|t|U|T| Tbl idx |1| MAX Queue |
  *       +---------------+-------------+-+-+-+-+-+---------+-+-+---------+
  *    1  |                            RSS Key                            |
- *       +---------------------------------------------------------------+
+ *       +-+-----------------------------------------------------------+-+-+
+ *    2  |R|                             0                             |Z|S|
+ *       +-+-----------------------------------------------------------+-+-+
  *
  *       u - Enable IPV4_UDP
  *       t - Enable IPV4_TCP
  *       U - Enable IPV6_UDP
  *       T - Enable IPV6_TCP
  *       1 - RSSv1
+ *       Z - Toeplitz hash with the key at Tbl idx of NIC_RSS_KEY_TBL,
+ *           CRC-32 seeded with RSS Key otherwise
+ *       S - Symmetric, hash the lower address and the lower port first
+ *       R - Look the hash up in _nic_rfs_tbl first, see app_config_rfs.h
  *
  * INSTR_CHECKSUM:
  * Bit \  3 3 2 2 2 2 2 2 2 2 2 2 1 1 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0
  * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
- *       +-----------------------------+-+-------------+-+-------+-+-+-+-+
- *    0  |              5              |P|      0      |M|   0   |I|i|C|c|
- *       +-----------------------------+-+-------------+-+-------+-+-+-+-+
+ *       +-----------------------------+-+-------------+-+---+-+-+-+-+-+-+
+ *    0  |              5              |P|      0      |M| 0 |S|V|I|i|C|c|
+ *       +-----------------------------+-+-------------+-+---+-+-+-+-+-+-+
  *
  *       M - Update CHECKSUM_COMPLETE metadata
+ *       S - Update the CRC32c of SCTP packets that are not tunnelled (if
+ *           the host requested the L4 checksum), leaving the checksums of
+ *           other packets to the MAC
+ *       V - Validate the inner L3 and L4 checksums of tunnelled packets,
+ *           setting the inner checksum flags of the RX descriptor, and the
+ *           CRC32c of SCTP packets, setting the TCP checksum flags
  *       I - Update inner L3 checksum in packet (if requested by host)
  *       i - Update inner L4 checksum in packet (if requested by host)
  *       C - Update outer L3 checksum in packet (if requested by host)
- *       c - Update outer L4 checksum in packet (if requested by host)
+ *       c - Update outer L4 checksum in packet (if requested by host), the
+ *           CRC32c of SCTP packets that are not tunnelled
  *
  * INSTR_TX_HOST:
  * Bit \  3 3 2 2 2 2 2 2 2 2 2 2 1 1 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0
@@ -314,6 +415,73 @@ enum instruction_ops {
  *       +-----------------------------+-+-------------------------------+
  *    0  |              18             |P|                               |
  *       +-----------------------------+-+-------------------------------+
+ *
+ * INSTR_CHAIN:
+ * Bit \  3 3 2 2 2 2 2 2 2 2 2 2 1 1 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +-----------------------------+-+---------------------+-----+-+-+
+ *    0  |              19             |P|      CLS ADDR       |  0  |J|F|
+ *       +-----------------------------+-+---------------------+-----+-+-+
+ *
+ *       CLS ADDR = Bits 15:5 of the CLS address of the segment to fetch
+ *       J = Wait for the segment fetched by the previous INSTR_CHAIN
+ *       F = Fetch the segment at CLS ADDR
+ *
+ * A list longer than NIC_MAX_INSTR words is split into NIC_INSTR_SEG word
+ * segments, which execute alternately from the two halves of $__actions.
+ * INSTR_CHAIN ends every segment but the last: it continues at the start
+ * of the other half and refills the half just executed with the segment
+ * after next, so the CLS read overlaps the execution of a whole segment.
+ * actions_load and INSTR_VEB_LOOKUP read segments 0 and 1, so the first
+ * INSTR_CHAIN has J clear. No action straddles two segments.
+ *
+ * INSTR_METER:
+ * Bit \  3 3 2 2 2 2 2 2 2 2 2 2 1 1 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +-----------------------------+-+-+-+-----------+---------------+
+ *    0  |              20             |P|M|Q|   DSCP    |     INDEX     |
+ *       +-----------------------------+-+-+-+-----------+---------------+
+ *
+ *       M = Remark yellow packets with DSCP, drop them if clear
+ *       Q = Use the _nic_meter_tbl entry of the ingress queue
+ *       DSCP = Outer IP DSCP of yellow packets
+ *       INDEX = _nic_meter_tbl entry, if Q is clear
+ *
+ * Polices the packet with the two-rate three-colour meter of the entry,
+ * see app_config_meter.h. Red packets are dropped.
+ *
+ * INSTR_SAMPLE:
+ * Bit \  3 3 2 2 2 2 2 2 2 2 2 2 1 1 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +-----------------------------+-+-------------------------------+
+ *    0  |              21             |P|          SNAP LENGTH          |
+ *       +-----------------------------+-+-------------------------------+
+ *    1  |                           THRESHOLD                           |
+ *       +---------------------------------------------------------------+
+ *
+ *       SNAP LENGTH = Bytes of the packet to send, at most
+ *                     NIC_SAMPLE_SNAP_MAX
+ *       THRESHOLD = Sample if PSEUDO_RANDOM_NUMBER <= THRESHOLD
+ *
+ * Sends the head of the packet to the control vNIC, see
+ * app_config_sample.h. The packet continues with the next action.
+ *
+ * INSTR_ACL:
+ * Bit \  3 3 2 2 2 2 2 2 2 2 2 2 1 1 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +-----------------------------+-+-------------------+-----------+
+ *    0  |              22             |P|       TABLE       | MAX QUEUE |
+ *       +-----------------------------+-+-------------------+-----------+
+ *    1  |                          Reserved                           |V|
+ *       +-------------------------------------------------------------+-+
+ *
+ *       V = Key on the VLAN ID of the packet as well
+ *       TABLE = ACL table of the vNIC, first word of the lookup key
+ *       MAX QUEUE = Last queue a rule may steer to
+ *
+ * Looks the inner 5-tuple, and the VLAN ID if V is set, up in the ACL_TID
+ * hashmap and drops, passes or steers the packet as the matching rule
+ * says, see app_config_acl.h.
  */
 
 /* Instruction format of NIC_CFG_INSTR_TBL table. Some 32-bit words will
@@ -336,15 +504,21 @@ typedef union {
         uint32_t v1_meta : 1;
         uint32_t max_queue : 6;
         uint32_t key;
+        uint32_t rfs : 1;
+        uint32_t reserved : 29;
+        uint32_t toeplitz : 1;
+        uint32_t symmetric : 1;
     };
-    uint32_t __raw[2];
+    uint32_t __raw[3];
 } instr_rss_t;
 
 typedef union {
     struct {
 	    uint32_t op: 15;
 	    uint32_t pipeline: 1;
-	    uint32_t reserved: 3;
+	    uint32_t parse_mpls_udp: 1;
+	    uint32_t parse_mpls_ip: 1;
+	    uint32_t parse_tun_ip: 1;
 	    uint32_t vxlan_nn_idx: 7;
 	    uint32_t parse_vxlans: 3;
 	    uint32_t parse_geneve: 1;
@@ -406,7 +580,9 @@ typedef union {
         uint32_t pipeline: 1;
         uint32_t reserved: 7;
         uint32_t complete_meta : 1;
-        uint32_t zero: 4;
+        uint32_t zero: 2;
+        uint32_t sctp_only : 1;
+        uint32_t validate_inner : 1;
         uint32_t inner_l3 : 1;
         uint32_t inner_l4 : 1;
         uint32_t outer_l3 : 1;
@@ -414,19 +590,65 @@ typedef union {
     };
     uint32_t __raw[1];
 } instr_checksum_t;
+
+typedef union {
+    struct {
+        uint32_t op : 15;
+        uint32_t pipeline : 1;
+        uint32_t mark : 1;
+        uint32_t per_queue : 1;
+        uint32_t dscp : 6;
+        uint32_t index : 8;
+    };
+    uint32_t __raw[1];
+} instr_meter_t;
+
+typedef union {
+    struct {
+        uint32_t op : 15;
+        uint32_t pipeline : 1;
+        uint32_t snaplen : 16;
+        uint32_t threshold;
+    };
+    uint32_t __raw[2];
+} instr_sample_t;
+
+typedef union {
+    struct {
+        uint32_t op : 15;
+        uint32_t pipeline : 1;
+        uint32_t table : 10;
+        uint32_t max_queue : 6;
+        uint32_t reserved : 31;
+        uint32_t vlan : 1;
+    };
+    uint32_t __raw[2];
+} instr_acl_t;
 #endif
 
 #define INSTR_PIPELINE_BIT 16
 #define INSTR_OPCODE_LSB   17
 
+/* Fixed opcode field values at the start of the actions_execute jump table,
+ * for lists written before cfg_act_map is available (the defaults below). */
+#define INSTR_DEFAULT_DROP      0
+#define INSTR_DEFAULT_RX_WIRE   1
+#define INSTR_DEFAULT_RX_HOST   2
+
 #define INSTR_RSS_CFG_PROTO_bf  0, 15, 12
 #define INSTR_RSS_TABLE_IDX_bf  0, 11, 7
 #define INSTR_RSS_V1_META_bf    0, 6, 6
 #define INSTR_RSS_MAX_QUEUE_bf  0, 5, 0
 #define INSTR_RSS_KEY_bf        1, 31, 0
+#define INSTR_RSS_RFS_bf        2, 31, 31
+#define INSTR_RSS_TOEPLITZ_bf   2, 1, 1
+#define INSTR_RSS_SYMMETRIC_bf  2, 0, 0
 
 #define INSTR_RX_HOST_MTU_bf     0, 15, 2
 
+#define INSTR_RX_PARSE_MPLS_UDP_bf 0, 15, 15
+#define INSTR_RX_PARSE_MPLS_IP_bf  0, 14, 14
+#define INSTR_RX_PARSE_TUN_IP_bf   0, 13, 13
 #define INSTR_RX_VXLAN_NN_IDX_bf 0, 12, 6
 #define INSTR_RX_PARSE_VXLANS_bf 0, 5, 3
 #define INSTR_RX_PARSE_GENEVE_bf 0, 2, 2
@@ -443,11 +665,29 @@ typedef union {
 #define INSTR_TX_WIRE_TMQ_bf     0, 9, 0
 
 #define INSTR_CSUM_META_bf       0, 8, 8
+#define INSTR_CSUM_SCTP_bf       0, 5, 5
+#define INSTR_CSUM_VAL_bf        0, 4, 4
 #define INSTR_CSUM_IL3_bf        0, 3, 3
 #define INSTR_CSUM_IL4_bf        0, 2, 2
 #define INSTR_CSUM_OL3_bf        0, 1, 1
 #define INSTR_CSUM_OL4_bf        0, 0, 0
 
+#define INSTR_CHAIN_ADDR_bf      0, 15, 5
+#define INSTR_CHAIN_JOIN_bf      0, 1, 1
+#define INSTR_CHAIN_FETCH_bf     0, 0, 0
+
+#define INSTR_METER_MARK_bf      0, 15, 15
+#define INSTR_METER_QUEUE_bf     0, 14, 14
+#define INSTR_METER_DSCP_bf      0, 13, 8
+#define INSTR_METER_INDEX_bf     0, 7, 0
+
+#define INSTR_SAMPLE_SNAPLEN_bf  0, 15, 0
+#define INSTR_SAMPLE_THRESH_bf   1, 31, 0
+
+#define INSTR_ACL_TABLE_bf       0, 15, 6
+#define INSTR_ACL_MAX_QUEUE_bf   0, 5, 0
+#define INSTR_ACL_VLAN_bf        1, 0, 0
+
 #define INSTR_DEL_OFFSET_bf      0, 14, 8
 #define INSTR_DEL_LENGTH_bf      0, 7, 0
 
@@ -457,7 +697,8 @@ typedef union {
     #define __OFFSET 0
 
     #while (__LOOP <= (NUM_PCIE_Q_PER_PORT * NS_PLATFORM_NUM_PORTS))
-        .init NIC_CFG_INSTR_TBL+__OFFSET  ((INSTR_RX_HOST << INSTR_OPCODE_LSB) | 16383) INSTR_DROP
+        .init NIC_CFG_INSTR_TBL+__OFFSET  ((INSTR_DEFAULT_RX_HOST << INSTR_OPCODE_LSB) | 16383) (INSTR_DEFAULT_DROP << INSTR_OPCODE_LSB)
+        .init NIC_CFG_INSTR_BANK1+__OFFSET  ((INSTR_DEFAULT_RX_HOST << INSTR_OPCODE_LSB) | 16383) (INSTR_DEFAULT_DROP << INSTR_OPCODE_LSB)
         #define_eval __OFFSET (__OFFSET + (4 * NIC_MAX_INSTR))
         #define_eval __LOOP (__LOOP + 1)
     #endloop
@@ -466,7 +707,8 @@ typedef union {
     #define_eval __OFFSET ((1 << 8) * (NIC_MAX_INSTR * 4))
 
     #while (__LOOP < NS_PLATFORM_NUM_PORTS)
-        .init NIC_CFG_INSTR_TBL+__OFFSET  ((INSTR_RX_WIRE << INSTR_OPCODE_LSB) | 16383) INSTR_DROP
+        .init NIC_CFG_INSTR_TBL+__OFFSET  ((INSTR_DEFAULT_RX_WIRE << INSTR_OPCODE_LSB) | 16383) (INSTR_DEFAULT_DROP << INSTR_OPCODE_LSB)
+        .init NIC_CFG_INSTR_BANK1+__OFFSET  ((INSTR_DEFAULT_RX_WIRE << INSTR_OPCODE_LSB) | 16383) (INSTR_DEFAULT_DROP << INSTR_OPCODE_LSB)
         #define_eval __OFFSET (__OFFSET + (4 * NIC_MAX_INSTR))
         #define_eval __LOOP (__LOOP + 1)
 	#endloop
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file          apps/nic/app_config_meter.h
+ * @brief         Two-rate three-colour policer state used by INSTR_METER
+ *
+ * _nic_meter_tbl holds NIC_METER_ENTRIES policers of NIC_METER_ENTRY_SZ
+ * bytes. A vNIC metered as a whole uses the entry of its first queue,
+ * ((pcie << 6) | queue), and a vNIC metered per queue uses the entry of
+ * each of its queues, selected by the worker from PV_QUEUE_IN. The app
+ * master writes the configuration words and clears the state words (see
+ * cfg_act_append_meter()), the workers only change the state words:
+ *
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +---------------------------------------------------------------+
+ *    0  |                 Peak bucket deficit (Dp)                      |
+ *       +---------------------------------------------------------------+
+ *    1  |               Committed bucket deficit (Dc)                   |
+ *       +---------------------------------------------------------------+
+ *    2  |               TIMESTAMP_LOW of the last refill                |
+ *       +---------------------------------------------------------------+
+ *    3  |                           Reserved                            |
+ *       +---------------------------------------------------------------+
+ *    4  |                   Peak burst size (PBS)                       |
+ *       +---------------------------------------------------------------+
+ *    5  |                 Committed burst size (CBS)                    |
+ *       +---------------------------------------------------------------+
+ *    6  |                 Peak information rate (PIR)                   |
+ *       +---------------------------------------------------------------+
+ *    7  |              Committed information rate (CIR)                 |
+ *       +---------------------------------------------------------------+
+ *
+ * The buckets are kept as the bytes used rather than the tokens left, so
+ * that the atomic engine can drain them with a saturating subtract. The
+ * deficits and burst sizes are in units of 1 / (1 << NIC_METER_FRAC_SHF)
+ * bytes, the rates in those units per TIMESTAMP_LOW tick (16 ME cycles),
+ * shifted left by NIC_METER_RATE_SHF.
+ *
+ * For each packet the worker swaps the timestamp for the current one and
+ * drains both buckets by the elapsed ticks times the rate, so concurrent
+ * packets account disjoint intervals and no refill is lost. It then adds
+ * the packet length to both deficits and decides the colour from the
+ * deficits returned by the add (RFC 2698, colour blind):
+ *
+ *  - red if Dp + length > PBS: both adds are undone and the packet is
+ *    dropped;
+ *  - yellow if Dc + length > CBS: the committed add is undone and the
+ *    packet is DSCP remarked, or treated as red if marking is disabled;
+ *  - green otherwise.
+ *
+ * Packets that race through the same entry may see each other's adds
+ * before they are undone, so a bucket at its limit can reject slightly
+ * more than the exact algorithm would. Timestamps are per ME; a swap that
+ * goes back by less than (1 << NIC_METER_SKEW_SHF) ticks is taken as skew
+ * between MEs and refills nothing.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _APP_CONFIG_METER_H_
+#define _APP_CONFIG_METER_H_
+
+#define NIC_METER_ENTRIES       256
+#define NIC_METER_ENTRY_SZ      32
+#define NIC_METER_ENTRY_SHF     5
+#define NIC_METER_TBL_SZ        (NIC_METER_ENTRIES * NIC_METER_ENTRY_SZ)
+
+#define NIC_METER_DP_wrd        0
+#define NIC_METER_DC_wrd        1
+#define NIC_METER_TS_wrd        2
+#define NIC_METER_PBS_wrd       4
+#define NIC_METER_CBS_wrd       5
+#define NIC_METER_PIR_wrd       6
+#define NIC_METER_CIR_wrd       7
+
+#define NIC_METER_FRAC_SHF      8
+#define NIC_METER_RATE_SHF      12
+#define NIC_METER_SKEW_SHF      24
+#define NIC_METER_TICK_CYCLES   16
+
+/* Largest burst size in bytes, keeps the deficits below 1 << 31 */
+#define NIC_METER_BURST_MAX     ((1 << (31 - NIC_METER_FRAC_SHF)) - 1)
+
+/* Flags of struct nic_meter_cfg */
+#define NIC_METER_CFG_PER_QUEUE (1 << 0)
+#define NIC_METER_CFG_MARK      (1 << 1)
+#define NIC_METER_CFG_DSCP_shf  8
+#define NIC_METER_CFG_DSCP_msk  0x3f
+
+/* Packet colours */
+#define NIC_METER_GREEN         0
+#define NIC_METER_YELLOW        1
+#define NIC_METER_RED           2
+
+#if defined(__NFP_LANG_ASM)
+
+    .alloc_mem _nic_meter_tbl emem global NIC_METER_TBL_SZ 256
+
+#elif defined(__NFP_LANG_MICROC)
+
+    __asm
+    {
+        .alloc_mem _nic_meter_tbl emem global NIC_METER_TBL_SZ 256
+    }
+
+#endif
+
+#if !defined(__NFP_LANG_ASM)
+
+#if defined(__NFP_LANG_MICROC)
+#define NIC_METER_FUNC      __intrinsic
+#else
+#include <stdint.h>
+#define NIC_METER_FUNC      static inline
+#endif
+
+/**
+ * Policer of a vNIC, written by the host to the exported nic_meter_cfg
+ * table and applied on the next reconfiguration or NIC_CFG_RELOAD. A
+ * zero pir_kbps disables the policer.
+ */
+struct nic_meter_cfg {
+    uint32_t cir_kbps;
+    uint32_t pir_kbps;
+    uint32_t cbs;           /* bytes */
+    uint32_t pbs;           /* bytes */
+    uint32_t flags;         /* NIC_METER_CFG_* */
+    uint32_t reserved[3];
+};
+
+
+/**
+ * Convert a rate in kbit/s to the entry format, for an ME clock of
+ * @tclk_mhz. 1 kbit/s is 2 / (tclk_mhz * 1000) bytes per tick, scaled
+ * by 2^(NIC_METER_FRAC_SHF + NIC_METER_RATE_SHF), so this is
+ * kbps * 2^21 / (tclk_mhz * 1000), computed 7 bits at a time.
+ */
+NIC_METER_FUNC uint32_t
+nic_meter_rate(uint32_t kbps, uint32_t tclk_mhz)
+{
+    uint32_t div = tclk_mhz * 1000;
+    uint32_t rate, rem;
+    int i;
+
+    rate = kbps / div;
+    rem = kbps % div;
+    for (i = 0; i < 3; i++) {
+        rem <<= 7;
+        rate = (rate << 7) | (rem / div);
+        rem %= div;
+    }
+
+    return rate;
+}
+
+
+/**
+ * Convert a burst size in bytes to the entry format.
+ */
+NIC_METER_FUNC uint32_t
+nic_meter_burst(uint32_t bytes)
+{
+    if (bytes > NIC_METER_BURST_MAX)
+        bytes = NIC_METER_BURST_MAX;
+
+    return bytes << NIC_METER_FRAC_SHF;
+}
+
+#endif
+
+#endif /* _APP_CONFIG_METER_H_ */
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file          apps/nic/app_config_optimize.h
+ * @brief         Action list optimisation applied before the lists are
+ *                written to NIC_CFG_INSTR_TBL
+ *
+ * Every transition between actions that is not pipelined costs the worker
+ * a taken branch through the actions_execute jump table, per packet. The
+ * optimiser rewrites a list so that more transitions fall through to the
+ * next handler in code store, and drops actions that have no effect:
+ *
+ *  - CHECKSUM with no update or validation requested is removed.
+ *  - Adjacent CHECKSUM actions where one requests a subset of the updates
+ *    of the other are merged. CHECKSUM_COMPLETE metadata is never merged,
+ *    each one pushes its own metadata entry. Validation runs after the
+ *    updates of its own action, so it is only merged into a later
+ *    CHECKSUM that adds no updates.
+ *  - Actions are moved past actions they commute with if that raises the
+ *    number of pipelined transitions (see cfg_act_opt_commute()).
+ *
+ * POP_VLAN followed by PUSH_VLAN rewrites the tag, and PUSH_VLAN followed
+ * by POP_VLAN leaves PV_VLAN_ID as NULL_VLAN, so neither pair is removed.
+ *
+ * The functions work on a list decoded to enum instruction_ops values and
+ * are shared with the host side model (host/src), which checks that the
+ * optimised lists process packets identically.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _APP_CONFIG_OPTIMIZE_H_
+#define _APP_CONFIG_OPTIMIZE_H_
+
+#include "app_config_instr.h"
+
+#if defined(__NFP_LANG_MICROC)
+#define CFG_ACT_OPT_FUNC    __intrinsic
+#define CFG_ACT_OPT_MEM     __lmem
+#else
+#include <stdint.h>
+#define CFG_ACT_OPT_FUNC    static inline
+#define CFG_ACT_OPT_MEM
+#endif
+
+/* Number of enum instruction_ops values, larger values are unknown. */
+#define CFG_ACT_OPT_NUM_OPS     (INSTR_ACL + 1)
+
+#define _CFG_ACT_OPT_BIT(w, m, l)   (1 << (l))
+#define CFG_ACT_OPT_BIT(bf)         _CFG_ACT_OPT_BIT(bf)
+
+#define CFG_ACT_OPT_CSUM_META   CFG_ACT_OPT_BIT(INSTR_CSUM_META_bf)
+#define CFG_ACT_OPT_CSUM_VAL    CFG_ACT_OPT_BIT(INSTR_CSUM_VAL_bf)
+#define CFG_ACT_OPT_CSUM_ALL    (CFG_ACT_OPT_BIT(INSTR_CSUM_IL3_bf) | \
+                                 CFG_ACT_OPT_BIT(INSTR_CSUM_IL4_bf) | \
+                                 CFG_ACT_OPT_BIT(INSTR_CSUM_OL3_bf) | \
+                                 CFG_ACT_OPT_BIT(INSTR_CSUM_OL4_bf) | \
+                                 CFG_ACT_OPT_BIT(INSTR_CSUM_SCTP_bf) | \
+                                 CFG_ACT_OPT_CSUM_VAL | \
+                                 CFG_ACT_OPT_CSUM_META)
+
+/* Opcode field value of each action and of the handler that follows it in
+ * code store, see app_config_tables.c. */
+extern uint32_t cfg_act_map[];
+extern uint32_t cfg_act_next[];
+
+/**
+ * An action list decoded to one entry per action.
+ */
+struct cfg_act_opt {
+    uint32_t count;
+    uint32_t op[NIC_MAX_INSTR_CHAIN];    /* enum instruction_ops */
+    uint32_t args[NIC_MAX_INSTR_CHAIN];  /* 16-bit argument of first word */
+    uint32_t param[NIC_MAX_INSTR_CHAIN]; /* second word of longer actions */
+    uint32_t param2[NIC_MAX_INSTR_CHAIN]; /* third word of INSTR_RSS */
+};
+
+
+/**
+ * Number of instruction words used by an action.
+ */
+CFG_ACT_OPT_FUNC uint32_t
+cfg_act_opt_words(uint32_t op)
+{
+    switch (op) {
+    case INSTR_RSS:
+        return 3;
+    case INSTR_DST_MAC_MATCH:
+    case INSTR_SRC_MAC_MATCH:
+    case INSTR_VEB_LOOKUP:
+    case INSTR_SAMPLE:
+    case INSTR_ACL:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+
+/**
+ * Check if the handler of @op directly follows the handler of @prev.
+ */
+CFG_ACT_OPT_FUNC int
+cfg_act_opt_pipelined(uint32_t prev, uint32_t op)
+{
+    if (prev >= CFG_ACT_OPT_NUM_OPS || op >= CFG_ACT_OPT_NUM_OPS)
+        return 0;
+
+    return cfg_act_next[prev] == cfg_act_map[op];
+}
+
+
+/**
+ * Count the pipelined transitions of the entries [@start, @end).
+ */
+CFG_ACT_OPT_FUNC uint32_t
+cfg_act_opt_count(CFG_ACT_OPT_MEM struct cfg_act_opt *opt, uint32_t start,
+                  uint32_t end)
+{
+    uint32_t i;
+    uint32_t n = 0;
+
+    if (start == 0)
+        start = 1;
+    if (end > opt->count)
+        end = opt->count;
+
+    for (i = start; i < end; i++)
+        n += cfg_act_opt_pipelined(opt->op[i - 1], opt->op[i]);
+
+    return n;
+}
+
+
+/**
+ * Check if two adjacent actions give the same result in either order.
+ *
+ * Only actions that neither change control flow nor depend on each
+ * other's packet or metadata changes are reordered. The MAC matches read
+ * the MAC addresses, which the VLAN actions move but do not change, and a
+ * mismatch drops the packet whatever ran before it. RSS and the L3/L4
+ * checksum updates use the header offsets, which the VLAN actions keep up
+ * to date. CHECKSUM_COMPLETE covers any VLAN tag and pushes metadata like
+ * RSS does, so it stays in place.
+ */
+CFG_ACT_OPT_FUNC int
+cfg_act_opt_commute(uint32_t op_a, uint32_t args_a,
+                    uint32_t op_b, uint32_t args_b)
+{
+    uint32_t tmp;
+
+    if (op_a == op_b)
+        return 0;
+
+    /* Sort the pair to halve the cases below */
+    if (op_a > op_b) {
+        tmp = op_a;
+        op_a = op_b;
+        op_b = tmp;
+        tmp = args_a;
+        args_a = args_b;
+        args_b = tmp;
+    }
+
+    switch (op_a) {
+    case INSTR_DST_MAC_MATCH:
+        return (op_b == INSTR_CHECKSUM || op_b == INSTR_RSS ||
+                op_b == INSTR_POP_VLAN || op_b == INSTR_PUSH_VLAN ||
+                op_b == INSTR_SRC_MAC_MATCH);
+    case INSTR_CHECKSUM:
+        if (args_a & CFG_ACT_OPT_CSUM_META)
+            return (op_b == INSTR_SRC_MAC_MATCH);
+        return (op_b == INSTR_RSS || op_b == INSTR_POP_VLAN ||
+                op_b == INSTR_PUSH_VLAN || op_b == INSTR_SRC_MAC_MATCH);
+    case INSTR_RSS:
+        return (op_b == INSTR_POP_VLAN || op_b == INSTR_PUSH_VLAN ||
+                op_b == INSTR_SRC_MAC_MATCH);
+    case INSTR_POP_VLAN:
+    case INSTR_PUSH_VLAN:
+        return (op_b == INSTR_SRC_MAC_MATCH);
+    default:
+        return 0;
+    }
+}
+
+
+/**
+ * Remove entry @idx from the list.
+ */
+CFG_ACT_OPT_FUNC void
+cfg_act_opt_remove(CFG_ACT_OPT_MEM struct cfg_act_opt *opt, uint32_t idx)
+{
+    uint32_t i;
+
+    for (i = idx; i + 1 < opt->count; i++) {
+        opt->op[i] = opt->op[i + 1];
+        opt->args[i] = opt->args[i + 1];
+        opt->param[i] = opt->param[i + 1];
+        opt->param2[i] = opt->param2[i + 1];
+    }
+    opt->count--;
+}
+
+
+/**
+ * Remove CHECKSUM actions with nothing to do and merge adjacent ones.
+ *
+ * @return number of entries removed
+ */
+CFG_ACT_OPT_FUNC uint32_t
+cfg_act_opt_checksum(CFG_ACT_OPT_MEM struct cfg_act_opt *opt)
+{
+    uint32_t a, b;
+    uint32_t i = 0;
+    uint32_t removed = 0;
+
+    while (i < opt->count) {
+        if (opt->op[i] != INSTR_CHECKSUM) {
+            i++;
+            continue;
+        }
+
+        a = opt->args[i] & CFG_ACT_OPT_CSUM_ALL;
+        if (a == 0) {
+            cfg_act_opt_remove(opt, i);
+            removed++;
+            continue;
+        }
+
+        if (i + 1 < opt->count && opt->op[i + 1] == INSTR_CHECKSUM) {
+            b = opt->args[i + 1] & CFG_ACT_OPT_CSUM_ALL;
+
+            /* Recomputing a checksum that is already up to date has no
+             * effect, so one CHECKSUM covers both if it requests every
+             * update of the other. A validation must not move behind
+             * updates that the original list made after it. */
+            if (!((a | b) & CFG_ACT_OPT_CSUM_META) &&
+                (((a & b) == a && !(a & CFG_ACT_OPT_CSUM_VAL)) ||
+                 (a & b) == b)) {
+                opt->args[i] |= opt->args[i + 1];
+                cfg_act_opt_remove(opt, i + 1);
+                removed++;
+                continue;
+            }
+        }
+
+        i++;
+    }
+
+    return removed;
+}
+
+
+/**
+ * Move entry @from to position @to, shifting the entries in between.
+ */
+CFG_ACT_OPT_FUNC void
+cfg_act_opt_move(CFG_ACT_OPT_MEM struct cfg_act_opt *opt, uint32_t from,
+                 uint32_t to)
+{
+    uint32_t op = opt->op[from];
+    uint32_t args = opt->args[from];
+    uint32_t param = opt->param[from];
+    uint32_t param2 = opt->param2[from];
+    uint32_t i = from;
+
+    for (; i < to; i++) {
+        opt->op[i] = opt->op[i + 1];
+        opt->args[i] = opt->args[i + 1];
+        opt->param[i] = opt->param[i + 1];
+        opt->param2[i] = opt->param2[i + 1];
+    }
+    for (; i > to; i--) {
+        opt->op[i] = opt->op[i - 1];
+        opt->args[i] = opt->args[i - 1];
+        opt->param[i] = opt->param[i - 1];
+        opt->param2[i] = opt->param2[i - 1];
+    }
+
+    opt->op[to] = op;
+    opt->args[to] = args;
+    opt->param[to] = param;
+    opt->param2[to] = param2;
+}
+
+
+/**
+ * Try moving entry @from to position @to, keeping the move if it adds
+ * pipelined transitions to the list.
+ *
+ * @return non-zero if the move was kept
+ */
+CFG_ACT_OPT_FUNC int
+cfg_act_opt_try_move(CFG_ACT_OPT_MEM struct cfg_act_opt *opt,
+                     uint32_t from, uint32_t to)
+{
+    uint32_t before = cfg_act_opt_count(opt, 0, opt->count);
+
+    cfg_act_opt_move(opt, from, to);
+    if (cfg_act_opt_count(opt, 0, opt->count) > before)
+        return 1;
+
+    cfg_act_opt_move(opt, to, from);
+    return 0;
+}
+
+
+/**
+ * Move actions past the actions they commute with while that adds
+ * pipelined transitions. Each move strictly raises the count, so this
+ * terminates. Swapping neighbours alone is not enough, e.g. RSS has to
+ * pass both DST_MAC_MATCH and CHECKSUM to reach TX_HOST.
+ *
+ * @return number of moves made
+ */
+CFG_ACT_OPT_FUNC uint32_t
+cfg_act_opt_reorder(CFG_ACT_OPT_MEM struct cfg_act_opt *opt)
+{
+    uint32_t i, j;
+    uint32_t moves = 0;
+    uint32_t changed = 1;
+
+    while (changed) {
+        changed = 0;
+
+        for (i = 0; i < opt->count && !changed; i++) {
+            for (j = i + 1; j < opt->count && !changed; j++) {
+                if (!cfg_act_opt_commute(opt->op[i], opt->args[i],
+                                         opt->op[j], opt->args[j]))
+                    break;
+                changed = cfg_act_opt_try_move(opt, i, j);
+            }
+
+            for (j = i; j > 0 && !changed; j--) {
+                if (!cfg_act_opt_commute(opt->op[j - 1], opt->args[j - 1],
+                                         opt->op[i], opt->args[i]))
+                    break;
+                changed = cfg_act_opt_try_move(opt, i, j - 1);
+            }
+        }
+
+        moves += changed;
+    }
+
+    return moves;
+}
+
+
+/**
+ * Run all optimisation passes over a decoded action list.
+ *
+ * @return non-zero if the list was changed
+ */
+CFG_ACT_OPT_FUNC uint32_t
+cfg_act_opt_run(CFG_ACT_OPT_MEM struct cfg_act_opt *opt)
+{
+    uint32_t changes;
+
+    changes = cfg_act_opt_checksum(opt);
+    changes += cfg_act_opt_reorder(opt);
+
+    /* Reordering can bring CHECKSUM actions together */
+    if (changes)
+        changes += cfg_act_opt_checksum(opt);
+
+    return changes;
+}
+
+
+/**
+ * Check if cfg_act_chain() ends the segment with INSTR_CHAIN before an
+ * action of @words words at word @pos, with @remain words of the list from
+ * @pos on. Segment 1 ends at word @head rather than at NIC_MAX_INSTR, the
+ * flow cache keeps its tag in the words after a VEB list.
+ */
+CFG_ACT_OPT_FUNC int
+cfg_act_opt_seg_end(uint32_t pos, uint32_t words, uint32_t remain,
+                    uint32_t head)
+{
+    uint32_t end = (pos / NIC_INSTR_SEG + 1) * NIC_INSTR_SEG;
+
+    if (end == NIC_MAX_INSTR)
+        end = head;
+
+    /* Unless the rest of the list fits, one word is left for INSTR_CHAIN */
+    return pos + remain > end && pos + words >= end;
+}
+
+#endif /* _APP_CONFIG_OPTIMIZE_H_ */
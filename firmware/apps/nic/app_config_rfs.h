@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file          apps/nic/app_config_rfs.h
+ * @brief         Accelerated RFS flow table consulted by INSTR_RSS
+ *
+ * _nic_rfs_tbl steers flows to the queue of the CPU consuming them, for
+ * the vNICs that set NIC_RSS_CFG_RFS. A flow is identified by its RSS hash,
+ * the RSS table index of the vNIC, vnic + pcie * NS_PLATFORM_NUM_PORTS,
+ * which is how the kernel knows the flows it asks the driver to steer
+ * (ndo_rx_flow_steer), and a flow ID. Flows of a vNIC with the same hash
+ * but another flow ID miss their entry and are left to RSS.
+ *
+ * The flow ID is a CRC32c of the tuple, independent of the RSS hash. The
+ * tuple is the source and the destination address of the (inner) IP
+ * header, 16 bytes each with an IPv4 address in the first 4 followed by zeros, then the source and the
+ * destination port, zero for fragments and protocols other than TCP and
+ * UDP: 36 bytes in packet order, also for symmetric hashes. In kernel terms
+ * the flow ID is bitrev32(crc32c(~0, tuple, 36)), the remainder of the CRC
+ * unit.
+ *
+ * INSTR_RSS looks the flow up after computing the hash, reading the bucket
+ * with the RSS indirection table. A live entry for the flow selects the
+ * queue instead of the indirection table, unless the queue is beyond the
+ * last one enabled. Queues selected by INSTR_ACL take precedence, as
+ * ethtool ntuple filters do over aRFS.
+ *
+ * The table has NIC_RFS_BUCKETS buckets of NIC_RFS_WAYS entries, the
+ * bucket being (hash ^ table index) % NIC_RFS_BUCKETS:
+ *
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +---------------------------------------------------------------+
+ *    0  |                           RSS hash                            |
+ *       +-+-+-----------+---------------+-------------------------------+
+ *    1  |V|0| Table idx |     Queue     |             Stamp             |
+ *       +-+-+-----------+---------------+-------------------------------+
+ *    2  |                            Flow ID                            |
+ *       +---------------------------------------------------------------+
+ *    3  |                               0                               |
+ *       +---------------------------------------------------------------+
+ *
+ * The stamp is TIMESTAMP_LOW >> NIC_RFS_STAMP_SHF of the last use, about
+ * 0.9 ms per unit at 1.2 GHz. Entries unused for NIC_RFS_TIMEOUT units
+ * (about 3.6 s) have expired: lookups miss them and updates reuse them.
+ * Lookups refresh the stamp of a hit at most every NIC_RFS_TOUCH units,
+ * so a busy flow costs one write per interval rather than one per packet.
+ * A refresh racing with an update of the same bucket may restore the entry
+ * the update replaced. The stamp wraps after about 57 s, an entry unused
+ * for that long may look recent again until it is replaced.
+ *
+ * The host updates the table in batches with a CMSG_TYPE_RFS control
+ * message on the control vNIC, of up to NIC_RFS_BATCH_MAX entries. Words
+ * are big endian, like the header of the map messages. The map ME answers
+ * with CMSG_TYPE_RFS_REPLY:
+ *
+ * Request
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +---------------+---------------+-------------------------------+
+ *    0  |  CMSG_TYPE_RFS|    version    |              tag              |
+ *       +---------------+---------------+-------------------------------+
+ *    1  |                        Entry count (n)                        |
+ *       +---------------------------------------------------------------+
+ *  2+4i |                           RSS hash                            |
+ *       +-+-+-----------+---------------+-------------------------------+
+ *  3+4i |D|0| Table idx |     Queue     |               0               |
+ *       +-+-+-----------+---------------+-------------------------------+
+ *  4+4i |                            Flow ID                            |
+ *       +---------------------------------------------------------------+
+ *  5+4i |                               0                               |
+ *       +---------------------------------------------------------------+
+ *
+ * Reply
+ *       +---------------+---------------+-------------------------------+
+ *    0  |     0x8a      |    version    |              tag              |
+ *       +---------------+---------------+-------------------------------+
+ *    1  |               CMSG_RC_SUCCESS or CMSG_RC_ERR_E2BIG            |
+ *       +---------------------------------------------------------------+
+ *    2  |                       Entries written                         |
+ *       +---------------------------------------------------------------+
+ *
+ * An entry steers the flow to the queue, replacing the entry of the flow
+ * if there is one, else a free or expired entry of the bucket, else the
+ * least recently used one. D removes the entry of the flow instead. The
+ * map ME handles the entries in order, one bucket read and write each.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _APP_CONFIG_RFS_H_
+#define _APP_CONFIG_RFS_H_
+
+#define NIC_RFS_BUCKET_BITS     13
+#define NIC_RFS_BUCKETS         (1 << NIC_RFS_BUCKET_BITS)
+#define NIC_RFS_WAYS            2
+#define NIC_RFS_ENTRY_LW        4
+#define NIC_RFS_ENTRY_SZ        (NIC_RFS_ENTRY_LW * 4)
+#define NIC_RFS_BUCKET_LW       (NIC_RFS_WAYS * NIC_RFS_ENTRY_LW)
+#define NIC_RFS_BUCKET_SHF      5
+#define NIC_RFS_TBL_SZ          (NIC_RFS_BUCKETS << NIC_RFS_BUCKET_SHF)
+
+/* Entry word 1, and word 3 + 4i of the request */
+#define NIC_RFS_VALID_bit       31
+#define NIC_RFS_DELETE_bit      31
+#define NIC_RFS_TBL_shf         24
+#define NIC_RFS_TBL_msk         0x3f
+#define NIC_RFS_QUEUE_shf       16
+#define NIC_RFS_QUEUE_msk       0xff
+#define NIC_RFS_STAMP_msk       0xffff
+#define NIC_RFS_FLOW_ID_wrd     2
+
+/* Ageing, in stamp units of (1 << NIC_RFS_STAMP_SHF) TIMESTAMP_LOW ticks */
+#define NIC_RFS_STAMP_SHF       16
+#define NIC_RFS_TIMEOUT_SHF     12
+#define NIC_RFS_TIMEOUT         (1 << NIC_RFS_TIMEOUT_SHF)
+#define NIC_RFS_TOUCH_SHF       8
+#define NIC_RFS_TOUCH           (1 << NIC_RFS_TOUCH_SHF)
+
+/* CMSG_TYPE_RFS */
+#define NIC_RFS_BATCH_MAX       64
+#define CMSG_RFS_COUNT_IDX      1
+#define CMSG_RFS_ENTRY_IDX      2
+#define CMSG_RFS_REPLY_LW       3
+
+#if defined(__NFP_LANG_ASM)
+
+    .alloc_mem _nic_rfs_tbl emem global NIC_RFS_TBL_SZ 256
+
+#elif defined(__NFP_LANG_MICROC)
+
+    __asm
+    {
+        .alloc_mem _nic_rfs_tbl emem global NIC_RFS_TBL_SZ 256
+    }
+
+#endif
+
+#if !defined(__NFP_LANG_ASM)
+
+#if defined(__NFP_LANG_MICROC)
+#define NIC_RFS_FUNC    __intrinsic
+#else
+#include <stdint.h>
+#define NIC_RFS_FUNC    static inline
+#endif
+
+/**
+ * nic_rfs_bucket
+ * Return the _nic_rfs_tbl word offset of the bucket of a flow.
+ *
+ * @param hash      RSS hash of the flow
+ * @param tbl_idx   RSS table index of the vNIC
+ */
+NIC_RFS_FUNC uint32_t
+nic_rfs_bucket(uint32_t hash, uint32_t tbl_idx)
+{
+    return ((hash ^ tbl_idx) & (NIC_RFS_BUCKETS - 1)) * NIC_RFS_BUCKET_LW;
+}
+
+#endif
+
+#endif /* _APP_CONFIG_RFS_H_ */
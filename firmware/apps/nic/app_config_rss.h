@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file          apps/nic/app_config_rss.h
+ * @brief         Per vNIC RSS hash selection used by INSTR_RSS
+ *
+ * INSTR_RSS hashes with CRC-32, seeded with the first word of the RSS key,
+ * unless the vNIC selects Toeplitz. The Toeplitz hash is that of the
+ * Microsoft RSS specification over the same input, the source address,
+ * destination address, source port and destination port in network byte
+ * order, with the full NFP_NET_CFG_RSS_KEY as key. Software can predict
+ * the queue of a flow with it, as with other NICs. Toeplitz costs about
+ * 100 cycles per 32 bit word of input, against a few for CRC-32, so an
+ * IPv6 4-tuple takes around 900 cycles.
+ *
+ * The symmetric mode, for either function, swaps the addresses if the
+ * destination is lower than the source and swaps the ports if the
+ * destination port is lower than the source port, comparing them as
+ * unsigned numbers in network byte order. Both directions of a flow then
+ * hash to the same value.
+ *
+ * Toeplitz is selected by the driver through NFP_NET_CFG_RSS_TOEPLITZ in
+ * NFP_NET_CFG_RSS_CTRL, if NFD_RSS_HASH_FUNC advertises it, or by the
+ * host writing the exported nic_rss_cfg table. Changes take effect on the
+ * next reconfiguration or NIC_CFG_RELOAD.
+ *
+ * RSS hashes the innermost IP header and L4 ports the parser finds. The
+ * driver enables VXLAN, GENEVE and NVGRE parsing, the NIC_RSS_CFG_TUN_*
+ * flags further tunnels for wire ingress: IP carried by GRE, GENEVE and
+ * GTP-U G-PDUs (UDP port 2152, extension headers skipped), IP after MPLS
+ * labels other than the explicit null labels, recognised by the IP
+ * version of the payload, and MPLS over UDP (RFC 7510). These packets are
+ * otherwise hashed on their outer headers, or not at all for MPLS. The
+ * checksum and ACL actions then use the same inner headers. GTP-U and
+ * MPLS over UDP share the PV_PROTO classes of VXLAN. With
+ * NIC_RSS_CFG_TUN_IP, IPv4 UDP packets to port 2152 are not classified
+ * from the NBI metadata alone.
+ *
+ * With NIC_RSS_CFG_RFS, flows the host steered with CMSG_TYPE_RFS bypass
+ * the indirection table, see app_config_rfs.h.
+ *
+ * The driver writes NFP_NET_CFG_RSS_ITBL_SZ indirection table entries.
+ * With NIC_RSS_TBL_ENTRIES above that, a table that is round robin over
+ * the queues, entry i being i % n as the driver writes by default, stays
+ * round robin over the larger table and any other table is repeated. A
+ * 128 entry table over 48 queues gives 3 entries to some queues and 2 to
+ * others, 12.5% more traffic than the mean for the former, 512 entries
+ * 3%. nic_rss_tbl_queues() is shared with the host model, which checks
+ * the spread of both tables.
+ *
+ * NFD queues are numbered from the first queue of the vNIC, modulo the 64
+ * of a PCIe island. A table naming a queue past the NFD queues of the vNIC
+ * would steer to another vNIC, upd_rss_table() keeps the previous table
+ * and counts cfg_error_rss_cntr instead (see nic_rss_tbl_max()).
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _APP_CONFIG_RSS_H_
+#define _APP_CONFIG_RSS_H_
+
+/* nic_rss_cfg flags */
+#define NIC_RSS_CFG_TOEPLITZ        (1 << 0)
+#define NIC_RSS_CFG_SYMMETRIC       (1 << 1)
+#define NIC_RSS_CFG_TUN_IP          (1 << 2)    /* IP in GRE, GENEVE, GTP-U */
+#define NIC_RSS_CFG_TUN_MPLS        (1 << 3)    /* IP after any MPLS label */
+#define NIC_RSS_CFG_TUN_MPLS_UDP    (1 << 4)    /* MPLS over UDP */
+#define NIC_RSS_CFG_RFS             (1 << 5)    /* see app_config_rfs.h */
+
+#if !defined(__NFP_LANG_ASM)
+
+#if defined(__NFP_LANG_MICROC)
+#define NIC_RSS_FUNC    __intrinsic
+#define NIC_RSS_MEM     __lmem
+#else
+#include <stdint.h>
+#define NIC_RSS_FUNC    static inline
+#define NIC_RSS_MEM
+#endif
+
+/**
+ * RSS hash selection and tunnel parsing of a vNIC, written by the host to
+ * the exported nic_rss_cfg table.
+ */
+struct nic_rss_cfg {
+    uint32_t flags;         /* NIC_RSS_CFG_* */
+    uint32_t reserved[3];
+};
+
+/**
+ * nic_rss_tbl_queues
+ * Return the number of queues of a round robin indirection table, or 0
+ * for any other table.
+ *
+ * @param tbl       Table entries, four to a word with the first in the MSB
+ * @param entries   Number of entries
+ */
+NIC_RSS_FUNC uint32_t
+nic_rss_tbl_queues(NIC_RSS_MEM uint32_t *tbl, uint32_t entries)
+{
+    uint32_t queues = 0;
+    uint32_t queue = 0;
+    uint32_t entry;
+    uint32_t i;
+
+    for (i = 0; i < entries; i++) {
+        entry = (tbl[i / 4] >> (24 - 8 * (i & 3))) & 0xff;
+
+        /* The first wrap to queue 0 gives the number of queues */
+        if (!queues && i && !entry) {
+            queues = i;
+            queue = 0;
+        }
+        if (entry != queue)
+            return 0;
+        if (++queue == queues)
+            queue = 0;
+    }
+
+    return queues;
+}
+
+/**
+ * nic_rss_tbl_max
+ * Return the highest queue of an indirection table.
+ *
+ * @param tbl       Table entries, four to a word with the first in the MSB
+ * @param entries   Number of entries
+ */
+NIC_RSS_FUNC uint32_t
+nic_rss_tbl_max(NIC_RSS_MEM uint32_t *tbl, uint32_t entries)
+{
+    uint32_t max = 0;
+    uint32_t entry;
+    uint32_t i;
+
+    for (i = 0; i < entries; i++) {
+        entry = (tbl[i / 4] >> (24 - 8 * (i & 3))) & 0xff;
+        if (entry > max)
+            max = entry;
+    }
+
+    return max;
+}
+
+#endif
+
+#endif /* _APP_CONFIG_RSS_H_ */
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file          apps/nic/app_config_sample.h
+ * @brief         Packet sampling to the control vNIC used by INSTR_SAMPLE
+ *
+ * INSTR_SAMPLE picks packets at random with probability 1 / rate and
+ * sends the first snap length bytes of each to the control vNIC queue,
+ * as a control message of type CMSG_TYPE_SAMPLE. The sample shares the
+ * packet buffer with the original, which continues with the rest of its
+ * action list. Nothing is copied: the worker writes the message header
+ * into the buffer headroom and queues a second NFD descriptor for the
+ * buffer, starting NIC_SAMPLE_HEADROOM bytes before the packet:
+ *
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +---------------+---------------+-+-------------+---------------+
+ *    0  |  cmsg_type    |    version    |0|     Ingress port or queue   |
+ *       +---------------+---------------+-+-------------+---------------+
+ *    1  |         Frame length          |         Pad length            |
+ *       +-------------------------------+-------------------------------+
+ *    2  |                    TIMESTAMP_LOW of the ME                    |
+ *       +---------------------------------------------------------------+
+ *    3  |                           Reserved                            |
+ *       +---------------------------------------------------------------+
+ *       |                     Pad (Pad length bytes)                    |
+ *       +---------------------------------------------------------------+
+ *       |                 Frame, truncated to snap length               |
+ *       +---------------------------------------------------------------+
+ *
+ * The ingress field is PV_QUEUE_IN: bit 8 set for a wire port, clear for
+ * a host queue ((pcie << 6) | queue). The frame length is that of the
+ * whole packet, the frame in the message may be shorter. Actions after
+ * INSTR_SAMPLE prepend metadata or an NBI packet modifier script to the
+ * original in the pad, so its contents are undefined. They may also
+ * change the packet itself before the sample is DMAed, so INSTR_SAMPLE
+ * is placed after the actions that edit the packet.
+ *
+ * Packets with less than NIC_SAMPLE_MIN_OFFSET bytes of headroom, which
+ * would overlap the buffer metadata, are not sampled. Samples that find
+ * no NFD credits on the control queue are dropped, _nic_sample_cntrs
+ * counts both kinds of skipped samples next to the samples sent.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _APP_CONFIG_SAMPLE_H_
+#define _APP_CONFIG_SAMPLE_H_
+
+#define NIC_SAMPLE_HDR_SZ       16
+#define NIC_SAMPLE_HEADROOM     64
+#define NIC_SAMPLE_PAD_SZ       (NIC_SAMPLE_HEADROOM - NIC_SAMPLE_HDR_SZ)
+#define NIC_SAMPLE_MIN_OFFSET   (NIC_SAMPLE_HEADROOM + 16)
+#define NIC_SAMPLE_SNAP_MAX     512
+
+/* 64 bit counters in _nic_sample_cntrs */
+#define NIC_SAMPLE_CNTR_TX          0
+#define NIC_SAMPLE_CNTR_NO_CREDIT   1
+#define NIC_SAMPLE_CNTR_NO_ROOM     2
+#define NIC_SAMPLE_CNTRS            4
+
+#if defined(__NFP_LANG_ASM)
+
+    .alloc_mem _nic_sample_cntrs emem global (NIC_SAMPLE_CNTRS * 8) 256
+
+#elif defined(__NFP_LANG_MICROC)
+
+    __asm
+    {
+        .alloc_mem _nic_sample_cntrs emem global (NIC_SAMPLE_CNTRS * 8) 256
+    }
+
+#endif
+
+#if !defined(__NFP_LANG_ASM)
+
+#if defined(__NFP_LANG_MICROC)
+#define NIC_SAMPLE_FUNC     __intrinsic
+#else
+#include <stdint.h>
+#define NIC_SAMPLE_FUNC     static inline
+#endif
+
+/**
+ * Sampling of a vNIC, written by the host to the exported nic_sample_cfg
+ * table and applied on the next reconfiguration or NIC_CFG_RELOAD. A
+ * zero rate disables sampling.
+ */
+struct nic_sample_cfg {
+    uint32_t rate;          /* 1 in rate packets */
+    uint32_t snaplen;       /* bytes, at most NIC_SAMPLE_SNAP_MAX */
+    uint32_t reserved[2];
+};
+
+
+/**
+ * Convert a sampling rate to the INSTR_SAMPLE threshold: a packet is
+ * sampled if the ME's PSEUDO_RANDOM_NUMBER is at most the threshold.
+ */
+NIC_SAMPLE_FUNC uint32_t
+nic_sample_threshold(uint32_t rate)
+{
+    if (rate <= 1)
+        return 0xffffffff;
+
+    return 0xffffffff / rate;
+}
+
+#endif
+
+#endif /* _APP_CONFIG_SAMPLE_H_ */
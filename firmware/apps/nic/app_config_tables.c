@@ -33,7 +33,14 @@
 #include "maps/cmsg_map_types.h"
 #include "app_config_tables.h"
 #include "app_config_instr.h"
+#include "app_config_acl.h"
+#include "app_config_csum.h"
+#include "app_config_meter.h"
+#include "app_config_rss.h"
+#include "app_config_sample.h"
+#include "app_config_optimize.h"
 #include "ebpf.h"
+#include "flow_cache.h"
 #include "nic_tables.h"
 
 /*
@@ -51,13 +58,15 @@
     No VFs
 
     Wire -> PF
-    RX_WIRE -> MAC_MATCH -> CHECKSUM(C) -> BPF -> RSS -> TX_HOST(PF)
+    RX_WIRE -> MAC_MATCH -> CHECKSUM(C|V) -> BPF -> RSS -> TX_HOST(PF)
 
     Wire -> PF (promisc)
-    RX_WIRE -> CHECKSUM(C) -> BPF -> RSS -> TX_HOST(PF)
+    RX_WIRE -> CHECKSUM(C|V) -> BPF -> RSS -> TX_HOST(PF)
 
     Host -> Wire
-    RX_HOST -> CHECKSUM(I) -> TX_WIRE
+    RX_HOST -> CHECKSUM(I,S) -> TX_WIRE
+
+    V and S only with nic_csum_cfg, see app_config_csum.h
 
     Wire -> Host (SR-IOV)
 
@@ -105,11 +114,28 @@
     RX_HOST -> VEB_LOOKUP -hit-> [CHECKSUM(O,I,C) -> BPF -> RSS -> TX_HOST(PF)]
  */
 
+/*
+ * Opcode field value for each enum instruction_ops entry, and the value of
+ * the action whose handler follows it in the worker code store. The build
+ * generates both from the datapath .list file (see parse_list.py), giving
+ * the offset of each handler from the worker's dispatch jump base. The
+ * identity fallback keeps the enum values for builds without a datapath,
+ * such as the app master unit tests.
+ */
+#ifdef ACTIONS_JUMP_TABLE
+#include "actions_jump_table.h"
+#else
 uint32_t cfg_act_map[] = {
     0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
     16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
 };
 
+uint32_t cfg_act_next[] = {
+    1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 16,
+    17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32,
+};
+#endif
+
 /*
  * Global declarations for configuration change management
  */
@@ -176,12 +202,52 @@ struct mac_addr {
     };
 };
 
+/* Owner of each set of NIC_INSTR_EXT_BLOCKS chained list blocks, plus one
+ * (zero when free), see cfg_act_chain(). A set written since the last
+ * cfg_act_commit() is only referenced by the bank the workers are not
+ * reading (CFG_ACT_EXT_NEW), a replaced set may still be in use until the
+ * next cfg_act_commit() (CFG_ACT_EXT_OLD). */
+#define CFG_ACT_EXT_NEW     0x8000
+#define CFG_ACT_EXT_OLD     0x4000
+__shared __lmem uint16_t cfg_act_ext_owner[NIC_INSTR_EXT_SLOTS] = {0};
+
+/* NIC_CFG_INSTR_TBL bank the workers read, cfg_act_write_queue() writes
+ * the other one, see app_config_instr.h */
+__shared __lmem uint32_t cfg_act_bank = 0;
+
+/* Entries of the bank not in use written since the last cfg_act_commit() */
+#define CFG_ACT_BANK_ENTRIES    (NIC_INSTR_BANK_SIZE / (NIC_MAX_INSTR * 4))
+__shared __lmem uint32_t cfg_act_dirty[(CFG_ACT_BANK_ENTRIES + 31) / 32];
+
+/* Time to wait for the workers to switch banks, epochs are normally
+ * completed by perq_stats_loop() every few microseconds */
+#define CFG_ACT_BANK_TIMEOUT    (NS_PLATFORM_TCLK * 1000) // 1ms
+#define CFG_ACT_BANK_RETRIES    10
+
+__export __emem uint64_t cfg_error_bank_cntr = 0;
+
+/* Decoded list, used by cfg_act_optimize() and cfg_act_chain() */
+__shared __lmem struct cfg_act_opt cfg_act_opt_scratch;
+
+/* Per vNIC tables written by the host, see process_cfg_reload() */
+__export __emem struct nic_meter_cfg nic_meter_cfg[NFD_MAX_ISL][NVNICS];
+__export __emem struct nic_sample_cfg nic_sample_cfg[NFD_MAX_ISL][NVNICS];
+__export __emem struct nic_acl_cfg nic_acl_cfg[NFD_MAX_ISL][NVNICS];
+__export __emem struct nic_rss_cfg nic_rss_cfg[NFD_MAX_ISL][NVNICS];
+__export __emem struct nic_csum_cfg nic_csum_cfg[NFD_MAX_ISL][NVNICS];
+
+/* nic_acl_cfg entries ignored for a table beyond NIC_ACL_MAX_TABLE */
+__export __emem uint64_t cfg_error_acl_cntr = 0;
+
 /* Store configured MAC address for when vNICs must be downed */
 __export __shared __cls struct mac_addr nvnic_macs[NFD_MAX_ISL][NVNICS];
 
 /* RSS table length in words */
 #define NFP_NET_CFG_RSS_ITBL_SZ_wrd (NFP_NET_CFG_RSS_ITBL_SZ >> 2)
 
+/* RSS table words written per command by upd_rss_table() */
+#define RSS_TBL_WR_LW       16
+
 /* Cluster target NN write defines and structures */
 typedef enum CT_ADDR_MODE
 {
@@ -322,13 +388,11 @@ init_nn_tables()
 }
 
 
-/* Write RSS indirection table */
+/* Write RSS indirection table or key table */
 __intrinsic void
-wr_rss_tbl(__xwrite uint32_t *xwr_rss,
-           uint32_t start_offset, uint32_t count)
+wr_rss_tbl_sym(__xwrite uint32_t *xwr_rss, __cls __addr32 void *tbl,
+               uint32_t start_offset, uint32_t count)
 {
-    __cls __addr32 void *nic_rss_tbl = (__cls __addr32 void*)
-                                        __link_sym("NIC_RSS_TBL");
     SIGNAL sig;
     uint32_t addr_hi;
     uint32_t addr_lo;
@@ -338,7 +402,7 @@ wr_rss_tbl(__xwrite uint32_t *xwr_rss,
     ctassert(count <= 32);
 
     for (isl = 0; isl < sizeof(app_isl_ids) / sizeof(uint32_t); isl++) {
-        addr_lo = (uint32_t) nic_rss_tbl + start_offset;
+        addr_lo = (uint32_t) tbl + start_offset;
         addr_hi = app_isl_ids[isl] >> 4; /* only use island, mask out ME */
         addr_hi = (addr_hi << (34 - 8)); /* address shifted by 8 in instr */
 
@@ -354,6 +418,42 @@ wr_rss_tbl(__xwrite uint32_t *xwr_rss,
     return;
 }
 
+/* Write RSS indirection table, in CLS or in the CTM of each worker island */
+__intrinsic void
+wr_rss_tbl(__xwrite uint32_t *xwr_rss,
+           uint32_t start_offset, uint32_t count)
+{
+#ifdef NIC_RSS_TBL_CTM
+    __ctm __addr40 void *nic_rss_tbl =
+        (__ctm __addr40 void*) __link_sym("NIC_RSS_TBL");
+    SIGNAL sig;
+    uint32_t addr_hi;
+    uint32_t addr_lo;
+    uint32_t isl;
+    struct nfp_mecsr_prev_alu ind;
+
+    ctassert(count <= 16);
+
+    for (isl = 0; isl < sizeof(app_isl_ids) / sizeof(uint32_t); isl++) {
+        addr_lo = (uint32_t) nic_rss_tbl + start_offset;
+        addr_hi = (app_isl_ids[isl] >> 4) << (32 - 8);
+        addr_hi = (addr_hi | (1 << (39 - 8)));
+
+        ind.__raw = 0;
+        ind.ov_len = 1;
+        ind.length = count - 1;
+        __asm {
+            alu[--, --, B, ind.__raw]
+            mem[write32, *xwr_rss, addr_hi, <<8, addr_lo, \
+                __ct_const_val(count)], ctx_swap[sig], indirect_ref
+        }
+    }
+#else
+    wr_rss_tbl_sym(xwr_rss, (__cls __addr32 void*) __link_sym("NIC_RSS_TBL"),
+                   start_offset, count);
+#endif
+}
+
 /* Update RX wire instr -> one table entry per NBI queue/port */
 __intrinsic void
 upd_rx_wire_instr(__xwrite uint32_t *xwr_instr,
@@ -464,13 +564,19 @@ upd_ctm_vlan_members()
 //for each port size of table must be known and configured accordingly
 __intrinsic
 void upd_rss_table(uint32_t start_offset, __emem __addr40 uint8_t *bar_base,
-                   uint32_t vnic_port)
+                   uint32_t vnic_port, uint32_t max_queues)
 {
     __xread uint32_t rss_rd[RSS_TBL_SIZE_LW];
-    __xwrite uint32_t rss_wr[RSS_TBL_SIZE_LW];
+    __xwrite uint32_t rss_wr[RSS_TBL_WR_LW];
+    __lmem uint32_t rss_tbl[RSS_TBL_SIZE_LW];
+    uint32_t queues;
+    uint32_t queue = 0;
+    uint32_t offset;
+    uint32_t word;
     uint32_t i;
+    uint32_t j;
 
-    if ((start_offset + NFP_NET_CFG_RSS_ITBL_SZ > NIC_RSS_TBL_SIZE) ||
+    if ((start_offset + NIC_RSS_TBL_ENTRIES > NIC_RSS_TBL_SIZE) ||
         (vnic_port > NS_PLATFORM_NUM_PORTS)) {
         cfg_error_rss_cntr++;
         return;
@@ -479,9 +585,36 @@ void upd_rss_table(uint32_t start_offset, __emem __addr40 uint8_t *bar_base,
     mem_read32_swap(rss_rd, bar_base + NFP_NET_CFG_RSS_ITBL, sizeof(rss_rd));
 
     for (i = 0; i < RSS_TBL_SIZE_LW; i++)
-        rss_wr[i] = rss_rd[i];
+        rss_tbl[i] = rss_rd[i];
+
+    /* Queues past those of the vNIC wrap onto other vNICs in NFD */
+    if (nic_rss_tbl_max(rss_tbl, NFP_NET_CFG_RSS_ITBL_SZ) >= max_queues) {
+        cfg_error_rss_cntr++;
+        return;
+    }
 
-    wr_rss_tbl(rss_wr, start_offset, RSS_TBL_SIZE_LW);
+    /* Beyond NFP_NET_CFG_RSS_ITBL_SZ entries a round robin table stays
+     * round robin, other tables repeat (see app_config_rss.h) */
+    queues = nic_rss_tbl_queues(rss_tbl, NFP_NET_CFG_RSS_ITBL_SZ);
+
+    for (offset = 0; offset < NIC_RSS_TBL_ENTRIES;
+         offset += RSS_TBL_WR_LW * 4) {
+        for (i = 0; i < RSS_TBL_WR_LW; i++) {
+            if (queues) {
+                word = 0;
+                for (j = 0; j < 4; j++) {
+                    word = (word << 8) | queue;
+                    if (++queue == queues)
+                        queue = 0;
+                }
+            } else {
+                word = rss_tbl[(offset / 4 + i) & (RSS_TBL_SIZE_LW - 1)];
+            }
+            rss_wr[i] = word;
+        }
+
+        wr_rss_tbl(rss_wr, start_offset + offset, RSS_TBL_WR_LW);
+    }
 }
 
 __intrinsic void
@@ -549,23 +682,161 @@ cfg_act_init(action_list_t *acts)
 
 
 __intrinsic void
-cfg_act_write_queue(uint32_t qid, action_list_t *acts)
+cfg_act_append(action_list_t *acts, uint16_t op, uint16_t args)
+{
+    /* Fall through if this handler directly follows the previous one */
+    acts->instr[acts->count].pipeline =
+        (acts->count && cfg_act_next[acts->prev] == cfg_act_map[op]) ? 1 : 0;
+
+    acts->instr[acts->count].op = cfg_act_map[op];
+    acts->prev = op;
+
+    acts->instr[acts->count++].args = args;
+}
+
+
+/*
+ * Decode a list to one entry per action, as used by the optimiser.
+ * Returns zero if the list holds an opcode the optimiser does not know.
+ */
+__intrinsic int
+cfg_act_decode(action_list_t *acts, __lmem struct cfg_act_opt *opt)
+{
+    uint32_t i, op;
+
+    /* Map the opcode field values back to enum instruction_ops */
+    opt->count = 0;
+    for (i = 0; i < acts->count; i += cfg_act_opt_words(op)) {
+        for (op = 0; op < CFG_ACT_OPT_NUM_OPS; op++) {
+            if (cfg_act_map[op] == acts->instr[i].op)
+                break;
+        }
+        if (op == CFG_ACT_OPT_NUM_OPS)
+            return 0;
+
+        opt->op[opt->count] = op;
+        opt->args[opt->count] = acts->instr[i].args;
+        opt->param[opt->count] = (cfg_act_opt_words(op) >= 2) ?
+                                  acts->instr[i + 1].value : 0;
+        opt->param2[opt->count] = (cfg_act_opt_words(op) == 3) ?
+                                   acts->instr[i + 2].value : 0;
+        opt->count++;
+    }
+
+    return 1;
+}
+
+
+__intrinsic void
+cfg_act_optimize(action_list_t *acts)
+{
+    __lmem struct cfg_act_opt *opt = &cfg_act_opt_scratch;
+    uint32_t i;
+
+    if (!cfg_act_decode(acts, opt))
+        return;
+
+    if (!cfg_act_opt_run(opt))
+        return;
+
+    cfg_act_init(acts);
+    for (i = 0; i < opt->count; i++) {
+        cfg_act_append(acts, opt->op[i], opt->args[i]);
+        if (cfg_act_opt_words(opt->op[i]) >= 2)
+            acts->instr[acts->count++].value = opt->param[i];
+        if (cfg_act_opt_words(opt->op[i]) == 3)
+            acts->instr[acts->count++].value = opt->param2[i];
+    }
+}
+
+
+/*
+ * Find the chained list blocks of @owner, allocating a free set if
+ * @alloc is set and releasing them otherwise. Blocks the workers may be
+ * reading are not reused, they are released by cfg_act_commit().
+ * Returns the set index, or NIC_INSTR_EXT_SLOTS if there is none.
+ */
+__intrinsic uint32_t
+cfg_act_ext_slot(uint32_t owner, uint32_t alloc)
+{
+    uint32_t i;
+    uint32_t free = NIC_INSTR_EXT_SLOTS;
+
+    for (i = 0; i < NIC_INSTR_EXT_SLOTS; i++) {
+        if ((cfg_act_ext_owner[i] & ~CFG_ACT_EXT_NEW) == owner + 1) {
+            if (cfg_act_ext_owner[i] & CFG_ACT_EXT_NEW) {
+                if (!alloc)
+                    cfg_act_ext_owner[i] = 0;
+                return i;
+            }
+            cfg_act_ext_owner[i] |= CFG_ACT_EXT_OLD;
+        }
+        if (cfg_act_ext_owner[i] == 0 && free == NIC_INSTR_EXT_SLOTS)
+            free = i;
+    }
+
+    if (!alloc || free == NIC_INSTR_EXT_SLOTS)
+        return NIC_INSTR_EXT_SLOTS;
+
+    cfg_act_ext_owner[free] = (owner + 1) | CFG_ACT_EXT_NEW;
+    return free;
+}
+
+
+__intrinsic uint32_t
+cfg_act_bank_addr(uint32_t bank)
+{
+    if (bank)
+        return (uint32_t) __link_sym("NIC_CFG_INSTR_BANK1");
+
+    return (uint32_t) __link_sym("NIC_CFG_INSTR_TBL");
+}
+
+
+/*
+ * Read NIC_MAX_INSTR instruction words from CLS address @addr of the first
+ * app island.
+ */
+__intrinsic void
+cfg_act_read_block(uint32_t addr, __lmem union instruction_format *instr)
+{
+    SIGNAL sig;
+    uint32_t addr_hi;
+    struct nfp_mecsr_prev_alu ind;
+    __xread uint32_t xrd_instr[NIC_MAX_INSTR];
+
+    addr_hi = app_isl_ids[0] >> 4; /* only use island, mask out ME */
+    addr_hi = (addr_hi << (34 - 8)); /* address shifted by 8 in instr */
+
+    ind.__raw = 0;
+    ind.ov_len = 1;
+    ind.length = NIC_MAX_INSTR - 1;
+    __asm {
+        alu[--, --, B, ind.__raw]
+        cls[read, *xrd_instr, addr_hi, <<8, addr, \
+            __ct_const_val(NIC_MAX_INSTR)], ctx_swap[sig], indirect_ref
+    }
+
+    reg_cp((void *) instr, xrd_instr, NIC_MAX_INSTR << 2);
+}
+
+
+/*
+ * Write @count instruction words to CLS address @addr on all app islands.
+ */
+__intrinsic void
+cfg_act_write_block(uint32_t addr, __lmem union instruction_format *instr,
+                    uint32_t count)
 {
     SIGNAL sig;
     uint32_t addr_hi;
-    uint32_t addr_lo;
     uint32_t isl;
-    uint32_t count;
     struct nfp_mecsr_prev_alu ind;
     __xwrite uint32_t xwr_instr[NIC_MAX_INSTR];
-    __cls __addr32 void *nic_cfg_instr_tbl = (__cls __addr32 void*)
-                                              __link_sym("NIC_CFG_INSTR_TBL");
 
-    reg_cp(xwr_instr, (void *) acts->instr, NIC_MAX_INSTR << 2);
-    count = acts->count;
+    reg_cp(xwr_instr, (void *) instr, NIC_MAX_INSTR << 2);
 
     for (isl = 0; isl < sizeof(app_isl_ids) / sizeof(uint32_t); isl++) {
-        addr_lo = (uint32_t) nic_cfg_instr_tbl + qid * NIC_MAX_INSTR * 4;
         addr_hi = app_isl_ids[isl] >> 4; /* only use island, mask out ME */
         addr_hi = (addr_hi << (34 - 8)); /* address shifted by 8 in instr */
 
@@ -574,42 +845,218 @@ cfg_act_write_queue(uint32_t qid, action_list_t *acts)
         ind.length = count - 1;
         __asm {
             alu[--, --, B, ind.__raw]
-            cls[write, *xwr_instr, addr_hi, <<8, addr_lo, \
+            cls[write, *xwr_instr, addr_hi, <<8, addr, \
                 __ct_const_val(count)], ctx_swap[sig], indirect_ref
         }
     }
 }
 
 
+/*
+ * Lay out a list longer than @head words as segments joined by INSTR_CHAIN
+ * (see app_config_instr.h). Segments 0 and 1 stay at the start of the
+ * list for the caller to write to the port's entries or VEB map entry, the
+ * others are written to the extension blocks of @owner. Segment 1 ends by
+ * word @head, NIC_MAX_INSTR unless the words after it are used otherwise.
+ * A list that does not fit is replaced by a drop.
+ */
 __intrinsic void
-cfg_act_write_host(uint32_t pcie, uint32_t vid, action_list_t *acts)
+cfg_act_chain(action_list_t *acts, uint32_t owner, uint32_t head)
 {
-    uint32_t i;
+    __lmem struct cfg_act_opt *opt = &cfg_act_opt_scratch;
+    __lmem uint32_t chain_idx[NIC_MAX_INSTR_CHAIN / NIC_INSTR_SEG];
+    uint32_t i, words, remain, num_seg;
+    uint32_t slot, ext, args;
+    uint32_t num_chain = 0;
+
+    slot = cfg_act_ext_slot(owner, acts->count > head);
+    if (acts->count <= head)
+        return;
 
-    for (i = 0; i < NFD_VID_MAXQS(vid); ++i)
-        cfg_act_write_queue((pcie << 6) | NFD_VID2QID(vid, i), acts);
+    if (slot == NIC_INSTR_EXT_SLOTS || !cfg_act_decode(acts, opt))
+        goto drop;
+
+    remain = acts->count;
+    cfg_act_init(acts);
+    for (i = 0; i < opt->count; i++) {
+        words = cfg_act_opt_words(opt->op[i]);
+
+        if (cfg_act_opt_seg_end(acts->count, words, remain, head)) {
+            chain_idx[num_chain++] = acts->count;
+            cfg_act_append(acts, INSTR_CHAIN, 0);
+            while (acts->count % NIC_INSTR_SEG)
+                acts->instr[acts->count++].value = 0;
+        }
+
+        if (acts->count + words > NIC_MAX_INSTR_CHAIN)
+            goto drop;
+
+        cfg_act_append(acts, opt->op[i], opt->args[i]);
+        if (words >= 2)
+            acts->instr[acts->count++].value = opt->param[i];
+        if (words == 3)
+            acts->instr[acts->count++].value = opt->param2[i];
+        remain -= words;
+    }
+
+    /* Segment k + 2 is fetched at the end of segment k, into the half of
+     * $__actions that segment k executed from */
+    ext = (uint32_t) __link_sym("NIC_CFG_INSTR_TBL") + NIC_INSTR_EXT_BASE +
+          slot * NIC_INSTR_EXT_BLOCKS * NIC_MAX_INSTR * 4;
+    num_seg = (acts->count + NIC_INSTR_SEG - 1) / NIC_INSTR_SEG;
+    for (i = 0; i < num_chain; i++) {
+        args = (i > 0) ? CFG_ACT_OPT_BIT(INSTR_CHAIN_JOIN_bf) : 0;
+        if (i + 2 < num_seg) {
+            args |= ext + i * NIC_INSTR_SEG * 4;
+            args |= CFG_ACT_OPT_BIT(INSTR_CHAIN_FETCH_bf);
+        }
+        acts->instr[chain_idx[i]].args = args;
+    }
+
+    for (i = NIC_MAX_INSTR; i < acts->count; i += NIC_MAX_INSTR) {
+        words = acts->count - i;
+        if (words > NIC_MAX_INSTR)
+            words = NIC_MAX_INSTR;
+        cfg_act_write_block(ext + (i - NIC_MAX_INSTR) * 4, &acts->instr[i],
+                            words);
+    }
+
+    return;
+
+drop:
+    cfg_act_ext_slot(owner, 0);
+    cfg_act_init(acts);
+    cfg_act_append(acts, INSTR_DROP, 0);
 }
 
 
+/*
+ * Write the list of @qid to the bank the workers are not reading, it is
+ * used from the next cfg_act_commit().
+ */
 __intrinsic void
-cfg_act_write_wire(uint32_t port, action_list_t *acts)
+cfg_act_write_queue(uint32_t qid, action_list_t *acts)
 {
-    cfg_act_write_queue((1 << 8) | port, acts);
+    uint32_t count = acts->count;
+
+    /* Words past NIC_MAX_INSTR are in the blocks written by cfg_act_chain */
+    if (count > NIC_MAX_INSTR)
+        count = NIC_MAX_INSTR;
+
+    cfg_act_write_block(cfg_act_bank_addr(!cfg_act_bank) +
+                        qid * NIC_MAX_INSTR * 4, acts->instr, count);
+    cfg_act_dirty[qid / 32] |= 1 << (qid % 32);
 }
 
 
+/* Workers pick up @bank from NN on the next epoch */
 __intrinsic void
-cfg_act_append(action_list_t *acts, uint16_t op, uint16_t args)
+cfg_act_bank_select(uint32_t bank)
 {
-    uint32_t precursor_act = 2 * cfg_act_map[op] - cfg_act_map[op + 1];
+    SIGNAL sig;
+    uint32_t i;
+    union ct_nn_write_format command;
+    __xwrite uint32_t xwr_bank;
 
-    acts->instr[acts->count].pipeline =
-        (acts->count && acts->prev == precursor_act) ? 1 : 0;
+    command.value = 0;
+    command.sig_num = 0x0;
+    command.addr_mode = CT_ADDR_MODE_ABSOLUTE;
+    command.NN_reg_num = NIC_INSTR_BANK_NN_IDX;
+    xwr_bank = bank;
+    for (i = 0; i < sizeof(cfg_mes_ids) / sizeof(uint32_t); i++) {
+        command.remote_isl = cfg_mes_ids[i] >> 4;
+        command.master = cfg_mes_ids[i] & 0x0f;
+        ct_nn_write(&xwr_bank, &command, 1, ctx_swap, &sig);
+    }
+}
 
-    acts->instr[acts->count].op = cfg_act_map[op];
-    acts->prev = cfg_act_map[op];
 
-    acts->instr[acts->count++].args = args;
+/*
+ * Switch the workers to the bank holding the lists written since the last
+ * call, then bring the other bank up to date for the next changes. Lists
+ * of all queues written in between take effect together, and no packet
+ * sees a partly written list.
+ *
+ * If the workers do not complete an epoch in CFG_ACT_BANK_RETRIES
+ * timeouts, they are sent back to the old bank, which is still whole, and
+ * the lists stay dirty for the next call. Returns 0 on success and -1 if
+ * the new lists are not in use.
+ */
+__intrinsic int
+cfg_act_commit()
+{
+    uint32_t i, j, offset;
+    uint32_t retries;
+    uint32_t bank = !cfg_act_bank;
+    __lmem union instruction_format instr[NIC_MAX_INSTR];
+
+    for (i = 0; i < sizeof(cfg_act_dirty) / sizeof(uint32_t); i++) {
+        if (cfg_act_dirty[i])
+            break;
+    }
+    if (i == sizeof(cfg_act_dirty) / sizeof(uint32_t))
+        return 0;
+
+    cfg_act_bank_select(bank);
+
+    /* Once the epoch completes no worker reads the old bank. Copying over
+     * (or later writing) a list a worker may still execute would corrupt
+     * it, so do neither until then. */
+    for (retries = 0; nic_local_epoch_wait(CFG_ACT_BANK_TIMEOUT); retries++) {
+        cfg_error_bank_cntr++;
+        if (retries == CFG_ACT_BANK_RETRIES) {
+            cfg_act_bank_select(!bank);
+            return -1;
+        }
+    }
+    cfg_act_bank = bank;
+
+    /* Copy the new lists over, all islands hold the same tables */
+    for (i = 0; i < sizeof(cfg_act_dirty) / sizeof(uint32_t); i++) {
+        for (j = 0; cfg_act_dirty[i] && j < 32; j++) {
+            if (!(cfg_act_dirty[i] & (1 << j)))
+                continue;
+
+            offset = (i * 32 + j) * NIC_MAX_INSTR * 4;
+            cfg_act_read_block(cfg_act_bank_addr(bank) + offset, instr);
+            cfg_act_write_block(cfg_act_bank_addr(!bank) + offset, instr,
+                                NIC_MAX_INSTR);
+
+            cfg_act_dirty[i] &= ~(1 << j);
+        }
+    }
+
+    /* Chained list blocks replaced before the switch are unused now */
+    for (i = 0; i < NIC_INSTR_EXT_SLOTS; i++) {
+        if (cfg_act_ext_owner[i] & CFG_ACT_EXT_OLD)
+            cfg_act_ext_owner[i] = 0;
+        else
+            cfg_act_ext_owner[i] &= ~CFG_ACT_EXT_NEW;
+    }
+
+    return 0;
+}
+
+
+__intrinsic void
+cfg_act_write_host(uint32_t pcie, uint32_t vid, action_list_t *acts)
+{
+    uint32_t i;
+
+    cfg_act_optimize(acts);
+    cfg_act_chain(acts, (pcie << 6) | vid, NIC_MAX_INSTR);
+
+    for (i = 0; i < NFD_VID_MAXQS(vid); ++i)
+        cfg_act_write_queue((pcie << 6) | NFD_VID2QID(vid, i), acts);
+}
+
+
+__intrinsic void
+cfg_act_write_wire(uint32_t port, action_list_t *acts)
+{
+    cfg_act_optimize(acts);
+    cfg_act_chain(acts, (1 << 8) | port, NIC_MAX_INSTR);
+    cfg_act_write_queue((1 << 8) | port, acts);
 }
 
 
@@ -715,6 +1162,115 @@ cfg_act_append_smac_match_sriov(action_list_t *acts, uint32_t pcie,
                               sriov_cfg_data.mac_lo);
 }
 
+
+/* Program the _nic_meter_tbl entries of the vNIC from nic_meter_cfg and
+ * append INSTR_METER, unless no peak rate is configured. The entries are
+ * reset, so the buckets start full. */
+__intrinsic void
+cfg_act_append_meter(action_list_t *acts, uint32_t pcie, uint32_t vid)
+{
+    __emem uint32_t *meter_tbl = (__emem uint32_t *)
+                                    __link_sym("_nic_meter_tbl");
+    __xread struct nic_meter_cfg meter_cfg;
+    __xwrite uint32_t entry_wr[NIC_METER_ENTRY_SZ / 4];
+    instr_meter_t instr_meter;
+    uint32_t cir, pir, cbs, pbs;
+    uint32_t queue;
+    int i;
+
+    mem_read32(&meter_cfg, &nic_meter_cfg[pcie][vid], sizeof(meter_cfg));
+    if (meter_cfg.pir_kbps == 0)
+        return;
+
+    cir = meter_cfg.cir_kbps;
+    pir = (meter_cfg.pir_kbps < cir) ? cir : meter_cfg.pir_kbps;
+    cbs = meter_cfg.cbs;
+    pbs = (meter_cfg.pbs < cbs) ? cbs : meter_cfg.pbs;
+
+    entry_wr[NIC_METER_DP_wrd] = 0;
+    entry_wr[NIC_METER_DC_wrd] = 0;
+    entry_wr[NIC_METER_TS_wrd] = 0;
+    entry_wr[3] = 0;
+    entry_wr[NIC_METER_PBS_wrd] = nic_meter_burst(pbs);
+    entry_wr[NIC_METER_CBS_wrd] = nic_meter_burst(cbs);
+    entry_wr[NIC_METER_PIR_wrd] = nic_meter_rate(pir, NS_PLATFORM_TCLK);
+    entry_wr[NIC_METER_CIR_wrd] = nic_meter_rate(cir, NS_PLATFORM_TCLK);
+
+    for (i = 0; i < NFD_VID_MAXQS(vid); ++i) {
+        queue = (pcie << 6) | NFD_VID2QID(vid, i);
+        mem_write32(entry_wr,
+                    &meter_tbl[queue * (NIC_METER_ENTRY_SZ / 4)],
+                    sizeof(entry_wr));
+        if (!(meter_cfg.flags & NIC_METER_CFG_PER_QUEUE))
+            break;
+    }
+
+    instr_meter.__raw[0] = 0;
+    instr_meter.mark = (meter_cfg.flags & NIC_METER_CFG_MARK) ? 1 : 0;
+    instr_meter.per_queue =
+        (meter_cfg.flags & NIC_METER_CFG_PER_QUEUE) ? 1 : 0;
+    instr_meter.dscp = (meter_cfg.flags >> NIC_METER_CFG_DSCP_shf) &
+        NIC_METER_CFG_DSCP_msk;
+    instr_meter.index = (pcie << 6) | NFD_VID2QID(vid, 0);
+
+    cfg_act_append(acts, INSTR_METER, instr_meter.__raw[0]);
+}
+
+
+__intrinsic void
+cfg_act_append_sample(action_list_t *acts, uint32_t pcie, uint32_t vid)
+{
+    __xread struct nic_sample_cfg sample_cfg;
+    instr_sample_t instr_sample;
+
+    mem_read32(&sample_cfg, &nic_sample_cfg[pcie][vid], sizeof(sample_cfg));
+    if (sample_cfg.rate == 0)
+        return;
+
+    instr_sample.__raw[0] = 0;
+    instr_sample.snaplen = (sample_cfg.snaplen > NIC_SAMPLE_SNAP_MAX) ?
+        NIC_SAMPLE_SNAP_MAX : sample_cfg.snaplen;
+
+    cfg_act_append(acts, INSTR_SAMPLE, instr_sample.__raw[0]);
+    acts->instr[acts->count++].value = nic_sample_threshold(sample_cfg.rate);
+}
+
+
+/* Append INSTR_ACL if the vNIC has an ACL table. Rules may steer to any
+ * queue enabled when the list is built, like RSS. */
+__intrinsic void
+cfg_act_append_acl(action_list_t *acts, uint32_t pcie, uint32_t vid)
+{
+    __emem __addr40 uint8_t *bar_base;
+    __xread struct nic_acl_cfg acl_cfg;
+    __xread uint32_t rx_rings[2];
+    instr_acl_t instr_acl;
+
+    mem_read32(&acl_cfg, &nic_acl_cfg[pcie][vid], sizeof(acl_cfg));
+    if (acl_cfg.table == 0)
+        return;
+
+    /* INSTR_ACL holds 10 bits of table, see app_config_instr.h */
+    if (acl_cfg.table > NIC_ACL_MAX_TABLE) {
+        cfg_error_acl_cntr++;
+        return;
+    }
+
+    bar_base = nfd_cfg_bar_base(pcie, vid);
+    mem_read64(&rx_rings, (__mem void*) (bar_base + NFP_NET_CFG_RXRS_ENABLE),
+               sizeof(uint64_t));
+
+    instr_acl.__raw[0] = 0;
+    instr_acl.__raw[1] = 0;
+    instr_acl.table = acl_cfg.table;
+    instr_acl.max_queue =
+        ((~rx_rings[0]) ? ffs(~rx_rings[0]) : 32 + ffs(~rx_rings[1]) - 1);
+    instr_acl.vlan = (acl_cfg.flags & NIC_ACL_CFG_VLAN) ? 1 : 0;
+
+    cfg_act_append(acts, INSTR_ACL, instr_acl.__raw[0]);
+    acts->instr[acts->count++].value = instr_acl.__raw[1];
+}
+
 #define ACTION_RSS_IPV6_TCP_BIT 0
 #define ACTION_RSS_IPV6_UDP_BIT 1
 #define ACTION_RSS_IPV4_TCP_BIT 2
@@ -725,12 +1281,15 @@ cfg_act_append_rss(action_list_t *acts, uint32_t pcie, uint32_t vid,
                    int update_map, int v1_meta)
 {
     __emem __addr40 uint8_t *bar_base;
-    SIGNAL sig1, sig2, sig3;
+    SIGNAL sig1, sig2, sig3, sig4;
     __xread uint32_t rss_ctrl;
     __xread uint32_t rx_rings[2];
     __xread uint32_t rss_key[NFP_NET_CFG_RSS_KEY_SZ / sizeof(uint32_t)];
+    __xwrite uint32_t rss_key_wr[NIC_RSS_KEY_LW];
+    __xread struct nic_rss_cfg rss_cfg;
     uint32_t rss_tbl_idx;
     uint32_t type, vnic;
+    uint32_t i;
     instr_rss_t instr_rss;
 
     bar_base = nfd_cfg_bar_base(pcie, vid);
@@ -739,7 +1298,9 @@ cfg_act_append_rss(action_list_t *acts, uint32_t pcie, uint32_t vid,
     NFD_VID2VNIC(type, vnic, vid);
     rss_tbl_idx = vnic + pcie * NS_PLATFORM_NUM_PORTS;
     if (update_map)
-        upd_rss_table(rss_tbl_idx * NFP_NET_CFG_RSS_ITBL_SZ, bar_base, vnic);
+        upd_rss_table(rss_tbl_idx * NIC_RSS_TBL_ENTRIES, bar_base, vnic,
+                      (type == NFD_VNIC_TYPE_VF) ? NFD_MAX_VF_QUEUES :
+                                                   NFD_MAX_PF_QUEUES);
 
     /* Read RSS configuration from BAR */
     __mem_read32(&rss_ctrl, (__mem void*) (bar_base + NFP_NET_CFG_RSS_CTRL),
@@ -749,9 +1310,27 @@ cfg_act_append_rss(action_list_t *acts, uint32_t pcie, uint32_t vid,
                  &sig2);
     __mem_read64(&rx_rings, (__mem void*) (bar_base + NFP_NET_CFG_RXRS_ENABLE),
                  sizeof(uint64_t), sizeof(uint64_t), sig_done, &sig3);
-    wait_for_all(&sig1, &sig2, &sig3);
+    __mem_read32(&rss_cfg, &nic_rss_cfg[pcie][vid], sizeof(rss_cfg),
+                 sizeof(rss_cfg), sig_done, &sig4);
+    wait_for_all(&sig1, &sig2, &sig3, &sig4);
     instr_rss.key = rss_key[0];
 
+    /* The whole key is only used by Toeplitz, but the hash function may
+     * change without an RSS update */
+    if (update_map) {
+        for (i = 0; i < NIC_RSS_KEY_LW; i++)
+            rss_key_wr[i] = rss_key[i];
+        wr_rss_tbl_sym(rss_key_wr,
+                       (__cls __addr32 void*) __link_sym("NIC_RSS_KEY_TBL"),
+                       rss_tbl_idx * NIC_RSS_KEY_STRIDE, NIC_RSS_KEY_LW);
+    }
+
+    instr_rss.__raw[2] = 0;
+    instr_rss.toeplitz = ((rss_ctrl & NFP_NET_CFG_RSS_TOEPLITZ) ||
+                          (rss_cfg.flags & NIC_RSS_CFG_TOEPLITZ)) ? 1 : 0;
+    instr_rss.symmetric = (rss_cfg.flags & NIC_RSS_CFG_SYMMETRIC) ? 1 : 0;
+    instr_rss.rfs = (rss_cfg.flags & NIC_RSS_CFG_RFS) ? 1 : 0;
+
     // Driver does L3 unconditionally, so we only care about L4 combinations
     instr_rss.cfg_proto = 0;
     if (rss_ctrl & NFP_NET_CFG_RSS_IPV4_TCP)
@@ -771,6 +1350,7 @@ cfg_act_append_rss(action_list_t *acts, uint32_t pcie, uint32_t vid,
 
     cfg_act_append(acts, INSTR_RSS, instr_rss.__raw[0]);
     acts->instr[acts->count++].value = instr_rss.__raw[1];
+    acts->instr[acts->count++].value = instr_rss.__raw[2];
 }
 
 
@@ -790,7 +1370,7 @@ cfg_act_append_pop_pkt(action_list_t *acts)
 
 __intrinsic void
 cfg_act_append_checksum(action_list_t *acts, int outer, int inner,
-                        int complete)
+                        int complete, int validate, int sctp)
 {
     instr_checksum_t instr_csum;
 
@@ -799,6 +1379,8 @@ cfg_act_append_checksum(action_list_t *acts, int outer, int inner,
     instr_csum.outer_l4 = outer;
     instr_csum.inner_l3 = inner;
     instr_csum.inner_l4 = inner;
+    instr_csum.validate_inner = validate;
+    instr_csum.sctp_only = sctp;
     instr_csum.complete_meta = complete;
 
     cfg_act_append(acts, INSTR_CHECKSUM, instr_csum.__raw[0]);
@@ -807,7 +1389,8 @@ cfg_act_append_checksum(action_list_t *acts, int outer, int inner,
 
 __intrinsic void
 cfg_act_append_rx_wire(action_list_t *acts, uint32_t pcie, uint32_t vid,
-                       uint32_t vxlan, uint32_t nvgre, uint32_t rxcsum)
+                       uint32_t vxlan, uint32_t nvgre, uint32_t tun,
+                       uint32_t rxcsum)
 {
     instr_rx_wire_t instr_rx_wire;
 
@@ -819,6 +1402,9 @@ cfg_act_append_rx_wire(action_list_t *acts, uint32_t pcie, uint32_t vid,
     }
 
     instr_rx_wire.parse_nvgre = nvgre;
+    instr_rx_wire.parse_tun_ip = (tun & NIC_RSS_CFG_TUN_IP) ? 1 : 0;
+    instr_rx_wire.parse_mpls_ip = (tun & NIC_RSS_CFG_TUN_MPLS) ? 1 : 0;
+    instr_rx_wire.parse_mpls_udp = (tun & NIC_RSS_CFG_TUN_MPLS_UDP) ? 1 : 0;
     instr_rx_wire.host_encap_prop_csum = rxcsum;
 
     cfg_act_append(acts, INSTR_RX_WIRE, instr_rx_wire.__raw[0]);
@@ -834,7 +1420,7 @@ cfg_act_remove_strip_vlan(action_list_t *acts)
         if (found) {
             acts->instr[i] = acts->instr[i + 1];
         }
-        else if (acts->instr[i].op == INSTR_POP_VLAN) {
+        else if (acts->instr[i].op == cfg_act_map[INSTR_POP_VLAN]) {
             found = 1;
             acts->instr[i] = acts->instr[i + 1];
             acts->instr[i].pipeline = 0;
@@ -947,8 +1533,9 @@ __intrinsic void
 cfg_act_build_pf(action_list_t *acts, uint32_t pcie, uint32_t vid,
                  uint32_t veb_up, uint32_t control, uint32_t update)
 {
+    __xread struct nic_csum_cfg csum_cfg;
     uint32_t type, vnic;
-    uint32_t csum_i, csum_o;
+    uint32_t csum_i, csum_o, csum_s;
     uint32_t tmq;
 
     cfg_act_init(acts);
@@ -958,14 +1545,19 @@ cfg_act_build_pf(action_list_t *acts, uint32_t pcie, uint32_t vid,
     if (type != NFD_VNIC_TYPE_PF)
         return;
 
+    mem_read32(&csum_cfg, &nic_csum_cfg[pcie][vid], sizeof(csum_cfg));
+
     csum_o = (control & NFP_NET_CFG_CTRL_TXCSUM) ? 1 : 0;
     csum_i = (csum_o && (control & NFP_NET_CFG_CTRL_VXLAN)) ? 1 : 0;
+    csum_s = (csum_o && (csum_cfg.flags & NIC_CSUM_CFG_TX_SCTP)) ? 1 : 0;
     tmq = NS_PLATFORM_NBI_TM_QID_LO(vnic);
 
     cfg_act_append_rx_host(acts, pcie, vid, veb_up);
 
-    if (csum_i)
-        cfg_act_append_checksum(acts, 0, 1, 0); // I
+    /* The MAC computes the TCP and UDP checksums but not the CRC32c of
+     * SCTP */
+    if (csum_i || csum_s)
+        cfg_act_append_checksum(acts, 0, csum_i, 0, 0, csum_s); // I?, S?
 
     if (veb_up)
         cfg_act_append_veb_lookup(acts, pcie, vid, 0, 0);
@@ -974,7 +1566,7 @@ cfg_act_build_pf(action_list_t *acts, uint32_t pcie, uint32_t vid,
 
     if (veb_up) {
         if (csum_o)
-            cfg_act_append_checksum(acts, 1, 0, 0); // O
+            cfg_act_append_checksum(acts, 1, 0, 0, 0, 0); // O
 
         cfg_act_append_push_pkt(acts);
         cfg_act_append_tx_vlan(acts);
@@ -987,9 +1579,10 @@ cfg_act_build_vf(action_list_t *acts, uint32_t pcie, uint32_t vid,
                  uint32_t pf_control, uint32_t vf_control)
 {
     __xread struct sriov_cfg sriov_cfg_data;
+    __xread struct nic_csum_cfg csum_cfg;
     __emem __addr40 uint8_t *vf_cfg_base;
     uint32_t type, vnic;
-    uint32_t csum_i, csum_o;
+    uint32_t csum_i, csum_o, csum_s;
     uint32_t promisc;
 
     cfg_act_init(acts);
@@ -998,8 +1591,11 @@ cfg_act_build_vf(action_list_t *acts, uint32_t pcie, uint32_t vid,
     if (type != NFD_VNIC_TYPE_VF)
         return;
 
+    mem_read32(&csum_cfg, &nic_csum_cfg[pcie][vid], sizeof(csum_cfg));
+
     csum_o = (vf_control & NFP_NET_CFG_CTRL_TXCSUM) ? 1 : 0;
     csum_i = (csum_o && (vf_control & NFP_NET_CFG_CTRL_VXLAN)) ? 1 : 0;
+    csum_s = (csum_o && (csum_cfg.flags & NIC_CSUM_CFG_TX_SCTP)) ? 1 : 0;
     promisc = (pf_control & NFP_NET_CFG_CTRL_PROMISC) ? 1 : 0;
 
     cfg_act_append_rx_host(acts, pcie, vid, 1);
@@ -1013,16 +1609,20 @@ cfg_act_build_vf(action_list_t *acts, uint32_t pcie, uint32_t vid,
     if (sriov_cfg_data.ctrl_spoof)
         cfg_act_append_smac_match_sriov(acts, pcie, vid);
 
+    cfg_act_append_meter(acts, pcie, vid);
+
+    cfg_act_append_sample(acts, pcie, vid);
+
     cfg_act_append_veb_lookup(acts, pcie, vid, 0, 0);
 
-    if (csum_i)
-        cfg_act_append_checksum(acts, 0, 1, 0); // I
+    if (csum_i || csum_s)
+        cfg_act_append_checksum(acts, 0, csum_i, 0, 0, csum_s); // I?, S?
 
     cfg_act_append_tx_wire(acts, NS_PLATFORM_NBI_TM_QID_LO(0) /* vnic 0 */,
                            promisc, 1);
 
     if (csum_o)
-        cfg_act_append_checksum(acts, 1, 0, 0); // O
+        cfg_act_append_checksum(acts, 1, 0, 0, 0, 0); // O
 
     cfg_act_append_tx_host(acts, pcie, NFD_PF2VID(0), 0, 1); // M
 
@@ -1043,12 +1643,15 @@ __intrinsic void
 cfg_act_build_nbi(action_list_t *acts, uint32_t pcie, uint32_t vid,
                   uint32_t veb_up, uint32_t control, uint32_t update)
 {
+    __xread struct nic_rss_cfg rss_cfg;
+    __xread struct nic_csum_cfg csum_cfg;
     uint32_t type, vnic;
     uint32_t vxlan = (control & NFP_NET_CFG_CTRL_VXLAN) ? 1 : 0;
     uint32_t nvgre = (control & NFP_NET_CFG_CTRL_NVGRE) ? 1 : 0;
     uint32_t promisc = (control & NFP_NET_CFG_CTRL_PROMISC) ? 1 : 0;
     uint32_t csum_compl = (control & NFP_NET_CFG_CTRL_CSUM_COMPLETE) ? 1 : 0;
     uint32_t rx_csum = (control & NFP_NET_CFG_CTRL_RXCSUM) ? 1 : 0;
+    uint32_t csum_val;
     uint32_t update_rss =
         (update & NFP_NET_CFG_UPDATE_RSS || update & NFP_NET_CFG_CTRL_BPF);
     uint32_t rss_v1 =
@@ -1060,16 +1663,29 @@ cfg_act_build_nbi(action_list_t *acts, uint32_t pcie, uint32_t vid,
     if (type != NFD_VNIC_TYPE_PF)
         return;
 
-    cfg_act_append_rx_wire(acts, pcie, vid, vxlan, nvgre,
+    /* Tunnels beyond those of the driver, see app_config_rss.h */
+    mem_read32(&rss_cfg, &nic_rss_cfg[pcie][vid], sizeof(rss_cfg));
+
+    cfg_act_append_rx_wire(acts, pcie, vid, vxlan, nvgre, rss_cfg.flags,
                            rx_csum && !csum_compl);
 
+    /* The MAC neither checks the inner headers of tunnelled packets nor
+     * the CRC32c of SCTP, the driver takes CHECKSUM_COMPLETE over the
+     * checksum flags */
+    mem_read32(&csum_cfg, &nic_csum_cfg[pcie][vid], sizeof(csum_cfg));
+    csum_val = (rx_csum && !csum_compl &&
+                (csum_cfg.flags & NIC_CSUM_CFG_RX_VALIDATE)) ? 1 : 0;
+
     if (veb_up)
         cfg_act_append_veb_lookup(acts, pcie, vid, promisc, 1);
     else if (! promisc)
         cfg_act_append_dmac_match_bar(acts, pcie, vid);
 
-    if (veb_up || csum_compl)
-        cfg_act_append_checksum(acts, veb_up, veb_up, csum_compl); // O, I, C
+    cfg_act_append_acl(acts, pcie, vid);
+
+    if (veb_up || csum_compl || csum_val)
+        cfg_act_append_checksum(acts, veb_up, veb_up, csum_compl,
+                                csum_val, 0); // O, I, C, V
 
     if (control & NFP_NET_CFG_CTRL_BPF)
         cfg_act_append_bpf(acts, vnic);
@@ -1077,6 +1693,8 @@ cfg_act_build_nbi(action_list_t *acts, uint32_t pcie, uint32_t vid,
     if (control & NFP_NET_CFG_CTRL_RSS_ANY || control & NFP_NET_CFG_CTRL_BPF)
         cfg_act_append_rss(acts, pcie, vid, update_rss, rss_v1);
 
+    cfg_act_append_sample(acts, pcie, vid);
+
     cfg_act_append_tx_host(acts, pcie, vid, 0, veb_up);
 
     if (veb_up) {
@@ -1091,7 +1709,7 @@ __intrinsic void
 cfg_act_build_nbi_down(action_list_t *acts, uint32_t pcie, uint32_t vid)
 {
     cfg_act_init(acts);
-    cfg_act_append_rx_wire(acts, pcie, vid, 0, 0, 0);
+    cfg_act_append_rx_wire(acts, pcie, vid, 0, 0, 0, 0);
     cfg_act_append_drop(acts);
 }
 
@@ -1113,7 +1731,9 @@ cfg_act_build_veb_pf(action_list_t *acts, uint32_t pcie, uint32_t vid,
     if (type != NFD_VNIC_TYPE_PF)
         return;
 
-    cfg_act_append_checksum(acts, 1, 1, csum_c); // O, I, C?
+    cfg_act_append_acl(acts, pcie, vid);
+
+    cfg_act_append_checksum(acts, 1, 1, csum_c, 0, 0); // O, I, C?
 
     if (control & NFP_NET_CFG_CTRL_BPF)
         cfg_act_append_bpf(acts, vnic);
@@ -1152,7 +1772,10 @@ cfg_act_build_veb_vf(action_list_t *acts, uint32_t pcie, uint32_t vid,
     if (sriov_cfg_data.vlan_tag != 0)
         cfg_act_append_strip_vlan(acts);
 
-    cfg_act_append_checksum(acts, 1, 1, csum_c); // O, I, C?
+    /* An ACL drop also drops the copy pushed for the promiscuous PF */
+    cfg_act_append_acl(acts, pcie, vid);
+
+    cfg_act_append_checksum(acts, 1, 1, csum_c, 0, 0); // O, I, C?
 
     cfg_act_append_tx_host(acts, pcie, vid, promisc, 0);
 
@@ -1160,7 +1783,7 @@ cfg_act_build_veb_vf(action_list_t *acts, uint32_t pcie, uint32_t vid,
         cfg_act_append_pop_pkt(acts);
 
         if (pf_control & NFP_NET_CFG_CTRL_CSUM_COMPLETE)
-            cfg_act_append_checksum(acts, 0, 0, 1); // C
+            cfg_act_append_checksum(acts, 0, 0, 1, 0, 0); // C
 
         if (pf_control & NFP_NET_CFG_CTRL_BPF)
             cfg_act_append_bpf(acts, vnic);
@@ -1199,6 +1822,38 @@ cfg_act_cache_fl_buf_sz(uint32_t pcie, uint32_t vid)
 
 __shared __mem struct nic_mac_vlan_key veb_stored_keys[NVNICS];
 
+/* Chained list blocks of the tagged and untagged VEB lists of a vNIC */
+#define CFG_ACT_VEB_OWNER(vid, untagged)    ((2 << 8) | ((vid) << 1) | \
+                                             (untagged))
+
+/* VEB lists are loaded by __actions_veb_lookup from the map entry, which
+ * holds segments 0 and 1. The flow cache keeps its tag in the last words
+ * of an entry, so segment 1 ends before them. */
+#ifdef NIC_FLOW_CACHE
+#define CFG_ACT_VEB_HEAD    FLOW_CACHE_LIST_LW
+#else
+#define CFG_ACT_VEB_HEAD    NIC_MAX_INSTR
+#endif
+
+/* Untagged VEB list, the list of cfg_act_write_veb() without POP_VLAN */
+__shared __lmem action_list_t cfg_act_veb_untagged;
+
+/*
+ * A VEB map entry is in use as soon as the map is updated, not from the
+ * next cfg_act_commit(), so the blocks chained to it are not NEW. Once
+ * replaced they are released by cfg_act_commit() like those of a bank.
+ */
+__intrinsic void
+cfg_act_ext_live(uint32_t owner)
+{
+    uint32_t i;
+
+    for (i = 0; i < NIC_INSTR_EXT_SLOTS; i++) {
+        if (cfg_act_ext_owner[i] == ((owner + 1) | CFG_ACT_EXT_NEW))
+            cfg_act_ext_owner[i] = owner + 1;
+    }
+}
+
 enum cfg_msg_err
 cfg_act_write_veb(uint32_t vid, __lmem struct nic_mac_vlan_key *veb_key,
                   action_list_t *acts)
@@ -1206,7 +1861,9 @@ cfg_act_write_veb(uint32_t vid, __lmem struct nic_mac_vlan_key *veb_key,
     __xread struct nic_mac_vlan_key stored_key_rd;
     __xwrite struct nic_mac_vlan_key stored_key_wr;
     __lmem struct nic_mac_vlan_key del_key;
+    action_list_t *untagged = &cfg_act_veb_untagged;
     uint32_t new_vlan_id, vlan_id;
+    uint32_t i;
     uint64_t new_mac_addr = MAC64_FROM_VEB_KEY(*veb_key);
     enum cfg_msg_err err_code = NO_ERROR;
 
@@ -1215,13 +1872,30 @@ cfg_act_write_veb(uint32_t vid, __lmem struct nic_mac_vlan_key *veb_key,
         if (new_mac_addr == 0 || ((new_mac_addr >> 40) & 0x01))
             return MAC_VLAN_ADD_FAIL;
 
+        cfg_act_optimize(acts);
+
         new_vlan_id = veb_key->vlan_id;
+        if (new_vlan_id == NIC_NO_VLAN_ID || new_vlan_id == 0) {
+            for (i = 0; i < acts->count; i++)
+                untagged->instr[i] = acts->instr[i];
+            untagged->count = acts->count;
+            untagged->prev = acts->prev;
+            cfg_act_remove_strip_vlan(untagged);
+            cfg_act_chain(untagged, CFG_ACT_VEB_OWNER(vid, 1),
+                          CFG_ACT_VEB_HEAD);
+            cfg_act_ext_live(CFG_ACT_VEB_OWNER(vid, 1));
+        } else {
+            cfg_act_ext_slot(CFG_ACT_VEB_OWNER(vid, 1), 0);
+        }
+        cfg_act_chain(acts, CFG_ACT_VEB_OWNER(vid, 0), CFG_ACT_VEB_HEAD);
+        cfg_act_ext_live(CFG_ACT_VEB_OWNER(vid, 0));
+
         /* Add or overwrite VEB table entries */
         for (vlan_id = 0; vlan_id <= NIC_NO_VLAN_ID; vlan_id++) {
             if (new_vlan_id == NIC_NO_VLAN_ID || vlan_id == new_vlan_id ||
                     (new_vlan_id == 0 && vlan_id == NIC_NO_VLAN_ID)) {
                 if (vlan_id == NIC_NO_VLAN_ID)
-                    cfg_act_remove_strip_vlan(acts);
+                    acts = untagged;
                 veb_key->vlan_id = vlan_id;
                 if (nic_mac_vlan_entry_op_cmsg(veb_key,
                             (__lmem uint32_t *) acts->instr,
@@ -1229,6 +1903,9 @@ cfg_act_write_veb(uint32_t vid, __lmem struct nic_mac_vlan_key *veb_key,
                     return MAC_VLAN_ADD_FAIL;
             }
         }
+    } else {
+        cfg_act_ext_slot(CFG_ACT_VEB_OWNER(vid, 0), 0);
+        cfg_act_ext_slot(CFG_ACT_VEB_OWNER(vid, 1), 0);
     }
 
     mem_read32(&stored_key_rd, &veb_stored_keys[vid],
@@ -38,7 +38,7 @@ enum cfg_msg_err {
 } while (0);
 
 typedef struct {
-    union instruction_format instr[NIC_MAX_INSTR];
+    union instruction_format instr[NIC_MAX_INSTR_CHAIN];
     uint32_t count;
     uint32_t prev;
 } __lmem __shared action_list_t;
@@ -65,6 +65,23 @@ void cfg_act_build_nbi(action_list_t *acts, uint32_t pcie, uint32_t vid,
 
 void cfg_act_write_wire(uint32_t port, action_list_t *acts);
 
+/**
+ * Make the lists written since the last call visible to the workers
+ *
+ * @return 0 on success, -1 if the workers did not switch banks in time,
+ *         the old lists then stay in use
+ */
+int cfg_act_commit();
+
+/*
+ * Values of nic_cfg_reload[pcie]. The host writes NIC_CFG_RELOAD after
+ * writing the per vNIC tables of the island and waits for the master to
+ * replace it with 0, or with NIC_CFG_RELOAD_ERR if a list could not be
+ * rebuilt, in which case the old lists stay in use.
+ */
+#define NIC_CFG_RELOAD          1
+#define NIC_CFG_RELOAD_ERR      0xffffffff
+
 void cfg_act_write_host(uint32_t pcie, uint32_t vid, action_list_t *acts);
 
 void cfg_act_build_nbi_down(action_list_t *acts, uint32_t pcie, uint32_t vid);
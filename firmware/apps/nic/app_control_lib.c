@@ -473,6 +473,10 @@ process_pf_reconfig(int pcie, uint32_t control, uint32_t update, uint32_t vid,
                     return 1;
                 }
             }
+            if (cfg_act_commit()) {
+                cfg_msg->error = 1;
+                return 1;
+            }
 
             /* wait for TM queues to drain */
             process_pf_reconfig_tmq_drain(port);
@@ -570,6 +574,70 @@ process_vf_reconfig(int pcie, uint32_t control, uint32_t update, uint32_t vid,
     return 0;
 }
 
+/* Reload requests for the exported per vNIC tables, see NIC_CFG_RELOAD */
+__export __emem uint32_t nic_cfg_reload[NFD_MAX_ISL];
+
+/*
+ * The per vNIC tables written by the host with nfp-rtsym (nic_meter_cfg,
+ * nic_sample_cfg, nic_acl_cfg, nic_rss_cfg and nic_csum_cfg) are only read
+ * while building the action lists. The driver rebuilds them on a
+ * reconfiguration, this rebuilds the lists of every enabled vNIC of
+ * @pcie on request of the host, without a BAR update.
+ */
+static int
+process_cfg_reload(int pcie)
+{
+    uint32_t pf_control = nic_control_word[pcie][NFD_PF2VID(0)];
+    uint32_t vf_control;
+    uint32_t control;
+    uint32_t veb_up = 0;
+    int err = 0;
+    int i;
+
+    if (pf_control & NFP_NET_CFG_CTRL_ENABLE) {
+        for (i = 0; i < NFD_MAX_VFS; i++) {
+            vf_control = nic_control_word[pcie][NFD_VF2VID(i)];
+            if (vf_control & NFP_NET_CFG_CTRL_ENABLE) {
+                if (cfg_act_vf_up(pcie, NFD_VF2VID(i), pf_control,
+                                  vf_control, 0))
+                    err = 1;
+                veb_up = 1;
+            }
+        }
+    }
+
+    for (i = 0; i < NS_PLATFORM_NUM_PORTS; i++) {
+        control = nic_control_word[pcie][NFD_PF2VID(i)];
+        if (control & NFP_NET_CFG_CTRL_ENABLE) {
+            if (cfg_act_pf_up(pcie, NFD_PF2VID(i), veb_up, control, 0))
+                err = 1;
+        }
+    }
+
+    /* Publish what was rebuilt, as cfg_changes_loop() does on an error */
+    if (cfg_act_commit())
+        err = 1;
+
+    return err;
+}
+
+static void
+process_cfg_reload_req(void)
+{
+    __xread uint32_t req;
+    __xwrite uint32_t res;
+    int pcie;
+
+    for (pcie = 0; pcie < NFD_MAX_ISL; pcie++) {
+        mem_read32(&req, &nic_cfg_reload[pcie], sizeof(req));
+        if (req != NIC_CFG_RELOAD)
+            continue;
+
+        res = process_cfg_reload(pcie) ? NIC_CFG_RELOAD_ERR : 0;
+        mem_write32(&res, &nic_cfg_reload[pcie], sizeof(res));
+    }
+}
+
 __intrinsic static int
 next_nfd_cfg_msg(int *pcie, struct nfd_cfg_msg *cfg_msg)
 {
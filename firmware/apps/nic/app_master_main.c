@@ -189,8 +189,6 @@ __export __emem uint32_t abi_nfd_out_red_offload_2 = 0;
 __export __emem uint32_t abi_nfd_out_red_offload_3 = 0;
 #endif
 
-__intrinsic void nic_local_epoch();
-
 
 /*
  * Config change management.
@@ -288,10 +286,17 @@ cfg_changes_loop(void)
             }
 
 error:
+            /* Switch the workers to the new lists, also if only part of
+             * the message was processed */
+            if (cfg_act_commit())
+                cfg_msg.error = 1;
+
             /* Complete the message */
             cfg_msg.msg_valid = 0;
             nfd_cfg_app_complete_cfg_msg(pcie, &cfg_msg,
                                          nfd_cfg_bar_base(pcie, 0));
+        } else {
+            process_cfg_reload_req();
         }
         ctx_swap();
     }
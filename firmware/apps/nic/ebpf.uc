@@ -159,6 +159,7 @@ ebpf_init_cap_finalize()
 
     pv_set_tx_flag(_ebpf_pkt_vec, BF_L(PV_TX_HOST_RX_BPF_bf))
     pv_invalidate_cache(_ebpf_pkt_vec)
+    pv_invalidate_hdr_cache(_ebpf_pkt_vec)
 
     __actions_restore_t_idx()
     br_bset[rc, EBPF_RET_PASS, actions#]
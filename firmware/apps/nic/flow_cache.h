@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file          flow_cache.h
+ * @brief         Per island cache of the action lists resolved by
+ *                INSTR_VEB_LOOKUP
+ *
+ * The cache is direct mapped and keyed on the VEB lookup key (VLAN ID and
+ * destination MAC address). An entry is the resolved action list read
+ * from the SRIOV_TID map, at most FLOW_CACHE_LIST_LW words, followed by
+ * the entry tag in the last words of the NIC_MAX_INSTR word entry. Longer
+ * lists end segment 1 by then and continue with INSTR_CHAIN, see
+ * cfg_act_write_veb():
+ *
+ * Word   1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ *       +-----------------------+-+-----+-------------------------------+
+ *   13  |       VLAN ID         |V|  0  |         MAC ADDR HI           |
+ *       +-----------------------+-+-----+-------------------------------+
+ *   14  |                           MAC ADDR LO                         |
+ *       +---------------------------------------------------------------+
+ *   15  |                        FLOW_CACHE_GEN                         |
+ *       +---------------------------------------------------------------+
+ *
+ * Entries are written with a single 64 byte command, so a list and its
+ * tag always belong together.
+ *
+ * FLOW_CACHE_GEN is incremented for every change to the SRIOV_TID map
+ * (cmsg_map.uc), which invalidates all entries. The cache itself is only
+ * allocated and consulted if the firmware is built with NIC_FLOW_CACHE=1,
+ * which defines NIC_FLOW_CACHE for the datapath and the app master.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _FLOW_CACHE_H_
+#define _FLOW_CACHE_H_
+
+#define FLOW_CACHE_IDX_BITS     9
+#define FLOW_CACHE_ENTRIES      (1 << FLOW_CACHE_IDX_BITS)
+#define FLOW_CACHE_ENTRY_LW     16
+#define FLOW_CACHE_LIST_LW      13
+#define FLOW_CACHE_SIZE         (FLOW_CACHE_ENTRIES * FLOW_CACHE_ENTRY_LW * 4)
+#define FLOW_CACHE_VALID_bit    19
+
+#if defined(__NFP_LANG_ASM)
+
+    .alloc_mem FLOW_CACHE_GEN imem global 8 256
+
+    #ifdef NIC_FLOW_CACHE
+        .alloc_mem _flow_cache ctm island FLOW_CACHE_SIZE 65536
+    #endif
+
+#endif
+
+#endif /* _FLOW_CACHE_H_ */
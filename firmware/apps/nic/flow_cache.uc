@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc.  All rights reserved.
+ *
+ * @file   flow_cache.uc
+ * @brief  Per island cache of the action lists resolved by the VEB lookup,
+ *         see flow_cache.h
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _FLOW_CACHE_UC
+#define _FLOW_CACHE_UC
+
+#include <ov.uc>
+
+#include "flow_cache.h"
+
+passert(FLOW_CACHE_ENTRY_LW, "EQ", NIC_MAX_INSTR)
+passert(FLOW_CACHE_LIST_LW, "EQ", (NIC_MAX_INSTR - 3))
+
+
+/* Look up the list resolved for the VEB lookup key in_key[2] and load it
+ * into $__actions.
+ *
+ * The stored tag is checked before the list is loaded, so $__actions is
+ * left alone on a miss. The tag is checked again after the load, which
+ * only fails if another context replaced the entry in between. The list
+ * that was in $__actions is lost in that case.
+ *
+ * @param out_addr      Entry offset, for flow_cache_insert()
+ * @param out_tag       Entry tag (3 words), for flow_cache_insert()
+ * @param in_key        VEB lookup key (2 words)
+ * @param MISS_LABEL    Taken if there is no entry for in_key
+ * @param STALE_LABEL   Taken if the entry was replaced during the load
+ */
+#macro flow_cache_lookup(out_addr, out_tag, in_key, MISS_LABEL, STALE_LABEL)
+.begin
+    .reg cache_base
+    .reg gen_addr
+    .reg tag_addr
+    .reg read $gen
+    .reg read $tag[3]
+    .xfer_order $tag
+    .sig sig_gen
+    .sig sig_tag
+
+    move(gen_addr, ((FLOW_CACHE_GEN >> 8) & 0xffffffff))
+    mem[read32, $gen, gen_addr, <<8, (FLOW_CACHE_GEN & 0xff), 1], sig_done[sig_gen]
+
+    immed[cache_base, (_flow_cache >> 16), <<(16 - 8)]
+    alu[out_addr, in_key[0], XOR, in_key[1]]
+    alu[out_addr, out_addr, XOR, in_key[0], >>20]
+    alu[out_addr, --, B, out_addr, <<(32 - FLOW_CACHE_IDX_BITS)]
+    alu[out_addr, --, B, out_addr, >>(32 - FLOW_CACHE_IDX_BITS - 6)]
+    alu[tag_addr, out_addr, +, (FLOW_CACHE_LIST_LW * 4)]
+    mem[read32, $tag[0], cache_base, <<8, tag_addr, 3], sig_done[sig_tag]
+
+    alu[out_tag[0], in_key[0], OR, 1, <<FLOW_CACHE_VALID_bit]
+    alu[out_tag[1], --, B, in_key[1]]
+    ctx_arb[sig_gen, sig_tag]
+
+    alu[out_tag[2], --, B, $gen]
+    alu[--, out_tag[0], XOR, $tag[0]]
+    bne[MISS_LABEL]
+    alu[--, out_tag[1], XOR, $tag[1]]
+    bne[MISS_LABEL]
+    alu[--, out_tag[2], XOR, $tag[2]]
+    bne[MISS_LABEL]
+
+    __actions_chain_sync()
+    ov_start(OV_LENGTH)
+    ov_set_use(OV_LENGTH, 16, OVF_SUBTRACT_ONE)
+    ov_clean()
+    mem[read32, $__actions[0], cache_base, <<8, out_addr, max_16], indirect_ref, ctx_swap[sig_tag]
+
+    alu[--, out_tag[0], XOR, $__actions[FLOW_CACHE_LIST_LW]]
+    bne[STALE_LABEL]
+    alu[--, out_tag[1], XOR, $__actions[(FLOW_CACHE_LIST_LW + 1)]]
+    bne[STALE_LABEL]
+    alu[--, out_tag[2], XOR, $__actions[(FLOW_CACHE_LIST_LW + 2)]]
+    bne[STALE_LABEL]
+.end
+#endm
+
+
+/* Store the list in $__actions, just loaded for the key that
+ * flow_cache_lookup() missed on, replacing whatever entry was there.
+ *
+ * @param in_addr       Entry offset returned by flow_cache_lookup()
+ * @param in_tag        Entry tag returned by flow_cache_lookup()
+ */
+#macro flow_cache_insert(in_addr, in_tag)
+.begin
+    .reg cache_base
+    .reg write $entry[FLOW_CACHE_ENTRY_LW]
+    .xfer_order $entry
+    .sig sig_write
+
+    #define_eval LOOP (0)
+    #while (LOOP < FLOW_CACHE_LIST_LW)
+        alu[$entry[LOOP], --, B, $__actions[LOOP]]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+    alu[$entry[FLOW_CACHE_LIST_LW], --, B, in_tag[0]]
+    alu[$entry[(FLOW_CACHE_LIST_LW + 1)], --, B, in_tag[1]]
+    alu[$entry[(FLOW_CACHE_LIST_LW + 2)], --, B, in_tag[2]]
+
+    immed[cache_base, (_flow_cache >> 16), <<(16 - 8)]
+    ov_start(OV_LENGTH)
+    ov_set_use(OV_LENGTH, 16, OVF_SUBTRACT_ONE)
+    ov_clean()
+    mem[write32, $entry[0], cache_base, <<8, in_addr, max_16], indirect_ref, ctx_swap[sig_write]
+.end
+#endm
+
+#endif
@@ -25,6 +25,7 @@
 #include "hashmap.uc"
 #include "cmsg_map.uc"
 #include "app_mac_vlan_config_cmsg.h"
+#include "app_config_acl.h"
 hashmap_init()
 cmsg_init()
 
@@ -57,6 +58,7 @@ cmsg_init()
 
     .if (ctx() == 0)
 	        hashmap_alloc_fd(SRIOV_TID, 8, 56, NIC_MAC_VLAN_TABLE__NUM_ENTRIES, --, swap, BPF_MAP_TYPE_HASH)
+	        hashmap_alloc_fd(ACL_TID, NIC_ACL_KEY_SZ, NIC_ACL_VALUE_SZ, NIC_ACL_MAX_ENTRIES, --, swap, BPF_MAP_TYPE_HASH)
     .endif
 
 main_loop#:
@@ -41,6 +41,9 @@
 #include <gro.uc>
 #include <endian.uc>
 #include "pkt_buf.uc"
+#include "flow_cache.h"
+#include "app_config_acl.h"
+#include "app_config_rfs.h"
 
 #ifndef NUM_CONTEXT
 	#define NUM_CONTEXT 4
@@ -515,7 +518,7 @@ cmsg_exit#:
 	.reg version
 
 	ld_field_w_clr[o_msg_type, 0001, in_ctrl_w0, >>24]
-    .if(o_msg_type > CMSG_TYPE_MAP_MAX)
+    .if((o_msg_type > CMSG_TYPE_MAP_MAX) && (o_msg_type != CMSG_TYPE_RFS))
 		br[ERROR_LABEL]
     .endif
 
@@ -576,6 +579,9 @@ cmsg_exit#:
     #define_eval MAX_JUMP (CMSG_TYPE_MAP_MAX + 1)
     preproc_jump_targets(j, MAX_JUMP)
 
+    alu[--, cmsg_type, -, CMSG_TYPE_RFS]
+    beq[cmsg_rfs#]
+
     #ifdef _CMSG_LOOP
         #error "_CMSG_LOOP is already defined" (_CMSG_LOOP)
     #endif
@@ -589,6 +595,10 @@ cmsg_exit#:
     #undef _CMSG_LOOP
     #undef MAX_JUMP
 
+    cmsg_rfs#:
+		_cmsg_rfs_update(cmsg_addr_hi, HDR_DATA[CMSG_RFS_COUNT_IDX], $pkt_data, $reply)
+		br[cmsg_proc_ret#]
+
     s/**/CMSG_TYPE_MAP_ALLOC#:
 		.begin
 			.reg keysz, valuesz, maxent
@@ -624,6 +634,9 @@ alloc_cont#:
 			.reg max_entries
 			.reg cur_key
 			.reg le_key
+			.reg gen_addr
+			.reg entry_op
+			.reg acl_table
 
 			cmsg_lm_ctx_addr(lm_key_offset,lm_value_offset, ctx_num)
 			cmsg_lm_handles_define()
@@ -661,6 +674,7 @@ proc_loop#:
     		ov_single(OV_LENGTH, CMSG_TXFR_COUNT, OVF_SUBTRACT_ONE) // Length in 32-bit LWs
     		mem[read32_swap, $pkt_data[0], cmsg_addr_hi, <<8, key_offset, max_/**/CMSG_TXFR_COUNT], indirect_ref, sig_done[rd_sig]
 			ctx_arb[rd_sig]
+			alu[acl_table, --, b, $pkt_data[0], >>NIC_ACL_KEY_TABLE_shf]
 			aggregate_copy(CMSG_KEY_LM_INDEX, ++, $pkt_data, 0, (CMSG_TXFR_COUNT-1))
 			br[proc_loop_cont#]
 proc_array_map#:
@@ -701,11 +715,29 @@ proc_loop_cont#:
 
 do_op#:
 			swap(le_key, cur_key, NO_LOAD_CC)
+			alu[entry_op, --, b, l_cmsg_type]
 
-			_cmsg_hashmap_op(l_cmsg_type, cur_fd, lm_key_offset, lm_value_offset, cmsg_addr_hi, key_offset, value_offset, flags, rc, swap, le_key, cur_key)
+			/* INSTR_ACL only holds tables up to NIC_ACL_MAX_TABLE, fail
+			 * the entry with CMSG_RC_ERR_MAP_PARSE rather than add a rule
+			 * that never matches */
+			.if (cmsg_type == CMSG_TYPE_MAP_ADD)
+			.begin
+				.reg max_table
+
+				alu[--, cur_fd, -, ACL_TID]
+				bne[acl_table_ok#]
+				move(max_table, NIC_ACL_MAX_TABLE)
+				alu[--, max_table, -, acl_table]
+				bhs[acl_table_ok#]
+				immed[entry_op, 0]
+acl_table_ok#:
+			.end
+			.endif
+
+			_cmsg_hashmap_op(entry_op, cur_fd, lm_key_offset, lm_value_offset, cmsg_addr_hi, key_offset, value_offset, flags, rc, swap, le_key, cur_key)
     /* check if reply required */
             alu[--, cur_fd, -, SRIOV_TID]
-            beq[FREE_LABEL]
+            beq[sriov_done#]
 			alu[key_offset, value_offset, +, 64]
 			alu[cmsg_reply_pktlen, cmsg_reply_pktlen, +, (64*2)]
 			alu[save_rc, save_rc, or, rc]
@@ -732,6 +764,12 @@ do_op#:
 			.endif
 			br[proc_loop#]
 
+sriov_done#:
+			/* Flow cache entries may hold the old value, see flow_cache.h */
+			move(gen_addr, ((FLOW_CACHE_GEN >> 8) & 0xffffffff))
+			mem[incr, --, gen_addr, <<8, (FLOW_CACHE_GEN & 0xff)]
+			br[FREE_LABEL]
+
 done#:
 			/* fill in header here */
 			cmsg_set_reply($reply[0], cmsg_type, cmsg_tag)
@@ -748,6 +786,143 @@ cmsg_proc_ret#:
 .end
 #endm
 
+/* Apply the entries of a CMSG_TYPE_RFS message to _nic_rfs_tbl and write
+ * the reply, see app_config_rfs.h. io_bucket holds the bucket of each entry
+ * in turn and io_reply the reply.
+ */
+#macro _cmsg_rfs_update(in_addr_hi, in_count, io_bucket, io_reply)
+.begin
+	.reg age
+	.reg bucket_addr
+	.reg count
+	.reg data
+	.reg entry_offset
+	.reg flow_id
+	.reg hash
+	.reg hit_way
+	.reg lru_age
+	.reg now
+	.reg rc
+	.reg reply_offset
+	.reg req
+	.reg rfs_base
+	.reg tag
+	.reg way
+	.reg written
+	.reg read $req[3]
+	.xfer_order $req
+	.reg write $entry[NIC_RFS_ENTRY_LW]
+	.xfer_order $entry
+	.sig sig_req
+	.sig sig_bucket
+	.sig sig_write
+
+	immed[rc, CMSG_RC_SUCCESS]
+	immed[written, 0]
+	alu[count, --, b, in_count]
+	beq[reply#]
+	alu[--, count, -, (NIC_RFS_BATCH_MAX + 1)]
+	blo[entries#]
+	br[reply#], defer[1]
+		immed[rc, CMSG_RC_ERR_E2BIG]
+
+entries#:
+	move(rfs_base, ((_nic_rfs_tbl >> 8) & 0xffffffff))
+	immed[entry_offset, (NFD_IN_DATA_OFFSET + (CMSG_RFS_ENTRY_IDX * 4))]
+
+entry_loop#:
+	mem[read32, $req[0], in_addr_hi, <<8, entry_offset, 3], ctx_swap[sig_req]
+	alu[hash, --, b, $req[0]]
+	alu[req, --, b, $req[1]]
+	alu[flow_id, --, b, $req[NIC_RFS_FLOW_ID_wrd]]
+	alu[tag, NIC_RFS_TBL_msk, and, req, >>NIC_RFS_TBL_shf]
+	alu[bucket_addr, hash, xor, tag]
+	alu[bucket_addr, --, b, bucket_addr, <<(32 - NIC_RFS_BUCKET_BITS)]
+	alu[bucket_addr, --, b, bucket_addr, >>(32 - NIC_RFS_BUCKET_BITS - NIC_RFS_BUCKET_SHF)]
+	mem[read32, io_bucket[0], rfs_base, <<8, bucket_addr, NIC_RFS_BUCKET_LW], ctx_swap[sig_bucket]
+
+	alu[tag, tag, or, 1, <<(NIC_RFS_VALID_bit - NIC_RFS_TBL_shf)]
+	local_csr_rd[TIMESTAMP_LOW]
+	immed[now, 0]
+	alu[now, --, b, now, >>NIC_RFS_STAMP_SHF]
+
+	/* The entry of the flow, else the first free or expired entry, else
+	 * the least recently used one */
+	immed[way, 0]
+	immed[lru_age, 0]
+	#define_eval LOOP (0)
+	#while (LOOP < NIC_RFS_WAYS)
+		alu[data, --, b, io_bucket[((LOOP * NIC_RFS_ENTRY_LW) + 1)]]
+		alu[--, hash, xor, io_bucket[(LOOP * NIC_RFS_ENTRY_LW)]]
+		bne[age/**/LOOP#]
+		alu[--, flow_id, xor, io_bucket[((LOOP * NIC_RFS_ENTRY_LW) + NIC_RFS_FLOW_ID_wrd)]]
+		bne[age/**/LOOP#]
+		alu[--, tag, xor, data, >>NIC_RFS_TBL_shf]
+		beq[found#], defer[1]
+			immed[hit_way, (LOOP * NIC_RFS_ENTRY_SZ)]
+	age/**/LOOP#:
+		alu[age, now, -, data]
+		ld_field_w_clr[age, 0011, age]
+		br_bclr[data, NIC_RFS_VALID_bit, free/**/LOOP#]
+		alu[--, --, b, age, >>NIC_RFS_TIMEOUT_SHF]
+		bne[free/**/LOOP#]
+		alu[--, lru_age, -, age]
+		bhs[next/**/LOOP#]
+		br[next/**/LOOP#], defer[2]
+			alu[lru_age, --, b, age]
+			immed[way, (LOOP * NIC_RFS_ENTRY_SZ)]
+	free/**/LOOP#:
+		/* Ages are below 1 << 16 */
+		alu[--, lru_age, -, 1, <<16]
+		bhs[next/**/LOOP#]
+		immed[lru_age, 1, <<16]
+		immed[way, (LOOP * NIC_RFS_ENTRY_SZ)]
+	next/**/LOOP#:
+		#define_eval LOOP (LOOP + 1)
+	#endloop
+	#undef LOOP
+
+	/* Nothing to remove for a flow without an entry */
+	br_bset[req, NIC_RFS_DELETE_bit, next_entry#]
+	br[add#]
+
+found#:
+	br_bclr[req, NIC_RFS_DELETE_bit, add#], defer[1]
+		alu[way, --, b, hit_way]
+	alu[$entry[0], --, b, 0]
+	alu[$entry[1], --, b, 0]
+	br[write#], defer[1]
+		alu[$entry[2], --, b, 0]
+
+add#:
+	alu[data, --, b, req, <<2]
+	alu[data, --, b, data, >>2]
+	ld_field[data, 0011, now]
+	alu[$entry[0], --, b, hash]
+	alu[$entry[1], data, or, 1, <<NIC_RFS_VALID_bit]
+	alu[$entry[2], --, b, flow_id]
+
+write#:
+	immed[$entry[3], 0]
+	alu[bucket_addr, bucket_addr, +, way]
+	mem[write32, $entry[0], rfs_base, <<8, bucket_addr, NIC_RFS_ENTRY_LW], ctx_swap[sig_write]
+	alu[written, written, +, 1]
+
+next_entry#:
+	alu[count, count, -, 1]
+	bne[entry_loop#], defer[1]
+		alu[entry_offset, entry_offset, +, NIC_RFS_ENTRY_SZ]
+
+reply#:
+	cmsg_set_reply(io_reply[0], CMSG_TYPE_RFS, cmsg_tag)
+	alu[io_reply[1], --, b, rc]
+	alu[io_reply[2], --, b, written]
+	immed[reply_offset, NFD_IN_DATA_OFFSET]
+	mem[write32, io_reply[0], in_addr_hi, <<8, reply_offset, CMSG_RFS_REPLY_LW], ctx_swap[sig_write]
+	immed[cmsg_reply_pktlen, (CMSG_RFS_REPLY_LW * 4)]
+.end
+#endm
+
 #macro _cmsg_alloc_fd(key_sz, value_sz, max_entries, endian, map_type)
 .begin
 		.reg fd
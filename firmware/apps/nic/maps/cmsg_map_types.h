@@ -19,6 +19,9 @@
 //SR-IOV VLAN-MAC Table ID
 #define SRIOV_TID               (HASHMAP_MAX_TID - 1)
 
+//5-tuple ACL Table ID, see app_config_acl.h
+#define ACL_TID                 (HASHMAP_MAX_TID - 2)
+
 /*
  * enhancement:  add field length to support variable size
  */
@@ -197,6 +200,8 @@
 #define CMSG_TYPE_MAP_GETNEXT   6
 #define CMSG_TYPE_MAP_GETFIRST  7
 #define CMSG_TYPE_PRINT			8
+#define CMSG_TYPE_SAMPLE		9	/* see app_config_sample.h */
+#define CMSG_TYPE_RFS			10	/* see app_config_rfs.h */
 	/* CMSG_TYPE_MAP_ARRAY_GETNEXT is internal type */
 #define CMSG_TYPE_MAP_ARRAY_GETNEXT  0xf6
 
@@ -212,6 +217,7 @@
 #define CMSG_TYPE_MAP_DELETE_REPLY		0x85
 #define CMSG_TYPE_MAP_GETNEXT_REPLY		0x86
 #define CMSG_TYPE_MAP_GETFIRST_REPLY	0x87
+#define CMSG_TYPE_RFS_REPLY				0x8a
 
 #define CMSG_TYPE_MAP_REPLY_BIT			7
 
@@ -151,12 +151,21 @@
 /* Configuration mechanism defines */
 #define NFD_CFG_MAX_MTU         9216
 
+/* UDP segmentation offload: the driver hands UDP packets to the LSO path
+ * (PCIE_DESC_TX_LSO) and __pv_lso_fixup writes the UDP length of each
+ * segment. Drivers that know the bit advertise NETIF_F_GSO_UDP_L4 for it,
+ * the NFD headers of this tree predate it. */
+#ifndef NFP_NET_CFG_CTRL_USO
+#define NFP_NET_CFG_CTRL_USO    (0x1 << 16)
+#endif
+
 #define NFD_CFG_VF_CAP                                             \
     (NFP_NET_CFG_CTRL_ENABLE    | NFP_NET_CFG_CTRL_PROMISC |       \
      NFP_NET_CFG_CTRL_RXCSUM    | NFP_NET_CFG_CTRL_TXCSUM |        \
      NFP_NET_CFG_CTRL_MSIXAUTO  | NFP_NET_CFG_CTRL_CSUM_COMPLETE | \
      NFP_NET_CFG_CTRL_GATHER    | NFP_NET_CFG_CTRL_LSO |           \
-     NFP_NET_CFG_CTRL_IRQMOD    | NFP_NET_CFG_CTRL_VXLAN)
+     NFP_NET_CFG_CTRL_USO       | NFP_NET_CFG_CTRL_IRQMOD |        \
+     NFP_NET_CFG_CTRL_VXLAN)
 
 #define NFD_CFG_VF_LEGAL_UPD \
     (NFP_NET_CFG_UPDATE_GEN     | NFP_NET_CFG_UPDATE_RING |        \
@@ -172,9 +181,9 @@
      NFP_NET_CFG_CTRL_RSS       | NFP_NET_CFG_CTRL_RSS2 |          \
      NFP_NET_CFG_CTRL_MSIXAUTO  | NFP_NET_CFG_CTRL_CSUM_COMPLETE | \
      NFP_NET_CFG_CTRL_GATHER    | NFP_NET_CFG_CTRL_LSO |           \
-     NFP_NET_CFG_CTRL_IRQMOD    | NFP_NET_CFG_CTRL_BPF |           \
-     NFP_NET_CFG_CTRL_LIVE_ADDR | NFP_NET_CFG_CTRL_VXLAN |         \
-     NFP_NET_CFG_CTRL_NVGRE)
+     NFP_NET_CFG_CTRL_USO       | NFP_NET_CFG_CTRL_IRQMOD |        \
+     NFP_NET_CFG_CTRL_BPF       | NFP_NET_CFG_CTRL_LIVE_ADDR |     \
+     NFP_NET_CFG_CTRL_VXLAN     | NFP_NET_CFG_CTRL_NVGRE)
 
 #else
 
@@ -184,9 +193,9 @@
      NFP_NET_CFG_CTRL_RSS       | NFP_NET_CFG_CTRL_RSS2 |          \
      NFP_NET_CFG_CTRL_MSIXAUTO  | NFP_NET_CFG_CTRL_CSUM_COMPLETE | \
      NFP_NET_CFG_CTRL_GATHER    | NFP_NET_CFG_CTRL_LSO |           \
-     NFP_NET_CFG_CTRL_IRQMOD    | NFP_NET_CFG_CTRL_BPF |           \
-     NFP_NET_CFG_CTRL_LIVE_ADDR | NFP_NET_CFG_CTRL_VXLAN |         \
-     NFP_NET_CFG_CTRL_NVGRE)
+     NFP_NET_CFG_CTRL_USO       | NFP_NET_CFG_CTRL_IRQMOD |        \
+     NFP_NET_CFG_CTRL_BPF       | NFP_NET_CFG_CTRL_LIVE_ADDR |     \
+     NFP_NET_CFG_CTRL_VXLAN     | NFP_NET_CFG_CTRL_NVGRE)
 
 #endif
 
@@ -3,6 +3,7 @@
 # Copyright (c) 2019 Netronome Systems, Inc. All rights reserved.
 # SPDX-License-Identifier: BSD-2-Clause
 
+import os
 import re
 import sys
 import argparse
@@ -118,14 +119,130 @@ def parse_list(filename, label_prefix, jump_comment_tag, offsets=[]):
                     offsets.append(uwords[i] - jump_addr)
 
 
-def write_header_file(array_type, array_name, header_file_name, offsets = []):
+def parse_label_addrs(filename):
+    """Return a dict of ucode address by label for a .list file.
+
+    Labels are listed after the uword they are attached to, as assumed by
+    parse_list() above.
+    """
+    uword_pat = re.compile(r'^\.([0-9]+)\s+([a-zA-Z0-9]+)\s+')
+    label_pat = re.compile(r'^\s*(\w+#):')
+    end_pat = re.compile(r'\+ucode_end')
+    addrs = {}
+    addr = -1
+
+    with open(filename, 'r') as f:
+        for line in f:
+            line = line.strip()
+
+            if end_pat.search(line):
+                break
+
+            s = uword_pat.search(line)
+            if s:
+                addr = int(s.group(1))
+                continue
+
+            s = label_pat.search(line)
+            if s and addr >= 0 and s.group(1) not in addrs:
+                addrs[s.group(1)] = addr
+
+    return addrs
+
+
+def parse_instructions(filename):
+    """Return a dict of instruction text by ucode address for a .list file.
+
+    The instruction lines follow the uword and its labels, as assumed by
+    parse_list() above.
+    """
+    uword_pat = re.compile(r'^\.([0-9]+)\s+([a-zA-Z0-9]+)\s+')
+    label_pat = re.compile(r'^\s*(\w+#):')
+    debug_pat = re.compile(r'\.%line')
+    skip_pat = re.compile(r'^[\.\;\#]')
+    end_pat = re.compile(r'\+ucode_end')
+    instrs = {}
+    addr = -1
+
+    with open(filename, 'r') as f:
+        for line in f:
+            line = line.strip()
+
+            if end_pat.search(line):
+                break
+
+            s = uword_pat.search(line)
+            if s:
+                addr = int(s.group(1))
+                instrs[addr] = ''
+                continue
+
+            if (addr < 0 or not line or label_pat.search(line) or
+                    debug_pat.search(line) or skip_pat.search(line)):
+                continue
+
+            instrs[addr] = (instrs[addr] + ' ' + line).strip()
+
+    return instrs
+
+
+# The conditional branch of __actions_next(), which falls through to the
+# next instruction for a pipelined action
+PIPELINE_EXIT_PAT = re.compile(r'^br_bclr\[.*\bnext#\s*\]')
+
+
+def handler_offsets(filename, base_label, handlers, offsets, successors):
+    """Find the offset of each handler label from the base label.
+
+    The base label is that of the dispatch jump[] in actions_execute, so
+    the offsets are the jump indices the worker uses.
+    The successor of a handler is the handler that follows it in code
+    store, which is where a pipelined action falls through to. That only
+    holds if the __actions_next() of the handler is the last word before
+    the successor; any other __actions_next() in between would fall
+    through into code that is not a handler, which is an error. Handlers
+    with no __actions_next() there are given an offset that no action can
+    have, so their actions are never marked pipelined.
+    """
+    addrs = parse_label_addrs(filename)
+    instrs = parse_instructions(filename)
+
+    for label in handlers + [base_label]:
+        if label not in addrs:
+            raise ValueError('label ' + label + ' not found')
+
+    base = addrs[base_label]
+    for label in handlers:
+        if addrs[label] < base:
+            raise ValueError('handler ' + label + ' precedes jump base')
+        offsets.append(addrs[label] - base)
+
+    for label, offset in zip(handlers, offsets):
+        following = [o for o in offsets if o > offset]
+        if not following:
+            successors.append(0xffff)
+            continue
+
+        succ = min(following)
+        exits = [a for a in range(base + offset, base + succ)
+                 if PIPELINE_EXIT_PAT.search(instrs.get(a, ''))]
+        for a in exits:
+            if a != base + succ - 1:
+                raise ValueError('handler ' + label + ' falls through at ' +
+                                 str(a) + ', not into the next handler')
+        successors.append(succ if exits else 0xffff)
+
+
+def write_header_file(array_type, array_name, header_file_name, offsets = [],
+                      next_array_name = None, successors = []):
 
     lines = []
+    guard = os.path.basename(str(header_file_name)).upper()
 
     with open(header_file_name + '.h', 'w') as f:
 
-        lines.append('#ifndef __' + str(header_file_name).upper() + '_H\n')
-        lines.append('#define __' + str(header_file_name).upper() + '_H\n')
+        lines.append('#ifndef __' + guard + '_H\n')
+        lines.append('#define __' + guard + '_H\n')
 
         lines.append('\n')
 
@@ -136,9 +253,14 @@ def write_header_file(array_type, array_name, header_file_name, offsets = []):
             if(i < len(offsets)):
                 lines.append(str(offset) + ', ')
             else:
-                lines.append(str(offset) + '}\n ')
+                lines.append(str(offset) + '};\n')
             i = i + 1
 
+        if next_array_name:
+            lines.append('\n')
+            lines.append(array_type + ' ' + next_array_name + '[] = {')
+            lines.append(', '.join([str(s) for s in successors]) + '};\n')
+
         lines.append('\n')
 
         lines.append('#endif\n')
@@ -151,15 +273,26 @@ if __name__ == '__main__':
 
 
     offsets = []
+    successors = []
     array_name = ''
     header_file_name = ''
 
     parser = argparse.ArgumentParser(
         description='Parse list file')
 
-    parser.add_argument('--label_prefix', '-l', action='store', required=True,
+    parser.add_argument('--label_prefix', '-l', action='store',
                         help='label prefix to find offsets for')
 
+    parser.add_argument('--handlers', action='store',
+                        help='Comma or space separated handler labels, in opcode order. Their offsets from '
+                        '--base_label and code store successors are emitted instead of using --label_prefix')
+
+    parser.add_argument('--base_label', '-b', action='store',
+                        help='Label the handler offsets are relative to. Defaults to the first handler')
+
+    parser.add_argument('--next_array_name', '-n', action='store',
+                        help='Array name for the handler successors. Requires --handlers')
+
     parser.add_argument('--jump_table_tag', '-j', action='store', required=True,
                         help='Tag to identify the jump table. Will be used as array name')
 
@@ -180,16 +313,33 @@ if __name__ == '__main__':
 
     if(arguments.array_name == None):
         array_name = arguments.jump_table_tag
+    else:
+        array_name = arguments.array_name
 
     if(arguments.header_file_name == None):
         header_file_name = arguments.jump_table_tag
+    else:
+        header_file_name = arguments.header_file_name
+
+    if(arguments.handlers == None and arguments.label_prefix == None):
+        parser.error('one of --label_prefix or --handlers is required')
 
 
     try:
-        parse_list(arguments.listfile, arguments.label_prefix, arguments.jump_table_tag, offsets)
-        write_header_file(arguments.array_type, array_name, header_file_name, offsets)
-    except:
-        print 'Error parsing ' + arguments.listfile
+        if(arguments.handlers != None):
+            handlers = [h if h.endswith('#') else h + '#'
+                        for h in re.split(r'[,\s]+', arguments.handlers.strip())]
+            base_label = arguments.base_label or handlers[0]
+            if not base_label.endswith('#'):
+                base_label += '#'
+            handler_offsets(arguments.listfile, base_label, handlers,
+                            offsets, successors)
+        else:
+            parse_list(arguments.listfile, arguments.label_prefix, arguments.jump_table_tag, offsets)
+        write_header_file(arguments.array_type, array_name, header_file_name, offsets,
+                          arguments.next_array_name, successors)
+    except Exception as e:
+        print('Error parsing ' + arguments.listfile + ': ' + str(e))
         sys.exit(1)
 
 
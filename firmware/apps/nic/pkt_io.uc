@@ -30,6 +30,7 @@ nfd_out_send_init()
 .endif
 
 #include "pv.uc"
+#include "actions_profile.uc"
 
 .sig volatile __pkt_io_sig_epoch
 .addr __pkt_io_sig_epoch 8
@@ -68,6 +69,10 @@ nfd_out_send_init()
 .reg_addr __pkt_io_quiescent 27 A
 .set __pkt_io_quiescent
 
+/* CLS address of the NIC_CFG_INSTR_TBL bank in use, see app_config_instr.h */
+.reg volatile __pkt_io_act_bank
+.set __pkt_io_act_bank
+
 
 #macro pkt_io_drop(in_pkt_vec)
     pv_free($__pkt_io_gro_meta, pkt_vec)
@@ -104,6 +109,8 @@ nfd_out_send_init()
     #ifdef PV_MULTI_PCI
         alu[pci_isl, 3, AND, in_tx_args, >>6]
     #endif
+    /* NFD has 64 queues per PCIe island, upd_rss_table() keeps RSS
+     * tables of any size within the queues of the vNIC */
     alu[pci_q, in_tx_args, +8, BF_A(io_pkt_vec, PV_QUEUE_OFFSET_bf)]
     alu[pci_q, pci_q, AND, 0x3f]
 
@@ -448,8 +455,29 @@ skip_dispatch#:
 #endm
 
 
+/* Switch to the action table bank selected by the app master. The NN
+ * register is written before the epoch signal is sent, so it is up to date
+ * whenever the signal is consumed. Only bit 0 is used, so any value selects
+ * a valid bank before the app master initialises the NN registers, both
+ * banks start out with the same default lists. */
+#macro __pkt_io_act_bank_load()
+.begin
+    .reg bank_mask
+
+    local_csr_wr[NN_GET, NIC_INSTR_BANK_NN_IDX]
+    immed[__pkt_io_act_bank, NIC_INSTR_BANK1_ADDR]
+    nop
+    nop
+    alu[bank_mask, 1, AND, *n$index]
+    alu[bank_mask, 0, -, bank_mask]
+    alu[__pkt_io_act_bank, __pkt_io_act_bank, AND, bank_mask]
+.end
+#endm
+
+
 #macro pkt_io_init(out_pkt_vec)
     immed[__pkt_io_quiescent, 0]
+    immed[__pkt_io_act_bank, 0]
     alu[BF_A(out_pkt_vec, PV_QUEUE_IN_TYPE_bf), --, B, 0, <<BF_L(PV_QUEUE_IN_TYPE_bf)]
     __pkt_io_dispatch_nbi()
 #endm
@@ -477,7 +505,7 @@ nbi_dispatch#:
 wait_nfd_priority#:
     ctx_arb[__pkt_io_sig_epoch, __pkt_io_sig_nbi, __pkt_io_sig_nfd, __pkt_io_sig_nfd_retry], any
     br_signal[__pkt_io_sig_nfd_retry, nfd_dispatch#]
-    br_signal[__pkt_io_sig_epoch, wait_nfd_priority#]
+    br_signal[__pkt_io_sig_epoch, epoch_nfd#]
 
 clear_sig_rx_nfd#:
     br_!signal[__pkt_io_sig_nfd, clear_sig_rx_nbi#] // __pkt_io_sig_nbi is asserted
@@ -488,6 +516,16 @@ rx_nfd#:
         alu[out_act_addr, 0xff, AND, BF_A($__pkt_io_nfd_desc, NFD_IN_QID_fld)]
         alu[out_act_addr, --, B, out_act_addr, <<(log2(NIC_MAX_INSTR * 4))]
 
+epoch_nfd#:
+    __pkt_io_act_bank_load()
+    actions_profile_flush()
+    br[wait_nfd_priority#]
+
+epoch_nbi#:
+    __pkt_io_act_bank_load()
+    actions_profile_flush()
+    br[wait_nbi_priority#]
+
 quiesce_nbi#:
     __pkt_io_quiesce_wait_active(NBI, nbi_dispatch#, nfd, rx_nfd#, quiescence#)
 
@@ -497,6 +535,7 @@ quiesce_nfd#:
 quiescence#:
     ctx_arb[__pkt_io_sig_resume]
     pkt_io_init(io_vec)
+    __pkt_io_act_bank_load()
 
 nfd_dispatch#:
     br_signal[__pkt_io_sig_quiesce_nfd, quiesce_nfd#]
@@ -505,7 +544,7 @@ nfd_dispatch#:
 wait_nbi_priority#:
     ctx_arb[__pkt_io_sig_epoch, __pkt_io_sig_nbi, __pkt_io_sig_nfd, __pkt_io_sig_nfd_retry], any
     br_signal[__pkt_io_sig_nfd_retry, nfd_dispatch#]
-    br_signal[__pkt_io_sig_epoch, wait_nbi_priority#]
+    br_signal[__pkt_io_sig_epoch, epoch_nbi#]
 
 clear_sig_rx_nbi#:
     br_!signal[__pkt_io_sig_nbi, clear_sig_rx_nfd#] // __pkt_io_sig_nfd is asserted
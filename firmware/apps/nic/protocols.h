@@ -18,6 +18,7 @@
 #define ETH_TYPE_SIZE               2
 #define ETH_VLAN_SIZE               2
 #define NET_ETH_TYPE_SVLAN          0x88A8
+#define NET_ETH_TYPE_TEB            0x6558  // transparent Ethernet bridging
 
 #define MPLS_LABEL_SIZE             4
 
@@ -102,6 +103,7 @@
 
 #define IP_PROTOCOL_TCP             0x06
 #define IP_PROTOCOL_UDP             0x11
+#define IP_PROTOCOL_SCTP            0x84
 
 #define L4_SOURCE_PORT_bf           0, 31, 16
 #define L4_DESTINATION_PORT_bf      0, 15, 0
@@ -164,11 +166,35 @@
 #define UDP_LEN_OFFS                4
 #define UDP_HDR_SIZE                8
 
+/*
+ * SCTP common header, the checksum is a CRC32c in little endian
+ * Bit    3 3 2 2 2 2 2 2 2 2 2 2 1 1 1 1 1 1 1 1 1 1 0 0 0 0 0 0 0 0 0 0
+ * -----\ 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0 9 8 7 6 5 4 3 2 1 0
+ * Word  +-------------------------------+-------------------------------+
+ *    0  |          Source port          |      Destination port         |
+ *       +-------------------------------+-------------------------------+
+ *    1  |                       Verification tag                        |
+ *       +---------------------------------------------------------------+
+ *    2  |                           Checksum                            |
+ *       +---------------------------------------------------------------+
+ */
+
+#define SCTP_VERIFICATION_TAG_bf    1, 31, 0
+#define SCTP_CHECKSUM_bf            2, 31, 0
+
+#define SCTP_CHECKSUM_OFFS          8
+#define SCTP_HDR_SIZE               12
+
 /* Tunnel Definitions */
 
 #define VXLAN_SIZE                   8
 #define NVGRE_SIZE                   4
 #define GENEVE_SIZE                  8
 #define NET_GENEVE_PORT              0x17C1
+#define NET_MPLS_UDP_PORT            0x19EB  // RFC 7510
+#define GTPU_SIZE                    8
+#define GTPU_OPT_SIZE                4       // if any of the E, S, PN flags
+#define GTPU_MSG_GPDU                0xFF
+#define NET_GTPU_PORT                0x0868  // 3GPP TS 29.281
 
 #endif
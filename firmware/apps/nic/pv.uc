@@ -76,7 +76,7 @@ passert(PV_MAX_CLONES, "EQ", 2)
  *       +-+---------+-------------------+-----+---------+---------------+
  *    11 |        Sequence Number        | --- | Seq Ctx |   Protocol    | 3
  *       +-------------------------------+-+-+-+---------+---+-+-+-+-+-+-+
- *    12 |         TX Host Flags         |M|B|Seek (64B algn)|-|Q|I|i|C|c| 4
+ *    12 |         TX Host Flags         |M|B|Seek (64B algn)|H|Q|I|i|C|c| 4
  *       +-------------------------------+-+-+---------------+-+-+-+-+-+-+
  *    13 |       8B Header Offsets (stacked outermost to innermost)      | 5
  *       +-----------------+-----+-----------------------+---------------+
@@ -95,6 +95,7 @@ passert(PV_MAX_CLONES, "EQ", 2)
  * V     - One or more VLANs present
  * M     - dest MAC is multicast
  * B     - dest MAC is broadcast
+ * H     - Header words copied to LM by an action (see actions.uc)
  * I     - Enable offload of inner L3 checksum
  * i     - Enable offload of inner L4 checksum
  * C     - Enable offload of outer L3 checksum
@@ -114,8 +115,8 @@ passert(PV_MAX_CLONES, "EQ", 2)
  * B   - BPF offload executed
  * 4   - IPv4 header was parsed
  * $   - IPv4 checksum is valid
- * t   - TCP header was parsed
- * T   - TCP checksum is valid
+ * t   - TCP header was parsed, or SCTP validated by CHECKSUM V
+ * T   - TCP checksum is valid, or SCTP CRC32c (see app_config_csum.h)
  * u   - UDP header was parsed
  * U   - UDP checksum is valid
  * V   - VLAN parsed and stripped
@@ -153,6 +154,7 @@ passert(PV_MAX_CLONES, "EQ", 2)
 #define PV_SEQ_NO_bf                    PV_SEQ_wrd, 31, 16
 #define PV_SEQ_CTX_bf                   PV_SEQ_wrd, 12, 8
 #define PV_PROTO_bf                     PV_SEQ_wrd, 7, 0
+#define PV_PROTO_L4_UNKNOWN_bf          PV_SEQ_wrd, 2, 2
 #define PV_PROTO_IPV4_bf                PV_SEQ_wrd, 1, 1
 #define PV_PROTO_UDP_bf                 PV_SEQ_wrd, 0, 0
 
@@ -160,7 +162,7 @@ passert(PV_MAX_CLONES, "EQ", 2)
 #define PV_TX_FLAGS_bf                  PV_FLAGS_wrd, 31, 16
 #define PV_TX_HOST_RX_RSS_bf            PV_FLAGS_wrd, 31, 31
 #define PV_TX_HOST_I_IP4_bf             PV_FLAGS_wrd, 30, 30
-#define PV_TX_HOST_I_CSUM_IP4_OK_bf     PV_FLAGS_wrd, 29, 20
+#define PV_TX_HOST_I_CSUM_IP4_OK_bf     PV_FLAGS_wrd, 29, 29
 #define PV_TX_HOST_I_TCP_bf             PV_FLAGS_wrd, 28, 28
 #define PV_TX_HOST_I_CSUM_TCP_OK_bf     PV_FLAGS_wrd, 27, 27
 #define PV_TX_HOST_I_UDP_bf             PV_FLAGS_wrd, 26, 26
@@ -174,10 +176,14 @@ passert(PV_MAX_CLONES, "EQ", 2)
 #define PV_TX_HOST_CSUM_TCP_OK_bf       PV_FLAGS_wrd, 19, 19
 #define PV_TX_HOST_UDP_bf               PV_FLAGS_wrd, 18, 18
 #define PV_TX_HOST_CSUM_UDP_OK_bf       PV_FLAGS_wrd, 17, 17
+/* SCTP CRC32c results use the TCP flags, the host takes either for L4 */
+#define PV_TX_HOST_SCTP_bf              PV_TX_HOST_TCP_bf
+#define PV_TX_HOST_CSUM_SCTP_OK_bf      PV_TX_HOST_CSUM_TCP_OK_bf
 #define PV_MAC_DST_TYPE_bf              PV_FLAGS_wrd, 15, 14
 #define PV_MAC_DST_MC_bf                PV_FLAGS_wrd, 15, 15
 #define PV_MAC_DST_BC_bf                PV_FLAGS_wrd, 14, 14
 #define PV_SEEK_BASE_bf                 PV_FLAGS_wrd, 13, 6
+#define PV_HDR_CACHED_bf                PV_FLAGS_wrd, 5, 5
 #define PV_QUEUE_SELECTED_bf            PV_FLAGS_wrd, 4, 4
 #define PV_CSUM_OFFLOAD_bf              PV_FLAGS_wrd, 3, 0
 #define PV_CSUM_OFFLOAD_IL3_bf          PV_FLAGS_wrd, 3, 3
@@ -286,6 +292,13 @@ passert(PV_MAX_CLONES, "EQ", 2)
 #define PROTO_ENCAP_SHF                    5
 #define PROTO_UNKNOWN                      0xFF
 
+/* pv_hdr_parse_subroutine starts no header beyond PV_HDR_PARSE_MAX_OFFSET,
+ * leaving room for an IPv4 header with options within the 8 bit offsets of
+ * PV_HEADER_STACK, and reads at most PV_MPLS_MAX_LABELS labels, which are
+ * within the packet window of the seek to the first */
+#define PV_HDR_PARSE_MAX_OFFSET            (0xff - 60)
+#define PV_MPLS_MAX_LABELS                 8
+
 #ifndef PV_GRO_NFD_START
     #define PV_GRO_NFD_START            8
 #endif
@@ -1299,6 +1312,7 @@ end#:
     .reg seq_ctx
     .reg shift
     .reg tunnel
+    .reg udp_dst_port
     .reg vlan_len
     .reg vlan_id
     .reg read $seq
@@ -1383,6 +1397,17 @@ ipv4_frag#:
     br[finalize_l3#], defer[1]
         ld_field[BF_A(out_vec, PV_PROTO_bf), 0001, PROTO_IPV4_FRAGMENT]
 
+gtpu_port#:
+    // UDP to port 2152 only, the port is the low half of the word at the L4
+    // offset, within the window read at offset 0
+    br_bset[BF_AL(in_nbi_desc, CAT_L4_CLASS_bf), l4_fast_path#] ; CAT_L4_CLASS_bf
+    pv_seek(out_vec, l4_offset, PV_SEEK_T_INDEX_ONLY)
+    alu[udp_dst_port, 0, +16, *$index++]
+    immed[tunnel, NET_GTPU_PORT]
+    alu[--, udp_dst_port, -, tunnel]
+    beq[hdr_parse#]
+    br[l4_fast_path#]
+
 read_pkt#:
     __pv_get_mac_dst_type(mac_dst_type, out_vec) // advances *$index by 2 words
     alu[vlan_len, (3 << 2), AND, BF_A(in_nbi_desc, MAC_PARSE_VLAN_bf), >>(BF_L(MAC_PARSE_VLAN_bf) - 2)]
@@ -1414,20 +1439,27 @@ skip_vlan#:
     alu[l4_type, 0xe, AND, BF_A(in_nbi_desc, CAT_L4_CLASS_bf), >>BF_L(CAT_L4_CLASS_bf)] ; CAT_L4_CLASS_bf
     br!=byte[l4_type, 0, 2, hdr_parse#]
 
+    // deep parse if MPLS over UDP is configured
+    br_bset[in_rx_args, BF_L(INSTR_RX_PARSE_MPLS_UDP_bf), hdr_parse#]
+
     // deep parse if UDP tunnels are possible and configured
     alu[tunnel, in_rx_args, AND, ((BF_MASK(INSTR_RX_PARSE_VXLANS_bf) << BF_L(INSTR_RX_PARSE_VXLANS_bf)) | (1 << BF_L(INSTR_RX_PARSE_GENEVE_bf)))]
     alu[tunnel, 0, -, tunnel]
     alu[tunnel, tunnel, AND~, BF_A(in_nbi_desc, CAT_L4_CLASS_bf)]
     br_bset[tunnel, BF_L(CAT_L4_CLASS_bf), hdr_parse#] ; CAT_L4_CLASS_bf
 
+    // deep parse GTP-U if the IP payloads of tunnels are configured
+    bitfield_extract__sz1(l4_offset, BF_AML(in_nbi_desc, CAT_L4_OFFSET_bf)) ; CAT_L4_OFFSET_bf
+    br_bset[in_rx_args, BF_L(INSTR_RX_PARSE_TUN_IP_bf), gtpu_port#], defer[1]
+        alu[l4_offset, l4_offset, -, MAC_PREPEND_BYTES]
+
+l4_fast_path#:
     // set PV_PROTO_bf to IPv4 according to L4 protocol
     alu[BF_A(out_vec, PV_PROTO_bf), BF_A(out_vec, PV_PROTO_bf), AND~, 0xfc] ; PV_PROTO_bf
     alu[l4_tcp, 1, AND, BF_A(in_nbi_desc, CAT_L4_CLASS_bf), >>BF_L(CAT_L4_CLASS_bf)] ; CAT_L4_CLASS_bf
     alu[BF_A(out_vec, PV_PROTO_bf), BF_A(out_vec, PV_PROTO_bf), AND~, l4_tcp] ; PV_PROTO_bf
 
     // store header offsets
-    bitfield_extract__sz1(l4_offset, BF_AML(in_nbi_desc, CAT_L4_OFFSET_bf)) ; CAT_L4_OFFSET_bf
-    alu[l4_offset, l4_offset, -, MAC_PREPEND_BYTES]
     alu[BF_A(out_vec, PV_HEADER_STACK_bf), BF_A(out_vec, PV_HEADER_STACK_bf), OR, l4_offset, <<BF_L(PV_HEADER_OFFSET_INNER_L4_bf)]
     alu[BF_A(out_vec, PV_HEADER_STACK_bf), BF_A(out_vec, PV_HEADER_STACK_bf), OR, l4_offset, <<BF_L(PV_HEADER_OFFSET_OUTER_L4_bf)]
 
@@ -1478,11 +1510,12 @@ end#:
     bitfield_extract__sz1(l3_offset, BF_AML(io_vec, PV_HEADER_OFFSET_OUTER_IP_bf))
     beq[lso_error#]
 
+    // GRE tunnels have no outer L4 header
     bitfield_extract__sz1(l4_offset, BF_AML(io_vec, PV_HEADER_OFFSET_OUTER_L4_bf))
-    beq[lso_error#]
-
-    br_bset[BF_AL(io_vec, PV_PROTO_UDP_bf), lso_error#]
+    bne[outer_l4#]
+    br_bclr[BF_AL(in_nfd_desc, NFD_IN_FLAGS_TX_ENCAP_fld), lso_error#]
 
+outer_l4#:
     alu[addr_hi, --, B, BF_A(io_vec, PV_MU_ADDR_bf), <<(31 - BF_M(PV_MU_ADDR_bf))]
 
     bitfield_extract(mss, BF_AML(in_nfd_desc, NFD_IN_LSO_MSS_fld))
@@ -1490,12 +1523,15 @@ end#:
     bitfield_extract__sz1(lso_seq, BF_AML(in_nfd_desc, NFD_IN_LSO_SEQ_CNT_fld))
     alu[lso_seq, lso_seq, -, 1]
 
-    br_bset[BF_AL(in_nfd_desc, NFD_IN_FLAGS_TX_ENCAP_fld), udp_encap#], defer[3]
+    br_bset[BF_AL(in_nfd_desc, NFD_IN_FLAGS_TX_ENCAP_fld), encap_l4#], defer[3]
 lso_begin#:
         immed[sig_mask, 0]
         alu[l3_addr, l3_offset, +16, BF_A(io_vec, PV_OFFSET_bf)]
         alu[l4_addr, l4_offset, +16, BF_A(io_vec, PV_OFFSET_bf)]
 
+    // UDP segmentation only fixes up the lengths, the host requests the checksum
+    br_bset[BF_AL(io_vec, PV_PROTO_UDP_bf), uso#]
+
     mem[read32, $tcp_hdr[0], addr_hi, <<8, l4_addr, 4], ctx_swap[sig_read_tcp], defer[2]
         alu[sig_mask, sig_mask, OR, mask(sig_write_tcp_seq), <<(&sig_write_tcp_seq)]
         alu[sig_mask, sig_mask, OR, mask(sig_write_tcp_flags), <<(&sig_write_tcp_flags)]
@@ -1523,6 +1559,7 @@ lso_begin#:
     alu[addr_lo, l4_addr, +, TCP_FLAGS_OFFS]
     mem[write8, $tcp_flags, addr_hi, <<8, addr_lo, 2], sig_done[sig_write_tcp_flags]
 
+ip#:
     br_bclr[BF_AL(io_vec, PV_PROTO_IPV4_bf), ipv6#], defer[3]
         /* IP length = pkt_len - l3_off */
         alu[ip_len, BF_A(io_vec, PV_LENGTH_bf), -, l3_offset]
@@ -1569,7 +1606,20 @@ repeat#:
         alu[sig_mask, sig_mask, OR, mask(sig_write_ip), <<(&sig_write_ip)]
         local_csr_wr[ACTIVE_CTX_WAKEUP_EVENTS, sig_mask]
 
-udp_encap#:
+uso#:
+    alu[udp_len, BF_A(io_vec, PV_LENGTH_bf), -, l4_offset]
+    alu[udp_len, udp_len, AND~, BF_MASK(PV_BLS_bf), <<BF_L(PV_BLS_bf)]
+    alu[$udp_len, --, B, udp_len, <<16]
+
+    alu[addr_lo, l4_addr, +, UDP_LEN_OFFS]
+    mem[write8, $udp_len, addr_hi, <<8, addr_lo, 2], sig_done[sig_write_udp_len]
+    br[ip#], defer[1]
+        alu[sig_mask, sig_mask, OR, mask(sig_write_udp_len), <<(&sig_write_udp_len)]
+
+encap_l4#:
+    alu[--, --, B, l4_offset]
+    beq[outer_ip#]
+
     alu[udp_len, BF_A(io_vec, PV_LENGTH_bf), -, l4_offset]
     alu[udp_len, udp_len, AND~, BF_MASK(PV_BLS_bf), <<BF_L(PV_BLS_bf)]
     alu[$udp_len, --, B, udp_len, <<16]
@@ -1577,6 +1627,8 @@ udp_encap#:
     alu[addr_lo, l4_addr, +, UDP_LEN_OFFS]
     mem[write8, $udp_len, addr_hi, <<8, addr_lo, 2], sig_done[sig_write_udp_len]
     alu[sig_mask, sig_mask, OR, mask(sig_write_udp_len), <<(&sig_write_udp_len)]
+
+outer_ip#:
     br_bset[BF_A(io_vec, PV_PROTO_IPV4_bf), (BF_L(PV_PROTO_IPV4_bf) + PROTO_ENCAP_SHF), ipv4#], defer[3]
         alu[ip_len, BF_A(io_vec, PV_LENGTH_bf), -, l3_offset]
         alu[ip_len, ip_len, AND~, BF_MASK(PV_BLS_bf), <<BF_L(PV_BLS_bf)]
@@ -1628,6 +1680,9 @@ ipv6#:
  *       25  VXLAN   -> PCIE_DESC_TX_ENCAP
  *       24  GRE     -> PCIE_DESC_TX_O_IP4_CSUM
  *
+ *       TCP_CS or UDP_CS on an SCTP packet requests its CRC32c.
+ *       TX_LSO on a UDP packet segments it (USO), UDP_CS is also set.
+ *
  *      S -> sp0 (spare)
  *    itf -> PCIe interface
  */
@@ -1737,7 +1792,11 @@ hdr_parse#:
         alu[BF_A(out_vec, PV_META_TYPES_bf), *$index++, B, 0]
         alu[BF_A(out_vec, PV_HEADER_STACK_bf), --, B, 0]
 
-    bitfield_extract__sz1(encap, BF_AML(in_nfd_desc, NFD_IN_FLAGS_TX_ENCAP_fld))
+    // the host marks tunnels, GENEVE and GRE are told apart from VXLAN here
+    br_bset[BF_AL(in_nfd_desc, NFD_IN_FLAGS_TX_ENCAP_fld), tunnel#], defer[1]
+        immed[encap, ((1 << BF_L(INSTR_RX_PARSE_TUN_IP_bf)) | (1 << BF_L(INSTR_RX_PARSE_GENEVE_bf)) | (1 << BF_L(INSTR_RX_PARSE_NVGRE_bf)) | (1 << BF_L(INSTR_RX_HOST_ENCAP_bf)))]
+    immed[encap, 0]
+tunnel#:
     pv_hdr_parse(out_vec, encap)
 
     br_bset[BF_AL(in_nfd_desc, NFD_IN_FLAGS_TX_LSO_fld), lso_fixup#]
@@ -2046,11 +2105,73 @@ end#:
 #endm
 
 
+/* Start reading the 64B chunk at in_offset into half HALF (0 or 1) of
+ * $__pv_pkt_data, signalling in_sig. The offset is 64B aligned and
+ * includes the 2 bytes of pad, as that of pv_seek_subroutine. Linear walks
+ * over the packet, such as __actions_checksum, read the next chunk into one
+ * half while consuming the other, there are no transfer registers for a
+ * second window. A chunk straddling the CTM buffer and MU is not read, the
+ * macro branches to STRADDLE_LABEL instead and pv_seek has to read it.
+ *
+ * The packet cache does not match PV_SEEK_BASE_bf after any read ahead,
+ * the caller has to invalidate it.
+ */
+#macro pv_read_ahead(io_vec, in_offset, HALF, in_sig, STRADDLE_LABEL)
+.begin
+    .reg buffer_offset
+    .reg cbs
+    .reg ctm_bytes
+    .reg mu_addr
+    .reg read_offset
+    .reg split_offset
+
+    #if ((HALF != 0) && (HALF != 1))
+        #error "pv_read_ahead: HALF must be 0 or 1"
+    #endif
+
+    br_bclr[BF_AL(io_vec, PV_CTM_ALLOCATED_bf), read_mu#], defer[1]
+        alu[read_offset, in_offset, -, 2]
+
+    br_bclr[BF_AL(io_vec, PV_SPLIT_bf), read_ctm#]
+
+    bitfield_extract__sz1(cbs, BF_AML(io_vec, PV_CBS_bf))
+    alu[split_offset, cbs, B, 1, <<8]
+    alu[split_offset, --, B, split_offset, <<indirect]
+
+    alu[buffer_offset, read_offset, +16, BF_A(io_vec, PV_OFFSET_bf)]
+    alu[ctm_bytes, split_offset, -, buffer_offset]
+    ble[read_mu#]
+
+    alu[--, 64, -, ctm_bytes]
+    bgt[STRADDLE_LABEL]
+
+read_ctm#:
+    ov_single(OV_LENGTH, 16, OVF_SUBTRACT_ONE)
+    mem[read32, $__pv_pkt_data[(HALF * 16)], BF_A(io_vec, PV_CTM_ADDR_bf), read_offset, max_16], indirect_ref, sig_done[in_sig]
+    br[end#]
+
+read_mu#:
+    alu[mu_addr, --, B, BF_A(io_vec, PV_MU_ADDR_bf), <<(31 - BF_M(PV_MU_ADDR_bf))]
+    alu[read_offset, read_offset, +16, BF_A(io_vec, PV_OFFSET_bf)]
+    ov_single(OV_LENGTH, 16, OVF_SUBTRACT_ONE)
+    mem[read32, $__pv_pkt_data[(HALF * 16)], mu_addr, <<8, read_offset, max_16], indirect_ref, sig_done[in_sig]
+
+end#:
+.end
+#endm
+
+
 #macro pv_invalidate_cache(in_pkt_vec)
     alu[BF_A(in_pkt_vec, PV_SEEK_BASE_bf), BF_A(in_pkt_vec, PV_SEEK_BASE_bf), OR, 0xff, <<BF_L(PV_SEEK_BASE_bf)]
 #endm
 
 
+/* The header words copied by the actions no longer match the packet */
+#macro pv_invalidate_hdr_cache(in_pkt_vec)
+    bits_clr__sz1(BF_AL(in_pkt_vec, PV_HDR_CACHED_bf), BF_MASK(PV_HDR_CACHED_bf))
+#endm
+
+
 .reg __pv_hdr_parse_args
 .reg __pv_hdr_parse_rtn
 #macro pv_hdr_parse_subroutine(pkt_vec)
@@ -2109,6 +2230,7 @@ check_ipv6_other#:
     br=byte[next_hdr, 3, NET_IP_PROTO_DSTOPTS, skip_ipv6_ext#]
     br=byte[next_hdr, 3, NET_IP_PROTO_ROUTING, skip_ipv6_ext#]
 
+ipv6_unknown#:
     br[done_hdr_stack#], defer[2]
         alu[BF_A(pkt_vec, PV_PROTO_bf), BF_A(pkt_vec, PV_PROTO_bf), OR, PROTO_IPV6_UNKNOWN] // L4 Unknown
         alu[hdr_stack, --, B, BF_A(pkt_vec, PV_HEADER_STACK_bf)]
@@ -2124,10 +2246,16 @@ skip_ipv6_ext#:
     byte_align_be[--, *$index++]
     byte_align_be[next_hdr, *$index++]
     alu[hdr_len, 0xff, AND, next_hdr, >>16]
-    br[check_ipv6_next_hdr#], defer[2]
-        /* hdr length = "Hdr Ext Len" * 8 + 8 */
-        alu[hdr_len, --, B, hdr_len, <<3]
-        alu[hdr_len, hdr_len, +, 8]
+    /* hdr length = "Hdr Ext Len" * 8 + 8 */
+    alu[hdr_len, --, B, hdr_len, <<3]
+    alu[hdr_len, hdr_len, +, 8]
+
+    /* the next header must start within reach of the 8 bit offsets of
+     * PV_HEADER_STACK, inner headers after a tunnel included */
+    alu[tmp, pkt_offset, +, hdr_len]
+    alu[--, 0xff, -, tmp]
+    bhs[check_ipv6_next_hdr#]
+    br[ipv6_unknown#]
 
 check_ipv4#:
     immed[proto_test, NET_ETH_TYPE_IPV4]
@@ -2165,7 +2293,7 @@ parse_ipv4_udp#:
 check_tunnel#:
     pv_seek(pkt_vec, pkt_offset, PV_SEEK_T_INDEX_ONLY)
 
-    br_bset[__pv_hdr_parse_args, BF_L(INSTR_RX_HOST_ENCAP_bf), skip_vxlan#], defer[1]
+    br_bset[__pv_hdr_parse_args, BF_L(INSTR_RX_HOST_ENCAP_bf), host_encap#], defer[1]
         // don't need byte_align_be[] after seek because check_tunnel# is only done for outer header
         alu[udp_dst_port, 0, +16, *$index++]
 
@@ -2189,41 +2317,168 @@ seek_inner#:
     alu[BF_A(pkt_vec, PV_HEADER_STACK_bf), --, B, BF_A(pkt_vec, PV_HEADER_STACK_bf), <<16]
 
 seek_eth_type#:
+    alu[--, PV_HDR_PARSE_MAX_OFFSET, -, pkt_offset]
+    blo[unknown_proto#]
     pv_seek(pkt_vec, pkt_offset, PV_SEEK_PAD_INCLUDED, check_eth_type#)
 
+host_encap#:
+    // the host marks UDP tunnels, GENEVE by its port if parsed, else VXLAN
+    br_bclr[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_GENEVE_bf), skip_vxlan#]
+    immed[proto_test, NET_GENEVE_PORT]
+    alu[--, udp_dst_port, -, proto_test]
+    beq[geneve#]
+    br[skip_vxlan#]
+
 check_geneve_tun#:
-    br_bclr[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_GENEVE_bf), done#]
+    br_bclr[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_GENEVE_bf), check_mpls_udp_tun#]
     immed[proto_test, NET_GENEVE_PORT]
     alu[--, udp_dst_port, -, proto_test]
-    bne[done#]
+    bne[check_mpls_udp_tun#]
 
+geneve#:
     alu[BF_A(pkt_vec, PV_PROTO_bf), BF_A(pkt_vec, PV_PROTO_bf), OR, (PROTO_GENEVE >> PROTO_ENCAP_SHF)]
 
     alu[--, --, B, *$index++] // skip over UDP Length:Checksum
+    alu[eth_type, 0, +16, *$index] // Protocol Type
     alu[hdr_len, (0x3f << 2), AND, *$index++, >>(24 - 2)] // Opt Len
 
-    br[seek_inner#], defer[2]
+    br[tun_payload#], defer[2]
+        alu[pkt_offset, pkt_offset, +, hdr_len]
+        alu[pkt_offset, pkt_offset, +, (UDP_HDR_SIZE + GENEVE_SIZE)]
+
+check_mpls_udp_tun#:
+    br_bclr[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_MPLS_UDP_bf), check_gtpu_tun#]
+    immed[proto_test, NET_MPLS_UDP_PORT]
+    alu[--, udp_dst_port, -, proto_test]
+    bne[check_gtpu_tun#]
+
+    // the label stack follows the UDP header, tmp as after check_eth_type#
+    alu[pkt_offset, pkt_offset, +, UDP_HDR_SIZE]
+    pv_seek(pkt_vec, pkt_offset, PV_SEEK_PAD_INCLUDED)
+    byte_align_be[--, *$index++]
+    br[mpls_labels#], defer[1]
+        byte_align_be[tmp, *$index++]
+
+check_gtpu_tun#:
+    // GTP-U carries IP only, parsed with the IP payloads of other tunnels
+    br_bclr[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_TUN_IP_bf), done#]
+    immed[proto_test, NET_GTPU_PORT]
+    alu[--, udp_dst_port, -, proto_test]
+    bne[done#]
+
+    // flags:type:length, TEID, then sequence:N-PDU:next extension type
+    alu[pkt_offset, pkt_offset, +, UDP_HDR_SIZE]
+    pv_seek(pkt_vec, pkt_offset)
+    byte_align_be[--, *$index++]
+    byte_align_be[tmp, *$index++]
+    byte_align_be[--, *$index++]
+    byte_align_be[next_hdr, *$index++]
+
+    // version 1 and protocol type GTP, a G-PDU, other messages (echo, error
+    // indication) are left as outer UDP
+    alu[label, 0xf, AND, tmp, >>28]
+    alu[--, label, -, 3]
+    bne[done#]
+    br!=byte[tmp, 2, GTPU_MSG_GPDU, done#]
+
+    // the optional fields are present if any of the E, S and PN flags are
+    alu[--, 0x7, AND, tmp, >>24]
+    beq[gtpu_payload#], defer[1]
+        alu[pkt_offset, pkt_offset, +, GTPU_SIZE]
+    br_bclr[tmp, 26, gtpu_payload#], defer[1]
+        alu[pkt_offset, pkt_offset, +, GTPU_OPT_SIZE]
+
+gtpu_ext#:
+    // next extension header type in the last byte, 0 if none, the length
+    // in 4 byte units in the first
+    br=byte[next_hdr, 0, 0, gtpu_payload#]
+    pv_seek(pkt_vec, pkt_offset)
+    byte_align_be[--, *$index++]
+    byte_align_be[next_hdr, *$index++]
+    alu[hdr_len, --, B, next_hdr, >>24]
+    beq[done#], defer[2]
+        alu[hdr_len, --, B, hdr_len, <<2]
         alu[pkt_offset, pkt_offset, +, hdr_len]
-        alu[pkt_offset, pkt_offset, +, (UDP_HDR_SIZE + GENEVE_SIZE + ETHERNET_SIZE)]
+
+    // stop while the inner headers still fit PV_HEADER_STACK
+    alu[--, PV_HDR_PARSE_MAX_OFFSET, -, pkt_offset]
+    blo[done#]
+    alu[--, hdr_len, -, 4]
+    beq[gtpu_ext#]
+    alu[tmp, pkt_offset, -, 4]
+    pv_seek(pkt_vec, tmp)
+    byte_align_be[--, *$index++]
+    br[gtpu_ext#], defer[1]
+        byte_align_be[next_hdr, *$index++]
+
+gtpu_payload#:
+    // the IP version of the payload selects IPv4 or IPv6, tmp as after
+    // check_eth_type#
+    alu[--, PV_HDR_PARSE_MAX_OFFSET, -, pkt_offset]
+    blo[done#]
+    pv_seek(pkt_vec, pkt_offset, PV_SEEK_PAD_INCLUDED)
+    byte_align_be[--, *$index++]
+    br[ip_version#], defer[2]
+        byte_align_be[tmp, *$index++]
+        alu[label, 0xf, AND, tmp, >>12]
 
 check_ipv4_gre#:
     br!=byte[next_hdr, 0, NET_IP_PROTO_GRE, unknown_l4#]
 
 gre#:
     br!=byte[BF_A(pkt_vec, PV_HEADER_STACK_bf), 3, 0, done#]
-    br_bclr[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_NVGRE_bf), unknown_l4#]
+    br_bset[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_NVGRE_bf), parse_gre#]
+    br_bclr[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_TUN_IP_bf), unknown_l4#]
+
+parse_gre#:
     pv_seek(pkt_vec, pkt_offset, PV_SEEK_T_INDEX_ONLY)
     alu[BF_A(pkt_vec, PV_PROTO_bf), BF_A(pkt_vec, PV_PROTO_bf), OR, (PROTO_GRE >> PROTO_ENCAP_SHF)]
     // determine GRE header length - refer to RFC1701
     alu[tmp, (1 << 3), AND, *$index, >>(28 - 1)] // R implies C
     alu[tmp, tmp, OR, *$index, >>28]
+    alu[eth_type, 0, +16, *$index] // Protocol Type
     pop_count1[tmp]
     pop_count2[tmp]
     pop_count3[tmp, tmp]
     alu[tmp, --, B, tmp, <<2]
-    br[seek_inner#], defer[2]
+    br[tun_payload#], defer[2]
         alu[pkt_offset, pkt_offset, +, tmp]
-        alu[pkt_offset, pkt_offset, +, (NVGRE_SIZE + ETHERNET_SIZE)]
+        alu[pkt_offset, pkt_offset, +, NVGRE_SIZE]
+
+tun_payload#:
+    // NVGRE and GENEVE carry Ethernet, GRE and GENEVE may also carry IP
+    immed[proto_test, NET_ETH_TYPE_TEB]
+    alu[--, eth_type, -, proto_test]
+    bne[tun_ip#]
+    br[seek_inner#], defer[1]
+        alu[pkt_offset, pkt_offset, +, ETHERNET_SIZE]
+
+tun_ip#:
+    br_bclr[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_TUN_IP_bf), tun_unknown#]
+    immed[proto_test, NET_ETH_TYPE_IPV4]
+    alu[--, eth_type, -, proto_test]
+    beq[seek_inner_ip#]
+    immed[proto_test, NET_ETH_TYPE_IPV6]
+    alu[--, eth_type, -, proto_test]
+    bne[tun_unknown#]
+
+seek_inner_ip#:
+    alu[--, PV_HDR_PARSE_MAX_OFFSET, -, pkt_offset]
+    blo[tun_unknown#]
+    alu[tmp, 0xff, AND, BF_A(pkt_vec, PV_PROTO_bf)]
+    ld_field[BF_A(pkt_vec, PV_PROTO_bf), 0001, tmp, <<PROTO_ENCAP_SHF]
+    alu[BF_A(pkt_vec, PV_HEADER_STACK_bf), --, B, BF_A(pkt_vec, PV_HEADER_STACK_bf), <<16]
+    // eth_type is the tunnel protocol type, tmp as after check_eth_type#
+    pv_seek(pkt_vec, pkt_offset, PV_SEEK_PAD_INCLUDED)
+    byte_align_be[--, *$index++]
+    br[check_ipv6#], defer[1]
+        byte_align_be[tmp, *$index++]
+
+tun_unknown#:
+    // other payloads, GENEVE is left as UDP and GRE as unknown L4
+    alu[tmp, PROTO_L4_UNKNOWN, AND, BF_A(pkt_vec, PV_PROTO_bf), <<2]
+    br[done#], defer[1]
+        alu[BF_A(pkt_vec, PV_PROTO_bf), BF_A(pkt_vec, PV_PROTO_bf), AND~, tmp]
 
 unknown_l4#:
     br[done_hdr_stack#], defer[2]
@@ -2256,24 +2511,64 @@ check_mpls#:
     immed[proto_test, NET_ETH_TYPE_MPLS]
     alu[--, eth_type, -, proto_test]
     bne[unknown_proto#]
+    // PV_PROTO has no class for MPLS after a tunnel
+    br!=byte[BF_A(pkt_vec, PV_HEADER_STACK_bf), 3, 0, unknown_proto#]
     alu[BF_A(pkt_vec, PV_PROTO_bf), BF_A(pkt_vec, PV_PROTO_bf), OR, PROTO_MPLS] // MPLS
 
+mpls_labels#:
+    /* hdr_len is the end of the labels parsed */
+    alu[hdr_len, pkt_offset, +, (MPLS_LABEL_SIZE * PV_MPLS_MAX_LABELS)]
+
 mpls_loop#:
     /* get low 16 bits of MPLS label into hi 16 bits of tmp */
     alu[label, --, B, tmp, <<16]
     byte_align_be[tmp, *$index++]
 
     /* check Bottom of Stack bit */
-    br_bclr[tmp, 24, mpls_loop#], defer[1]
+    br_bset[tmp, 24, mpls_bos#], defer[1]
         alu[pkt_offset, pkt_offset, +, MPLS_LABEL_SIZE]
+    alu[--, pkt_offset, -, hdr_len]
+    blo[mpls_loop#]
+    br[done#]
+
+mpls_bos#:
+    /* the IP header must start within reach of the PV_HEADER_STACK offsets */
+    alu[--, PV_HDR_PARSE_MAX_OFFSET, -, pkt_offset]
+    blo[done#]
 
     /* check for IPv4 or IPv6 explicit null labels */
     alu[label, label, OR, tmp, >>16]
     alu[label, --, B, label, >>12]
-    beq[parse_ipv4#]
+    beq[mpls_ipv4#]
     alu[--, label, -, 2]
-    beq[parse_ipv6#]
-    br[done#]
+    beq[mpls_ipv6#]
+
+    /* if configured, other labels by the IP version of the payload */
+    br_bclr[__pv_hdr_parse_args, BF_L(INSTR_RX_PARSE_MPLS_IP_bf), done#], defer[1]
+        alu[label, 0xf, AND, tmp, >>12]
+
+ip_version#:
+    alu[--, label, -, 4]
+    beq[mpls_ipv4#]
+    alu[--, label, -, 6]
+    bne[done#]
+
+mpls_ipv6#:
+    br=byte[BF_A(pkt_vec, PV_HEADER_STACK_bf), 0, 0, parse_ipv6#], defer[1]
+        immed[eth_type, NET_ETH_TYPE_IPV6]
+    br[mpls_udp_inner#]
+
+mpls_ipv4#:
+    br=byte[BF_A(pkt_vec, PV_HEADER_STACK_bf), 0, 0, parse_ipv4#], defer[1]
+        immed[eth_type, NET_ETH_TYPE_IPV4]
+
+mpls_udp_inner#:
+    /* MPLS or GTP-U over UDP (outer L4 offset set), the IP header is the
+     * inner one */
+    alu[label, 0xff, AND, BF_A(pkt_vec, PV_PROTO_bf)]
+    ld_field[BF_A(pkt_vec, PV_PROTO_bf), 0001, label, <<PROTO_ENCAP_SHF]
+    br[check_ipv6#], defer[1]
+        alu[BF_A(pkt_vec, PV_HEADER_STACK_bf), --, B, BF_A(pkt_vec, PV_HEADER_STACK_bf), <<16]
 
 parse_ipv6_udp#:
     br=byte[BF_A(pkt_vec, PV_HEADER_STACK_bf), 3, 0, check_tunnel#], defer[2]
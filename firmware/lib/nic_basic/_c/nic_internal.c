@@ -603,6 +603,7 @@ nic_local_bpf_reconfig(__gpr uint32_t *ctx_mode, uint32_t vid, uint32_t vnic)
 
 #define EPOCH_NN_IDX 127
 __shared __lmem uint32_t epoch = 0;
+__shared __lmem uint32_t epoch_done = 0;
 
 __intrinsic void
 nic_local_epoch() {
@@ -634,6 +635,27 @@ nic_local_epoch() {
 
         ct_write_nn(isl, me, EPOCH_NN_IDX, epoch);
     }
+
+    epoch_done = epoch;
+}
+
+__intrinsic int
+nic_local_epoch_wait(uint32_t timeout)
+{
+    __gpr uint32_t start = epoch;
+    __gpr uint32_t waited = 0;
+
+    /* An epoch already in progress may have signalled some MEs before the
+     * caller's update, so wait for one that started after it */
+    while ((int32_t)(epoch_done - start) <= 0) {
+        if (waited >= timeout)
+            return -1;
+
+        sleep(250);
+        waited += 250;
+    }
+
+    return 0;
 }
 
 #endif /* _LIBNIC_NIC_INTERNAL_C_ */
@@ -70,6 +70,26 @@ __intrinsic void nic_local_reconfig(uint32_t *enable_changed);
  */
 __intrinsic void nic_local_reconfig_done();
 
+/**
+ * Signal an epoch to all datapath worker contexts
+ *
+ * Returns once every context has consumed the signal, i.e. has been back
+ * to waiting for a packet since the call started.  This function must be
+ * called periodically by a single context.
+ */
+__intrinsic void nic_local_epoch();
+
+/**
+ * Wait for an epoch started after this call to complete
+ *
+ * @param timeout       Cycles to wait before giving up
+ *
+ * Worker state updated before the call, such as an NN register, has been
+ * seen by every context on return.  Returns 0 on success and -1 if no
+ * epoch completed in time.
+ */
+__intrinsic int nic_local_epoch_wait(uint32_t timeout);
+
 
 /*
  * Statistics and counter functions.
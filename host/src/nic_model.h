@@ -0,0 +1,452 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model.h
+ * @brief  Host executable model of the CoreNIC datapath action interpreter.
+ *
+ * The model decodes the NIC_CFG_INSTR_TBL action lists exactly as written
+ * by the app master (app_config_tables.c) and executes them against
+ * packets on a host CPU, mirroring the control flow of actions_execute in
+ * firmware/apps/nic/actions.uc. It does not produce cycle accurate
+ * results; instead it accounts for the events that dominate worker cost:
+ * action dispatches (taken branches), packet window fetches by pv_seek,
+ * table lookups and packet writes per memory unit, and drops.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef NIC_MODEL_H
+#define NIC_MODEL_H 1
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "app_config_instr.h"
+
+/*
+ * Bitfield access helpers for the (word, msb, lsb) triples used by the
+ * firmware headers, e.g. nm_bf_get(instr, INSTR_RSS_TABLE_IDX_bf).
+ */
+#define NM_BF_MASK(m, l)        ((uint32_t) ((2ull << ((m) - (l))) - 1))
+#define _NM_BF_GET(a, w, m, l)  (((a)[w] >> (l)) & NM_BF_MASK(m, l))
+#define NM_BF_GET(a, bf)        _NM_BF_GET(a, bf)
+
+/* Instruction word layout, see INSTR_OPCODE_LSB in app_config_instr.h. */
+#define NM_INSTR_OP(w)          ((w) >> INSTR_OPCODE_LSB)
+#define NM_INSTR_PIPELINE(w)    (((w) >> INSTR_PIPELINE_BIT) & 1)
+#define NM_INSTR_ARGS(w)        ((w) & 0xffff)
+
+/* Number of opcodes the model knows about (one past the last opcode). */
+#define NM_NUM_OPS              (INSTR_ACL + 1)
+
+/* Packet vector protocol encoding, mirrors PROTO_* in pv.uc. */
+#define NM_PROTO_UDP            (0x1 << 0)
+#define NM_PROTO_IPV4           (0x1 << 1)
+#define NM_PROTO_L4_UNKNOWN     (0x1 << 2)
+#define NM_PROTO_FRAG           (0x5 << 0)
+#define NM_PROTO_IPV6_UNKNOWN   0x04
+#define NM_PROTO_IPV6_FRAGMENT  0x05
+#define NM_PROTO_MPLS           (0x1 << 6)
+#define NM_PROTO_GRE            (0x4 << 5)
+#define NM_PROTO_GENEVE         (0x5 << 5)
+#define NM_PROTO_ENCAP_SHF      5
+#define NM_PROTO_UNKNOWN        0xff
+
+/* Header stack byte positions, mirrors PV_HEADER_OFFSET_*_bf in pv.uc. */
+#define NM_HDR_OUTER_IP(s)      (((s) >> 24) & 0xff)
+#define NM_HDR_OUTER_L4(s)      (((s) >> 16) & 0xff)
+#define NM_HDR_INNER_IP(s)      (((s) >> 8) & 0xff)
+#define NM_HDR_INNER_L4(s)      ((s) & 0xff)
+
+/* Checksum offload request bits, mirrors PV_CSUM_OFFLOAD_bf in pv.uc. */
+#define NM_CSUM_OL4             (1 << 0)
+#define NM_CSUM_OL3             (1 << 1)
+#define NM_CSUM_IL4             (1 << 2)
+#define NM_CSUM_IL3             (1 << 3)
+
+/* PV_TX_HOST_* flags of PV_TX_FLAGS_bf, as the bits of PV_FLAGS_wrd. The
+ * SCTP flags are the TCP ones. */
+#define NM_TX_HOST_RX_RSS       (1u << 31)
+#define NM_TX_HOST_I_IP4        (1 << 30)
+#define NM_TX_HOST_I_IP4_OK     (1 << 29)
+#define NM_TX_HOST_I_TCP        (1 << 28)
+#define NM_TX_HOST_I_TCP_OK     (1 << 27)
+#define NM_TX_HOST_I_UDP        (1 << 26)
+#define NM_TX_HOST_I_UDP_OK     (1 << 25)
+#define NM_TX_HOST_RX_BPF       (1 << 24)
+#define NM_TX_HOST_IP4          (1 << 22)
+#define NM_TX_HOST_IP4_OK       (1 << 21)
+#define NM_TX_HOST_TCP          (1 << 20)
+#define NM_TX_HOST_TCP_OK       (1 << 19)
+#define NM_TX_HOST_UDP          (1 << 18)
+#define NM_TX_HOST_UDP_OK       (1 << 17)
+#define NM_TX_HOST_L3           (NM_TX_HOST_IP4 | NM_TX_HOST_IP4_OK)
+#define NM_TX_HOST_L4           (NM_TX_HOST_TCP | NM_TX_HOST_TCP_OK | \
+                                 NM_TX_HOST_UDP | NM_TX_HOST_UDP_OK)
+
+#define NM_NULL_VLAN            0xfff
+
+/* RSS indirection table size in byte entries, mirrors nfp_net_ctrl.h. */
+#ifndef NFP_NET_CFG_RSS_ITBL_SZ
+#define NFP_NET_CFG_RSS_ITBL_SZ 0x80
+#endif
+
+/* Largest RSS indirection table, see NIC_RSS_TBL_ENTRIES. */
+#define NM_RSS_TBL_MAX          512
+
+/* RSS key size in bytes, mirrors nfp_net_ctrl.h. */
+#ifndef NFP_NET_CFG_RSS_KEY_SZ
+#define NFP_NET_CFG_RSS_KEY_SZ  0x28
+#endif
+#define NM_RSS_KEY_LW           (NFP_NET_CFG_RSS_KEY_SZ / 4)
+
+/* Bytes of the packet held in CTM before the MU split (approximations of
+ * the 2K NBI CTM buffer less PKT_NBI_OFFSET and the 256B NFD CTM buffer
+ * less NFD_IN_DATA_OFFSET). */
+#define NM_CTM_SIZE_NBI         (2048 - 128)
+#define NM_CTM_SIZE_NFD         (256 - 64)
+
+/* Size of the packet window cached by pv_seek and its alignment. */
+#define NM_SEEK_WINDOW          128
+#define NM_SEEK_ALIGN           64
+
+/* pv_seek flags, mirrors PV_SEEK_* in pv.uc. */
+#define NM_SEEK_DEFAULT         0
+#define NM_SEEK_T_INDEX_ONLY    (1 << 1)
+#define NM_SEEK_PAD_INCLUDED    (1 << 2)
+#define NM_SEEK_INIT            (1 << 3)
+
+/* Number of host queues reachable through a _vf_vlan_cache entry. */
+#define NM_VLAN_MAX_QUEUES      58
+#define NM_NUM_VLANS            (1 << 12)
+
+/* Largest packet the model accepts (jumbo frame plus VLAN pushes). */
+#define NM_MAX_PKT_SIZE         (10 * 1024)
+#define NM_PKT_HEADROOM         64
+
+/* Maximum number of alternate action lists (VEB / L2 switch entries). */
+#define NM_MAX_ALT_LISTS        256
+
+/* Maximum number of NIC_CFG_INSTR_TBL blocks holding chained segments. */
+#define NM_MAX_EXT_BLOCKS       64
+
+/**
+ * Memory units touched by the datapath, used to bucket memory references.
+ */
+enum nm_mem {
+    NM_MEM_CLS = 0,     /* Action lists, RSS tables */
+    NM_MEM_CTM,         /* Packet head, VLAN member cache */
+    NM_MEM_IMEM,        /* L2 switch MAC table, buffer size cache */
+    NM_MEM_EMEM,        /* Packet tail in MU buffer, VEB hashmap */
+    NM_MEM_PCIE,        /* NFD credits */
+    NM_NUM_MEMS
+};
+
+/**
+ * Reasons for a packet to be dropped, matching the firmware statistics.
+ */
+enum nm_drop {
+    NM_DROP_ACT = 0,    /* RX_DISCARD_ACT: INSTR_DROP */
+    NM_DROP_ADDR,       /* RX_DISCARD_ADDR: MAC match / VEB miss */
+    NM_DROP_MTU,        /* TX_ERROR_MTU */
+    NM_DROP_PKT_STACK,  /* ERROR_PKT_STACK: unbalanced PUSH/POP_PKT */
+    NM_DROP_NO_CTM,     /* TX_ERROR_NO_CTM: TX_WIRE without CTM buffer */
+    NM_DROP_INVALID,    /* Unknown opcode or list overrun */
+    NM_DROP_RUNT,       /* Packet too short to carry an Ethernet header */
+    NM_NUM_DROPS
+};
+
+/**
+ * Model of the packet vector (pv.uc) fields relevant to the actions.
+ */
+struct nm_pkt {
+    uint8_t buf[NM_PKT_HEADROOM + NM_MAX_PKT_SIZE];
+    uint32_t offset;        /* PV_OFFSET: start of the frame within buf */
+    uint32_t length;        /* PV_LENGTH */
+    uint32_t ctm_size;      /* Bytes held in CTM before the MU split */
+    uint32_t proto;         /* PV_PROTO */
+    uint32_t hdr_stack;     /* PV_HEADER_STACK */
+    uint32_t csum_offload;  /* PV_CSUM_OFFLOAD (host packets only) */
+    uint32_t tx_flags;      /* PV_TX_FLAGS */
+    uint32_t mac_dst_mc;    /* PV_MAC_DST_MC */
+    uint32_t mac_dst_bc;    /* PV_MAC_DST_BC */
+    uint32_t vlan_id;       /* PV_VLAN_ID */
+    uint32_t queue_offset;  /* PV_QUEUE_OFFSET */
+    uint32_t queue_selected; /* PV_QUEUE_SELECTED */
+    uint32_t seek_base;     /* PV_SEEK_BASE, UINT32_MAX when invalid */
+    uint32_t hdr_cached;    /* PV_HDR_CACHED, see nm_hdr_cache() */
+    uint32_t ctm_allocated; /* PV_CTM_ALLOCATED, cleared by PUSH_PKT */
+    uint32_t meta_len;      /* Bytes of prepended metadata (hash, csum) */
+    uint32_t hash;          /* RSS hash, valid if meta_len is non-zero */
+    uint32_t from_host;     /* Ingress is NFD rather than NBI */
+};
+
+/* Start of the Ethernet frame of a model packet vector. */
+#define NM_PKT_DATA(pkt)        (&(pkt)->buf[(pkt)->offset])
+
+/**
+ * An action list, as stored in one NIC_CFG_INSTR_TBL entry or returned by
+ * a VEB / L2 switch lookup. Alternate lists are keyed on MAC and VLAN,
+ * blocks holding INSTR_CHAIN segments on their CLS address.
+ */
+struct nm_action_list {
+    uint32_t instr[NIC_MAX_INSTR];
+    uint32_t num_words;
+    uint64_t mac;           /* Lookup key MAC (alternate lists only) */
+    uint32_t vlan_id;       /* Lookup key VLAN (alternate lists only) */
+    uint32_t addr;          /* CLS address (chained blocks only) */
+};
+
+/**
+ * The set of action lists and table state the model executes against.
+ */
+struct nm_config {
+    struct nm_action_list ingress;
+    struct nm_action_list veb[NM_MAX_ALT_LISTS];
+    uint32_t num_veb;
+    struct nm_action_list l2[NM_MAX_ALT_LISTS];
+    uint32_t num_l2;
+    struct nm_action_list ext[NM_MAX_EXT_BLOCKS];
+    uint32_t num_ext;
+    uint8_t rss_tbl[NM_RSS_TBL_MAX]; /* NIC_RSS_TBL, rss_tbl_entries used */
+    uint32_t rss_tbl_entries;
+    uint32_t rss_key[NM_RSS_KEY_LW]; /* NIC_RSS_KEY_TBL, Toeplitz key */
+    uint16_t vxlan_ports[8]; /* NN VXLAN port table, see init_nn_tables() */
+    uint32_t num_vxlan_ports;
+    uint64_t vlan_members[NM_NUM_VLANS]; /* _vf_vlan_cache queue bitmaps */
+    uint32_t ingress_csum;  /* PV_CSUM_OFFLOAD requested for host packets */
+    uint32_t op_map[NM_NUM_OPS]; /* cfg_act_map, opcode field per action */
+    uint32_t num_op_map;    /* Zero if words hold instruction_ops values */
+};
+
+/**
+ * Accumulated results over a replay.
+ */
+struct nm_stats {
+    uint64_t pkts;
+    uint64_t bytes;
+    uint64_t invocations[NM_NUM_OPS];
+    uint64_t dispatches;    /* Jump table dispatches (one taken branch) */
+    uint64_t pipelined;     /* Fall-through transitions (no branch) */
+    uint64_t pipeline_mismatch; /* Fall-throughs into a different action */
+    uint64_t list_loads;    /* Action list (re)loads, initial and switched */
+    uint64_t chain_fetches; /* Segments prefetched by INSTR_CHAIN */
+    uint64_t seeks;         /* pv_seek calls */
+    uint64_t seek_fetches;  /* pv_seek calls that had to read the packet */
+    uint64_t read_aheads;   /* 64B chunks read by pv_read_ahead */
+    uint64_t mem_reads[NM_NUM_MEMS];
+    uint64_t mem_writes[NM_NUM_MEMS];
+    uint64_t drops[NM_NUM_DROPS];
+    uint64_t tx_host;
+    uint64_t tx_wire;
+    uint64_t tx_cmsg;
+    uint64_t tx_ebpf;
+};
+
+/**
+ * nm_pkt_init
+ * Initialise a model packet vector from a raw Ethernet frame.
+ *
+ * @param pkt        Packet vector to initialise
+ * @param frame      Frame contents, starting at the destination MAC
+ * @param length     Frame length in bytes
+ * @param from_host  Non-zero if the packet arrives from a host queue
+ * @return 0 on success, -1 if the frame does not fit the model buffer
+ */
+int nm_pkt_init(struct nm_pkt *pkt, const uint8_t *frame, uint32_t length,
+                int from_host);
+
+/**
+ * nm_seek
+ * Account for a pv_seek to a byte offset of the frame, fetching a new
+ * window if the offset falls outside the cached one.
+ *
+ * @param pkt        Packet vector
+ * @param offset     Frame offset, including the two bytes of alignment pad
+ *                   if NM_SEEK_PAD_INCLUDED is given
+ * @param flags      NM_SEEK_* flags
+ * @param stats      Statistics to account the fetch against, may be NULL
+ */
+void nm_seek(struct nm_pkt *pkt, uint32_t offset, uint32_t flags,
+             struct nm_stats *stats);
+
+/**
+ * nm_read_ahead
+ * Account for a pv_read_ahead of the 64B chunk at a pad-included, 64B
+ * aligned offset of the frame into half of the packet window.
+ *
+ * @return 0 if the chunk was read, -1 if it straddles CTM and MU
+ */
+int nm_read_ahead(struct nm_pkt *pkt, uint32_t offset, struct nm_stats *stats);
+
+/**
+ * nm_invalidate_cache
+ * Mirror pv_invalidate_cache, forcing the next seek to fetch.
+ */
+void nm_invalidate_cache(struct nm_pkt *pkt);
+
+/**
+ * nm_hdr_parse
+ * Reference implementation of pv_hdr_parse_subroutine: fill in PV_PROTO
+ * and PV_HEADER_STACK for the packet.
+ *
+ * @param pkt        Packet vector to update
+ * @param rx_args    RX_WIRE / RX_HOST instruction argument bits
+ * @param cfg        VXLAN port table (NN registers on the workers)
+ * @param stats      Statistics to account packet reads against
+ */
+void nm_hdr_parse(struct nm_pkt *pkt, uint32_t rx_args,
+                  const struct nm_config *cfg, struct nm_stats *stats);
+
+/**
+ * nm_ipv4_csum_ok
+ * Whether the IPv4 header at an offset of the frame has a valid checksum.
+ */
+int nm_ipv4_csum_ok(const struct nm_pkt *pkt, uint32_t ip_offset);
+
+/**
+ * nm_l4_csum_ok
+ * Whether a TCP or UDP checksum is valid, summing the pseudo header of the
+ * IP header and the L4 header and payload. Bytes past the end of the frame
+ * are summed as zeros.
+ *
+ * @param pkt        Packet vector
+ * @param ip_offset  Frame offset of the IPv4 or IPv6 header
+ * @param l4_offset  Frame offset of the TCP or UDP header
+ * @param l4_len     Length of the L4 header and payload
+ * @param ip_proto   6 for TCP, 17 for UDP
+ * @param ipv4       Non-zero if the IP header is IPv4
+ */
+int nm_l4_csum_ok(const struct nm_pkt *pkt, uint32_t ip_offset,
+                  uint32_t l4_offset, uint32_t l4_len, uint32_t ip_proto,
+                  int ipv4);
+
+/**
+ * nm_mac_csum
+ * Set the outer PV_TX_HOST_L3 and PV_TX_HOST_L4 flags as pv_init_nbi
+ * propagates them from the checksum status of the MAC parse (Catamaran
+ * MAC_PARSE_L3 and MAC_PARSE_STS): IPv4 after up to two VLAN tags, then
+ * TCP or UDP of an unfragmented IPv4 packet or directly after the IPv6
+ * header.
+ */
+void nm_mac_csum(struct nm_pkt *pkt);
+
+/**
+ * nm_execute
+ * Run one packet through the ingress action list, mirroring
+ * actions_load followed by actions_execute.
+ *
+ * @return 0 if the packet was transmitted, or 1 if it was dropped
+ */
+int nm_execute(struct nm_pkt *pkt, const struct nm_config *cfg,
+               struct nm_stats *stats);
+
+/**
+ * nm_toeplitz
+ * Toeplitz hash of the Microsoft RSS specification, as INSTR_RSS computes
+ * it: the input words are hashed MSB first, each set bit XORing in the 32
+ * bits of the key that start at its position.
+ *
+ * @param key        NM_RSS_KEY_LW words of key, in network byte order
+ * @param data       Input words, at most NM_RSS_KEY_LW - 1
+ * @param num_words  Number of input words
+ */
+uint32_t nm_toeplitz(const uint32_t *key, const uint32_t *data,
+                     uint32_t num_words);
+
+/**
+ * nm_rss_tbl_extend
+ * Build an RSS indirection table of ENTRIES entries from the
+ * NFP_NET_CFG_RSS_ITBL_SZ entries written by the driver, as
+ * upd_rss_table() does.
+ */
+void nm_rss_tbl_extend(uint8_t *tbl, uint32_t entries, const uint8_t *itbl);
+
+/**
+ * nm_rss_tbl_spread
+ * Return the share of the busiest of QUEUES queues over an indirection
+ * table relative to an even spread, 1.0 if every queue has as many
+ * entries.
+ */
+double nm_rss_tbl_spread(const uint8_t *tbl, uint32_t entries,
+                         uint32_t queues);
+
+/**
+ * nm_config_load
+ * Read action lists from a text file. See host/README.md for the format.
+ *
+ * @return 0 on success, -1 on error (with a message on stderr)
+ */
+int nm_config_load(struct nm_config *cfg, const char *filename);
+
+/**
+ * nm_op_name
+ * Return a printable name for an opcode.
+ */
+const char *nm_op_name(uint32_t op);
+
+/**
+ * nm_stats_print
+ * Print a report of the replay as "name value" lines, one per counter,
+ * suitable both for reading and for comparing against a stored baseline.
+ */
+void nm_stats_print(FILE *f, const struct nm_stats *stats);
+
+/**
+ * nm_stats_compare
+ * Compare per-packet costs against a baseline report written by
+ * nm_stats_print and print the counters that regressed.
+ *
+ * @param tolerance  Permitted relative increase, e.g. 0.02 for 2%
+ * @return number of regressed counters, or -1 if the baseline is unreadable
+ */
+int nm_stats_compare(FILE *f, const struct nm_stats *stats,
+                     const char *baseline, double tolerance);
+
+/**
+ * State and configuration of one _nic_meter_tbl entry, in the units of
+ * firmware/apps/nic/app_config_meter.h.
+ */
+struct nm_meter {
+    uint32_t dp;            /* Peak bucket deficit */
+    uint32_t dc;            /* Committed bucket deficit */
+    uint32_t ts;            /* TIMESTAMP_LOW of the last refill */
+    uint32_t pbs;
+    uint32_t cbs;
+    uint32_t pir;
+    uint32_t cir;
+};
+
+/**
+ * nm_meter_credit
+ * Mirror __actions_meter_credit: the bucket drain for @elapsed ticks at
+ * @rate, saturated to 32 bits.
+ */
+uint32_t nm_meter_credit(uint32_t elapsed, uint32_t rate);
+
+/**
+ * nm_meter_pkt
+ * Mirror __actions_meter for one packet of @length bytes at TIMESTAMP_LOW
+ * @now, with the atomic operations applied in order.
+ *
+ * @param mark       M bit of the instruction
+ * @return NIC_METER_GREEN, NIC_METER_YELLOW for a remarked packet or
+ *         NIC_METER_RED for a dropped one
+ */
+int nm_meter_pkt(struct nm_meter *meter, uint32_t now, uint32_t length,
+                 int mark);
+
+/**
+ * nm_pcap_open / nm_pcap_next / nm_pcap_close
+ * Minimal reader for classic libpcap capture files with Ethernet link type.
+ */
+struct nm_pcap;
+
+struct nm_pcap *nm_pcap_open(const char *filename);
+
+int nm_pcap_next(struct nm_pcap *pcap, uint8_t *frame, uint32_t size,
+                 uint32_t *length);
+
+void nm_pcap_close(struct nm_pcap *pcap);
+
+#endif /* NIC_MODEL_H */
@@ -0,0 +1,1533 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_actions.c
+ * @brief  Model of actions_execute and the individual datapath actions.
+ *
+ * Each action mirrors the corresponding macro in firmware/apps/nic/actions.uc
+ * (and pkt_io.uc / pv.uc for the RX and TX actions): it consumes the same
+ * number of instruction words, makes the same control flow decisions and
+ * accounts for the memory references the worker would issue. Checksum and
+ * metadata values are not computed; only their cost is. Checksums are
+ * verified only where the result lands in the PV_TX_HOST flags.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nic_model.h"
+
+#include <string.h>
+
+#define NM_MAC(hi16, lo32)      (((uint64_t) (hi16) << 32) | (lo32))
+
+/* Bit of PV_CSUM_OFFLOAD and INSTR_CHECKSUM args requesting metadata */
+#define NM_CSUM_META            (1 << 8)
+
+/* Bit of INSTR_CHECKSUM args validating the inner checksums of tunnels */
+#define NM_CSUM_VAL             (1 << 4)
+
+/* Bit of INSTR_CHECKSUM args updating only the CRC32c of SCTP */
+#define NM_CSUM_SCTP            (1 << 5)
+
+/* pv_init_nfd parse args for NFD_IN_FLAGS_TX_ENCAP: INSTR_RX_PARSE_TUN_IP,
+ * INSTR_RX_PARSE_GENEVE, INSTR_RX_PARSE_NVGRE and INSTR_RX_HOST_ENCAP */
+#define NM_TX_ENCAP_ARGS        ((1 << 13) | (1 << 2) | (1 << 1) | (1 << 0))
+
+#define NM_GTPU_PORT            2152
+
+#define NM_IP_PROTO_SCTP        132
+#define NM_SCTP_HDR_SIZE        12
+#define NM_SCTP_CSUM_OFFS       8
+
+/**
+ * Result of executing one action.
+ */
+enum nm_act_rc {
+    NM_ACT_NEXT = 0,    /* __actions_next(): dispatch or fall through */
+    NM_ACT_DISPATCH,    /* Branch back to actions#, always dispatch */
+    NM_ACT_TX,          /* Packet handed to egress */
+    NM_ACT_DROP         /* Packet dropped, reason accounted */
+};
+
+/**
+ * State of one actions_execute invocation.
+ */
+struct nm_exec {
+    struct nm_pkt *pkt;
+    const struct nm_config *cfg;
+    struct nm_stats *stats;
+    uint32_t instr[NIC_MAX_INSTR]; /* $__actions */
+    uint32_t idx;           /* *$index, in words */
+    uint32_t fetch_addr;    /* Segment prefetched by INSTR_CHAIN */
+    uint32_t fetch_half;    /* $__actions word the segment is read to */
+    uint32_t fetch_pending; /* __actions_chain_pending */
+    struct nm_pkt *saved;   /* Packet vector saved by PUSH_PKT */
+};
+
+/*
+ * Handler that is reached by falling through the end of each handler in
+ * actions_execute, i.e. the code order of the action labels. The pipeline
+ * bit only saves a dispatch if this matches the next opcode in the list.
+ */
+static const uint32_t nm_fall_through[NM_NUM_OPS] = {
+    [INSTR_DROP] = NM_NUM_OPS,
+    [INSTR_RX_WIRE] = INSTR_DST_MAC_MATCH,
+    [INSTR_DST_MAC_MATCH] = INSTR_ACL,
+    [INSTR_ACL] = INSTR_CHECKSUM,
+    [INSTR_CHECKSUM] = INSTR_RSS,
+    [INSTR_RSS] = INSTR_SAMPLE,
+    [INSTR_SAMPLE] = INSTR_TX_HOST,
+    [INSTR_TX_HOST] = INSTR_RX_HOST,
+    [INSTR_RX_HOST] = INSTR_TX_WIRE,
+    [INSTR_TX_WIRE] = INSTR_POP_VLAN,
+    [INSTR_CMSG] = NM_NUM_OPS,
+    [INSTR_EBPF] = NM_NUM_OPS,
+    [INSTR_POP_VLAN] = INSTR_PUSH_VLAN,
+    [INSTR_PUSH_VLAN] = INSTR_SRC_MAC_MATCH,
+    [INSTR_SRC_MAC_MATCH] = INSTR_METER,
+    [INSTR_METER] = INSTR_VEB_LOOKUP,
+    [INSTR_VEB_LOOKUP] = INSTR_POP_PKT,
+    [INSTR_POP_PKT] = INSTR_PUSH_PKT,
+    [INSTR_PUSH_PKT] = INSTR_TX_VLAN,
+    [INSTR_TX_VLAN] = NM_NUM_OPS,
+    [INSTR_L2_SWITCH_WIRE] = INSTR_L2_SWITCH_HOST,
+    [INSTR_L2_SWITCH_HOST] = INSTR_CHAIN,
+    [INSTR_CHAIN] = NM_NUM_OPS,
+};
+
+static const char *nm_op_names[NM_NUM_OPS] = {
+    [INSTR_DROP] = "drop",
+    [INSTR_RX_WIRE] = "rx_wire",
+    [INSTR_DST_MAC_MATCH] = "dst_mac_match",
+    [INSTR_CHECKSUM] = "checksum",
+    [INSTR_RSS] = "rss",
+    [INSTR_TX_HOST] = "tx_host",
+    [INSTR_RX_HOST] = "rx_host",
+    [INSTR_TX_WIRE] = "tx_wire",
+    [INSTR_CMSG] = "cmsg",
+    [INSTR_EBPF] = "ebpf",
+    [INSTR_POP_VLAN] = "pop_vlan",
+    [INSTR_PUSH_VLAN] = "push_vlan",
+    [INSTR_SRC_MAC_MATCH] = "src_mac_match",
+    [INSTR_VEB_LOOKUP] = "veb_lookup",
+    [INSTR_POP_PKT] = "pop_pkt",
+    [INSTR_PUSH_PKT] = "push_pkt",
+    [INSTR_TX_VLAN] = "tx_vlan",
+    [INSTR_L2_SWITCH_WIRE] = "l2_switch_wire",
+    [INSTR_L2_SWITCH_HOST] = "l2_switch_host",
+    [INSTR_CHAIN] = "chain",
+    [INSTR_METER] = "meter",
+    [INSTR_SAMPLE] = "sample",
+    [INSTR_ACL] = "acl",
+};
+
+static const char *nm_mem_names[NM_NUM_MEMS] = {
+    [NM_MEM_CLS] = "cls",
+    [NM_MEM_CTM] = "ctm",
+    [NM_MEM_IMEM] = "imem",
+    [NM_MEM_EMEM] = "emem",
+    [NM_MEM_PCIE] = "pcie",
+};
+
+static const char *nm_drop_names[NM_NUM_DROPS] = {
+    [NM_DROP_ACT] = "act",
+    [NM_DROP_ADDR] = "addr",
+    [NM_DROP_MTU] = "mtu",
+    [NM_DROP_PKT_STACK] = "pkt_stack",
+    [NM_DROP_NO_CTM] = "no_ctm",
+    [NM_DROP_INVALID] = "invalid",
+    [NM_DROP_RUNT] = "runt",
+};
+
+
+const char *
+nm_op_name(uint32_t op)
+{
+    if (op >= NM_NUM_OPS)
+        return "unknown";
+
+    return nm_op_names[op];
+}
+
+
+/**
+ * nm_instr_op
+ * Decode the action of an instruction word. Lists dumped from firmware hold
+ * handler offsets (cfg_act_map) rather than enum instruction_ops values.
+ */
+static uint32_t
+nm_instr_op(const struct nm_config *cfg, uint32_t word)
+{
+    uint32_t op;
+
+    if (!cfg->num_op_map)
+        return NM_INSTR_OP(word);
+
+    for (op = 0; op < cfg->num_op_map; op++) {
+        if (cfg->op_map[op] == NM_INSTR_OP(word))
+            return op;
+    }
+
+    return NM_NUM_OPS;
+}
+
+
+static enum nm_act_rc
+nm_drop(struct nm_exec *ex, enum nm_drop reason)
+{
+    ex->stats->drops[reason]++;
+    return NM_ACT_DROP;
+}
+
+
+/**
+ * nm_pkt_mem
+ * Memory unit holding a packet byte, following pv_get_base_addr and the
+ * CTM / MU split point used by pv_seek_subroutine.
+ */
+static enum nm_mem
+nm_pkt_mem(const struct nm_pkt *pkt, uint32_t offset)
+{
+    if (pkt->ctm_allocated && offset < pkt->ctm_size)
+        return NM_MEM_CTM;
+
+    return NM_MEM_EMEM;
+}
+
+
+static uint64_t
+nm_pkt_mac(const struct nm_pkt *pkt, uint32_t offset)
+{
+    const uint8_t *p = NM_PKT_DATA(pkt) + offset;
+    uint64_t mac = 0;
+    int i;
+
+    for (i = 0; i < 6; i++)
+        mac = (mac << 8) | p[i];
+
+    return mac;
+}
+
+
+/**
+ * nm_list_switch
+ * Continue with an action list returned by a VEB or L2 switch lookup; the
+ * worker reads all 16 words of the new list into $__actions. A segment
+ * prefetch still in flight is waited for and overwritten.
+ */
+static void
+nm_list_switch(struct nm_exec *ex, const struct nm_action_list *list,
+               enum nm_mem mem)
+{
+    ex->stats->mem_reads[mem]++;
+    ex->stats->list_loads++;
+    memcpy(ex->instr, list->instr, sizeof(ex->instr));
+    ex->idx = 0;
+    ex->fetch_pending = 0;
+}
+
+
+/**
+ * nm_meta_push
+ * Account for one metadata item (pv_meta_push_type plus the LM value).
+ */
+static void
+nm_meta_push(struct nm_pkt *pkt)
+{
+    pkt->meta_len += pkt->meta_len ? 4 : 8;
+}
+
+
+/**
+ * nm_meta_write
+ * Account for pv_meta_write prepending the metadata to the packet.
+ */
+static void
+nm_meta_write(struct nm_exec *ex)
+{
+    if (ex->pkt->meta_len)
+        ex->stats->mem_writes[nm_pkt_mem(ex->pkt, 0)]++;
+}
+
+
+/**
+ * nm_hdr_stack_adjust
+ * Add delta to each non-zero header offset, as done by POP_VLAN / PUSH_VLAN.
+ */
+static uint32_t
+nm_hdr_stack_adjust(uint32_t stack, int delta)
+{
+    uint32_t out = 0;
+    uint32_t b;
+    int i;
+
+    for (i = 0; i < 32; i += 8) {
+        b = (stack >> i) & 0xff;
+        if (b)
+            b = (b + delta) & 0xff;
+        out |= b << i;
+    }
+
+    return out;
+}
+
+
+static enum nm_act_rc
+nm_act_rx_wire(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    uint32_t args = NM_INSTR_ARGS(ex->instr[ex->idx++]);
+    uint32_t eth_type;
+    uint32_t frag;
+    uint32_t l3_offset = 14;
+    uint32_t l4_offset;
+    uint32_t l4_proto;
+    uint32_t tunnel;
+    int i;
+
+    if (pkt->length < 14)
+        return nm_drop(ex, NM_DROP_RUNT);
+
+    nm_seek(pkt, 0, NM_SEEK_INIT, ex->stats);
+
+    if (NM_BF_GET(&args, INSTR_RX_WIRE_CSUM_bf))
+        nm_mac_csum(pkt);
+
+    /* Catamaran parses up to two VLAN tags and supplies the L3 / L4
+     * classification and offsets in the NBI descriptor. */
+    for (i = 0; i < 2; i++) {
+        eth_type = (NM_PKT_DATA(pkt)[l3_offset - 2] << 8 |
+                    NM_PKT_DATA(pkt)[l3_offset - 1]);
+        if ((eth_type != 0x8100 && eth_type != 0x88a8) ||
+            l3_offset + 4 > pkt->length)
+            break;
+        if (i == 0)
+            pkt->vlan_id = ((NM_PKT_DATA(pkt)[l3_offset] << 8 |
+                             NM_PKT_DATA(pkt)[l3_offset + 1]) & NM_NULL_VLAN);
+        l3_offset += 4;
+    }
+    eth_type = (NM_PKT_DATA(pkt)[l3_offset - 2] << 8 |
+                NM_PKT_DATA(pkt)[l3_offset - 1]);
+
+    if (eth_type != 0x0800 || l3_offset + 20 > pkt->length)
+        goto hdr_parse;
+
+    frag = (NM_PKT_DATA(pkt)[l3_offset + 6] << 8 |
+            NM_PKT_DATA(pkt)[l3_offset + 7]) & 0x3fff;
+    if (frag) {
+        pkt->proto = NM_PROTO_IPV4 | NM_PROTO_FRAG;
+        pkt->hdr_stack = (l3_offset << 8) | (l3_offset << 24);
+        return NM_ACT_NEXT;
+    }
+
+    /* deep parse if NVGRE is configured or not TCP / UDP */
+    if (NM_BF_GET(&args, INSTR_RX_PARSE_NVGRE_bf))
+        goto hdr_parse;
+
+    l4_proto = NM_PKT_DATA(pkt)[l3_offset + 9];
+    if (l4_proto != 6 && l4_proto != 17)
+        goto hdr_parse;
+
+    /* deep parse if MPLS over UDP is configured */
+    if (NM_BF_GET(&args, INSTR_RX_PARSE_MPLS_UDP_bf))
+        goto hdr_parse;
+
+    /* deep parse UDP if UDP tunnels are configured */
+    tunnel = (NM_BF_GET(&args, INSTR_RX_PARSE_VXLANS_bf) |
+              NM_BF_GET(&args, INSTR_RX_PARSE_GENEVE_bf));
+    if (tunnel && l4_proto == 17)
+        goto hdr_parse;
+
+    /* GTP-U is parsed with the IP payloads of other tunnels, deep parse
+     * UDP to its port only */
+    l4_offset = l3_offset + ((NM_PKT_DATA(pkt)[l3_offset] & 0xf) << 2);
+    if (NM_BF_GET(&args, INSTR_RX_PARSE_TUN_IP_bf) && l4_proto == 17 &&
+        (NM_PKT_DATA(pkt)[l4_offset + 2] << 8 |
+         NM_PKT_DATA(pkt)[l4_offset + 3]) == NM_GTPU_PORT)
+        goto hdr_parse;
+
+    pkt->proto = NM_PROTO_IPV4 | (l4_proto == 17 ? NM_PROTO_UDP : 0);
+    pkt->hdr_stack = ((l3_offset << 24) | (l4_offset << 16) |
+                      (l3_offset << 8) | l4_offset);
+    return NM_ACT_NEXT;
+
+hdr_parse:
+    args &= ~(1 << 0); /* INSTR_RX_HOST_ENCAP_bf */
+    nm_hdr_parse(pkt, args, ex->cfg, ex->stats);
+    return NM_ACT_NEXT;
+}
+
+
+static enum nm_act_rc
+nm_act_rx_host(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    uint32_t args = NM_INSTR_ARGS(ex->instr[ex->idx++]);
+    uint32_t encap;
+    uint32_t mtu = NM_BF_GET(&args, INSTR_RX_HOST_MTU_bf);
+
+    /* __pv_mtu_check allows for two VLAN tags */
+    if (pkt->length >= mtu + 4 * 2)
+        return nm_drop(ex, NM_DROP_MTU);
+
+    pkt->csum_offload = ex->cfg->ingress_csum & 0xf;
+    pkt->vlan_id = NM_NULL_VLAN;
+
+    /* packet is still in the MU buffer only */
+    nm_seek(pkt, 0, NM_SEEK_INIT, ex->stats);
+
+    if (pkt->csum_offload & ((NM_CSUM_IL4 | NM_CSUM_IL3) | (args & 0x3))) {
+        /* the host requests inner checksums only for encapsulated packets,
+         * which is what NFD_IN_FLAGS_TX_ENCAP conveys */
+        encap = 0;
+        if (pkt->csum_offload & (NM_CSUM_IL4 | NM_CSUM_IL3))
+            encap = NM_TX_ENCAP_ARGS;
+        nm_hdr_parse(pkt, encap, ex->cfg, ex->stats);
+    }
+
+    /* pkt_buf_copy_mu_head_to_ctm */
+    ex->stats->mem_reads[NM_MEM_EMEM]++;
+    ex->stats->mem_writes[NM_MEM_CTM]++;
+    pkt->ctm_allocated = 1;
+
+    return NM_ACT_NEXT;
+}
+
+
+static enum nm_act_rc
+nm_act_dst_mac_match(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    uint64_t mac = NM_MAC(NM_INSTR_ARGS(ex->instr[ex->idx]),
+                          ex->instr[ex->idx + 1]);
+
+    ex->idx += 2;
+
+    if (pkt->mac_dst_mc)
+        return NM_ACT_NEXT;
+
+    nm_seek(pkt, 0, NM_SEEK_DEFAULT, ex->stats);
+    if (nm_pkt_mac(pkt, 0) != mac)
+        return nm_drop(ex, NM_DROP_ADDR);
+
+    return NM_ACT_NEXT;
+}
+
+
+static enum nm_act_rc
+nm_act_src_mac_match(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    /* lo 2 bytes first, hi 4 bytes second */
+    uint64_t mac = (((uint64_t) ex->instr[ex->idx + 1] << 16) |
+                    NM_INSTR_ARGS(ex->instr[ex->idx]));
+
+    ex->idx += 2;
+
+    nm_seek(pkt, 8, NM_SEEK_DEFAULT, ex->stats);
+    if (nm_pkt_mac(pkt, 6) != mac)
+        return nm_drop(ex, NM_DROP_ADDR);
+
+    return NM_ACT_NEXT;
+}
+
+
+static uint32_t
+nm_crc32_be(uint32_t crc, uint32_t data)
+{
+    int i;
+
+    crc ^= data;
+    for (i = 0; i < 32; i++)
+        crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04c11db7 : 0);
+
+    return crc;
+}
+
+
+static uint32_t
+nm_pkt_be32(const struct nm_pkt *pkt, uint32_t offset)
+{
+    const uint8_t *p = NM_PKT_DATA(pkt) + offset;
+
+    if (offset + 4 > pkt->length)
+        return 0;
+
+    return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+
+uint32_t
+nm_toeplitz(const uint32_t *key, const uint32_t *data, uint32_t num_words)
+{
+    uint32_t hash = 0;
+    uint32_t i;
+    uint32_t bit;
+
+    for (i = 0; i < num_words; i++) {
+        for (bit = 0; bit < 32; bit++) {
+            if (!(data[i] & (0x80000000 >> bit)))
+                continue;
+            if (bit)
+                hash ^= (key[i] << bit) | (key[i + 1] >> (32 - bit));
+            else
+                hash ^= key[i];
+        }
+    }
+
+    return hash;
+}
+
+
+/**
+ * nm_rss_sort
+ * Put the lower of two words of a tuple first, comparing LEN words.
+ */
+static void
+nm_rss_sort(uint32_t *a, uint32_t *b, uint32_t len)
+{
+    uint32_t tmp;
+    uint32_t i;
+
+    for (i = 0; i < len && a[i] == b[i]; i++)
+        ;
+    if (i == len || a[i] < b[i])
+        return;
+
+    for (i = 0; i < len; i++) {
+        tmp = a[i];
+        a[i] = b[i];
+        b[i] = tmp;
+    }
+}
+
+
+/**
+ * nm_hdr_cache
+ * Account for __actions_hdr_cache: the first of RSS, ACL and VEB_LOOKUP
+ * to run copies the ports, MAC addresses and inner IP addresses, later
+ * actions read the copy until eBPF invalidates it.
+ */
+static void
+nm_hdr_cache(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    uint32_t l3_offset;
+    uint32_t l4_offset;
+
+    if (pkt->hdr_cached)
+        return;
+    pkt->hdr_cached = 1;
+
+    /* ports only for TCP and UDP, not for fragments or other protocols */
+    l4_offset = NM_HDR_INNER_L4(pkt->hdr_stack);
+    if (l4_offset && !(pkt->proto & NM_PROTO_L4_UNKNOWN))
+        nm_seek(pkt, l4_offset, NM_SEEK_DEFAULT, ex->stats);
+
+    nm_seek(pkt, 0, NM_SEEK_DEFAULT, ex->stats);
+
+    l3_offset = NM_HDR_INNER_IP(pkt->hdr_stack);
+    if (l3_offset) {
+        l3_offset += (pkt->proto & NM_PROTO_IPV4) ? 12 : 8;
+        nm_seek(pkt, l3_offset, NM_SEEK_DEFAULT, ex->stats);
+    }
+}
+
+
+static enum nm_act_rc
+nm_act_rss(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    const uint32_t *args = &ex->instr[ex->idx];
+    uint32_t tuple[9];
+    uint32_t hash;
+    uint32_t l3_offset;
+    uint32_t l4_offset;
+    uint32_t l4_data = 0;
+    uint32_t num_words;
+    uint32_t i;
+
+    ex->idx += 3;
+
+    if (pkt->queue_selected) {
+        if (NM_BF_GET(args, INSTR_RSS_MAX_QUEUE_bf) >= pkt->queue_offset)
+            return NM_ACT_NEXT;
+        pkt->queue_offset = 0;
+    }
+
+    l3_offset = NM_HDR_INNER_IP(pkt->hdr_stack);
+    if (!l3_offset)
+        return NM_ACT_NEXT;
+
+    /* L4 is hashed only if enabled for the (inner) protocol, this also
+     * excludes fragments as the shift moves all configuration bits out */
+    l4_offset = NM_HDR_INNER_L4(pkt->hdr_stack);
+    if (!((NM_BF_GET(args, INSTR_RSS_CFG_PROTO_bf) >> (pkt->proto & 0x1f)) &
+          1))
+        l4_offset = 0;
+
+    nm_hdr_cache(ex);
+    if (l4_offset)
+        l4_data = nm_pkt_be32(pkt, l4_offset);
+
+    /* source and destination addresses */
+    l3_offset += (pkt->proto & NM_PROTO_IPV4) ? 12 : 8;
+    num_words = (pkt->proto & NM_PROTO_IPV4) ? 2 : 8;
+
+    for (i = 0; i < num_words; i++)
+        tuple[i] = nm_pkt_be32(pkt, l3_offset + i * 4);
+    if (l4_offset)
+        tuple[num_words++] = l4_data;
+
+    /* Symmetric: lower address, then lower port first */
+    if (NM_BF_GET(args, INSTR_RSS_SYMMETRIC_bf)) {
+        i = (pkt->proto & NM_PROTO_IPV4) ? 1 : 4;
+        nm_rss_sort(tuple, tuple + i, i);
+        if (l4_offset && (l4_data & 0xffff) < (l4_data >> 16))
+            tuple[num_words - 1] = (l4_data << 16) | (l4_data >> 16);
+    }
+
+    if (NM_BF_GET(args, INSTR_RSS_TOEPLITZ_bf)) {
+        /* The key is read from NIC_RSS_KEY_TBL */
+        ex->stats->mem_reads[NM_MEM_CLS]++;
+        hash = nm_toeplitz(ex->cfg->rss_key, tuple, num_words);
+    } else {
+        hash = NM_BF_GET(args, INSTR_RSS_KEY_bf);
+        for (i = 0; i < num_words; i++)
+            hash = nm_crc32_be(hash, tuple[i]);
+    }
+
+    /* queue = rss_tbl[hash % NIC_RSS_TBL_ENTRIES], tables larger than the
+     * driver's are in CTM */
+    if (ex->cfg->rss_tbl_entries > NFP_NET_CFG_RSS_ITBL_SZ)
+        ex->stats->mem_reads[NM_MEM_CTM]++;
+    else
+        ex->stats->mem_reads[NM_MEM_CLS]++;
+
+    /* The _nic_rfs_tbl bucket is read alongside, into the cached packet
+     * data. The model has no steered flows, every lookup misses. */
+    if (NM_BF_GET(args, INSTR_RSS_RFS_bf)) {
+        ex->stats->mem_reads[NM_MEM_EMEM]++;
+        nm_invalidate_cache(pkt);
+    }
+    pkt->queue_offset =
+        ex->cfg->rss_tbl[hash & (ex->cfg->rss_tbl_entries - 1)];
+    pkt->hash = hash;
+    pkt->tx_flags |= NM_TX_HOST_RX_RSS;
+    nm_meta_push(pkt);
+
+    return NM_ACT_NEXT;
+}
+
+
+/**
+ * nm_csum_sum
+ * Account for summing num_words of the packet starting at the pad-included
+ * offset as in __actions_checksum: 64B aligned chunks read ahead while at
+ * least two remain, else one pv_seek per 128B window.
+ */
+static void
+nm_csum_sum(struct nm_exec *ex, uint32_t offset, uint32_t num_words)
+{
+    uint32_t avail;
+    int ahead;
+
+    while (num_words) {
+        if (num_words >= 32 && !(offset & (NM_SEEK_ALIGN - 1)) &&
+            !nm_read_ahead(ex->pkt, offset, ex->stats)) {
+            nm_invalidate_cache(ex->pkt);
+            do {
+                ahead = num_words >= 32 &&
+                        !nm_read_ahead(ex->pkt, offset + NM_SEEK_ALIGN,
+                                       ex->stats);
+                num_words -= NM_SEEK_ALIGN / 4;
+                offset += NM_SEEK_ALIGN;
+            } while (ahead);
+            continue;
+        }
+
+        nm_seek(ex->pkt, offset, NM_SEEK_PAD_INCLUDED, ex->stats);
+        avail = 32 - ((offset & (NM_SEEK_ALIGN - 1)) >> 2);
+        if (avail > num_words)
+            avail = num_words;
+        num_words -= avail;
+        offset += avail * 4;
+    }
+}
+
+
+static void
+nm_csum_write(struct nm_exec *ex, uint32_t offset)
+{
+    ex->stats->mem_writes[nm_pkt_mem(ex->pkt, offset)]++;
+}
+
+
+/**
+ * nm_crc32c_sctp
+ * CRC32c of the SCTP packet of LEN bytes at L4_OFFSET, its checksum field
+ * taken as zero.
+ */
+static uint32_t
+nm_crc32c_sctp(const struct nm_pkt *pkt, uint32_t l4_offset, uint32_t len)
+{
+    uint32_t crc = 0xffffffff;
+    uint32_t byte;
+    uint32_t i;
+    int j;
+
+    for (i = 0; i < len; i++) {
+        byte = NM_PKT_DATA(pkt)[l4_offset + i];
+        if (i >= NM_SCTP_CSUM_OFFS && i < NM_SCTP_CSUM_OFFS + 4)
+            byte = 0;
+        crc ^= byte;
+        for (j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78 : 0);
+    }
+
+    return ~crc;
+}
+
+
+/**
+ * nm_csum_sctp
+ * Account for the CRC32c of an SCTP packet as in __actions_checksum: the IP
+ * header to find SCTP, one pv_seek per 128B window of SCTP, and the CRC
+ * written in halves if requested by the host, else validated.
+ */
+static void
+nm_csum_sctp(struct nm_exec *ex, uint32_t state)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    uint32_t ip_offset = NM_HDR_INNER_IP(pkt->hdr_stack);
+    uint32_t l4_offset;
+    uint32_t l4_len;
+    uint32_t offset;
+    uint32_t avail;
+    uint32_t num_words;
+    uint32_t word;
+
+    if (!ip_offset)
+        return;
+
+    nm_seek(pkt, ip_offset, NM_SEEK_DEFAULT, ex->stats);
+    if (pkt->proto & NM_PROTO_IPV4) {
+        if (((nm_pkt_be32(pkt, ip_offset + 8) >> 16) & 0xff) !=
+            NM_IP_PROTO_SCTP)
+            return;
+
+        word = nm_pkt_be32(pkt, ip_offset);
+        l4_offset = ip_offset + ((word >> 22) & 0x3c);
+        l4_len = (word & 0xffff) - ((word >> 22) & 0x3c);
+    } else {
+        word = nm_pkt_be32(pkt, ip_offset + 4);
+        if (((word >> 8) & 0xff) != NM_IP_PROTO_SCTP)
+            return;
+
+        l4_offset = ip_offset + 40;
+        l4_len = word >> 16;
+    }
+
+    if ((l4_len & 3) || (int) l4_len < NM_SCTP_HDR_SIZE ||
+        l4_offset + l4_len > pkt->length || ((l4_offset + 2) & 3))
+        return;
+
+    /* the common header, then the chunks */
+    offset = l4_offset + 2;
+    nm_seek(pkt, offset, NM_SEEK_PAD_INCLUDED, ex->stats);
+    offset += NM_SCTP_HDR_SIZE;
+    num_words = (l4_len - NM_SCTP_HDR_SIZE) >> 2;
+    while (num_words) {
+        nm_seek(pkt, offset, NM_SEEK_PAD_INCLUDED, ex->stats);
+        avail = 32 - ((offset & (NM_SEEK_ALIGN - 1)) >> 2);
+        if (avail > num_words)
+            avail = num_words;
+        num_words -= avail;
+        offset += avail * 4;
+    }
+
+    if (state & (NM_CSUM_SCTP | NM_CSUM_OL4)) {
+        nm_csum_write(ex, l4_offset + NM_SCTP_CSUM_OFFS);
+        nm_csum_write(ex, l4_offset + NM_SCTP_CSUM_OFFS + 2);
+        nm_invalidate_cache(pkt);
+        return;
+    }
+
+    /* validated, reported like a TCP checksum. The CRC is stored least
+     * significant byte first. */
+    word = nm_pkt_be32(pkt, l4_offset + NM_SCTP_CSUM_OFFS);
+    word = ((word >> 24) | ((word >> 8) & 0xff00) | ((word << 8) & 0xff0000) |
+            (word << 24));
+    pkt->tx_flags |= NM_TX_HOST_TCP;
+    if (nm_crc32c_sctp(pkt, l4_offset, l4_len) == word)
+        pkt->tx_flags |= NM_TX_HOST_TCP_OK;
+}
+
+
+/**
+ * nm_csum_val_flags
+ * PV_TX_HOST flags of a validated checksum as __actions_csum_match sets
+ * them: the protocol flag, and the OK flag below it if the checksum is
+ * correct.
+ */
+static uint32_t
+nm_csum_val_flags(int ok, uint32_t flag)
+{
+    return flag | (ok ? flag >> 1 : 0);
+}
+
+
+static enum nm_act_rc
+nm_act_checksum(struct nm_exec *ex)
+{
+    static const uint32_t work_order[] = {
+        NM_CSUM_IL4, NM_CSUM_IL3, NM_CSUM_OL4, NM_CSUM_OL3
+    };
+    struct nm_pkt *pkt = ex->pkt;
+    uint32_t state = NM_INSTR_ARGS(ex->instr[ex->idx++]);
+    uint32_t inner;
+    uint32_t ip_offset;
+    uint32_t l4_offset;
+    uint32_t offsets;
+    uint32_t udp;
+    uint32_t work;
+    uint32_t i;
+
+    state &= pkt->csum_offload | NM_CSUM_META | NM_CSUM_VAL |
+             ((pkt->csum_offload & NM_CSUM_OL4) ? NM_CSUM_SCTP : 0);
+    if (!state)
+        return NM_ACT_NEXT;
+
+    /* SCTP is an unknown L4 of a packet that is not tunnelled */
+    if ((pkt->proto & (NM_PROTO_FRAG | (7 << NM_PROTO_ENCAP_SHF))) ==
+        NM_PROTO_L4_UNKNOWN &&
+        (state & (NM_CSUM_SCTP | NM_CSUM_VAL | NM_CSUM_OL4))) {
+        nm_csum_sctp(ex, state);
+        state &= ~(NM_CSUM_SCTP | NM_CSUM_VAL | NM_CSUM_OL4);
+    }
+    state &= ~NM_CSUM_SCTP;
+
+    if (pkt->proto == NM_PROTO_UNKNOWN ||
+        !((pkt->proto >> NM_PROTO_ENCAP_SHF) & 7))
+        state &= ~NM_CSUM_VAL;
+    if (!state)
+        return NM_ACT_NEXT;
+
+    if (pkt->length <= 14)
+        return NM_ACT_NEXT;
+
+    /* CHECKSUM_COMPLETE over everything past the Ethernet header */
+    nm_csum_sum(ex, 14 + 2, (pkt->length - 14) >> 2);
+
+    for (i = 0; i < sizeof(work_order) / sizeof(work_order[0]); i++) {
+        work = work_order[i];
+        if (!(state & work))
+            continue;
+
+        inner = work & (NM_CSUM_IL4 | NM_CSUM_IL3);
+        offsets = inner ? pkt->hdr_stack & 0xffff : pkt->hdr_stack >> 16;
+        ip_offset = offsets >> 8;
+        l4_offset = offsets & 0xff;
+
+        if (work & (NM_CSUM_IL4 | NM_CSUM_OL4)) {
+            if (!l4_offset)
+                continue;
+
+            /* outer L4 of an encapsulated packet is always UDP */
+            udp = (l4_offset != NM_HDR_INNER_L4(pkt->hdr_stack)) ?
+                  (pkt->proto >> NM_PROTO_ENCAP_SHF) & 1 : pkt->proto & 1;
+
+            /* subtract the checksum field and the headers from
+             * CHECKSUM_COMPLETE, then add the pseudo header */
+            nm_seek(pkt, l4_offset + (udp ? 6 : 16), NM_SEEK_DEFAULT,
+                    ex->stats);
+            nm_csum_sum(ex, 14 + 2, (l4_offset - 14) >> 2);
+            if (!(work & NM_CSUM_IL4) || !pkt->hdr_cached)
+                nm_seek(pkt, ip_offset, NM_SEEK_DEFAULT, ex->stats);
+            nm_csum_write(ex, l4_offset + (udp ? 6 : 16));
+        } else {
+            if (!ip_offset)
+                continue;
+
+            nm_seek(pkt, ip_offset, NM_SEEK_DEFAULT, ex->stats);
+            nm_csum_write(ex, ip_offset + 10);
+        }
+    }
+
+    /* validating the innermost checksums costs as much as updating them,
+     * less the writes. The model does not write the checksums it updates,
+     * those validate as the firmware's would. */
+    if (state & NM_CSUM_VAL) {
+        ip_offset = NM_HDR_INNER_IP(pkt->hdr_stack);
+        l4_offset = NM_HDR_INNER_L4(pkt->hdr_stack);
+        udp = pkt->proto & NM_PROTO_UDP;
+
+        if (!(pkt->proto & NM_PROTO_L4_UNKNOWN) && l4_offset) {
+            nm_seek(pkt, l4_offset + (udp ? 6 : 16), NM_SEEK_DEFAULT,
+                    ex->stats);
+            nm_csum_sum(ex, 14 + 2, (l4_offset - 14) >> 2);
+            if (!pkt->hdr_cached)
+                nm_seek(pkt, ip_offset, NM_SEEK_DEFAULT, ex->stats);
+
+            /* a zero UDP checksum was not calculated by the sender */
+            if (!udp || nm_pkt_be32(pkt, l4_offset + 4) & 0xffff)
+                pkt->tx_flags |= nm_csum_val_flags(
+                    (state & NM_CSUM_IL4) ||
+                    nm_l4_csum_ok(pkt, ip_offset, l4_offset,
+                                  pkt->length - l4_offset, udp ? 17 : 6,
+                                  pkt->proto & NM_PROTO_IPV4),
+                    udp ? NM_TX_HOST_I_UDP : NM_TX_HOST_I_TCP);
+        }
+
+        if ((pkt->proto & NM_PROTO_IPV4) && ip_offset) {
+            nm_seek(pkt, ip_offset, NM_SEEK_DEFAULT, ex->stats);
+            pkt->tx_flags |= nm_csum_val_flags(
+                (state & NM_CSUM_IL3) || nm_ipv4_csum_ok(pkt, ip_offset),
+                NM_TX_HOST_I_IP4);
+        }
+    }
+
+    nm_invalidate_cache(pkt);
+    if (state & NM_CSUM_META)
+        nm_meta_push(pkt);
+
+    return NM_ACT_NEXT;
+}
+
+
+/**
+ * nm_tx_continue
+ * TX actions continue processing if the C bit is set, or if the M bit is
+ * set and the packet is multicast.
+ */
+static int
+nm_tx_continue(const struct nm_pkt *pkt, uint32_t args)
+{
+    return (NM_BF_GET(&args, INSTR_TX_CONTINUE_bf) ||
+            (NM_BF_GET(&args, INSTR_TX_MULTICAST_bf) && pkt->mac_dst_mc));
+}
+
+
+static enum nm_act_rc
+nm_act_tx_host(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    uint32_t args = NM_INSTR_ARGS(ex->instr[ex->idx++]);
+    uint32_t min_rxb;
+
+    nm_meta_write(ex);
+
+    /* MRU check against the free list buffer size cache */
+    min_rxb = NM_BF_GET(&args, INSTR_TX_HOST_MIN_RXB_bf) << 8;
+    if (min_rxb < pkt->length + pkt->meta_len)
+        ex->stats->mem_reads[NM_MEM_IMEM]++;
+
+    /* NFD credit (test_subsat) */
+    ex->stats->mem_reads[NM_MEM_PCIE]++;
+    ex->stats->tx_host++;
+
+    return nm_tx_continue(pkt, args) ? NM_ACT_NEXT : NM_ACT_TX;
+}
+
+
+static enum nm_act_rc
+nm_act_tx_wire(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    uint32_t args = NM_INSTR_ARGS(ex->instr[ex->idx++]);
+
+    if (!pkt->ctm_allocated) {
+        if (nm_tx_continue(pkt, args)) {
+            ex->stats->drops[NM_DROP_NO_CTM]++;
+            return NM_ACT_NEXT;
+        }
+        return nm_drop(ex, NM_DROP_NO_CTM);
+    }
+
+    /* pv_write_nbi_meta: MAC prepend and packet modifier script */
+    ex->stats->mem_writes[NM_MEM_CTM]++;
+    ex->stats->tx_wire++;
+
+    return nm_tx_continue(pkt, args) ? NM_ACT_NEXT : NM_ACT_TX;
+}
+
+
+static enum nm_act_rc
+nm_act_pop_vlan(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    enum nm_mem mem = nm_pkt_mem(pkt, 0);
+
+    ex->idx++;
+
+    /* move the MAC addresses over the VLAN tag, read from the header
+     * copy if there is one */
+    memmove(NM_PKT_DATA(pkt) + 4, NM_PKT_DATA(pkt), 12);
+    if (!pkt->hdr_cached)
+        ex->stats->mem_reads[mem]++;
+    ex->stats->mem_writes[mem]++;
+    nm_invalidate_cache(pkt);
+
+    pkt->offset += 4;
+    pkt->length -= 4;
+    pkt->hdr_stack = nm_hdr_stack_adjust(pkt->hdr_stack, -4);
+    pkt->vlan_id = NM_NULL_VLAN;
+
+    return NM_ACT_NEXT;
+}
+
+
+static enum nm_act_rc
+nm_act_push_vlan(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    uint32_t tag = NM_INSTR_ARGS(ex->instr[ex->idx++]);
+    enum nm_mem mem = nm_pkt_mem(pkt, 0);
+    uint8_t *data;
+
+    if (pkt->offset < 4 || pkt->length + 4 > NM_MAX_PKT_SIZE)
+        return nm_drop(ex, NM_DROP_INVALID);
+
+    pkt->offset -= 4;
+    pkt->length += 4;
+    data = NM_PKT_DATA(pkt);
+    memmove(data, data + 4, 12);
+    data[12] = 0x81;
+    data[13] = 0x00;
+    data[14] = tag >> 8;
+    data[15] = tag & 0xff;
+    if (!pkt->hdr_cached)
+        ex->stats->mem_reads[mem]++;
+    ex->stats->mem_writes[mem]++;
+    nm_invalidate_cache(pkt);
+
+    pkt->hdr_stack = nm_hdr_stack_adjust(pkt->hdr_stack, 4);
+    pkt->vlan_id = tag & NM_NULL_VLAN;
+
+    return NM_ACT_NEXT;
+}
+
+
+/**
+ * nm_act_meter
+ * The model has no time base, so every packet is green. The policer
+ * arithmetic is modelled by nm_meter_pkt(), only the memory traffic of
+ * the swap, read, test_subsat and test_add is counted here.
+ */
+static enum nm_act_rc
+nm_act_meter(struct nm_exec *ex)
+{
+    ex->idx++;
+    ex->stats->mem_reads[NM_MEM_EMEM] += 2;
+    ex->stats->mem_writes[NM_MEM_EMEM] += 2;
+
+    return NM_ACT_NEXT;
+}
+
+
+/**
+ * nm_act_sample
+ * The model has no PSEUDO_RANDOM_NUMBER, so no packet is sampled. That is
+ * the common case at the rates INSTR_SAMPLE is meant for and costs no
+ * memory operations.
+ */
+static enum nm_act_rc
+nm_act_sample(struct nm_exec *ex)
+{
+    ex->idx += 2;
+
+    return NM_ACT_NEXT;
+}
+
+
+/**
+ * nm_act_acl
+ * The model holds no ACL rules, so every lookup misses and the packet
+ * passes. The key is still read from the packet and the hashmap lookup
+ * counted, which is the cost of the common case.
+ */
+static enum nm_act_rc
+nm_act_acl(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+
+    ex->idx += 2;
+
+    if (!NM_HDR_INNER_IP(pkt->hdr_stack))
+        return NM_ACT_NEXT;
+
+    /* the key is the header copy */
+    nm_hdr_cache(ex);
+
+    /* hashmap_ops overwrites the packet cache */
+    nm_invalidate_cache(pkt);
+    ex->stats->mem_reads[NM_MEM_EMEM]++;
+
+    return NM_ACT_NEXT;
+}
+
+
+static enum nm_act_rc
+nm_act_veb_lookup(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    const struct nm_config *cfg = ex->cfg;
+    uint64_t port_mac = NM_MAC(NM_INSTR_ARGS(ex->instr[ex->idx]),
+                               ex->instr[ex->idx + 1]);
+    uint64_t mac;
+    uint32_t i;
+
+    ex->idx += 2;
+
+    if (pkt->mac_dst_mc)
+        return NM_ACT_NEXT;
+
+    nm_hdr_cache(ex);
+    mac = nm_pkt_mac(pkt, 0);
+    if (mac == port_mac)
+        return NM_ACT_NEXT;
+
+    /* hashmap_ops overwrites the packet cache */
+    nm_invalidate_cache(pkt);
+    ex->stats->mem_reads[NM_MEM_EMEM]++;
+
+    for (i = 0; i < cfg->num_veb; i++) {
+        if (cfg->veb[i].mac == mac && cfg->veb[i].vlan_id == pkt->vlan_id) {
+            nm_list_switch(ex, &cfg->veb[i], NM_MEM_EMEM);
+            return NM_ACT_NEXT;
+        }
+    }
+
+    /* pass on miss in promiscuous mode */
+    if (!port_mac)
+        return NM_ACT_NEXT;
+
+    return nm_drop(ex, NM_DROP_ADDR);
+}
+
+
+static enum nm_act_rc
+nm_act_pop_pkt(struct nm_exec *ex)
+{
+    ex->idx++;
+
+    if (ex->pkt->ctm_allocated || !ex->saved)
+        return nm_drop(ex, NM_DROP_PKT_STACK);
+
+    *ex->pkt = *ex->saved;
+    ex->saved = NULL;
+
+    return NM_ACT_NEXT;
+}
+
+
+static enum nm_act_rc
+nm_act_push_pkt(struct nm_exec *ex, struct nm_pkt *save_area)
+{
+    struct nm_pkt *pkt = ex->pkt;
+
+    ex->idx++;
+
+    if (!pkt->ctm_allocated)
+        return nm_drop(ex, NM_DROP_PKT_STACK);
+
+    memcpy(save_area, pkt, sizeof(*pkt));
+    ex->saved = save_area;
+
+    /* pkt_buf_copy_ctm_to_mu_head */
+    ex->stats->mem_reads[NM_MEM_CTM]++;
+    ex->stats->mem_writes[NM_MEM_EMEM]++;
+    pkt->ctm_allocated = 0;
+    pkt->meta_len = 0;
+
+    return NM_ACT_NEXT;
+}
+
+
+/**
+ * nm_tx_vlan_members
+ * Send the packet to each queue of a _vf_vlan_cache entry.
+ */
+static void
+nm_tx_vlan_members(struct nm_exec *ex, uint32_t vlan_id)
+{
+    uint64_t members = ex->cfg->vlan_members[vlan_id];
+    uint32_t q;
+
+    ex->stats->mem_reads[NM_MEM_CTM]++;
+    nm_meta_write(ex);
+
+    for (q = 0; q < NM_VLAN_MAX_QUEUES; q++) {
+        if (!((members >> q) & 1))
+            continue;
+        ex->stats->mem_reads[NM_MEM_PCIE]++;
+        ex->stats->tx_host++;
+    }
+}
+
+
+static enum nm_act_rc
+nm_act_tx_vlan(struct nm_exec *ex)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    enum nm_mem mem;
+
+    ex->idx++;
+
+    if (pkt->vlan_id != NM_NULL_VLAN) {
+        /* strip the VLAN tag in place */
+        mem = nm_pkt_mem(pkt, 0);
+        ex->stats->mem_reads[mem]++;
+        ex->stats->mem_writes[mem]++;
+        memmove(NM_PKT_DATA(pkt) + 4, NM_PKT_DATA(pkt), 12);
+        pkt->offset += 4;
+        pkt->length -= 4;
+
+        nm_tx_vlan_members(ex, pkt->vlan_id);
+
+        /* the tagged copy remains in the CTM buffer saved by PUSH_PKT */
+        if (pkt->ctm_allocated || !ex->saved)
+            return nm_drop(ex, NM_DROP_PKT_STACK);
+        *pkt = *ex->saved;
+        ex->saved = NULL;
+    }
+
+    nm_tx_vlan_members(ex, NM_NULL_VLAN);
+
+    return NM_ACT_TX;
+}
+
+
+static enum nm_act_rc
+nm_act_l2_switch(struct nm_exec *ex, int wire)
+{
+    struct nm_pkt *pkt = ex->pkt;
+    const struct nm_config *cfg = ex->cfg;
+    uint64_t mac;
+    uint32_t i;
+
+    ex->idx++;
+
+    if (pkt->mac_dst_mc)
+        return NM_ACT_NEXT;
+
+    nm_seek(pkt, 0, NM_SEEK_DEFAULT, ex->stats);
+    mac = nm_pkt_mac(pkt, 0);
+
+    /* CAMR lookup in _mac_lkup_tbl */
+    ex->stats->mem_reads[NM_MEM_IMEM]++;
+
+    for (i = 0; i < cfg->num_l2; i++) {
+        if (cfg->l2[i].mac == mac) {
+            nm_list_switch(ex, &cfg->l2[i], NM_MEM_CLS);
+            return NM_ACT_NEXT;
+        }
+    }
+
+    return wire ? nm_drop(ex, NM_DROP_ADDR) : NM_ACT_NEXT;
+}
+
+
+/**
+ * nm_act_chain
+ * Mirror __actions_chain: join the segment prefetched by the previous
+ * INSTR_CHAIN, continue in the other half of $__actions and prefetch the
+ * segment at CLS ADDR into the half just executed. The prefetched words
+ * only appear at the join, as the worker must not use them earlier.
+ */
+static enum nm_act_rc
+nm_act_chain(struct nm_exec *ex)
+{
+    const struct nm_config *cfg = ex->cfg;
+    uint32_t args = NM_INSTR_ARGS(ex->instr[ex->idx]);
+    uint32_t half = ex->idx - (ex->idx % NIC_INSTR_SEG);
+    uint32_t block;
+    uint32_t i;
+
+    if (NM_BF_GET(&args, INSTR_CHAIN_JOIN_bf)) {
+        /* the worker would wait forever for the signal */
+        if (!ex->fetch_pending)
+            return nm_drop(ex, NM_DROP_INVALID);
+
+        block = ex->fetch_addr & ~(NIC_MAX_INSTR * 4 - 1);
+        for (i = 0; i < cfg->num_ext; i++) {
+            if (cfg->ext[i].addr == block)
+                break;
+        }
+        if (i == cfg->num_ext)
+            return nm_drop(ex, NM_DROP_INVALID);
+
+        memcpy(&ex->instr[ex->fetch_half],
+               &cfg->ext[i].instr[(ex->fetch_addr - block) / 4],
+               NIC_INSTR_SEG * 4);
+        ex->fetch_pending = 0;
+    }
+
+    if (NM_BF_GET(&args, INSTR_CHAIN_FETCH_bf)) {
+        ex->stats->mem_reads[NM_MEM_CLS]++;
+        ex->stats->chain_fetches++;
+        ex->fetch_addr = args & ~(NIC_INSTR_SEG * 4 - 1);
+        ex->fetch_half = half;
+        ex->fetch_pending = 1;
+    }
+
+    ex->idx = half ^ NIC_INSTR_SEG;
+
+    return NM_ACT_NEXT;
+}
+
+
+int
+nm_execute(struct nm_pkt *pkt, const struct nm_config *cfg,
+           struct nm_stats *stats)
+{
+    struct nm_pkt save_area;
+    struct nm_exec ex;
+    enum nm_act_rc rc = NM_ACT_DISPATCH;
+    uint32_t op = NM_NUM_OPS;
+    uint32_t word;
+
+    ex.pkt = pkt;
+    ex.cfg = cfg;
+    ex.stats = stats;
+    ex.saved = NULL;
+    ex.fetch_pending = 0;
+
+    stats->pkts++;
+    stats->bytes += pkt->length;
+
+    /* actions_load */
+    nm_list_switch(&ex, &cfg->ingress, NM_MEM_CLS);
+
+    for (;;) {
+        if (ex.idx >= NIC_MAX_INSTR) {
+            stats->drops[NM_DROP_INVALID]++;
+            return 1;
+        }
+        word = ex.instr[ex.idx];
+
+        if (rc == NM_ACT_NEXT && NM_INSTR_PIPELINE(word)) {
+            /* br_bclr not taken: fall into the next handler in code
+             * order, which interprets the word whatever its opcode */
+            stats->pipelined++;
+            op = nm_fall_through[op];
+            if (op != nm_instr_op(cfg, word))
+                stats->pipeline_mismatch++;
+        } else {
+            /* jump[] directly to the handler */
+            stats->dispatches++;
+            op = nm_instr_op(cfg, word);
+        }
+
+        if (op >= NM_NUM_OPS) {
+            stats->drops[NM_DROP_INVALID]++;
+            return 1;
+        }
+        stats->invocations[op]++;
+
+        switch (op) {
+        case INSTR_DROP:
+            rc = nm_drop(&ex, NM_DROP_ACT);
+            break;
+        case INSTR_RX_WIRE:
+            rc = nm_act_rx_wire(&ex);
+            break;
+        case INSTR_DST_MAC_MATCH:
+            rc = nm_act_dst_mac_match(&ex);
+            break;
+        case INSTR_CHECKSUM:
+            rc = nm_act_checksum(&ex);
+            break;
+        case INSTR_RSS:
+            rc = nm_act_rss(&ex);
+            break;
+        case INSTR_TX_HOST:
+            rc = nm_act_tx_host(&ex);
+            break;
+        case INSTR_RX_HOST:
+            rc = nm_act_rx_host(&ex);
+            break;
+        case INSTR_TX_WIRE:
+            rc = nm_act_tx_wire(&ex);
+            break;
+        case INSTR_CMSG:
+            stats->tx_cmsg++;
+            rc = NM_ACT_TX;
+            break;
+        case INSTR_EBPF:
+            /* modelled as XDP_PASS: ebpf_reentry branches to actions# */
+            ex.idx++;
+            stats->tx_ebpf++;
+            pkt->tx_flags |= NM_TX_HOST_RX_BPF;
+            nm_invalidate_cache(pkt);
+            pkt->hdr_cached = 0;
+            rc = NM_ACT_DISPATCH;
+            break;
+        case INSTR_POP_VLAN:
+            rc = nm_act_pop_vlan(&ex);
+            break;
+        case INSTR_PUSH_VLAN:
+            rc = nm_act_push_vlan(&ex);
+            break;
+        case INSTR_SRC_MAC_MATCH:
+            rc = nm_act_src_mac_match(&ex);
+            break;
+        case INSTR_METER:
+            rc = nm_act_meter(&ex);
+            break;
+        case INSTR_SAMPLE:
+            rc = nm_act_sample(&ex);
+            break;
+        case INSTR_ACL:
+            rc = nm_act_acl(&ex);
+            break;
+        case INSTR_VEB_LOOKUP:
+            rc = nm_act_veb_lookup(&ex);
+            break;
+        case INSTR_POP_PKT:
+            rc = nm_act_pop_pkt(&ex);
+            break;
+        case INSTR_PUSH_PKT:
+            rc = nm_act_push_pkt(&ex, &save_area);
+            break;
+        case INSTR_TX_VLAN:
+            rc = nm_act_tx_vlan(&ex);
+            break;
+        case INSTR_L2_SWITCH_WIRE:
+            rc = nm_act_l2_switch(&ex, 1);
+            break;
+        case INSTR_L2_SWITCH_HOST:
+            rc = nm_act_l2_switch(&ex, 0);
+            break;
+        case INSTR_CHAIN:
+            rc = nm_act_chain(&ex);
+            break;
+        }
+
+        if (rc == NM_ACT_TX)
+            return 0;
+        if (rc == NM_ACT_DROP)
+            return 1;
+    }
+}
+
+
+/**
+ * nm_stats_table
+ * Flatten the statistics into (name, value) pairs for printing and
+ * comparison.
+ *
+ * @return number of entries written
+ */
+static int
+nm_stats_table(const struct nm_stats *stats, char names[][32],
+               uint64_t *values, int size)
+{
+    int n = 0;
+    int i;
+
+#define NM_STATS_ADD(v, ...)                                            \
+    do {                                                                \
+        if (n < size) {                                                 \
+            snprintf(names[n], sizeof(names[n]), __VA_ARGS__);          \
+            values[n++] = (v);                                          \
+        }                                                               \
+    } while (0)
+
+    NM_STATS_ADD(stats->pkts, "pkts");
+    NM_STATS_ADD(stats->bytes, "bytes");
+    NM_STATS_ADD(stats->dispatches, "dispatches");
+    NM_STATS_ADD(stats->pipelined, "pipelined");
+    NM_STATS_ADD(stats->pipeline_mismatch, "pipeline_mismatch");
+    NM_STATS_ADD(stats->list_loads, "list_loads");
+    NM_STATS_ADD(stats->chain_fetches, "chain_fetches");
+    NM_STATS_ADD(stats->seeks, "seeks");
+    NM_STATS_ADD(stats->seek_fetches, "seek_fetches");
+    NM_STATS_ADD(stats->read_aheads, "read_aheads");
+    for (i = 0; i < NM_NUM_OPS; i++)
+        NM_STATS_ADD(stats->invocations[i], "op.%s", nm_op_names[i]);
+    for (i = 0; i < NM_NUM_MEMS; i++)
+        NM_STATS_ADD(stats->mem_reads[i], "mem_read.%s", nm_mem_names[i]);
+    for (i = 0; i < NM_NUM_MEMS; i++)
+        NM_STATS_ADD(stats->mem_writes[i], "mem_write.%s", nm_mem_names[i]);
+    for (i = 0; i < NM_NUM_DROPS; i++)
+        NM_STATS_ADD(stats->drops[i], "drop.%s", nm_drop_names[i]);
+    NM_STATS_ADD(stats->tx_host, "tx.host");
+    NM_STATS_ADD(stats->tx_wire, "tx.wire");
+    NM_STATS_ADD(stats->tx_cmsg, "tx.cmsg");
+    NM_STATS_ADD(stats->tx_ebpf, "tx.ebpf");
+
+#undef NM_STATS_ADD
+
+    return n;
+}
+
+#define NM_STATS_MAX    96
+
+
+void
+nm_stats_print(FILE *f, const struct nm_stats *stats)
+{
+    char names[NM_STATS_MAX][32];
+    uint64_t values[NM_STATS_MAX];
+    double pkts = stats->pkts ? stats->pkts : 1;
+    int n;
+    int i;
+
+    n = nm_stats_table(stats, names, values, NM_STATS_MAX);
+    fprintf(f, "# %-24s %14s %12s\n", "counter", "total", "per_pkt");
+    for (i = 0; i < n; i++)
+        fprintf(f, "%-26s %14llu %12.4f\n", names[i],
+                (unsigned long long) values[i], values[i] / pkts);
+}
+
+
+int
+nm_stats_compare(FILE *f, const struct nm_stats *stats,
+                 const char *baseline, double tolerance)
+{
+    char names[NM_STATS_MAX][32];
+    uint64_t values[NM_STATS_MAX];
+    char line[256];
+    char name[64];
+    double base_pp;
+    double cur_pp;
+    double pkts = stats->pkts ? stats->pkts : 1;
+    unsigned long long total;
+    int regressions = 0;
+    int n;
+    int i;
+    FILE *bf;
+
+    bf = fopen(baseline, "r");
+    if (!bf)
+        return -1;
+
+    n = nm_stats_table(stats, names, values, NM_STATS_MAX);
+
+    while (fgets(line, sizeof(line), bf)) {
+        if (line[0] == '#')
+            continue;
+        if (sscanf(line, "%63s %llu %lf", name, &total, &base_pp) != 3)
+            continue;
+        if (!strcmp(name, "pkts") || !strcmp(name, "bytes"))
+            continue;
+
+        for (i = 0; i < n; i++) {
+            if (strcmp(names[i], name))
+                continue;
+
+            cur_pp = values[i] / pkts;
+            /* the report prints per packet costs to four decimals */
+            if (cur_pp > base_pp * (1.0 + tolerance) + 0.00005) {
+                fprintf(f, "REGRESSION %-26s %12.4f -> %12.4f\n", name,
+                        base_pp, cur_pp);
+                regressions++;
+            }
+            break;
+        }
+    }
+
+    fclose(bf);
+    return regressions;
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_config.c
+ * @brief  Loader for the action list description used by the model.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nic_model.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+static int
+nm_parse_mac(const char *str, uint64_t *mac)
+{
+    unsigned int b[6];
+    int i;
+
+    if (sscanf(str, "%x:%x:%x:%x:%x:%x",
+               &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6)
+        return -1;
+
+    *mac = 0;
+    for (i = 0; i < 6; i++) {
+        if (b[i] > 0xff)
+            return -1;
+        *mac = (*mac << 8) | b[i];
+    }
+
+    return 0;
+}
+
+
+/**
+ * nm_config_directive
+ * Handle one keyword line, possibly selecting a new list to append to.
+ *
+ * @return 0 on success, 1 if the line is not a directive, -1 on error
+ */
+static int
+nm_config_directive(struct nm_config *cfg, char *line,
+                    struct nm_action_list **list)
+{
+    static const char *keywords[] = {
+        "ingress", "veb", "l2", "block", "vxlan", "rss", "rsskey", "vlan",
+        "csum", "opmap"
+    };
+    char *kw;
+    char *arg1;
+    char *arg2;
+    char word[9];
+    uint8_t itbl[NFP_NET_CFG_RSS_ITBL_SZ];
+    unsigned long val;
+    uint64_t mac;
+    uint32_t i;
+
+    for (i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+        if (!strncmp(line, keywords[i], strlen(keywords[i])) &&
+            strchr(" \t\n", line[strlen(keywords[i])]))
+            break;
+    }
+    if (i == sizeof(keywords) / sizeof(keywords[0]))
+        return 1;
+
+    kw = strtok(line, " \t\n");
+    arg1 = strtok(NULL, " \t\n");
+    arg2 = strtok(NULL, " \t\n");
+
+    if (!strcmp(kw, "ingress")) {
+        *list = &cfg->ingress;
+    } else if (!strcmp(kw, "veb")) {
+        if (!arg1 || !arg2 || nm_parse_mac(arg1, &mac) ||
+            cfg->num_veb == NM_MAX_ALT_LISTS)
+            return -1;
+        *list = &cfg->veb[cfg->num_veb++];
+        (*list)->mac = mac;
+        (*list)->vlan_id = strtoul(arg2, NULL, 0) & NM_NULL_VLAN;
+    } else if (!strcmp(kw, "l2")) {
+        if (!arg1 || nm_parse_mac(arg1, &mac) ||
+            cfg->num_l2 == NM_MAX_ALT_LISTS)
+            return -1;
+        *list = &cfg->l2[cfg->num_l2++];
+        (*list)->mac = mac;
+    } else if (!strcmp(kw, "block")) {
+        val = arg1 ? strtoul(arg1, NULL, 0) : 1;
+        if (val % (NIC_MAX_INSTR * 4) || val >= NIC_CFG_INSTR_TBL_SIZE ||
+            cfg->num_ext == NM_MAX_EXT_BLOCKS)
+            return -1;
+        *list = &cfg->ext[cfg->num_ext++];
+        (*list)->addr = val;
+    } else if (!strcmp(kw, "vxlan")) {
+        if (!arg1 || cfg->num_vxlan_ports == 8)
+            return -1;
+        cfg->vxlan_ports[cfg->num_vxlan_ports++] = strtoul(arg1, NULL, 0);
+    } else if (!strcmp(kw, "rss")) {
+        val = arg1 ? strtoul(arg1, NULL, 0) : 0;
+        if (!val || val > 64)
+            return -1;
+        for (i = 0; i < NFP_NET_CFG_RSS_ITBL_SZ; i++)
+            itbl[i] = i % val;
+        val = arg2 ? strtoul(arg2, NULL, 0) : NIC_RSS_TBL_ENTRIES;
+        if (val < NFP_NET_CFG_RSS_ITBL_SZ || val > NM_RSS_TBL_MAX ||
+            (val & (val - 1)))
+            return -1;
+        cfg->rss_tbl_entries = val;
+        nm_rss_tbl_extend(cfg->rss_tbl, val, itbl);
+    } else if (!strcmp(kw, "rsskey")) {
+        if (!arg1 || strlen(arg1) != NFP_NET_CFG_RSS_KEY_SZ * 2)
+            return -1;
+        for (i = 0; i < NM_RSS_KEY_LW; i++) {
+            memcpy(word, &arg1[i * 8], 8);
+            word[8] = '\0';
+            if (strspn(word, "0123456789abcdefABCDEF") != 8)
+                return -1;
+            cfg->rss_key[i] = strtoul(word, NULL, 16);
+        }
+    } else if (!strcmp(kw, "vlan")) {
+        if (!arg1 || !arg2)
+            return -1;
+        val = strtoul(arg1, NULL, 0);
+        if (val >= NM_NUM_VLANS)
+            return -1;
+        cfg->vlan_members[val] = strtoull(arg2, NULL, 16);
+    } else if (!strcmp(kw, "opmap")) {
+        cfg->num_op_map = 0;
+        for (; arg1; arg1 = arg2, arg2 = strtok(NULL, " \t\n,")) {
+            if (cfg->num_op_map == NM_NUM_OPS)
+                return -1;
+            cfg->op_map[cfg->num_op_map++] = strtoul(arg1, NULL, 0);
+        }
+    } else if (!strcmp(kw, "csum")) {
+        if (!arg1)
+            return -1;
+        cfg->ingress_csum = strtoul(arg1, NULL, 0);
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int
+nm_config_load(struct nm_config *cfg, const char *filename)
+{
+    struct nm_action_list *list = &cfg->ingress;
+    char line[256];
+    char *tok;
+    char *end;
+    uint32_t lineno = 0;
+    int rc;
+    FILE *f;
+
+    f = fopen(filename, "r");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", filename);
+        return -1;
+    }
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->rss_tbl_entries = NIC_RSS_TBL_ENTRIES;
+
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+
+        end = strchr(line, '#');
+        if (end)
+            *end = '\0';
+
+        tok = line + strspn(line, " \t\n");
+        if (!*tok)
+            continue;
+
+        rc = nm_config_directive(cfg, tok, &list);
+        if (rc < 0)
+            goto error;
+        if (!rc)
+            continue;
+
+        /* instruction words, in hex */
+        for (tok = strtok(tok, " \t\n"); tok; tok = strtok(NULL, " \t\n")) {
+            if (list->num_words == NIC_MAX_INSTR)
+                goto error;
+            list->instr[list->num_words++] = strtoul(tok, &end, 16);
+            if (*end)
+                goto error;
+        }
+    }
+
+    fclose(f);
+    return 0;
+
+error:
+    fprintf(stderr, "%s:%u: invalid line\n", filename, lineno);
+    fclose(f);
+    return -1;
+}
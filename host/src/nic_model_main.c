@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_main.c
+ * @brief  Replay a pcap trace through the action interpreter model.
+ *
+ * Usage: nic_model [-H] [-b baseline] [-t tolerance] config trace.pcap
+ *
+ * The per-packet cost report is written to stdout. With -b, the report is
+ * compared against a previously saved one and the exit status is 2 if any
+ * counter grew by more than the tolerance.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nic_model.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static struct nm_config config;
+static struct nm_stats stats;
+static uint8_t frame[NM_MAX_PKT_SIZE];
+
+
+static void
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-H] [-b baseline] [-t tolerance] config trace.pcap\n"
+            "  -H            packets arrive from a host queue (default wire)\n"
+            "  -b baseline   compare against a saved report\n"
+            "  -t tolerance  permitted relative increase per counter "
+            "(default 0.02)\n", prog);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    const char *baseline = NULL;
+    double tolerance = 0.02;
+    struct nm_pcap *pcap;
+    struct nm_pkt pkt;
+    uint32_t length;
+    int from_host = 0;
+    int rc;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "Hb:t:")) != -1) {
+        switch (opt) {
+        case 'H':
+            from_host = 1;
+            break;
+        case 'b':
+            baseline = optarg;
+            break;
+        case 't':
+            tolerance = strtod(optarg, NULL);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (nm_config_load(&config, argv[optind]))
+        return 1;
+
+    pcap = nm_pcap_open(argv[optind + 1]);
+    if (!pcap)
+        return 1;
+
+    while ((rc = nm_pcap_next(pcap, frame, sizeof(frame), &length)) > 0) {
+        if (nm_pkt_init(&pkt, frame, length, from_host)) {
+            stats.drops[NM_DROP_RUNT]++;
+            continue;
+        }
+        nm_execute(&pkt, &config, &stats);
+    }
+    nm_pcap_close(pcap);
+
+    if (rc < 0) {
+        fprintf(stderr, "%s: truncated trace\n", argv[optind + 1]);
+        return 1;
+    }
+
+    nm_stats_print(stdout, &stats);
+
+    if (baseline) {
+        rc = nm_stats_compare(stdout, &stats, baseline, tolerance);
+        if (rc < 0)
+            return 1;
+        if (rc > 0)
+            return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_meter.c
+ * @brief  Model of the INSTR_METER two-rate three-colour policer.
+ *
+ * The arithmetic mirrors __actions_meter in firmware/apps/nic/actions.uc
+ * step by step, in the units of app_config_meter.h, so that the rates and
+ * burst sizes the app master programs can be checked on the host.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nic_model.h"
+#include "app_config_meter.h"
+
+
+uint32_t
+nm_meter_credit(uint32_t elapsed, uint32_t rate)
+{
+    uint64_t credit = ((uint64_t) elapsed * rate) >> NIC_METER_RATE_SHF;
+
+    if (credit > UINT32_MAX)
+        return UINT32_MAX;
+
+    return credit;
+}
+
+
+static uint32_t
+nm_meter_subsat(uint32_t deficit, uint32_t credit)
+{
+    return (deficit > credit) ? deficit - credit : 0;
+}
+
+
+int
+nm_meter_pkt(struct nm_meter *meter, uint32_t now, uint32_t length,
+             int mark)
+{
+    uint32_t len = length << NIC_METER_FRAC_SHF;
+    uint32_t elapsed;
+    uint32_t dp, dc;
+
+    /* mem[swap] of the timestamp */
+    elapsed = now - meter->ts;
+    meter->ts = now;
+
+    /* mem[test_subsat], skipped for skew between MEs */
+    if (elapsed && (elapsed >> NIC_METER_SKEW_SHF) != 0xff) {
+        meter->dp = nm_meter_subsat(meter->dp,
+                                    nm_meter_credit(elapsed, meter->pir));
+        meter->dc = nm_meter_subsat(meter->dc,
+                                    nm_meter_credit(elapsed, meter->cir));
+    }
+
+    /* mem[test_add] */
+    dp = meter->dp;
+    dc = meter->dc;
+    meter->dp += len;
+    meter->dc += len;
+
+    if (dp + len > meter->pbs || (dc + len > meter->cbs && !mark)) {
+        meter->dp -= len;
+        meter->dc -= len;
+        return NIC_METER_RED;
+    }
+
+    if (dc + len > meter->cbs) {
+        meter->dc -= len;
+        return NIC_METER_YELLOW;
+    }
+
+    return NIC_METER_GREEN;
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_meter_test.c
+ * @brief  Check the INSTR_METER policer arithmetic on the host.
+ *
+ * Converts rates and burst sizes the way cfg_act_append_meter() does and
+ * offers packet streams to nm_meter_pkt(), checking that the green and
+ * green plus yellow throughput match CIR and PIR and that bursts, idle
+ * periods, timestamp wrap and skew between MEs are handled.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nic_model.h"
+#include "app_config_meter.h"
+
+/* ME clock of the NFP-4000/6000 */
+#define TCLK_MHZ        1200
+#define TICKS_PER_SEC   ((double) TCLK_MHZ * 1e6 / NIC_METER_TICK_CYCLES)
+
+/* Relative throughput error allowed */
+#define RATE_TOL        0.01
+
+/* Start close to the TIMESTAMP_LOW wrap */
+#define TS_START        0xfff00000
+
+
+struct test_stream {
+    const char *name;
+    uint32_t cir_kbps;
+    uint32_t pir_kbps;
+    uint32_t cbs;
+    uint32_t pbs;
+    uint32_t pkt_len;
+    double offered_kbps;
+    double seconds;
+    int mark;
+};
+
+static const struct test_stream streams[] = {
+    {"trtcm 1G/2G", 1000000, 2000000, 16000, 32000, 1500, 4e6, 0.2, 1},
+    {"drop 1G/2G", 1000000, 2000000, 16000, 32000, 1500, 4e6, 0.2, 0},
+    {"trtcm 10M/20M", 10000, 20000, 3000, 6000, 64, 512e3, 1.0, 1},
+    {"trtcm 40G/40G", 40000000, 40000000, 64000, 64000, 9000, 1e8, 0.05, 1},
+    {"under rate", 1000000, 2000000, 16000, 32000, 1500, 5e5, 0.2, 1},
+};
+
+
+static void
+meter_init(struct nm_meter *meter, uint32_t cir_kbps, uint32_t pir_kbps,
+           uint32_t cbs, uint32_t pbs, uint32_t now)
+{
+    memset(meter, 0, sizeof(*meter));
+    meter->ts = now;
+    meter->pbs = nic_meter_burst(pbs);
+    meter->cbs = nic_meter_burst(cbs);
+    meter->pir = nic_meter_rate(pir_kbps, TCLK_MHZ);
+    meter->cir = nic_meter_rate(cir_kbps, TCLK_MHZ);
+}
+
+
+static int
+rate_close(const char *name, const char *what, double got, double expect)
+{
+    double err = (got - expect) / expect;
+
+    if (err > RATE_TOL || err < -RATE_TOL) {
+        fprintf(stderr, "%s: %s %.0f kbit/s, expected %.0f kbit/s\n",
+                name, what, got, expect);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Check nic_meter_rate() against the exact conversion.
+ *
+ * @return 0 on success, 1 on failure
+ */
+static int
+test_rate(void)
+{
+    static const uint32_t kbps[] = {1, 64, 1000, 12345, 1000000, 25000000,
+                                    100000000};
+    uint64_t expect;
+    uint32_t i;
+
+    for (i = 0; i < sizeof(kbps) / sizeof(kbps[0]); i++) {
+        expect = ((uint64_t) kbps[i] <<
+                  (NIC_METER_FRAC_SHF + NIC_METER_RATE_SHF + 1)) /
+                 (TCLK_MHZ * 1000);
+        if (nic_meter_rate(kbps[i], TCLK_MHZ) != expect) {
+            fprintf(stderr, "rate: %u kbit/s gives %u, expected %llu\n",
+                    kbps[i], nic_meter_rate(kbps[i], TCLK_MHZ),
+                    (unsigned long long) expect);
+            return 1;
+        }
+    }
+
+    if (nm_meter_credit(UINT32_MAX, UINT32_MAX) != UINT32_MAX ||
+        nm_meter_credit(1 << NIC_METER_RATE_SHF, 1) != 1 ||
+        nm_meter_credit((1 << NIC_METER_RATE_SHF) - 1, 1) != 0) {
+        fprintf(stderr, "rate: nm_meter_credit does not saturate or "
+                "truncate\n");
+        return 1;
+    }
+
+    printf("%-16s ok\n", "rate");
+    return 0;
+}
+
+
+/**
+ * Offer a constant rate stream and compare the throughput of each colour
+ * with the configured rates. The stream starts with full buckets and
+ * crosses the TIMESTAMP_LOW wrap.
+ *
+ * @return 0 on success, 1 on failure
+ */
+static int
+test_stream(const struct test_stream *t)
+{
+    struct nm_meter meter;
+    uint64_t bytes[NIC_METER_RED + 1];
+    double gap = t->pkt_len * 8 / (t->offered_kbps * 1000) * TICKS_PER_SEC;
+    double ticks = 0;
+    double green, yellow;
+    uint64_t pkts = 0;
+    int colour;
+    int failed = 0;
+
+    memset(bytes, 0, sizeof(bytes));
+    meter_init(&meter, t->cir_kbps, t->pir_kbps, t->cbs, t->pbs, TS_START);
+
+    while (ticks < t->seconds * TICKS_PER_SEC) {
+        colour = nm_meter_pkt(&meter, TS_START + (uint64_t) ticks,
+                              t->pkt_len, t->mark);
+        bytes[colour] += t->pkt_len;
+        ticks += gap;
+        pkts++;
+    }
+
+    green = bytes[NIC_METER_GREEN] * 8 / t->seconds / 1000;
+    yellow = bytes[NIC_METER_YELLOW] * 8 / t->seconds / 1000;
+
+    if (t->offered_kbps < t->cir_kbps) {
+        if (bytes[NIC_METER_YELLOW] || bytes[NIC_METER_RED]) {
+            fprintf(stderr, "%s: stream below CIR policed\n", t->name);
+            failed = 1;
+        }
+    } else {
+        failed |= rate_close(t->name, "green", green, t->cir_kbps);
+        if (t->mark)
+            failed |= rate_close(t->name, "green+yellow", green + yellow,
+                                 t->pir_kbps);
+        else if (bytes[NIC_METER_YELLOW]) {
+            fprintf(stderr, "%s: yellow packets without marking\n",
+                    t->name);
+            failed = 1;
+        }
+    }
+
+    printf("%-16s %8llu pkts, green %10.0f yellow %10.0f kbit/s\n",
+           t->name, (unsigned long long) pkts, green, yellow);
+
+    return failed;
+}
+
+
+static int
+expect_colours(const char *name, struct nm_meter *meter, uint32_t now,
+               int mark, const int *colours, uint32_t count)
+{
+    uint32_t i;
+    int colour;
+
+    for (i = 0; i < count; i++) {
+        colour = nm_meter_pkt(meter, now, 1000, mark);
+        if (colour != colours[i]) {
+            fprintf(stderr, "%s: packet %u colour %d, expected %d\n",
+                    name, i, colour, colours[i]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Back to back packets at a single timestamp only see the burst sizes,
+ * an idle period refills the buckets completely and a timestamp going
+ * back by a little (another ME's swap) refills nothing.
+ *
+ * @return 0 on success, 1 on failure
+ */
+static int
+test_burst(void)
+{
+    static const int trtcm[] = {
+        NIC_METER_GREEN, NIC_METER_GREEN, NIC_METER_GREEN,
+        NIC_METER_YELLOW, NIC_METER_YELLOW, NIC_METER_YELLOW,
+        NIC_METER_RED, NIC_METER_RED
+    };
+    static const int drop[] = {
+        NIC_METER_GREEN, NIC_METER_GREEN, NIC_METER_GREEN,
+        NIC_METER_RED, NIC_METER_RED
+    };
+    struct nm_meter meter;
+    uint32_t now = TS_START;
+    uint32_t dp;
+
+    meter_init(&meter, 100000000, 100000000, 3000, 6000, now);
+    if (expect_colours("burst", &meter, now, 1, trtcm, 8))
+        return 1;
+    if (meter.dp != nic_meter_burst(6000) ||
+        meter.dc != nic_meter_burst(3000)) {
+        fprintf(stderr, "burst: red packets left in the buckets\n");
+        return 1;
+    }
+
+    /* Half the wrap, the refill saturates */
+    now += 1u << 31;
+    if (expect_colours("idle", &meter, now, 0, drop, 5))
+        return 1;
+
+    /* Skew: no refill, but the timestamp moves back */
+    dp = meter.dp;
+    now -= 100;
+    nm_meter_pkt(&meter, now, 0, 1);
+    if (meter.dp != dp || meter.ts != now) {
+        fprintf(stderr, "skew: buckets refilled on a backward swap\n");
+        return 1;
+    }
+
+    printf("%-16s ok\n", "burst");
+    return 0;
+}
+
+
+int
+main(void)
+{
+    int failed = 0;
+    uint32_t i;
+
+    failed |= test_rate();
+
+    for (i = 0; i < sizeof(streams) / sizeof(streams[0]); i++)
+        failed |= test_stream(&streams[i]);
+
+    failed |= test_burst();
+
+    if (failed) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,703 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_optimize_test.c
+ * @brief  Check the action list optimiser of the app master against the
+ *         interpreter model.
+ *
+ * Each list is run through cfg_act_opt_run() (app_config_optimize.h) and
+ * both the original and the optimised list are executed for a set of
+ * frames. The test fails if any frame is handled differently, or if the
+ * optimised list does not take fewer dispatch branches.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nic_model.h"
+#include "app_config_optimize.h"
+#include "flow_cache.h"
+
+#include <string.h>
+
+/* Handler positions in code store, following the order of nm_fall_through
+ * after the three default_* trampolines. Handlers that never fall through
+ * have no successor. */
+#define T_NONE      0xffff
+
+uint32_t cfg_act_map[NM_NUM_OPS] = {
+    [INSTR_DROP] = 3,
+    [INSTR_RX_WIRE] = 4,
+    [INSTR_DST_MAC_MATCH] = 5,
+    [INSTR_ACL] = 6,
+    [INSTR_CHECKSUM] = 7,
+    [INSTR_RSS] = 8,
+    [INSTR_SAMPLE] = 9,
+    [INSTR_TX_HOST] = 10,
+    [INSTR_RX_HOST] = 11,
+    [INSTR_TX_WIRE] = 12,
+    [INSTR_POP_VLAN] = 13,
+    [INSTR_PUSH_VLAN] = 14,
+    [INSTR_SRC_MAC_MATCH] = 15,
+    [INSTR_METER] = 16,
+    [INSTR_VEB_LOOKUP] = 17,
+    [INSTR_POP_PKT] = 18,
+    [INSTR_PUSH_PKT] = 19,
+    [INSTR_TX_VLAN] = 20,
+    [INSTR_CMSG] = 21,
+    [INSTR_EBPF] = 22,
+    [INSTR_L2_SWITCH_WIRE] = 23,
+    [INSTR_L2_SWITCH_HOST] = 24,
+    [INSTR_CHAIN] = 25,
+};
+
+uint32_t cfg_act_next[NM_NUM_OPS] = {
+    [INSTR_DROP] = T_NONE,
+    [INSTR_RX_WIRE] = 5,
+    [INSTR_DST_MAC_MATCH] = 6,
+    [INSTR_ACL] = 7,
+    [INSTR_CHECKSUM] = 8,
+    [INSTR_RSS] = 9,
+    [INSTR_SAMPLE] = 10,
+    [INSTR_TX_HOST] = 11,
+    [INSTR_RX_HOST] = 12,
+    [INSTR_TX_WIRE] = 13,
+    [INSTR_POP_VLAN] = 14,
+    [INSTR_PUSH_VLAN] = 15,
+    [INSTR_SRC_MAC_MATCH] = 16,
+    [INSTR_METER] = 17,
+    [INSTR_VEB_LOOKUP] = 18,
+    [INSTR_POP_PKT] = 19,
+    [INSTR_PUSH_PKT] = 20,
+    [INSTR_TX_VLAN] = T_NONE,
+    [INSTR_CMSG] = T_NONE,
+    [INSTR_EBPF] = T_NONE,
+    [INSTR_L2_SWITCH_WIRE] = 24,
+    [INSTR_L2_SWITCH_HOST] = 25,
+    [INSTR_CHAIN] = T_NONE,
+};
+
+#define MAC_PORT_HI     0x0015
+#define MAC_PORT_LO     0x4d000001
+#define MAC_PEER_HI     0x0015
+#define MAC_PEER_LO     0x4d0000f0
+
+#define CSUM_O          ((1 << 0) | (1 << 1))
+#define CSUM_I          ((1 << 2) | (1 << 3))
+#define CSUM_VAL        (1 << 4)
+#define CSUM_SCTP       (1 << 5)
+#define CSUM_META       (1 << 8)
+
+#define RX_HOST_MTU     (9216 << 2)
+#define TX_CONTINUE     (1 << 15)
+
+/**
+ * An action, as passed to the cfg_act_append_* builders.
+ */
+struct test_act {
+    uint32_t op;
+    uint32_t args;
+    uint32_t param;
+    uint32_t param2;
+};
+
+/**
+ * A list to optimise and the number of entries expected to remain.
+ */
+struct test_list {
+    const char *name;
+    int from_host;
+    uint32_t count_opt;
+    struct test_act acts[NIC_MAX_INSTR];
+    uint32_t count;
+};
+
+#define A3(op, args, param, param2) \
+                            { INSTR_##op, (args), (param), (param2) }
+#define A(op, args, param)  A3(op, args, param, 0)
+#define DST_MAC             A(DST_MAC_MATCH, MAC_PORT_HI, MAC_PORT_LO)
+#define SRC_MAC             A(SRC_MAC_MATCH, MAC_PEER_LO & 0xffff, \
+                              (MAC_PEER_HI << 16) | (MAC_PEER_LO >> 16))
+
+static const struct test_list lists[] = {
+    {
+        /* CHECKSUM_COMPLETE ahead of the MAC match */
+        "wire_pf", 0, 5, {
+            A(RX_WIRE, 0, 0), A(CHECKSUM, CSUM_META, 0), DST_MAC,
+            A(RSS, 0xf03f, 0x6d5a56da), A(TX_HOST, 0, 0),
+        }, 5
+    }, {
+        /* No-op CHECKSUM between RX_WIRE and the MAC match */
+        "wire_nop_csum", 0, 4, {
+            A(RX_WIRE, 0, 0), A(CHECKSUM, 0, 0), DST_MAC,
+            A(CHECKSUM, CSUM_META, 0), A(TX_HOST, 0, 0),
+        }, 5
+    }, {
+        /* Inner and outer checksums requested separately */
+        "host_pf", 1, 3, {
+            A(RX_HOST, RX_HOST_MTU, 0), A(CHECKSUM, CSUM_I, 0),
+            A(CHECKSUM, CSUM_I | CSUM_O, 0), A(TX_WIRE, 0, 0),
+        }, 4
+    }, {
+        /* Updates merged into a later CHECKSUM that also validates */
+        "host_csum_merge", 1, 3, {
+            A(RX_HOST, RX_HOST_MTU, 0), A(CHECKSUM, CSUM_O, 0),
+            A(CHECKSUM, CSUM_O | CSUM_VAL, 0), A(TX_WIRE, 0, 0),
+        }, 4
+    }, {
+        /* Source MAC check ahead of the VLAN insert */
+        "host_vf", 1, 5, {
+            A(RX_HOST, RX_HOST_MTU, 0), SRC_MAC, A(PUSH_VLAN, 0x0005, 0),
+            A(CHECKSUM, CSUM_I | CSUM_O, 0), A(TX_WIRE, 0, 0),
+        }, 5
+    }, {
+        /* VLAN strip, RSS and MAC match out of code order */
+        "wire_vf", 0, 7, {
+            A(RX_WIRE, 0, 0), A(POP_VLAN, 0, 0), A(RSS, 0xf03f, 0x6d5a56da),
+            DST_MAC, A(CHECKSUM, CSUM_O, 0),
+            A(TX_HOST, TX_CONTINUE, 0), A(DROP, 0, 0),
+        }, 7
+    }, {
+        /* Symmetric Toeplitz RSS moves like the CRC-32 one */
+        "wire_vf_toeplitz", 0, 7, {
+            A(RX_WIRE, 0, 0), A(POP_VLAN, 0, 0),
+            A3(RSS, 0xf03f, 0x6d5a56da, 0x3), DST_MAC,
+            A(CHECKSUM, CSUM_O, 0), A(TX_HOST, TX_CONTINUE, 0),
+            A(DROP, 0, 0),
+        }, 7
+    },
+};
+
+/* Lists that are already optimal and must be left as they are */
+static const struct test_list lists_kept[] = {
+    {
+        /* POP_VLAN -> PUSH_VLAN rewrites the tag */
+        "vlan_rewrite", 0, 5, {
+            A(RX_WIRE, 0, 0), A(POP_VLAN, 0, 0), A(PUSH_VLAN, 0x0007, 0),
+            A(CHECKSUM, CSUM_META, 0), A(TX_HOST, 0, 0),
+        }, 5
+    }, {
+        /* Metadata order of RSS and CHECKSUM_COMPLETE is kept */
+        "meta_order", 0, 4, {
+            A(RX_WIRE, 0, 0), A(RSS, 0xf03f, 0x6d5a56da),
+            A(CHECKSUM, CSUM_META, 0), A(TX_HOST, 0, 0),
+        }, 4
+    }, {
+        /* Validation without CHECKSUM_COMPLETE, as on a non-VEB PF */
+        "wire_pf_csum_val", 0, 5, {
+            A(RX_WIRE, 0, 0), DST_MAC, A(CHECKSUM, CSUM_VAL, 0),
+            A(RSS, 0xf03f, 0x6d5a56da), A(TX_HOST, 0, 0),
+        }, 5
+    }, {
+        /* CRC32c of SCTP only, as on a non-VEB PF */
+        "host_pf_sctp", 1, 3, {
+            A(RX_HOST, RX_HOST_MTU, 0), A(CHECKSUM, CSUM_SCTP, 0),
+            A(TX_WIRE, 0, 0),
+        }, 3
+    }, {
+        /* Validation ahead of updates is not merged into them */
+        "host_csum_val", 1, 4, {
+            A(RX_HOST, RX_HOST_MTU, 0), A(CHECKSUM, CSUM_VAL, 0),
+            A(CHECKSUM, CSUM_VAL | CSUM_O, 0), A(TX_WIRE, 0, 0),
+        }, 4
+    },
+};
+
+/* Verification key of the Microsoft RSS specification */
+static const uint32_t rss_key[NM_RSS_KEY_LW] = {
+    0x6d5a56da, 0x255b0ec2, 0x4167253d, 0x43a38fb0, 0xd0ca2bcb,
+    0xae7b30b4, 0x77cb2da3, 0x8030f20c, 0x6a42b73b, 0xbeac01fa,
+};
+
+static uint8_t frames[8][128];
+static uint32_t frame_lens[8];
+static uint32_t num_frames;
+static struct nm_config config_orig;
+static struct nm_config config_opt;
+static struct nm_pkt pkt_orig;
+static struct nm_pkt pkt_opt;
+
+
+/**
+ * Append an Ethernet / IPv4 / L4 frame to the test frames.
+ */
+static void
+add_frame(uint32_t dst_hi, uint32_t dst_lo, int vlan, uint8_t l4_proto)
+{
+    uint8_t *f = frames[num_frames];
+    uint32_t len = 0;
+    uint32_t i;
+
+    f[len++] = dst_hi >> 8;
+    f[len++] = dst_hi;
+    for (i = 0; i < 4; i++)
+        f[len++] = dst_lo >> (24 - 8 * i);
+    f[len++] = MAC_PEER_HI >> 8;
+    f[len++] = MAC_PEER_HI & 0xff;
+    for (i = 0; i < 4; i++)
+        f[len++] = MAC_PEER_LO >> (24 - 8 * i);
+
+    if (vlan) {
+        f[len++] = 0x81;
+        f[len++] = 0x00;
+        f[len++] = vlan >> 8;
+        f[len++] = vlan;
+    }
+    f[len++] = 0x08;
+    f[len++] = 0x00;
+
+    /* IPv4, no options, 64 bytes of payload */
+    f[len++] = 0x45;
+    f[len++] = 0;
+    f[len++] = 0;
+    f[len++] = 20 + 64;
+    for (i = 0; i < 4; i++)
+        f[len++] = 0;
+    f[len++] = 64;
+    f[len++] = l4_proto;
+    f[len++] = 0;
+    f[len++] = 0;
+    for (i = 0; i < 8; i++)
+        f[len++] = (i < 4) ? 10 + i : 20 + i;
+
+    for (i = 0; i < 64; i++)
+        f[len++] = i * 7 + num_frames;
+
+    frame_lens[num_frames++] = len;
+}
+
+
+/**
+ * Encode a decoded list into instruction words as cfg_act_append does.
+ */
+static void
+encode(const struct cfg_act_opt *opt, struct nm_action_list *list)
+{
+    uint32_t i;
+    uint32_t w = 0;
+
+    memset(list, 0, sizeof(*list));
+
+    for (i = 0; i < opt->count; i++) {
+        list->instr[w] = cfg_act_map[opt->op[i]] << INSTR_OPCODE_LSB;
+        if (i && cfg_act_opt_pipelined(opt->op[i - 1], opt->op[i]))
+            list->instr[w] |= 1 << INSTR_PIPELINE_BIT;
+        list->instr[w++] |= opt->args[i] & 0xffff;
+
+        if (cfg_act_opt_words(opt->op[i]) >= 2)
+            list->instr[w++] = opt->param[i];
+        if (cfg_act_opt_words(opt->op[i]) == 3)
+            list->instr[w++] = opt->param2[i];
+    }
+    list->num_words = w;
+}
+
+
+static void
+config_init(struct nm_config *cfg, const struct cfg_act_opt *opt)
+{
+    uint32_t i;
+
+    memset(cfg, 0, sizeof(*cfg));
+    for (i = 0; i < NM_NUM_OPS; i++)
+        cfg->op_map[i] = cfg_act_map[i];
+    cfg->num_op_map = NM_NUM_OPS;
+    for (i = 0; i < NFP_NET_CFG_RSS_ITBL_SZ; i++)
+        cfg->rss_tbl[i] = i % 8;
+    cfg->rss_tbl_entries = NFP_NET_CFG_RSS_ITBL_SZ;
+    memcpy(cfg->rss_key, rss_key, sizeof(rss_key));
+    cfg->ingress_csum = 0xf;
+
+    encode(opt, &cfg->ingress);
+}
+
+
+static int
+pkt_equal(const struct nm_pkt *a, const struct nm_pkt *b)
+{
+    return (a->length == b->length &&
+            !memcmp(NM_PKT_DATA(a), NM_PKT_DATA(b), a->length) &&
+            a->proto == b->proto && a->hdr_stack == b->hdr_stack &&
+            a->csum_offload == b->csum_offload &&
+            a->vlan_id == b->vlan_id && a->meta_len == b->meta_len &&
+            a->hash == b->hash && a->queue_offset == b->queue_offset &&
+            a->queue_selected == b->queue_selected);
+}
+
+
+static int
+stats_equal(const struct nm_stats *a, const struct nm_stats *b)
+{
+    return (!memcmp(a->drops, b->drops, sizeof(a->drops)) &&
+            a->tx_host == b->tx_host && a->tx_wire == b->tx_wire &&
+            a->tx_cmsg == b->tx_cmsg && a->tx_ebpf == b->tx_ebpf);
+}
+
+
+/**
+ * Optimise a list and compare both versions over all test frames.
+ *
+ * @return 0 on success, 1 on failure
+ */
+static int
+test_list(const struct test_list *t, int expect_change)
+{
+    struct cfg_act_opt orig, opt;
+    struct nm_stats stats_orig, stats_opt;
+    uint32_t changes;
+    uint32_t i;
+    int rc_orig, rc_opt;
+
+    memset(&orig, 0, sizeof(orig));
+    for (i = 0; i < t->count; i++) {
+        orig.op[i] = t->acts[i].op;
+        orig.args[i] = t->acts[i].args;
+        orig.param[i] = t->acts[i].param;
+        orig.param2[i] = t->acts[i].param2;
+    }
+    orig.count = t->count;
+
+    opt = orig;
+    changes = cfg_act_opt_run(&opt);
+
+    if (!expect_change && (changes || memcmp(&opt, &orig, sizeof(opt)))) {
+        fprintf(stderr, "%s: optimiser changed an optimal list\n", t->name);
+        return 1;
+    }
+    if (opt.count != t->count_opt) {
+        fprintf(stderr, "%s: %u actions after optimisation, expected %u\n",
+                t->name, opt.count, t->count_opt);
+        return 1;
+    }
+
+    config_init(&config_orig, &orig);
+    config_init(&config_opt, &opt);
+    memset(&stats_orig, 0, sizeof(stats_orig));
+    memset(&stats_opt, 0, sizeof(stats_opt));
+
+    for (i = 0; i < num_frames; i++) {
+        nm_pkt_init(&pkt_orig, frames[i], frame_lens[i], t->from_host);
+        nm_pkt_init(&pkt_opt, frames[i], frame_lens[i], t->from_host);
+
+        rc_orig = nm_execute(&pkt_orig, &config_orig, &stats_orig);
+        rc_opt = nm_execute(&pkt_opt, &config_opt, &stats_opt);
+
+        /* The state of a dropped packet does not matter */
+        if (rc_orig != rc_opt || !stats_equal(&stats_orig, &stats_opt) ||
+            (rc_orig == 0 && !pkt_equal(&pkt_orig, &pkt_opt))) {
+            fprintf(stderr, "%s: frame %u handled differently\n",
+                    t->name, i);
+            return 1;
+        }
+    }
+
+    if (stats_opt.pipeline_mismatch) {
+        fprintf(stderr, "%s: pipeline bit set on a mismatched handler\n",
+                t->name);
+        return 1;
+    }
+
+    if (expect_change && stats_opt.dispatches >= stats_orig.dispatches) {
+        fprintf(stderr, "%s: %llu dispatches after optimisation, "
+                "%llu before\n", t->name,
+                (unsigned long long) stats_opt.dispatches,
+                (unsigned long long) stats_orig.dispatches);
+        return 1;
+    }
+
+    printf("%-16s dispatches %3llu -> %3llu\n", t->name,
+           (unsigned long long) stats_orig.dispatches,
+           (unsigned long long) stats_opt.dispatches);
+
+    return 0;
+}
+
+
+/**
+ * Check nm_toeplitz against the IPv4 verification values of the Microsoft
+ * RSS specification, hashed with and without the ports.
+ *
+ * @return 0 on success, 1 on failure
+ */
+static int
+test_toeplitz(void)
+{
+    static const struct {
+        uint32_t tuple[3];
+        uint32_t hash_l4;
+        uint32_t hash_l3;
+    } vectors[] = {
+        { { 0x420995bb, 0xa18e6450, 0x0aea06e6 }, 0x51ccc178, 0x323e8fc2 },
+        { { 0xc75c6f02, 0x41458c53, 0x37961283 }, 0xc626b0ea, 0xd718262a },
+        { { 0x1813c65f, 0x0c16cfb8, 0x32629488 }, 0x5c2b394a, 0xd2d0a5de },
+        { { 0x261bcd1e, 0xd18ea306, 0xbc6408a9 }, 0xafc7327f, 0x82989176 },
+        { { 0x9927a3bf, 0xcabc7f02, 0xacdb0517 }, 0x10e828a2, 0x5d1809c5 },
+    };
+    uint32_t i;
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        if (nm_toeplitz(rss_key, vectors[i].tuple, 3) != vectors[i].hash_l4 ||
+            nm_toeplitz(rss_key, vectors[i].tuple, 2) != vectors[i].hash_l3) {
+            fprintf(stderr, "toeplitz: vector %u hashed wrongly\n", i);
+            return 1;
+        }
+    }
+
+    printf("%-16s %u vectors\n", "toeplitz", i);
+
+    return 0;
+}
+
+
+/**
+ * Check that the longest list of cfg_act_build_veb_vf, a promiscuous PF
+ * with BPF, RSS and CHECKSUM_COMPLETE behind a VF with a VLAN and an ACL,
+ * fits a flow cache entry after optimisation, so cfg_act_write_veb does
+ * not chain it.
+ *
+ * @return 0 on success, 1 on failure
+ */
+static int
+test_veb_vf_len(void)
+{
+    static const struct test_act acts[] = {
+        A(PUSH_PKT, 0, 0), A(POP_VLAN, 0, 0), A(ACL, 0x0047, 0),
+        A(CHECKSUM, CSUM_I | CSUM_O | CSUM_META, 0),
+        A(TX_HOST, TX_CONTINUE, 0), A(POP_PKT, 0, 0),
+        A(CHECKSUM, CSUM_META, 0), A(EBPF, 0, 0),
+        A(RSS, 0xf03f, 0x6d5a56da), A(TX_HOST, 0, 0),
+    };
+    struct cfg_act_opt opt;
+    struct nm_action_list list;
+    uint32_t i;
+
+    memset(&opt, 0, sizeof(opt));
+    for (i = 0; i < sizeof(acts) / sizeof(acts[0]); i++) {
+        opt.op[i] = acts[i].op;
+        opt.args[i] = acts[i].args;
+        opt.param[i] = acts[i].param;
+        opt.param2[i] = acts[i].param2;
+    }
+    opt.count = i;
+
+    cfg_act_opt_run(&opt);
+    encode(&opt, &list);
+
+    if (list.num_words > FLOW_CACHE_LIST_LW) {
+        fprintf(stderr, "veb_vf_len: %u words, the flow cache holds %u\n",
+                list.num_words, FLOW_CACHE_LIST_LW);
+        return 1;
+    }
+
+    printf("%-16s %u words\n", "veb_vf_len", list.num_words);
+
+    return 0;
+}
+
+
+/**
+ * Lay out a decoded list as cfg_act_chain does, with segment 1 ending by
+ * word @head. Segments 0 and 1 go to @list, the others to the blocks of
+ * @cfg at CLS address @ext.
+ *
+ * @return the number of words, 0 if the list does not fit
+ */
+static uint32_t
+encode_chain(const struct cfg_act_opt *opt, uint32_t head, uint32_t ext,
+             struct nm_action_list *list, struct nm_config *cfg)
+{
+    uint32_t instr[NIC_MAX_INSTR_CHAIN];
+    uint32_t chain_idx[NIC_MAX_INSTR_CHAIN / NIC_INSTR_SEG];
+    uint32_t num_chain = 0;
+    uint32_t prev = NM_NUM_OPS;
+    uint32_t remain = 0;
+    uint32_t i, w, words, num_seg;
+
+    for (i = 0; i < opt->count; i++)
+        remain += cfg_act_opt_words(opt->op[i]);
+
+    memset(instr, 0, sizeof(instr));
+    for (i = 0, w = 0; i < opt->count; i++) {
+        words = cfg_act_opt_words(opt->op[i]);
+
+        if (cfg_act_opt_seg_end(w, words, remain, head)) {
+            chain_idx[num_chain++] = w;
+            instr[w] = cfg_act_map[INSTR_CHAIN] << INSTR_OPCODE_LSB;
+            if (cfg_act_opt_pipelined(prev, INSTR_CHAIN))
+                instr[w] |= 1 << INSTR_PIPELINE_BIT;
+            prev = INSTR_CHAIN;
+            w = (w / NIC_INSTR_SEG + 1) * NIC_INSTR_SEG;
+        }
+
+        if (w + words > NIC_MAX_INSTR_CHAIN)
+            return 0;
+
+        instr[w] = cfg_act_map[opt->op[i]] << INSTR_OPCODE_LSB;
+        if (cfg_act_opt_pipelined(prev, opt->op[i]))
+            instr[w] |= 1 << INSTR_PIPELINE_BIT;
+        instr[w++] |= opt->args[i] & 0xffff;
+        if (words >= 2)
+            instr[w++] = opt->param[i];
+        if (words == 3)
+            instr[w++] = opt->param2[i];
+        prev = opt->op[i];
+        remain -= words;
+    }
+
+    num_seg = (w + NIC_INSTR_SEG - 1) / NIC_INSTR_SEG;
+    for (i = 0; i < num_chain; i++) {
+        if (i > 0)
+            instr[chain_idx[i]] |= CFG_ACT_OPT_BIT(INSTR_CHAIN_JOIN_bf);
+        if (i + 2 < num_seg)
+            instr[chain_idx[i]] |= (ext + i * NIC_INSTR_SEG * 4) |
+                                   CFG_ACT_OPT_BIT(INSTR_CHAIN_FETCH_bf);
+    }
+
+    memset(list, 0, sizeof(list->instr));
+    memcpy(list->instr, instr, NIC_MAX_INSTR * 4);
+    list->num_words = (w < NIC_MAX_INSTR) ? w : NIC_MAX_INSTR;
+    for (i = NIC_MAX_INSTR; i < w; i += NIC_MAX_INSTR) {
+        memset(&cfg->ext[cfg->num_ext], 0, sizeof(cfg->ext[0]));
+        memcpy(cfg->ext[cfg->num_ext].instr, &instr[i], NIC_MAX_INSTR * 4);
+        cfg->ext[cfg->num_ext].addr = ext + (i - NIC_MAX_INSTR) * 4;
+        cfg->ext[cfg->num_ext++].num_words = NIC_MAX_INSTR;
+    }
+
+    return w;
+}
+
+
+/**
+ * Check a VEB list longer than a flow cache entry, the list of
+ * test_veb_vf_len with a METER and a SAMPLE added. It is chained with
+ * segment 1 ending before the cache tag, and every frame is handled the
+ * same whether the list is read from the map or from the flow cache,
+ * whose tag overwrites the words after FLOW_CACHE_LIST_LW.
+ *
+ * @return 0 on success, 1 on failure
+ */
+static int
+test_veb_chain(void)
+{
+    static const struct test_act acts[] = {
+        A(PUSH_PKT, 0, 0), A(POP_VLAN, 0, 0), A(METER, 0x0003, 0),
+        A(SAMPLE, 128, 0x00ffffff), A(ACL, 0x0047, 0),
+        A(CHECKSUM, CSUM_I | CSUM_O | CSUM_META, 0),
+        A(TX_HOST, TX_CONTINUE, 0), A(POP_PKT, 0, 0),
+        A(CHECKSUM, CSUM_META, 0), A(EBPF, 0, 0),
+        A(RSS, 0xf03f, 0x6d5a56da), A(TX_HOST, 0, 0),
+    };
+    static const struct test_act ingress[] = {
+        A(RX_HOST, RX_HOST_MTU, 0),
+        A(VEB_LOOKUP, MAC_PEER_HI, MAC_PEER_LO),
+        A(TX_WIRE, 0, 0),
+    };
+    const uint32_t ext = 0x4000;       /* extension blocks, any set */
+    struct cfg_act_opt opt;
+    struct nm_stats stats_map, stats_cache;
+    uint32_t i, words;
+    int rc_map, rc_cache;
+
+    memset(&opt, 0, sizeof(opt));
+    for (i = 0; i < sizeof(ingress) / sizeof(ingress[0]); i++) {
+        opt.op[i] = ingress[i].op;
+        opt.args[i] = ingress[i].args;
+        opt.param[i] = ingress[i].param;
+    }
+    opt.count = i;
+    config_init(&config_orig, &opt);
+
+    memset(&opt, 0, sizeof(opt));
+    for (i = 0; i < sizeof(acts) / sizeof(acts[0]); i++) {
+        opt.op[i] = acts[i].op;
+        opt.args[i] = acts[i].args;
+        opt.param[i] = acts[i].param;
+        opt.param2[i] = acts[i].param2;
+    }
+    opt.count = i;
+    cfg_act_opt_run(&opt);
+
+    /* One entry per VLAN of the test frames, as cfg_act_write_veb writes */
+    words = encode_chain(&opt, FLOW_CACHE_LIST_LW, ext, &config_orig.veb[0],
+                         &config_orig);
+    if (words <= FLOW_CACHE_LIST_LW) {
+        fprintf(stderr, "veb_chain: %u words, not chained\n", words);
+        return 1;
+    }
+    config_orig.veb[0].mac = ((uint64_t) MAC_PORT_HI << 32) | MAC_PORT_LO;
+    config_orig.veb[0].vlan_id = NM_NULL_VLAN;
+    config_orig.veb[1] = config_orig.veb[0];
+    config_orig.veb[1].vlan_id = 5;
+    config_orig.num_veb = 2;
+
+    /* flow_cache_insert writes the tag over the words after the list */
+    config_opt = config_orig;
+    for (i = 0; i < config_opt.num_veb; i++) {
+        config_opt.veb[i].instr[FLOW_CACHE_LIST_LW] =
+            config_opt.veb[i].vlan_id << 20 | 1 << FLOW_CACHE_VALID_bit |
+            MAC_PORT_HI;
+        config_opt.veb[i].instr[FLOW_CACHE_LIST_LW + 1] = MAC_PORT_LO;
+        config_opt.veb[i].instr[FLOW_CACHE_LIST_LW + 2] = 0x5a5a5a5a;
+    }
+
+    memset(&stats_map, 0, sizeof(stats_map));
+    memset(&stats_cache, 0, sizeof(stats_cache));
+    for (i = 0; i < num_frames; i++) {
+        nm_pkt_init(&pkt_orig, frames[i], frame_lens[i], 1);
+        nm_pkt_init(&pkt_opt, frames[i], frame_lens[i], 1);
+
+        rc_map = nm_execute(&pkt_orig, &config_orig, &stats_map);
+        rc_cache = nm_execute(&pkt_opt, &config_opt, &stats_cache);
+
+        if (rc_map != rc_cache || !stats_equal(&stats_map, &stats_cache) ||
+            (rc_map == 0 && !pkt_equal(&pkt_orig, &pkt_opt))) {
+            fprintf(stderr, "veb_chain: frame %u handled differently from "
+                    "the flow cache\n", i);
+            return 1;
+        }
+    }
+
+    if (!stats_map.chain_fetches || !stats_map.invocations[INSTR_RSS] ||
+        stats_map.drops[NM_DROP_INVALID]) {
+        fprintf(stderr, "veb_chain: chained list not run to its end\n");
+        return 1;
+    }
+
+    printf("%-16s %u words\n", "veb_chain", words);
+
+    return 0;
+}
+
+
+int
+main(void)
+{
+    int failed = 0;
+    uint32_t i;
+
+    add_frame(MAC_PORT_HI, MAC_PORT_LO, 0, 6);         /* unicast TCP */
+    add_frame(MAC_PORT_HI, MAC_PORT_LO, 0, 17);        /* unicast UDP */
+    add_frame(0x0100, 0x5e000001, 0, 17);              /* multicast */
+    add_frame(0xffff, 0xffffffff, 0, 17);              /* broadcast */
+    add_frame(MAC_PORT_HI, MAC_PORT_LO + 1, 0, 6);     /* other MAC */
+    add_frame(MAC_PORT_HI, MAC_PORT_LO, 5, 6);         /* VLAN tagged */
+    add_frame(MAC_PORT_HI, MAC_PORT_LO, 5, 17);
+    add_frame(MAC_PORT_HI, MAC_PORT_LO + 1, 5, 17);
+
+    failed |= test_toeplitz();
+    failed |= test_veb_vf_len();
+    failed |= test_veb_chain();
+
+    for (i = 0; i < sizeof(lists) / sizeof(lists[0]); i++)
+        failed |= test_list(&lists[i], 1);
+
+    for (i = 0; i < sizeof(lists_kept) / sizeof(lists_kept[0]); i++)
+        failed |= test_list(&lists_kept[i], 0);
+
+    if (failed) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
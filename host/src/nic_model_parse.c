@@ -0,0 +1,649 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_parse.c
+ * @brief  Packet vector initialisation, pv_seek, header parse and MAC
+ *         checksum status model.
+ *
+ * The header parser below is a line by line transcription of
+ * pv_hdr_parse_subroutine in firmware/apps/nic/pv.uc, including its
+ * shortcuts (e.g. the UDP destination port is read from the aligned
+ * word at the L4 offset), so that the resulting PV_PROTO and
+ * PV_HEADER_STACK values match what the workers compute.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nic_model.h"
+
+#include <string.h>
+
+#define NM_ETH_TYPE_IPV4        0x0800
+#define NM_ETH_TYPE_IPV6        0x86dd
+#define NM_ETH_TYPE_TPID        0x8100
+#define NM_ETH_TYPE_SVLAN       0x88a8
+#define NM_ETH_TYPE_MPLS        0x8847
+#define NM_ETH_TYPE_TEB         0x6558
+
+#define NM_IP_PROTO_HOPOPT      0
+#define NM_IP_PROTO_TCP         6
+#define NM_IP_PROTO_UDP         17
+#define NM_IP_PROTO_ROUTING     43
+#define NM_IP_PROTO_FRAG        44
+#define NM_IP_PROTO_GRE         47
+#define NM_IP_PROTO_DSTOPTS     60
+
+#define NM_GENEVE_PORT          0x17c1
+#define NM_MPLS_UDP_PORT        6635
+#define NM_GTPU_PORT            2152
+#define NM_GTPU_MSG_GPDU        0xff
+
+#define NM_ETHERNET_SIZE        14
+#define NM_IPV6_HDR_SIZE        40
+#define NM_UDP_HDR_SIZE         8
+#define NM_VXLAN_SIZE           8
+#define NM_NVGRE_SIZE           4
+#define NM_GENEVE_SIZE          8
+#define NM_GTPU_SIZE            8
+#define NM_GTPU_OPT_SIZE        4
+#define NM_MPLS_LABEL_SIZE      4
+#define NM_VLAN_SIZE            4
+
+/* PV_HDR_PARSE_MAX_OFFSET and PV_MPLS_MAX_LABELS in pv.uc */
+#define NM_HDR_PARSE_MAX_OFFSET (0xff - 60)
+#define NM_MPLS_MAX_LABELS      8
+
+/* PV_SEEK_BASE_bf is 8 bits wide at bit 6, PV_SEEK_BASE_INVALID sets all */
+#define NM_SEEK_BASE(x)         (((x) >> 6) & 0xff)
+#define NM_SEEK_BASE_INVALID    (0xff << 6)
+
+
+/**
+ * nm_pkt_byte
+ * Read a frame byte, returning zero past the end of the packet where the
+ * firmware would read whatever stale data follows the packet.
+ */
+static uint32_t
+nm_pkt_byte(const struct nm_pkt *pkt, uint32_t offset)
+{
+    if (offset >= pkt->length)
+        return 0;
+
+    return pkt->buf[pkt->offset + offset];
+}
+
+
+static uint32_t
+nm_pkt_be16(const struct nm_pkt *pkt, uint32_t offset)
+{
+    return (nm_pkt_byte(pkt, offset) << 8) | nm_pkt_byte(pkt, offset + 1);
+}
+
+
+int
+nm_pkt_init(struct nm_pkt *pkt, const uint8_t *frame, uint32_t length,
+            int from_host)
+{
+    if (length > NM_MAX_PKT_SIZE)
+        return -1;
+
+    pkt->offset = NM_PKT_HEADROOM;
+    memcpy(NM_PKT_DATA(pkt), frame, length);
+
+    pkt->length = length;
+    pkt->ctm_size = from_host ? NM_CTM_SIZE_NFD : NM_CTM_SIZE_NBI;
+    pkt->proto = NM_PROTO_UNKNOWN;
+    pkt->hdr_stack = 0;
+    pkt->csum_offload = 0;
+    pkt->tx_flags = 0;
+    pkt->vlan_id = NM_NULL_VLAN;
+    pkt->queue_offset = 0;
+    pkt->queue_selected = 0;
+    pkt->seek_base = NM_SEEK_BASE_INVALID;
+    pkt->hdr_cached = 0;
+    /* NFD packets only get a CTM buffer once RX_HOST has run */
+    pkt->ctm_allocated = !from_host;
+    pkt->meta_len = 0;
+    pkt->hash = 0;
+    pkt->from_host = from_host;
+
+    /* __pv_get_mac_dst_type */
+    pkt->mac_dst_mc = nm_pkt_byte(pkt, 0) & 1;
+    pkt->mac_dst_bc = (nm_pkt_be16(pkt, 0) == 0xffff &&
+                       nm_pkt_be16(pkt, 2) == 0xffff &&
+                       nm_pkt_be16(pkt, 4) == 0xffff);
+
+    return 0;
+}
+
+
+void
+nm_invalidate_cache(struct nm_pkt *pkt)
+{
+    pkt->seek_base |= NM_SEEK_BASE_INVALID;
+}
+
+
+void
+nm_seek(struct nm_pkt *pkt, uint32_t offset, uint32_t flags,
+        struct nm_stats *stats)
+{
+    uint32_t aligned;
+    uint32_t read_offset;
+
+    if (!(flags & NM_SEEK_PAD_INCLUDED))
+        offset += 2;
+
+    if (stats)
+        stats->seeks++;
+
+    if (flags & NM_SEEK_T_INDEX_ONLY)
+        return;
+
+    if (!(flags & NM_SEEK_INIT) &&
+        NM_SEEK_BASE(pkt->seek_base) == NM_SEEK_BASE(offset))
+        return;
+
+    /* pv_seek_subroutine: read 128B at the 64B aligned offset less pad */
+    aligned = offset & ~(NM_SEEK_ALIGN - 1);
+    read_offset = aligned - 2;
+    pkt->seek_base = aligned;
+
+    if (!stats)
+        return;
+
+    stats->seek_fetches++;
+    if (!pkt->ctm_allocated) {
+        stats->mem_reads[NM_MEM_EMEM]++;
+    } else if (pkt->length <= pkt->ctm_size ||
+               (int) (pkt->ctm_size - read_offset) >= NM_SEEK_WINDOW) {
+        stats->mem_reads[NM_MEM_CTM]++;
+    } else if ((int) (pkt->ctm_size - read_offset) <= 0) {
+        stats->mem_reads[NM_MEM_EMEM]++;
+    } else {
+        /* straddled: CTM part, MU part and a reflect to merge the word */
+        stats->mem_reads[NM_MEM_CTM]++;
+        stats->mem_reads[NM_MEM_EMEM]++;
+        stats->mem_writes[NM_MEM_CTM]++;
+    }
+}
+
+
+int
+nm_read_ahead(struct nm_pkt *pkt, uint32_t offset, struct nm_stats *stats)
+{
+    uint32_t read_offset = offset - 2;
+
+    if (!pkt->ctm_allocated || (pkt->length > pkt->ctm_size &&
+                                (int) (pkt->ctm_size - read_offset) <= 0)) {
+        stats->mem_reads[NM_MEM_EMEM]++;
+    } else if (pkt->length <= pkt->ctm_size ||
+               (int) (pkt->ctm_size - read_offset) >= NM_SEEK_ALIGN) {
+        stats->mem_reads[NM_MEM_CTM]++;
+    } else {
+        return -1;
+    }
+
+    stats->read_aheads++;
+    return 0;
+}
+
+
+/**
+ * nm_parse_tunnel_port
+ * The UDP destination port as check_tunnel# reads it: the low half of the
+ * window word holding the L4 offset, which is only exact because the outer
+ * L4 header always starts two bytes before a word boundary.
+ */
+static uint32_t
+nm_parse_tunnel_port(const struct nm_pkt *pkt, uint32_t pkt_offset)
+{
+    return nm_pkt_be16(pkt, (pkt_offset + 2) & ~3);
+}
+
+
+void
+nm_hdr_parse(struct nm_pkt *pkt, uint32_t rx_args,
+             const struct nm_config *cfg, struct nm_stats *stats)
+{
+    uint32_t eth_type;
+    uint32_t hdr_len;
+    uint32_t hdr_stack;
+    uint32_t label;
+    uint32_t n_vxlan;
+    uint32_t next_hdr;
+    uint32_t pkt_offset = NM_ETHERNET_SIZE;
+    uint32_t port;
+    uint32_t i;
+
+    pkt->hdr_stack = 0;
+    pkt->proto = 0;
+
+check_eth_type:
+    /* All loops below advance pkt_offset; stop at the end of the packet
+     * rather than parse whatever follows it in the buffer. */
+    if (pkt_offset > pkt->length)
+        goto unknown_proto;
+    eth_type = nm_pkt_be16(pkt, pkt_offset - 2);
+
+check_ip:
+    if (eth_type == NM_ETH_TYPE_IPV6)
+        goto parse_ipv6;
+    if (eth_type == NM_ETH_TYPE_IPV4)
+        goto parse_ipv4;
+    if (eth_type == NM_ETH_TYPE_TPID || eth_type == NM_ETH_TYPE_SVLAN) {
+        pkt_offset += NM_VLAN_SIZE;
+        goto seek_eth_type;
+    }
+    if (eth_type != NM_ETH_TYPE_MPLS)
+        goto unknown_proto;
+    /* PV_PROTO has no class for MPLS after a tunnel */
+    if (NM_HDR_OUTER_IP(pkt->hdr_stack))
+        goto unknown_proto;
+
+    pkt->proto |= NM_PROTO_MPLS;
+
+mpls:
+    hdr_len = pkt_offset + NM_MPLS_LABEL_SIZE * NM_MPLS_MAX_LABELS;
+    for (;;) {
+        label = ((nm_pkt_be16(pkt, pkt_offset) << 16) |
+                 nm_pkt_be16(pkt, pkt_offset + 2));
+        pkt_offset += NM_MPLS_LABEL_SIZE;
+        if (label & (1 << 8))
+            break;
+        if (pkt_offset >= hdr_len || pkt_offset >= pkt->length)
+            goto done;
+    }
+    if (pkt_offset > NM_HDR_PARSE_MAX_OFFSET)
+        goto done;
+    /* IPv4 and IPv6 explicit null labels, if configured other labels by
+     * the IP version of the payload */
+    label >>= 12;
+    if (label == 0) {
+        eth_type = NM_ETH_TYPE_IPV4;
+    } else if (label == 2) {
+        eth_type = NM_ETH_TYPE_IPV6;
+    } else if (NM_BF_GET(&rx_args, INSTR_RX_PARSE_MPLS_IP_bf)) {
+        label = nm_pkt_byte(pkt, pkt_offset) >> 4;
+        if (label == 4)
+            eth_type = NM_ETH_TYPE_IPV4;
+        else if (label == 6)
+            eth_type = NM_ETH_TYPE_IPV6;
+        else
+            goto done;
+    } else {
+        goto done;
+    }
+
+    /* MPLS over UDP, the IP header is the inner one */
+    if (NM_HDR_INNER_L4(pkt->hdr_stack)) {
+        pkt->proto = (pkt->proto << NM_PROTO_ENCAP_SHF) & 0xff;
+        pkt->hdr_stack <<= 16;
+    }
+    goto check_ip;
+
+parse_ipv6:
+    pkt->hdr_stack = (pkt->hdr_stack & ~0xff00) | ((pkt_offset & 0xff) << 8);
+    next_hdr = nm_pkt_byte(pkt, pkt_offset + 6);
+    hdr_len = NM_IPV6_HDR_SIZE;
+
+    for (;;) {
+        pkt_offset += hdr_len;
+
+        if (next_hdr == NM_IP_PROTO_UDP)
+            goto parse_ipv6_udp;
+
+        if (next_hdr == NM_IP_PROTO_TCP) {
+            pkt->hdr_stack = (pkt->hdr_stack & ~0xff) | (pkt_offset & 0xff);
+            goto done;
+        }
+
+        if (next_hdr == NM_IP_PROTO_FRAG) {
+            pkt->proto |= NM_PROTO_IPV6_FRAGMENT;
+            goto done;
+        }
+
+        if (next_hdr == NM_IP_PROTO_GRE)
+            goto gre;
+
+        if (next_hdr != NM_IP_PROTO_HOPOPT &&
+            next_hdr != NM_IP_PROTO_DSTOPTS &&
+            next_hdr != NM_IP_PROTO_ROUTING) {
+            pkt->proto |= NM_PROTO_IPV6_UNKNOWN;
+            goto done;
+        }
+
+        /* skip_ipv6_ext#: hdr length = "Hdr Ext Len" * 8 + 8 */
+        nm_seek(pkt, pkt_offset, NM_SEEK_DEFAULT, stats);
+        if (pkt_offset >= pkt->length) {
+            pkt->proto |= NM_PROTO_IPV6_UNKNOWN;
+            goto done;
+        }
+        hdr_len = nm_pkt_byte(pkt, pkt_offset + 1) * 8 + 8;
+        next_hdr = nm_pkt_byte(pkt, pkt_offset);
+
+        /* the next header must fit the 8 bit PV_HEADER_STACK offsets */
+        if (pkt_offset + hdr_len > 0xff) {
+            pkt->proto |= NM_PROTO_IPV6_UNKNOWN;
+            goto done;
+        }
+    }
+
+parse_ipv4:
+    pkt->hdr_stack = (pkt->hdr_stack & ~0xff00) | ((pkt_offset & 0xff) << 8);
+    hdr_len = (nm_pkt_byte(pkt, pkt_offset) & 0xf) << 2;
+    pkt->proto |= NM_PROTO_IPV4;
+
+    /* fragment if more fragments flag or fragment offset is set */
+    if (nm_pkt_be16(pkt, pkt_offset + 6) & 0x3fff) {
+        pkt->proto |= NM_PROTO_FRAG;
+        goto done;
+    }
+
+    next_hdr = nm_pkt_byte(pkt, pkt_offset + 9);
+    pkt_offset += hdr_len;
+
+    if (next_hdr == NM_IP_PROTO_UDP) {
+        pkt->hdr_stack = (pkt->hdr_stack & ~0xff) | (pkt_offset & 0xff);
+        pkt->proto |= NM_PROTO_UDP;
+        if (NM_HDR_OUTER_IP(pkt->hdr_stack))
+            return;
+        goto check_tunnel;
+    }
+
+    if (next_hdr == NM_IP_PROTO_TCP) {
+        pkt->hdr_stack = (pkt->hdr_stack & ~0xff) | (pkt_offset & 0xff);
+        goto done;
+    }
+
+    if (next_hdr == NM_IP_PROTO_GRE)
+        goto gre;
+
+    pkt->proto |= NM_PROTO_L4_UNKNOWN;
+    goto done;
+
+parse_ipv6_udp:
+    pkt->hdr_stack = (pkt->hdr_stack & ~0xff) | (pkt_offset & 0xff);
+    pkt->proto |= NM_PROTO_UDP;
+    if (NM_HDR_OUTER_IP(pkt->hdr_stack))
+        goto done;
+
+check_tunnel:
+    nm_seek(pkt, pkt_offset, NM_SEEK_T_INDEX_ONLY, stats);
+    port = nm_parse_tunnel_port(pkt, pkt_offset);
+
+    if (NM_BF_GET(&rx_args, INSTR_RX_HOST_ENCAP_bf)) {
+        /* the host marks UDP tunnels, GENEVE by its port if parsed */
+        if (NM_BF_GET(&rx_args, INSTR_RX_PARSE_GENEVE_bf) &&
+            port == NM_GENEVE_PORT)
+            goto geneve;
+    } else {
+        n_vxlan = NM_BF_GET(&rx_args, INSTR_RX_PARSE_VXLANS_bf);
+        if (n_vxlan > cfg->num_vxlan_ports)
+            n_vxlan = cfg->num_vxlan_ports;
+
+        for (i = 0; i < n_vxlan; i++) {
+            if (cfg->vxlan_ports[i] == port)
+                break;
+        }
+
+        if (i == n_vxlan) {
+            if (NM_BF_GET(&rx_args, INSTR_RX_PARSE_GENEVE_bf) &&
+                port == NM_GENEVE_PORT)
+                goto geneve;
+
+            if (NM_BF_GET(&rx_args, INSTR_RX_PARSE_MPLS_UDP_bf) &&
+                port == NM_MPLS_UDP_PORT) {
+                pkt_offset += NM_UDP_HDR_SIZE;
+                nm_seek(pkt, pkt_offset, NM_SEEK_PAD_INCLUDED, stats);
+                goto mpls;
+            }
+
+            if (NM_BF_GET(&rx_args, INSTR_RX_PARSE_TUN_IP_bf) &&
+                port == NM_GTPU_PORT)
+                goto gtpu;
+
+            goto done;
+        }
+    }
+
+    pkt_offset += NM_UDP_HDR_SIZE + NM_VXLAN_SIZE + NM_ETHERNET_SIZE;
+
+seek_inner:
+    pkt->proto = (pkt->proto << NM_PROTO_ENCAP_SHF) & 0xff;
+    pkt->hdr_stack <<= 16;
+
+seek_eth_type:
+    if (pkt_offset > NM_HDR_PARSE_MAX_OFFSET)
+        goto unknown_proto;
+    nm_seek(pkt, pkt_offset, NM_SEEK_PAD_INCLUDED, stats);
+    goto check_eth_type;
+
+geneve:
+    pkt->proto |= NM_PROTO_GENEVE >> NM_PROTO_ENCAP_SHF;
+    eth_type = nm_pkt_be16(pkt, pkt_offset + NM_UDP_HDR_SIZE + 2);
+    hdr_len = (nm_pkt_byte(pkt, pkt_offset + NM_UDP_HDR_SIZE) & 0x3f) << 2;
+    pkt_offset += hdr_len + NM_UDP_HDR_SIZE + NM_GENEVE_SIZE;
+    goto tun_payload;
+
+gre:
+    if (NM_HDR_OUTER_IP(pkt->hdr_stack))
+        goto done;
+    if (!NM_BF_GET(&rx_args, INSTR_RX_PARSE_NVGRE_bf) &&
+        !NM_BF_GET(&rx_args, INSTR_RX_PARSE_TUN_IP_bf)) {
+        pkt->proto |= NM_PROTO_L4_UNKNOWN;
+        goto done;
+    }
+    nm_seek(pkt, pkt_offset, NM_SEEK_T_INDEX_ONLY, stats);
+    pkt->proto |= NM_PROTO_GRE >> NM_PROTO_ENCAP_SHF;
+
+    /* GRE header length from the C, R, K and S bits (R implies C) */
+    next_hdr = nm_pkt_byte(pkt, pkt_offset) >> 4;
+    next_hdr |= (next_hdr << 1) & 8;
+    hdr_len = 0;
+    for (i = 0; i < 4; i++)
+        hdr_len += (next_hdr >> i) & 1;
+    eth_type = nm_pkt_be16(pkt, pkt_offset + 2);
+    pkt_offset += (hdr_len << 2) + NM_NVGRE_SIZE;
+
+tun_payload:
+    /* NVGRE and GENEVE carry Ethernet, GRE and GENEVE may also carry IP */
+    if (eth_type == NM_ETH_TYPE_TEB) {
+        pkt_offset += NM_ETHERNET_SIZE;
+        goto seek_inner;
+    }
+
+    if (NM_BF_GET(&rx_args, INSTR_RX_PARSE_TUN_IP_bf) &&
+        (eth_type == NM_ETH_TYPE_IPV4 || eth_type == NM_ETH_TYPE_IPV6) &&
+        pkt_offset <= NM_HDR_PARSE_MAX_OFFSET) {
+        pkt->proto = (pkt->proto << NM_PROTO_ENCAP_SHF) & 0xff;
+        pkt->hdr_stack <<= 16;
+        nm_seek(pkt, pkt_offset, NM_SEEK_PAD_INCLUDED, stats);
+        goto check_ip;
+    }
+
+    /* other payloads, GENEVE is left as UDP and GRE as unknown L4 */
+    pkt->proto &= ~((pkt->proto & NM_PROTO_UDP) << 2);
+    goto done;
+
+gtpu:
+    /* check_gtpu_tun#: version 1 G-PDUs, other messages stay outer UDP */
+    pkt_offset += NM_UDP_HDR_SIZE;
+    nm_seek(pkt, pkt_offset, NM_SEEK_DEFAULT, stats);
+    label = nm_pkt_byte(pkt, pkt_offset);
+    if ((label >> 4) != 3 ||
+        nm_pkt_byte(pkt, pkt_offset + 1) != NM_GTPU_MSG_GPDU)
+        goto done;
+    pkt_offset += NM_GTPU_SIZE;
+
+    /* the optional fields if any of E, S and PN, the extension headers if
+     * E, each with its length in 4 byte units first and the type of the
+     * next last */
+    if (label & 7) {
+        next_hdr = (label & 4) ? nm_pkt_byte(pkt, pkt_offset + 3) : 0;
+        pkt_offset += NM_GTPU_OPT_SIZE;
+
+        while (next_hdr) {
+            nm_seek(pkt, pkt_offset, NM_SEEK_DEFAULT, stats);
+            hdr_len = nm_pkt_byte(pkt, pkt_offset) << 2;
+            if (!hdr_len)
+                goto done;
+            pkt_offset += hdr_len;
+            if (pkt_offset > NM_HDR_PARSE_MAX_OFFSET)
+                goto done;
+            if (hdr_len != 4)
+                nm_seek(pkt, pkt_offset - 4, NM_SEEK_DEFAULT, stats);
+            next_hdr = nm_pkt_byte(pkt, pkt_offset - 1);
+        }
+    }
+
+    /* IPv4 or IPv6 by the IP version of the payload */
+    if (pkt_offset > NM_HDR_PARSE_MAX_OFFSET)
+        goto done;
+    nm_seek(pkt, pkt_offset, NM_SEEK_PAD_INCLUDED, stats);
+    label = nm_pkt_byte(pkt, pkt_offset) >> 4;
+    if (label == 4)
+        eth_type = NM_ETH_TYPE_IPV4;
+    else if (label == 6)
+        eth_type = NM_ETH_TYPE_IPV6;
+    else
+        goto done;
+    pkt->proto = (pkt->proto << NM_PROTO_ENCAP_SHF) & 0xff;
+    pkt->hdr_stack <<= 16;
+    goto check_ip;
+
+unknown_proto:
+    pkt->proto = NM_PROTO_UNKNOWN;
+
+done:
+    hdr_stack = pkt->hdr_stack;
+    if (NM_HDR_OUTER_IP(pkt->hdr_stack) == 0)
+        pkt->hdr_stack |= hdr_stack << 16;
+}
+
+
+/**
+ * nm_pkt_sum
+ * Add LEN frame bytes from OFFSET to a ones' complement sum, as 16 bit
+ * words in network byte order, an odd last byte padded with zero.
+ */
+static uint32_t
+nm_pkt_sum(const struct nm_pkt *pkt, uint32_t offset, uint32_t len,
+           uint32_t sum)
+{
+    uint32_t i;
+
+    for (i = 0; i + 1 < len; i += 2)
+        sum += nm_pkt_be16(pkt, offset + i);
+    if (len & 1)
+        sum += nm_pkt_byte(pkt, offset + len - 1) << 8;
+
+    return sum;
+}
+
+
+static int
+nm_csum_fold_ok(uint32_t sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+
+    return sum == 0xffff;
+}
+
+
+int
+nm_ipv4_csum_ok(const struct nm_pkt *pkt, uint32_t ip_offset)
+{
+    uint32_t ihl = (nm_pkt_byte(pkt, ip_offset) & 0xf) << 2;
+
+    return nm_csum_fold_ok(nm_pkt_sum(pkt, ip_offset, ihl, 0));
+}
+
+
+int
+nm_l4_csum_ok(const struct nm_pkt *pkt, uint32_t ip_offset,
+              uint32_t l4_offset, uint32_t l4_len, uint32_t ip_proto,
+              int ipv4)
+{
+    uint32_t sum = l4_len + ip_proto;
+
+    /* source and destination addresses */
+    if (ipv4)
+        sum = nm_pkt_sum(pkt, ip_offset + 12, 8, sum);
+    else
+        sum = nm_pkt_sum(pkt, ip_offset + 8, 32, sum);
+
+    return nm_csum_fold_ok(nm_pkt_sum(pkt, l4_offset, l4_len, sum));
+}
+
+
+void
+nm_mac_csum(struct nm_pkt *pkt)
+{
+    uint32_t eth_type;
+    uint32_t ihl;
+    uint32_t ip_len;
+    uint32_t ip_proto;
+    uint32_t l3_offset = NM_ETHERNET_SIZE;
+    uint32_t l4_offset;
+    uint32_t l4_len;
+    int ipv4;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        eth_type = nm_pkt_be16(pkt, l3_offset - 2);
+        if ((eth_type != NM_ETH_TYPE_TPID && eth_type != NM_ETH_TYPE_SVLAN) ||
+            l3_offset + NM_VLAN_SIZE > pkt->length)
+            break;
+        l3_offset += NM_VLAN_SIZE;
+    }
+    eth_type = nm_pkt_be16(pkt, l3_offset - 2);
+
+    ipv4 = (eth_type == NM_ETH_TYPE_IPV4);
+    if (ipv4) {
+        ihl = (nm_pkt_byte(pkt, l3_offset) & 0xf) << 2;
+        if ((nm_pkt_byte(pkt, l3_offset) >> 4) != 4 || ihl < 20 ||
+            l3_offset + ihl > pkt->length)
+            return;
+
+        pkt->tx_flags |= NM_TX_HOST_IP4;
+        if (nm_ipv4_csum_ok(pkt, l3_offset))
+            pkt->tx_flags |= NM_TX_HOST_IP4_OK;
+
+        /* no L4 status for fragments */
+        if (nm_pkt_be16(pkt, l3_offset + 6) & 0x3fff)
+            return;
+
+        ip_len = nm_pkt_be16(pkt, l3_offset + 2);
+        if (ip_len < ihl)
+            return;
+        ip_proto = nm_pkt_byte(pkt, l3_offset + 9);
+        l4_offset = l3_offset + ihl;
+        l4_len = ip_len - ihl;
+    } else if (eth_type == NM_ETH_TYPE_IPV6) {
+        if (l3_offset + NM_IPV6_HDR_SIZE > pkt->length)
+            return;
+
+        ip_proto = nm_pkt_byte(pkt, l3_offset + 6);
+        l4_offset = l3_offset + NM_IPV6_HDR_SIZE;
+        l4_len = nm_pkt_be16(pkt, l3_offset + 4);
+    } else {
+        return;
+    }
+
+    if (l4_offset + l4_len > pkt->length)
+        return;
+
+    if (ip_proto == NM_IP_PROTO_TCP && l4_len >= 20) {
+        pkt->tx_flags |= NM_TX_HOST_TCP;
+        if (nm_l4_csum_ok(pkt, l3_offset, l4_offset, l4_len, ip_proto, ipv4))
+            pkt->tx_flags |= NM_TX_HOST_TCP_OK;
+    } else if (ip_proto == NM_IP_PROTO_UDP && l4_len >= NM_UDP_HDR_SIZE) {
+        pkt->tx_flags |= NM_TX_HOST_UDP;
+        /* a zero UDP checksum over IPv4 was not calculated by the sender */
+        if ((ipv4 && !nm_pkt_be16(pkt, l4_offset + 6)) ||
+            nm_l4_csum_ok(pkt, l3_offset, l4_offset, l4_len, ip_proto, ipv4))
+            pkt->tx_flags |= NM_TX_HOST_UDP_OK;
+    }
+}
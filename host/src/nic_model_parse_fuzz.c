@@ -0,0 +1,774 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_parse_fuzz.c
+ * @brief  Fuzz the header parser model and check it against the RX_WIRE
+ *         fast path.
+ *
+ * Each input is a 16 bit RX_WIRE / RX_HOST argument word in network byte
+ * order followed by an Ethernet frame. The frame is parsed by nm_hdr_parse
+ * and the resulting PV_PROTO and PV_HEADER_STACK are checked against the
+ * properties the checksum, RSS and ACL actions rely on:
+ *
+ * - offsets are at least the Ethernet header size and never decrease from
+ *   the outer to the inner headers, i.e. none wrapped around the 8 bit
+ *   PV_HEADER_STACK fields;
+ * - an encapsulation class comes with inner headers beyond the outer ones;
+ * - parsing the same frame twice gives the same result.
+ *
+ * The frame is also run through INSTR_RX_WIRE, whose NBI metadata fast path
+ * must agree with the deep parse wherever it does not defer to it. With
+ * INSTR_RX_WIRE_CSUM set it must parse the same and set only consistent
+ * outer PV_TX_HOST flags, the OK flags of the built in frames' checksums.
+ *
+ * Usage:
+ *   nic_model_parse_fuzz [-n iterations] [-s seed]
+ *       mutate built in tunnel frames, including deeply nested ones, and
+ *       check each (run by make -C host test)
+ *   nic_model_parse_fuzz -c dir
+ *       write the built in frames to dir, a starting corpus for AFL or
+ *       libFuzzer
+ *   nic_model_parse_fuzz [-d] file...
+ *       check each input file, e.g. an AFL queue or a libFuzzer crash, -d
+ *       printing the parse result as scripts/pv_parse_gentests.py reads it
+ *
+ * Built with -DNM_LIBFUZZER the file provides LLVMFuzzerTestOneInput
+ * instead of main, see the fuzz target of host/Makefile. A failed check
+ * calls abort() so that either fuzzer records the input.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nic_model.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FUZZ_ARGS_SIZE      2
+#define FUZZ_MAX_FRAME      512
+#define FUZZ_ITERATIONS     200000
+
+#define FUZZ_VXLAN_PORT     4789
+
+/* All parse bits, one VXLAN port */
+#define FUZZ_RX_ARGS        (0xe000 | (1 << 3) | (1 << 2) | (1 << 1))
+
+#define FUZZ_TX_HOST_MAC    (NM_TX_HOST_L3 | NM_TX_HOST_L4)
+
+/* Parse bits taking all UDP, or all IPv4, to the deep parse of RX_WIRE:
+ * MPLS over UDP, VXLAN ports, GENEVE and NVGRE */
+#define FUZZ_RX_DEEP        (RX_BIT(INSTR_RX_PARSE_MPLS_UDP_bf) | \
+                             (7 << 3) | RX_BIT(INSTR_RX_PARSE_GENEVE_bf) | \
+                             RX_BIT(INSTR_RX_PARSE_NVGRE_bf))
+
+#define _RX_BIT(w, m, l)    (1 << (l))
+#define RX_BIT(bf)          _RX_BIT(bf)
+
+static struct nm_config cfg;
+static struct nm_pkt pkt;
+
+
+static void
+fuzz_init(void)
+{
+    if (cfg.num_vxlan_ports)
+        return;
+
+    cfg.vxlan_ports[0] = FUZZ_VXLAN_PORT;
+    cfg.num_vxlan_ports = 1;
+
+    cfg.ingress.instr[0] = INSTR_RX_WIRE << INSTR_OPCODE_LSB;
+    cfg.ingress.instr[1] = INSTR_DROP << INSTR_OPCODE_LSB;
+    cfg.ingress.num_words = 2;
+}
+
+
+/**
+ * Return a description of the first property the parse result breaks, or
+ * NULL if it holds them all.
+ */
+static const char *
+fuzz_check_stack(uint32_t proto, uint32_t hdr_stack)
+{
+    uint32_t oip = NM_HDR_OUTER_IP(hdr_stack);
+    uint32_t ol4 = NM_HDR_OUTER_L4(hdr_stack);
+    uint32_t iip = NM_HDR_INNER_IP(hdr_stack);
+    uint32_t il4 = NM_HDR_INNER_L4(hdr_stack);
+    uint32_t encap = proto >> NM_PROTO_ENCAP_SHF;
+
+    if ((oip && oip < 14) || (ol4 && ol4 < 14) ||
+        (iip && iip < 14) || (il4 && il4 < 14))
+        return "offset within the Ethernet header";
+
+    if ((ol4 && ol4 < oip) || (il4 && il4 < iip))
+        return "L4 offset before the IP offset";
+
+    if (iip && iip < oip)
+        return "inner IP offset before the outer one";
+
+    /* MPLS has no outer IP header, only the inner one copied out */
+    if (proto != NM_PROTO_UNKNOWN && encap && encap != 2 &&
+        (!iip || iip <= oip || (ol4 && iip <= ol4)))
+        return "tunnel without inner headers after the outer ones";
+
+    return NULL;
+}
+
+
+/**
+ * Return a description of the first property the PV_TX_HOST flags set by
+ * RX_WIRE break, or NULL if they hold them all.
+ */
+static const char *
+fuzz_check_tx_flags(uint32_t tx_flags)
+{
+    if (tx_flags & ~FUZZ_TX_HOST_MAC)
+        return "TX host flags beyond the outer L3 / L4 ones";
+
+    if (((tx_flags & NM_TX_HOST_IP4_OK) && !(tx_flags & NM_TX_HOST_IP4)) ||
+        ((tx_flags & NM_TX_HOST_TCP_OK) && !(tx_flags & NM_TX_HOST_TCP)) ||
+        ((tx_flags & NM_TX_HOST_UDP_OK) && !(tx_flags & NM_TX_HOST_UDP)))
+        return "checksum OK flag without its protocol flag";
+
+    if ((tx_flags & NM_TX_HOST_TCP) && (tx_flags & NM_TX_HOST_UDP))
+        return "both TCP and UDP flags";
+
+    return NULL;
+}
+
+
+static void
+fuzz_fail(const char *what, uint32_t rx_args, uint32_t proto,
+          uint32_t hdr_stack)
+{
+    fprintf(stderr, "%s: args 0x%04x, proto 0x%02x, header stack 0x%08x\n",
+            what, rx_args, proto, hdr_stack);
+    abort();
+}
+
+
+/**
+ * Check one input, aborting on failure. Return the parse result in
+ * PROTO and HDR_STACK, the PV_TX_HOST flags RX_WIRE sets with its checksum
+ * bit in TX_FLAGS.
+ */
+static void
+fuzz_one(const uint8_t *data, size_t size, uint32_t *proto,
+         uint32_t *hdr_stack, uint32_t *tx_flags)
+{
+    struct nm_stats stats;
+    const char *what;
+    uint32_t rx_args;
+    uint32_t length;
+    int i;
+
+    if (size < FUZZ_ARGS_SIZE)
+        return;
+
+    rx_args = (data[0] << 8) | data[1];
+    data += FUZZ_ARGS_SIZE;
+    length = size - FUZZ_ARGS_SIZE;
+    if (length > NM_MAX_PKT_SIZE)
+        length = NM_MAX_PKT_SIZE;
+
+    fuzz_init();
+    memset(&stats, 0, sizeof(stats));
+
+    nm_pkt_init(&pkt, data, length, 0);
+    nm_hdr_parse(&pkt, rx_args, &cfg, &stats);
+    *proto = pkt.proto;
+    *hdr_stack = pkt.hdr_stack;
+
+    what = fuzz_check_stack(pkt.proto, pkt.hdr_stack);
+    if (what)
+        fuzz_fail(what, rx_args, pkt.proto, pkt.hdr_stack);
+
+    nm_pkt_init(&pkt, data, length, 0);
+    nm_hdr_parse(&pkt, rx_args, &cfg, &stats);
+    if (pkt.proto != *proto || pkt.hdr_stack != *hdr_stack)
+        fuzz_fail("parse not repeatable", rx_args, pkt.proto, pkt.hdr_stack);
+
+    /* RX_WIRE, with RX_HOST_ENCAP (the RX_WIRE checksum bit) cleared,
+     * then without the parse bits that leave no IPv4 UDP to the fast path.
+     * The result of the arguments as given is returned. */
+    rx_args &= ~RX_BIT(INSTR_RX_HOST_ENCAP_bf);
+    for (i = 1; i >= 0; i--) {
+        nm_pkt_init(&pkt, data, length, 0);
+        nm_hdr_parse(&pkt, rx_args & ~(i ? FUZZ_RX_DEEP : 0), &cfg, &stats);
+        *proto = pkt.proto;
+        *hdr_stack = pkt.hdr_stack;
+
+        cfg.ingress.instr[0] = ((INSTR_RX_WIRE << INSTR_OPCODE_LSB) |
+                                (rx_args & ~(i ? FUZZ_RX_DEEP : 0)));
+        nm_pkt_init(&pkt, data, length, 0);
+        nm_execute(&pkt, &cfg, &stats);
+        if (length >= 14 &&
+            (pkt.proto != *proto || pkt.hdr_stack != *hdr_stack))
+            fuzz_fail("RX_WIRE fast path differs from the deep parse",
+                      rx_args & ~(i ? FUZZ_RX_DEEP : 0), pkt.proto,
+                      pkt.hdr_stack);
+    }
+
+    /* RX_WIRE propagating the checksum status of the MAC */
+    cfg.ingress.instr[0] |= RX_BIT(INSTR_RX_WIRE_CSUM_bf);
+    nm_pkt_init(&pkt, data, length, 0);
+    nm_execute(&pkt, &cfg, &stats);
+    *tx_flags = pkt.tx_flags;
+    if (length >= 14 &&
+        (pkt.proto != *proto || pkt.hdr_stack != *hdr_stack))
+        fuzz_fail("RX_WIRE checksum bit changes the parse",
+                  rx_args, pkt.proto, pkt.hdr_stack);
+
+    what = fuzz_check_tx_flags(pkt.tx_flags);
+    if (what)
+        fuzz_fail(what, rx_args, pkt.proto, pkt.hdr_stack);
+}
+
+
+#ifdef NM_LIBFUZZER
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    uint32_t proto;
+    uint32_t hdr_stack;
+    uint32_t tx_flags;
+
+    fuzz_one(data, size, &proto, &hdr_stack, &tx_flags);
+    return 0;
+}
+
+#else
+
+
+static uint32_t
+xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+
+static uint32_t
+put_be16(uint8_t *buf, uint32_t val)
+{
+    buf[0] = val >> 8;
+    buf[1] = val;
+
+    return 2;
+}
+
+
+static uint32_t
+put_be32(uint8_t *buf, uint32_t val)
+{
+    put_be16(buf, val >> 16);
+    put_be16(buf + 2, val);
+
+    return 4;
+}
+
+
+/* Ones' complement sum of LEN bytes, LEN even */
+static uint32_t
+csum_add(const uint8_t *buf, uint32_t len, uint32_t sum)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i += 2)
+        sum += (buf[i] << 8) | buf[i + 1];
+
+    return sum;
+}
+
+
+static uint32_t
+csum_fold(uint32_t sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+
+    return ~sum & 0xffff;
+}
+
+
+/* IPv4 header with IHL words, 10.0.0.1 > 10.0.0.2, valid checksum */
+static uint32_t
+put_ipv4(uint8_t *buf, uint32_t proto, uint32_t ihl)
+{
+    memset(buf, 0, ihl * 4);
+    buf[0] = 0x40 | ihl;
+    buf[8] = 64;
+    buf[9] = proto;
+    put_be32(buf + 12, 0x0a000001);
+    put_be32(buf + 16, 0x0a000002);
+    put_be16(buf + 10, csum_fold(csum_add(buf, ihl * 4, 0)));
+
+    return ihl * 4;
+}
+
+
+/* IPv6 header, fe80::1 > fe80::2 */
+static uint32_t
+put_ipv6(uint8_t *buf, uint32_t next_hdr)
+{
+    memset(buf, 0, 40);
+    buf[0] = 0x60;
+    buf[6] = next_hdr;
+    buf[7] = 64;
+    put_be32(buf + 8, 0xfe800000);
+    buf[23] = 1;
+    put_be32(buf + 24, 0xfe800000);
+    buf[39] = 2;
+
+    return 40;
+}
+
+
+/* IPv6 extension header of LEN 8 byte units */
+static uint32_t
+put_ipv6_ext(uint8_t *buf, uint32_t next_hdr, uint32_t len)
+{
+    memset(buf, 0, len * 8);
+    buf[0] = next_hdr;
+    buf[1] = len - 1;
+
+    return len * 8;
+}
+
+
+static uint32_t
+put_udp(uint8_t *buf, uint32_t port)
+{
+    memset(buf, 0, 8);
+    put_be16(buf, 49152);
+    put_be16(buf + 2, port);
+
+    return 8;
+}
+
+
+static uint32_t
+put_tcp(uint8_t *buf)
+{
+    memset(buf, 0, 20);
+    put_be16(buf, 1024);
+    put_be16(buf + 2, 80);
+    buf[12] = 0x50;
+
+    return 20;
+}
+
+
+static uint32_t
+put_eth(uint8_t *buf, uint32_t eth_type)
+{
+    memset(buf, 0, 12);
+    buf[0] = 0x02;
+    buf[6] = 0x02;
+
+    return 12 + put_be16(buf + 12, eth_type);
+}
+
+
+/**
+ * Build seed frame IDX: a TCP/IPv4 flow after the headers of a tunnel or
+ * of a deep header stack. Return 0 past the last seed.
+ */
+static uint32_t
+seed_frame(uint8_t *buf, uint32_t idx)
+{
+    uint32_t len = 0;
+    uint32_t i;
+
+    memset(buf, 0, FUZZ_MAX_FRAME);
+
+    switch (idx) {
+    case 0:
+        len += put_eth(buf, 0x0800);
+        break;
+    case 1:
+        len += put_eth(buf, 0x8100);
+        len += put_be16(buf + len, 100);
+        len += put_be16(buf + len, 0x86dd);
+        len += put_ipv6(buf + len, 17);
+        len += put_udp(buf + len, 53);
+        return len + 32;
+    case 2:
+        len += put_eth(buf, 0x0800);
+        len += put_ipv4(buf + len, 17, 5);
+        len += put_udp(buf + len, FUZZ_VXLAN_PORT);
+        len += put_be32(buf + len, 0x08000000);
+        len += put_be32(buf + len, 0x00000100);
+        len += put_eth(buf + len, 0x0800);
+        break;
+    case 3:
+        len += put_eth(buf, 0x0800);
+        len += put_ipv4(buf + len, 17, 5);
+        len += put_udp(buf + len, 6081);
+        len += put_be32(buf + len, 0x00006558);
+        len += put_be32(buf + len, 0x00000100);
+        len += put_eth(buf + len, 0x86dd);
+        len += put_ipv6(buf + len, 0);
+        len += put_ipv6_ext(buf + len, 6, 1);
+        len += put_tcp(buf + len);
+        return len + 32;
+    case 4:
+        len += put_eth(buf, 0x0800);
+        len += put_ipv4(buf + len, 47, 5);
+        len += put_be32(buf + len, 0xb0000800);
+        len += put_be32(buf + len, 0);
+        len += put_be32(buf + len, 0);
+        len += put_be32(buf + len, 0);
+        break;
+    case 5:
+        len += put_eth(buf, 0x8847);
+        len += put_be32(buf + len, (100 << 12) | 64);
+        len += put_be32(buf + len, (200 << 12) | (1 << 8) | 64);
+        break;
+    case 6:
+        len += put_eth(buf, 0x0800);
+        len += put_ipv4(buf + len, 17, 5);
+        len += put_udp(buf + len, 6635);
+        len += put_be32(buf + len, (100 << 12) | (1 << 8) | 64);
+        break;
+    case 7:
+        len += put_eth(buf, 0x0800);
+        len += put_ipv4(buf + len, 17, 5);
+        len += put_udp(buf + len, 2152);
+        len += put_be32(buf + len, 0x34ff0000);
+        len += put_be32(buf + len, 1);
+        len += put_be32(buf + len, 0x00000085);
+        len += put_be32(buf + len, 0x01000900);
+        break;
+    case 8:
+        /* VLAN tags up to the end of the header stack offsets */
+        len += put_eth(buf, 0x8100);
+        for (i = 0; i < 60; i++) {
+            len += put_be16(buf + len, i);
+            len += put_be16(buf + len, 0x8100);
+        }
+        len += put_be16(buf + len, 0);
+        len += put_be16(buf + len, 0x0800);
+        len += put_ipv4(buf + len, 6, 15);
+        len += put_tcp(buf + len);
+        return len + 32;
+    case 9:
+        /* GENEVE with the longest options */
+        len += put_eth(buf, 0x0800);
+        len += put_ipv4(buf + len, 17, 5);
+        len += put_udp(buf + len, 6081);
+        len += put_be32(buf + len, 0x3f006558);
+        len += put_be32(buf + len, 0x00000100);
+        len += 0x3f * 4;
+        len += put_eth(buf + len, 0x0800);
+        break;
+    case 10:
+        /* GRE with IPv4 options in both IP headers */
+        len += put_eth(buf, 0x0800);
+        len += put_ipv4(buf + len, 47, 15);
+        len += put_be32(buf + len, 0xb0000800);
+        len += put_be32(buf + len, 0);
+        len += put_be32(buf + len, 0);
+        len += put_be32(buf + len, 0);
+        len += put_ipv4(buf + len, 47, 15);
+        len += put_be32(buf + len, 0x00000800);
+        len += put_ipv4(buf + len, 6, 15);
+        len += put_tcp(buf + len);
+        return len + 32;
+    case 11:
+        /* MPLS label stack up to the end of the header stack offsets */
+        len += put_eth(buf, 0x8847);
+        for (i = 0; i < 60; i++)
+            len += put_be32(buf + len, (100 << 12) | 64);
+        len += put_be32(buf + len, (200 << 12) | (1 << 8) | 64);
+        break;
+    case 12:
+        /* GTP-U after IPv6 extension headers */
+        len += put_eth(buf, 0x86dd);
+        len += put_ipv6(buf + len, 0);
+        len += put_ipv6_ext(buf + len, 60, 8);
+        len += put_ipv6_ext(buf + len, 17, 12);
+        len += put_udp(buf + len, 2152);
+        len += put_be32(buf + len, 0x30ff0000);
+        len += put_be32(buf + len, 1);
+        break;
+    default:
+        return 0;
+    }
+
+    len += put_ipv4(buf + len, 6, 5);
+    len += put_tcp(buf + len);
+
+    return len + 32;
+}
+
+
+/**
+ * Check the PV_TX_HOST flags RX_WIRE sets for a TCP / IPv4 and a UDP / IPv6
+ * frame with valid checksums, and with the last payload byte corrupted.
+ */
+static void
+check_mac_csum(uint8_t *buf)
+{
+    uint8_t *frame = buf + FUZZ_ARGS_SIZE;
+    uint8_t *ip;
+    uint8_t *l4;
+    uint32_t csum_offset;
+    uint32_t expected;
+    uint32_t hdr_stack;
+    uint32_t l4_len;
+    uint32_t len;
+    uint32_t proto;
+    uint32_t sum;
+    uint32_t tx_flags;
+    int ipv6;
+
+    for (ipv6 = 0; ipv6 < 2; ipv6++) {
+        memset(buf, 0, FUZZ_ARGS_SIZE + FUZZ_MAX_FRAME);
+        put_be16(buf, FUZZ_RX_ARGS);
+        len = put_eth(frame, ipv6 ? 0x86dd : 0x0800);
+        ip = frame + len;
+        if (ipv6) {
+            len += put_ipv6(ip, 17);
+            l4 = frame + len;
+            l4_len = put_udp(l4, 53) + 32;
+            put_be16(l4 + 4, l4_len);
+            put_be16(ip + 4, l4_len);
+            sum = csum_add(ip + 8, 32, 17 + l4_len);
+            csum_offset = 6;
+            expected = NM_TX_HOST_UDP | NM_TX_HOST_UDP_OK;
+        } else {
+            len += put_ipv4(ip, 6, 5);
+            l4 = frame + len;
+            l4_len = put_tcp(l4) + 32;
+            put_be16(ip + 2, 20 + l4_len);
+            put_be16(ip + 10, 0);
+            put_be16(ip + 10, csum_fold(csum_add(ip, 20, 0)));
+            sum = csum_add(ip + 12, 8, 6 + l4_len);
+            csum_offset = 16;
+            expected = (NM_TX_HOST_IP4 | NM_TX_HOST_IP4_OK |
+                        NM_TX_HOST_TCP | NM_TX_HOST_TCP_OK);
+        }
+        memset(l4 + l4_len - 32, 0xa5, 32);
+        put_be16(l4 + csum_offset, csum_fold(csum_add(l4, l4_len, sum)));
+        len += l4_len;
+
+        fuzz_one(buf, FUZZ_ARGS_SIZE + len, &proto, &hdr_stack, &tx_flags);
+        if (tx_flags != expected)
+            break;
+
+        l4[l4_len - 1] ^= 1;
+        expected &= ~(NM_TX_HOST_TCP_OK | NM_TX_HOST_UDP_OK);
+        fuzz_one(buf, FUZZ_ARGS_SIZE + len, &proto, &hdr_stack, &tx_flags);
+        if (tx_flags != expected)
+            break;
+    }
+
+    if (ipv6 < 2) {
+        fprintf(stderr, "TX host flags 0x%08x, expected 0x%08x\n",
+                tx_flags, expected);
+        abort();
+    }
+}
+
+
+/**
+ * Overwrite a few bytes of the frame, or of the argument word, with random
+ * values, single bit flips or header field values the parser tests for.
+ */
+static uint32_t
+mutate(uint8_t *buf, uint32_t len, uint32_t *state)
+{
+    static const uint16_t words[] = {
+        0x0800, 0x86dd, 0x8100, 0x88a8, 0x8847, 0x6558,
+        0x12b5, 0x17c1, 0x19eb, 0x0868, 0x0000, 0xffff,
+    };
+    uint32_t n = 1 + (xorshift32(state) & 7);
+    uint32_t pos;
+    uint32_t r;
+
+    while (n--) {
+        r = xorshift32(state);
+        pos = (r >> 8) % len;
+
+        switch (r & 7) {
+        case 0:
+            buf[pos] ^= 1 << ((r >> 4) & 7);
+            break;
+        case 1:
+        case 2:
+            if (pos + 1 < len)
+                put_be16(buf + pos, words[(r >> 4) % 12]);
+            break;
+        case 3:
+            /* argument word */
+            buf[(r >> 4) & 1] ^= 1 << ((r >> 5) & 7);
+            break;
+        case 4:
+            if (pos > 16)
+                len = pos;
+            break;
+        default:
+            buf[pos] = r >> 24;
+            break;
+        }
+    }
+
+    return len;
+}
+
+
+static int
+fuzz_files(int argc, char **argv, int dump)
+{
+    static uint8_t data[FUZZ_ARGS_SIZE + NM_MAX_PKT_SIZE];
+    uint32_t hdr_stack;
+    uint32_t tx_flags;
+    uint32_t proto;
+    size_t size;
+    FILE *f;
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        proto = NM_PROTO_UNKNOWN;
+        hdr_stack = 0;
+        tx_flags = 0;
+        f = fopen(argv[i], "rb");
+        if (!f) {
+            perror(argv[i]);
+            return 1;
+        }
+        size = fread(data, 1, sizeof(data), f);
+        fclose(f);
+
+        fuzz_one(data, size, &proto, &hdr_stack, &tx_flags);
+        if (dump)
+            printf("%s proto 0x%02x hdr_stack 0x%08x tx_flags 0x%08x\n",
+                   argv[i], proto, hdr_stack, tx_flags);
+    }
+
+    return 0;
+}
+
+
+static int
+write_corpus(const char *dir, uint8_t *buf)
+{
+    char path[256];
+    uint32_t len;
+    uint32_t i;
+    FILE *f;
+
+    put_be16(buf, FUZZ_RX_ARGS);
+    for (i = 0; (len = seed_frame(buf + FUZZ_ARGS_SIZE, i)); i++) {
+        snprintf(path, sizeof(path), "%s/seed_%02u", dir, i);
+        f = fopen(path, "wb");
+        if (!f) {
+            perror(path);
+            return 1;
+        }
+        fwrite(buf, 1, FUZZ_ARGS_SIZE + len, f);
+        fclose(f);
+    }
+
+    return 0;
+}
+
+
+static void
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n iterations] [-s seed]\n"
+            "       %s -c dir\n"
+            "       %s [-d] file...\n"
+            "  -n iterations  mutated frames to check (default %u)\n"
+            "  -s seed        random seed (default 1)\n"
+            "  -c dir         write the built in frames to dir\n"
+            "  -d             print the parse result of each file\n",
+            prog, prog, prog, FUZZ_ITERATIONS);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    uint8_t buf[FUZZ_ARGS_SIZE + FUZZ_MAX_FRAME];
+    uint32_t iterations = FUZZ_ITERATIONS;
+    const char *corpus = NULL;
+    uint32_t state = 1;
+    uint32_t num_seeds;
+    uint32_t hdr_stack;
+    uint32_t tx_flags;
+    uint32_t proto;
+    uint32_t len;
+    uint32_t i;
+    int dump = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:dn:s:")) != -1) {
+        switch (opt) {
+        case 'c':
+            corpus = optarg;
+            break;
+        case 'd':
+            dump = 1;
+            break;
+        case 'n':
+            iterations = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            state = strtoul(optarg, NULL, 0) | 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (corpus)
+        return write_corpus(corpus, buf);
+
+    if (optind < argc)
+        return fuzz_files(argc - optind, argv + optind, dump);
+
+    check_mac_csum(buf);
+
+    for (num_seeds = 0;
+         seed_frame(buf + FUZZ_ARGS_SIZE, num_seeds); num_seeds++)
+        ;
+
+    for (i = 0; i < num_seeds + iterations; i++) {
+        len = seed_frame(buf + FUZZ_ARGS_SIZE, i % num_seeds);
+        put_be16(buf, FUZZ_RX_ARGS);
+        len += FUZZ_ARGS_SIZE;
+
+        /* each seed as is first */
+        if (i >= num_seeds)
+            len = mutate(buf, len, &state);
+
+        fuzz_one(buf, len, &proto, &hdr_stack, &tx_flags);
+
+        /* the outer IPv4 header of a seed has a valid checksum */
+        if (i < num_seeds && buf[FUZZ_ARGS_SIZE + 12] == 0x08 &&
+            buf[FUZZ_ARGS_SIZE + 13] == 0x00 &&
+            (tx_flags & NM_TX_HOST_L3) != NM_TX_HOST_L3)
+            fuzz_fail("seed without a valid IPv4 checksum", FUZZ_RX_ARGS,
+                      proto, hdr_stack);
+    }
+
+    printf("%-16s %u seeds %u mutations\n", "parse fuzz", num_seeds,
+           iterations);
+    printf("PASS\n");
+    return 0;
+}
+
+#endif
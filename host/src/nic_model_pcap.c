@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_pcap.c
+ * @brief  Minimal classic pcap reader used to replay traces through the model.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nic_model.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NM_PCAP_MAGIC           0xa1b2c3d4
+#define NM_PCAP_MAGIC_NSEC      0xa1b23c4d
+#define NM_PCAP_LINKTYPE_ETH    1
+
+struct nm_pcap {
+    FILE *f;
+    int swap;
+};
+
+
+static uint32_t
+nm_pcap_u32(const struct nm_pcap *pcap, const uint8_t *p)
+{
+    if (pcap->swap)
+        return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+
+    return (p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+
+struct nm_pcap *
+nm_pcap_open(const char *filename)
+{
+    struct nm_pcap *pcap;
+    uint8_t hdr[24];
+    uint32_t magic;
+
+    pcap = calloc(1, sizeof(*pcap));
+    if (!pcap)
+        return NULL;
+
+    pcap->f = fopen(filename, "rb");
+    if (!pcap->f)
+        goto error;
+
+    if (fread(hdr, sizeof(hdr), 1, pcap->f) != 1)
+        goto error;
+
+    /* Host order is irrelevant: decode little endian, then try swapped. */
+    magic = nm_pcap_u32(pcap, hdr);
+    if (magic != NM_PCAP_MAGIC && magic != NM_PCAP_MAGIC_NSEC) {
+        pcap->swap = 1;
+        magic = nm_pcap_u32(pcap, hdr);
+        if (magic != NM_PCAP_MAGIC && magic != NM_PCAP_MAGIC_NSEC)
+            goto error;
+    }
+
+    if (nm_pcap_u32(pcap, &hdr[20]) != NM_PCAP_LINKTYPE_ETH)
+        goto error;
+
+    return pcap;
+
+error:
+    fprintf(stderr, "%s: not an Ethernet pcap file\n", filename);
+    if (pcap->f)
+        fclose(pcap->f);
+    free(pcap);
+    return NULL;
+}
+
+
+int
+nm_pcap_next(struct nm_pcap *pcap, uint8_t *frame, uint32_t size,
+             uint32_t *length)
+{
+    uint8_t rec[16];
+    uint32_t incl_len;
+    uint32_t copy_len;
+
+    if (fread(rec, sizeof(rec), 1, pcap->f) != 1)
+        return 0;
+
+    incl_len = nm_pcap_u32(pcap, &rec[8]);
+    copy_len = incl_len < size ? incl_len : size;
+
+    if (fread(frame, 1, copy_len, pcap->f) != copy_len)
+        return -1;
+
+    /* Frames larger than the model buffer are truncated, skip the rest. */
+    if (copy_len < incl_len &&
+        fseek(pcap->f, incl_len - copy_len, SEEK_CUR))
+        return -1;
+
+    *length = copy_len;
+    return 1;
+}
+
+
+void
+nm_pcap_close(struct nm_pcap *pcap)
+{
+    fclose(pcap->f);
+    free(pcap);
+}
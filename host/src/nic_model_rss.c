@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_rss.c
+ * @brief  Host model of the RSS indirection tables written by the app
+ *         master.
+ *
+ * Mirrors upd_rss_table() in firmware/apps/nic/app_config_tables.c, which
+ * extends the table written by the driver to NIC_RSS_TBL_ENTRIES entries
+ * using nic_rss_tbl_queues() from app_config_rss.h.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <string.h>
+
+#include "nic_model.h"
+#include "app_config_rss.h"
+
+
+void
+nm_rss_tbl_extend(uint8_t *tbl, uint32_t entries, const uint8_t *itbl)
+{
+    uint32_t words[NFP_NET_CFG_RSS_ITBL_SZ / 4];
+    uint32_t queues;
+    uint32_t i;
+
+    /* Four entries to a word as in CLS, the first in the MSB */
+    memset(words, 0, sizeof(words));
+    for (i = 0; i < NFP_NET_CFG_RSS_ITBL_SZ; i++)
+        words[i / 4] |= (uint32_t) itbl[i] << (24 - 8 * (i & 3));
+
+    queues = nic_rss_tbl_queues(words, NFP_NET_CFG_RSS_ITBL_SZ);
+
+    for (i = 0; i < entries; i++)
+        tbl[i] = queues ? i % queues : itbl[i % NFP_NET_CFG_RSS_ITBL_SZ];
+}
+
+
+double
+nm_rss_tbl_spread(const uint8_t *tbl, uint32_t entries, uint32_t queues)
+{
+    uint32_t count[256];
+    uint32_t max = 0;
+    uint32_t i;
+
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < entries; i++) {
+        if (++count[tbl[i]] > max)
+            max = count[tbl[i]];
+    }
+
+    return (double) max * queues / entries;
+}
@@ -0,0 +1,427 @@
+/*
+ * Copyright (C) 2020 Netronome Systems, Inc. All rights reserved.
+ *
+ * @file   nic_model_rss_test.c
+ * @brief  Check the spread of flows over the RSS queues on the host.
+ *
+ * For each number of queues the driver's default indirection table (entry
+ * i is i % queues) is extended to 512 entries with nm_rss_tbl_extend(),
+ * as upd_rss_table() does, and pseudo random TCP/IPv4 flows are hashed
+ * with Toeplitz through both tables. The larger table must not spread
+ * the flows less evenly, and the busiest queue of each table must stay
+ * close to the share its table entries give it.
+ *
+ * The parser is also run over a TCP/IPv4 flow in each tunnel that the
+ * NIC_RSS_CFG_TUN_* flags enable: RSS must find the inner headers with
+ * the RX_WIRE parse bit set and the outer headers, as before, without.
+ * QinQ and IPv6 extension headers after GENEVE need no bit.
+ *
+ * nic_rss_tbl_max(), which upd_rss_table() checks a table against the
+ * queues of the vNIC with, must find the highest queue of a custom table.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nic_model.h"
+#include "app_config_rss.h"
+
+#define TEST_ENTRIES    512
+#define TEST_FLOWS      (1 << 18)
+
+/* Allowed excess of the busiest queue over its share of entries, from the
+ * random spread of TEST_FLOWS flows over up to 64 queues */
+#define FLOW_TOL        0.08
+
+/* Verification key of the Microsoft RSS specification */
+static const uint32_t rss_key[NM_RSS_KEY_LW] = {
+    0x6d5a56da, 0x255b0ec2, 0x4167253d, 0x43a38fb0, 0xd0ca2bcb,
+    0xae7b30b4, 0x77cb2da3, 0x8030f20c, 0x6a42b73b, 0xbeac01fa,
+};
+
+static uint32_t hashes[TEST_FLOWS];
+
+#define _RX_BIT(w, m, l)    (1 << (l))
+#define RX_BIT(bf)          _RX_BIT(bf)
+
+#define HDR_STACK(oip, ol4, iip, il4) \
+    (((oip) << 24) | ((ol4) << 16) | ((iip) << 8) | (il4))
+
+/**
+ * A TCP/IPv4 flow in each tunnel, parsed with and without its RX_WIRE
+ * parse bit. GENEVE and NVGRE are parsed with their driver bits set.
+ * The GENEVE flow with an extension header is TCP/IPv6.
+ */
+static const struct {
+    const char *name;
+    uint32_t rx_args;
+    uint32_t tun_bit;
+    uint32_t proto[2];
+    uint32_t hdr_stack[2];
+} tunnels[] = {
+    {
+        "gre", 0, RX_BIT(INSTR_RX_PARSE_TUN_IP_bf),
+        {0x06, 0xc2}, {HDR_STACK(14, 0, 14, 0), HDR_STACK(14, 0, 38, 58)},
+    }, {
+        "nvgre_gre", RX_BIT(INSTR_RX_PARSE_NVGRE_bf),
+        RX_BIT(INSTR_RX_PARSE_TUN_IP_bf),
+        {0x06, 0xc2}, {HDR_STACK(14, 0, 14, 0), HDR_STACK(14, 0, 38, 58)},
+    }, {
+        "geneve_ip", RX_BIT(INSTR_RX_PARSE_GENEVE_bf),
+        RX_BIT(INSTR_RX_PARSE_TUN_IP_bf),
+        {0x03, 0xe2},
+        {HDR_STACK(14, 34, 14, 34), HDR_STACK(14, 34, 50, 70)},
+    }, {
+        "mpls", 0, RX_BIT(INSTR_RX_PARSE_MPLS_IP_bf),
+        {0x40, 0x42}, {0, HDR_STACK(18, 38, 18, 38)},
+    }, {
+        "mpls_udp", RX_BIT(INSTR_RX_PARSE_MPLS_IP_bf),
+        RX_BIT(INSTR_RX_PARSE_MPLS_UDP_bf),
+        {0x03, 0x62},
+        {HDR_STACK(14, 34, 14, 34), HDR_STACK(14, 34, 46, 66)},
+    }, {
+        "gtpu", 0, RX_BIT(INSTR_RX_PARSE_TUN_IP_bf),
+        {0x03, 0x62},
+        {HDR_STACK(14, 34, 14, 34), HDR_STACK(14, 34, 50, 70)},
+    }, {
+        "gtpu_ext", 0, RX_BIT(INSTR_RX_PARSE_TUN_IP_bf),
+        {0x03, 0x62},
+        {HDR_STACK(14, 34, 14, 34), HDR_STACK(14, 34, 58, 78)},
+    }, {
+        "qinq", 0, 0,
+        {0x02, 0x02},
+        {HDR_STACK(22, 42, 22, 42), HDR_STACK(22, 42, 22, 42)},
+    }, {
+        "geneve_ipv6_ext", RX_BIT(INSTR_RX_PARSE_GENEVE_bf), 0,
+        {0xe0, 0xe0},
+        {HDR_STACK(14, 34, 64, 112), HDR_STACK(14, 34, 64, 112)},
+    },
+};
+
+
+static uint32_t
+xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+
+static uint32_t
+put_be16(uint8_t *buf, uint32_t val)
+{
+    buf[0] = val >> 8;
+    buf[1] = val;
+
+    return 2;
+}
+
+
+static uint32_t
+put_be32(uint8_t *buf, uint32_t val)
+{
+    put_be16(buf, val >> 16);
+    put_be16(buf + 2, val);
+
+    return 4;
+}
+
+
+/* IPv4 header without options, 10.0.0.1 > 10.0.0.2 */
+static uint32_t
+put_ipv4(uint8_t *buf, uint32_t proto)
+{
+    memset(buf, 0, 20);
+    buf[0] = 0x45;
+    buf[8] = 64;
+    buf[9] = proto;
+    put_be32(buf + 12, 0x0a000001);
+    put_be32(buf + 16, 0x0a000002);
+
+    return 20;
+}
+
+
+/* IPv6 header, fe80::1 > fe80::2 */
+static uint32_t
+put_ipv6(uint8_t *buf, uint32_t next_hdr)
+{
+    memset(buf, 0, 40);
+    buf[0] = 0x60;
+    buf[6] = next_hdr;
+    buf[7] = 64;
+    put_be32(buf + 8, 0xfe800000);
+    buf[23] = 1;
+    put_be32(buf + 24, 0xfe800000);
+    buf[39] = 2;
+
+    return 40;
+}
+
+
+/* TCP header, port 1024 > 80 */
+static uint32_t
+put_tcp(uint8_t *buf)
+{
+    memset(buf, 0, 20);
+    put_be16(buf, 1024);
+    put_be16(buf + 2, 80);
+    buf[12] = 0x50;
+
+    return 20;
+}
+
+
+static uint32_t
+put_udp(uint8_t *buf, uint32_t port)
+{
+    memset(buf, 0, 8);
+    put_be16(buf, 49152);
+    put_be16(buf + 2, port);
+
+    return 8;
+}
+
+
+/**
+ * Build the frame of test tunnel IDX: Ethernet, IPv4 and the tunnel
+ * headers, followed by the inner TCP/IPv4 headers and some payload.
+ */
+static uint32_t
+tunnel_frame(uint8_t *buf, uint32_t idx)
+{
+    uint32_t len = 12;
+
+    memset(buf, 0, 256);
+    buf[0] = 0x02;
+    buf[6] = 0x02;
+
+    switch (idx) {
+    case 0:
+    case 1:
+        len += put_be16(buf + len, 0x0800);
+        len += put_ipv4(buf + len, 47);
+        len += put_be32(buf + len, 0x00000800);
+        break;
+    case 2:
+        len += put_be16(buf + len, 0x0800);
+        len += put_ipv4(buf + len, 17);
+        len += put_udp(buf + len, 6081);
+        len += put_be32(buf + len, 0x00000800);
+        len += put_be32(buf + len, 0x00000100);
+        break;
+    case 3:
+        len += put_be16(buf + len, 0x8847);
+        len += put_be32(buf + len, (100 << 12) | (1 << 8) | 64);
+        break;
+    case 4:
+        len += put_be16(buf + len, 0x0800);
+        len += put_ipv4(buf + len, 17);
+        len += put_udp(buf + len, 6635);
+        len += put_be32(buf + len, (100 << 12) | (1 << 8) | 64);
+        break;
+    case 5:
+        /* G-PDU, TEID 1 */
+        len += put_be16(buf + len, 0x0800);
+        len += put_ipv4(buf + len, 17);
+        len += put_udp(buf + len, 2152);
+        len += put_be32(buf + len, 0x30ff0000);
+        len += put_be32(buf + len, 1);
+        break;
+    case 6:
+        /* G-PDU with a PDU session container (QFI 9) */
+        len += put_be16(buf + len, 0x0800);
+        len += put_ipv4(buf + len, 17);
+        len += put_udp(buf + len, 2152);
+        len += put_be32(buf + len, 0x34ff0000);
+        len += put_be32(buf + len, 1);
+        len += put_be32(buf + len, 0x00000085);
+        len += put_be32(buf + len, 0x01000900);
+        break;
+    case 7:
+        len += put_be16(buf + len, 0x88a8);
+        len += put_be16(buf + len, 100);
+        len += put_be16(buf + len, 0x8100);
+        len += put_be16(buf + len, 200);
+        len += put_be16(buf + len, 0x0800);
+        break;
+    default:
+        /* Ethernet over GENEVE, IPv6 with a hop-by-hop options header */
+        len += put_be16(buf + len, 0x0800);
+        len += put_ipv4(buf + len, 17);
+        len += put_udp(buf + len, 6081);
+        len += put_be32(buf + len, 0x00006558);
+        len += put_be32(buf + len, 0x00000100);
+        memset(buf + len, 0, 12);
+        buf[len] = 0x02;
+        buf[len + 6] = 0x02;
+        len += 12;
+        len += put_be16(buf + len, 0x86dd);
+        len += put_ipv6(buf + len, 0);
+        len += put_be32(buf + len, 0x06000000);
+        len += put_be32(buf + len, 0);
+        len += put_tcp(buf + len);
+        return len + 64;
+    }
+
+    len += put_ipv4(buf + len, 6);
+    len += put_tcp(buf + len);
+
+    return len + 64;
+}
+
+
+static int
+test_tunnels(void)
+{
+    static const struct nm_config cfg;
+    struct nm_pkt pkt;
+    uint8_t frame[256];
+    uint32_t rx_args;
+    uint32_t len;
+    uint32_t i;
+    uint32_t on;
+    int failed = 0;
+
+    for (i = 0; i < sizeof(tunnels) / sizeof(tunnels[0]); i++) {
+        len = tunnel_frame(frame, i);
+
+        for (on = 0; on < 2; on++) {
+            rx_args = tunnels[i].rx_args | (on ? tunnels[i].tun_bit : 0);
+            nm_pkt_init(&pkt, frame, len, 0);
+            nm_hdr_parse(&pkt, rx_args, &cfg, NULL);
+
+            if (pkt.proto != tunnels[i].proto[on] ||
+                pkt.hdr_stack != tunnels[i].hdr_stack[on]) {
+                fprintf(stderr, "%s (args 0x%x): proto 0x%02x, header "
+                        "stack 0x%08x, expected 0x%02x, 0x%08x\n",
+                        tunnels[i].name, rx_args, pkt.proto, pkt.hdr_stack,
+                        tunnels[i].proto[on], tunnels[i].hdr_stack[on]);
+                failed = 1;
+            }
+        }
+    }
+
+    printf("%-16s %u tunnels\n", "tunnels", i);
+    return failed;
+}
+
+
+/**
+ * Return the share of the busiest queue of the hashed flows relative to
+ * an even spread.
+ */
+static double
+flow_spread(const uint8_t *tbl, uint32_t entries, uint32_t queues)
+{
+    uint32_t count[256];
+    uint32_t max = 0;
+    uint32_t q;
+    uint32_t i;
+
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < TEST_FLOWS; i++) {
+        q = tbl[hashes[i] & (entries - 1)];
+        if (++count[q] > max)
+            max = count[q];
+    }
+
+    return (double) max * queues / TEST_FLOWS;
+}
+
+
+int
+main(void)
+{
+    uint8_t itbl[NFP_NET_CFG_RSS_ITBL_SZ];
+    uint8_t tbl[TEST_ENTRIES];
+    uint32_t words[NFP_NET_CFG_RSS_ITBL_SZ / 4];
+    uint32_t tuple[3];
+    uint32_t state = 1;
+    uint32_t queues;
+    uint32_t i;
+    double tbl_drv, tbl_ext;
+    double flow_drv, flow_ext;
+    int failed = 0;
+
+    for (i = 0; i < TEST_FLOWS; i++) {
+        tuple[0] = xorshift32(&state);
+        tuple[1] = xorshift32(&state);
+        tuple[2] = xorshift32(&state);
+        hashes[i] = nm_toeplitz(rss_key, tuple, 3);
+    }
+
+    printf("%6s %18s %18s\n", "queues", "entries 128/512", "flows 128/512");
+    for (queues = 1; queues <= 64; queues++) {
+        for (i = 0; i < NFP_NET_CFG_RSS_ITBL_SZ; i++)
+            itbl[i] = i % queues;
+        nm_rss_tbl_extend(tbl, TEST_ENTRIES, itbl);
+
+        /* The extended table is still round robin */
+        for (i = 0; i < TEST_ENTRIES; i++) {
+            if (tbl[i] != i % queues) {
+                fprintf(stderr, "%u queues: entry %u is %u\n",
+                        queues, i, tbl[i]);
+                failed = 1;
+                break;
+            }
+        }
+
+        tbl_drv = nm_rss_tbl_spread(itbl, NFP_NET_CFG_RSS_ITBL_SZ, queues);
+        tbl_ext = nm_rss_tbl_spread(tbl, TEST_ENTRIES, queues);
+        flow_drv = flow_spread(itbl, NFP_NET_CFG_RSS_ITBL_SZ, queues);
+        flow_ext = flow_spread(tbl, TEST_ENTRIES, queues);
+
+        if (tbl_ext > tbl_drv || flow_ext > flow_drv + FLOW_TOL ||
+            flow_drv > tbl_drv + FLOW_TOL || flow_ext > tbl_ext + FLOW_TOL) {
+            fprintf(stderr, "%u queues: busiest queue %.3f/%.3f of entries, "
+                    "%.3f/%.3f of flows\n", queues, tbl_drv, tbl_ext,
+                    flow_drv, flow_ext);
+            failed = 1;
+        }
+
+        if (queues % 8 == 0 || tbl_drv - tbl_ext > 0.1)
+            printf("%6u %8.3f %9.3f %8.3f %9.3f\n", queues, tbl_drv, tbl_ext,
+                   flow_drv, flow_ext);
+    }
+
+    /* Any other table is repeated */
+    for (i = 0; i < NFP_NET_CFG_RSS_ITBL_SZ; i++)
+        itbl[i] = (i * 7) % 5;
+    nm_rss_tbl_extend(tbl, TEST_ENTRIES, itbl);
+    for (i = 0; i < TEST_ENTRIES; i++) {
+        if (tbl[i] != itbl[i % NFP_NET_CFG_RSS_ITBL_SZ]) {
+            fprintf(stderr, "custom table: entry %u is %u\n", i, tbl[i]);
+            failed = 1;
+            break;
+        }
+    }
+
+    /* Its highest queue bounds the queues of the vNIC it is accepted for */
+    memset(words, 0, sizeof(words));
+    for (i = 0; i < NFP_NET_CFG_RSS_ITBL_SZ; i++)
+        words[i / 4] |= (uint32_t) itbl[i] << (24 - 8 * (i & 3));
+    if (nic_rss_tbl_max(words, NFP_NET_CFG_RSS_ITBL_SZ) != 4) {
+        fprintf(stderr, "custom table: highest queue %u\n",
+                nic_rss_tbl_max(words, NFP_NET_CFG_RSS_ITBL_SZ));
+        failed = 1;
+    }
+
+    failed |= test_tunnels();
+
+    if (failed) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
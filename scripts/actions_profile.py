@@ -0,0 +1,143 @@
+#!/usr/bin/env python
+##
+## Copyright (c) 2020,  Netronome Systems, Inc.  All rights reserved.
+## SPDX-License-Identifier: BSD-2-Clause
+
+"""
+Decode the per action handler counters of a datapath built with
+ACTIONS_PROFILE_ENABLE (see firmware/apps/nic/actions_profile.uc)
+
+The _actions_profile table is read with nfp-rtsym, or from a file holding
+the output of nfp-rtsym _actions_profile.
+"""
+from __future__ import print_function
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+RTSYM = "_actions_profile"
+
+# ACTIONS_PROFILE_ME_SZ, bytes per ME
+ME_SZ = 512
+
+# ME cycles per TIMESTAMP_LOW tick
+TICK_CYCLES = 16
+
+# Opcode names are read from the instruction_ops enum
+INSTR_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..",
+                       "firmware", "apps", "nic", "app_config_instr.h")
+
+def read_ops(filename):
+    """Return the action names of the instruction_ops enum, in opcode order"""
+    enum_pat = re.compile(r'^enum\s+instruction_ops\s*\{')
+    end_pat = re.compile(r'^\}')
+    op_pat = re.compile(r'^INSTR_(\w+)\s*(=\s*([0-9]+))?\s*,?$')
+    ops = []
+    busy = False
+
+    with open(filename, 'r') as f:
+        for line in f:
+            line = line.strip()
+
+            if not busy:
+                busy = bool(enum_pat.search(line))
+                continue
+
+            if end_pat.search(line):
+                break
+
+            s = op_pat.search(line)
+            if s:
+                if s.group(3) is not None and int(s.group(3)) != len(ops):
+                    raise ValueError("INSTR_" + s.group(1) + " out of order")
+                ops.append(s.group(1).lower())
+
+    if not ops:
+        raise ValueError("no instruction_ops enum in " + filename)
+    return ops
+
+def parse_words(lines):
+    """Return the 32 bit words of a nfp-rtsym dump, in address order"""
+    words = []
+    for line in lines:
+        if ":" not in line:
+            continue
+        for token in line.split(":", 1)[1].split():
+            words.append(int(token, 16))
+    return words
+
+def read_rtsym(nfp):
+    cmd = ["nfp-rtsym", "-n", str(nfp), RTSYM]
+    out = subprocess.check_output(cmd)
+    if not isinstance(out, str):
+        out = out.decode()
+    return out.splitlines()
+
+def decode(words, nops):
+    """Return {(island, me): [(invocations, ticks), ...]} for active MEs"""
+    me_lw = ME_SZ // 4
+    mes = {}
+    for idx in range(len(words) // me_lw):
+        base = idx * me_lw
+        cntrs = []
+        for op in range(nops):
+            w = words[base + op * 4:base + op * 4 + 4]
+            cntrs.append((w[0] | (w[1] << 32), w[2] | (w[3] << 32)))
+        if any(n for n, _ in cntrs):
+            # Index is ((island & 7) << 4 | ME master ID), workers are on
+            # islands 32 and up and master IDs start at 4
+            mes[(32 + (idx >> 4), (idx & 0xf) - 4)] = cntrs
+    return mes
+
+def print_table(title, ops, cntrs):
+    print(title)
+    print("  %-16s %16s %18s %10s" %
+          ("action", "invocations", "cycles", "cyc/inv"))
+    for op, (n, ticks) in enumerate(cntrs):
+        if n == 0:
+            continue
+        cycles = ticks * TICK_CYCLES
+        print("  %-16s %16d %18d %10d" % (ops[op], n, cycles, cycles // n))
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("-n", "--nfp", type=int, default=0,
+                        help="NFP device number (default 0)")
+    parser.add_argument("-f", "--file",
+                        help="nfp-rtsym output to decode, - for stdin")
+    parser.add_argument("-m", "--per-me", action="store_true",
+                        help="show the counters of each ME")
+    parser.add_argument("-i", "--instr", default=INSTR_H,
+                        help="app_config_instr.h of the datapath "
+                        "(default %(default)s)")
+    args = parser.parse_args()
+
+    if args.file == "-":
+        lines = sys.stdin.readlines()
+    elif args.file:
+        with open(args.file, 'r') as in_file_handle:
+            lines = in_file_handle.readlines()
+    else:
+        lines = read_rtsym(args.nfp)
+
+    ops = read_ops(args.instr)
+    mes = decode(parse_words(lines), len(ops))
+    if not mes:
+        print("No counters, is the datapath built with ACTIONS_PROFILE_ENABLE?")
+        return 1
+
+    total = [(0, 0)] * len(ops)
+    for me in sorted(mes):
+        cntrs = mes[me]
+        total = [(n + m, t + u) for (n, t), (m, u) in zip(total, cntrs)]
+        if args.per_me:
+            print_table("i%d.me%d" % me, ops, cntrs)
+
+    print_table("all MEs (%d)" % len(mes), ops, total)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,235 @@
+#!/usr/bin/env python
+##
+## Copyright (c) 2020,  Netronome Systems, Inc.  All rights reserved.
+## SPDX-License-Identifier: BSD-2-Clause
+
+"""
+Generate datapath tests from inputs of the host parser fuzzer
+(host/src/nic_model_parse_fuzz.c). The script only writes the tests: the
+expected values in each come from the host model, and the comparison with
+the microcode happens when the datapath test target runs them in the
+simulator or on a card.
+
+Each test runs pv_hdr_parse_subroutine on the frame and checks PV_PROTO and
+PV_HEADER_STACK against the model. PV_TX_FLAGS starts out as the PV_TX_HOST
+flags the model derives for RX_WIRE with its checksum bit, and must come out
+of the parse unchanged. Those flags are not compared with the microcode:
+pv_init_nbi copies them from the NBI metadata of the MAC, which a test
+cannot derive from the frame.
+
+Each input is a 16 bit RX_WIRE argument word in network byte order followed
+by an Ethernet frame, as in an AFL queue or libFuzzer corpus directory. The
+tests are written to test/datapath/parse_gen by default, where the datapath
+test target of the firmware Makefile finds them:
+
+    scripts/pv_parse_gentests.py corpus/*
+    make test FILTER=pv_parse_gen
+
+The VXLAN port table of the model (port 4789 only) is loaded into the next
+neighbour registers the arguments select. Frames are placed in CTM as those
+of the pv_parse tests, followed by zeros as the model assumes past the end
+of the frame.
+"""
+from __future__ import print_function
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+MODEL = "host/bin/nic_model_parse_fuzz"
+OUT_DIR = "test/datapath/parse_gen"
+
+# CTM address of the frame, after 8 bytes of pad as in pkt_*_x88.uc
+CTM_BASE = 0x80
+CTM_PAD = 8
+
+# Largest frame placed in CTM and the zeros written after it, beyond the
+# window read by the last pv_seek
+MAX_FRAME = 512
+TAIL_PAD = 192
+
+VXLAN_PORT = 4789
+NN_REGS = 128
+NN_NO_PORT = 0x10000
+
+# PV_FLAGS_wrd besides PV_TX_FLAGS_bf: PV_SEEK_BASE_INVALID
+FLAGS_WORD = 0x3fc0
+
+# INSTR_RX_VXLAN_NN_IDX_bf, INSTR_RX_PARSE_VXLANS_bf and
+# INSTR_RX_HOST_ENCAP_bf in firmware/apps/nic/app_config_instr.h
+NN_IDX_SHF = 6
+NN_IDX_MSK = 0x7f
+VXLANS_SHF = 3
+VXLANS_MSK = 0x7
+ENCAP_BIT = 0x1
+
+TEMPLATE = """\
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Generated by scripts/pv_parse_gentests.py from {name} */
+{nn_init}
+{ctm_init}
+
+#include <single_ctx_test.uc>
+#include <global.uc>
+#include <actions.uc>
+#include <bitfields.uc>
+#include <aggregate.uc>
+#include <stdmac.uc>
+#include <pv.uc>
+
+.reg pkt_vec[PV_SIZE_LW]
+aggregate_zero(pkt_vec, PV_SIZE_LW)
+move(pkt_vec[0], {length:#x})
+move(pkt_vec[2], {offset:#x})
+move(pkt_vec[3], {proto:#04x})
+move(pkt_vec[4], {flags:#010x})
+move(pkt_vec[5], {hdr_stack:#010x})
+
+.reg o_l4_offset
+.reg o_l3_offset
+.reg i_l4_offset
+.reg i_l3_offset
+.reg proto
+.reg expected_o_l3_offset
+.reg expected_o_l4_offset
+.reg expected_i_l3_offset
+.reg expected_i_l4_offset
+.reg expected_proto
+.reg tx_flags
+.reg expected_tx_flags
+.reg port_tun_args
+
+move(port_tun_args, {rx_args:#06x})
+
+bitfield_extract__sz1(expected_i_l4_offset, BF_AML(pkt_vec, PV_HEADER_OFFSET_INNER_L4_bf))
+bitfield_extract__sz1(expected_i_l3_offset, BF_AML(pkt_vec, PV_HEADER_OFFSET_INNER_IP_bf))
+bitfield_extract__sz1(expected_o_l4_offset, BF_AML(pkt_vec, PV_HEADER_OFFSET_OUTER_L4_bf))
+bitfield_extract__sz1(expected_o_l3_offset, BF_AML(pkt_vec, PV_HEADER_OFFSET_OUTER_IP_bf))
+bitfield_extract__sz1(expected_proto, BF_AML(pkt_vec, PV_PROTO_bf))
+bitfield_extract(expected_tx_flags, BF_AML(pkt_vec, PV_TX_FLAGS_bf))
+
+move(BF_A(pkt_vec, PV_HEADER_STACK_bf), 0)
+move(BF_A(pkt_vec, PV_PROTO_bf), 0)
+
+pv_seek(pkt_vec, 0, (PV_SEEK_DEFAULT))
+alu[--, --, B, *$index++]
+alu[--, --, B, *$index++]
+alu[--, --, B, *$index++]
+
+pv_hdr_parse(pkt_vec, port_tun_args, check_result#)
+
+check_result#:
+bitfield_extract__sz1(i_l4_offset, BF_AML(pkt_vec, PV_HEADER_OFFSET_INNER_L4_bf))
+bitfield_extract__sz1(i_l3_offset, BF_AML(pkt_vec, PV_HEADER_OFFSET_INNER_IP_bf))
+bitfield_extract__sz1(o_l4_offset, BF_AML(pkt_vec, PV_HEADER_OFFSET_OUTER_L4_bf))
+bitfield_extract__sz1(o_l3_offset, BF_AML(pkt_vec, PV_HEADER_OFFSET_OUTER_IP_bf))
+bitfield_extract__sz1(proto, BF_AML(pkt_vec, PV_PROTO_bf))
+bitfield_extract(tx_flags, BF_AML(pkt_vec, PV_TX_FLAGS_bf))
+
+test_assert_equal(i_l4_offset, expected_i_l4_offset)
+test_assert_equal(i_l3_offset, expected_i_l3_offset)
+test_assert_equal(o_l4_offset, expected_o_l4_offset)
+test_assert_equal(o_l3_offset, expected_o_l3_offset)
+test_assert_equal(proto, expected_proto)
+test_assert_equal(tx_flags, expected_tx_flags)
+
+test_pass()
+
+PV_HDR_PARSE_SUBROUTINE#:
+pv_hdr_parse_subroutine(pkt_vec)
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
+"""
+
+def model_results(model, files):
+    """Return {file: (proto, hdr_stack, tx_flags)} as nic_model_parse_fuzz
+    -d prints"""
+    out = subprocess.check_output([model, "-d"] + files)
+    if not isinstance(out, str):
+        out = out.decode()
+    results = {}
+    for line in out.splitlines():
+        name, _, proto, _, hdr_stack, _, tx_flags = line.rsplit(" ", 6)
+        results[name] = (int(proto, 16), int(hdr_stack, 16),
+                         int(tx_flags, 16))
+    return results
+
+def nn_init(rx_args):
+    """Next neighbour registers holding the VXLAN ports the args select"""
+    idx = (rx_args >> NN_IDX_SHF) & NN_IDX_MSK
+    n = (rx_args >> VXLANS_SHF) & VXLANS_MSK
+    lines = []
+    for i in range(n):
+        port = VXLAN_PORT if i == 0 else NN_NO_PORT
+        lines.append(";TEST_INIT_EXEC nfp-reg mereg:i32.me0.NextNeighbor_%d=%#x"
+                     % ((idx + i) % NN_REGS, port))
+    return "\n".join(lines)
+
+def ctm_init(frame):
+    """nfp-mem lines writing the pad, the frame and the zeros after it"""
+    data = bytearray(CTM_PAD) + frame + bytearray(TAIL_PAD)
+    data += bytearray(-len(data) % 16)
+    lines = []
+    for addr in range(0, len(data), 16):
+        words = ["0x%02x%02x%02x%02x" % tuple(data[addr + i:addr + i + 4])
+                 for i in range(0, 16, 4)]
+        lines.append(";TEST_INIT_EXEC nfp-mem i32.ctm:%#05x     %s"
+                     % (CTM_BASE + addr, " ".join(words)))
+    return "\n".join(lines)
+
+def test_name(path):
+    base = re.sub(r"[^0-9A-Za-z]+", "_", os.path.basename(path)).strip("_")
+    return "pv_parse_gen_%s_test.uc" % base
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    parser.add_argument("inputs", nargs="+", help="fuzzer input files")
+    parser.add_argument("-m", "--model", default=MODEL,
+                        help="nic_model_parse_fuzz binary (default %s)"
+                        % MODEL)
+    parser.add_argument("-o", "--out", default=OUT_DIR,
+                        help="test directory (default %s)" % OUT_DIR)
+    args = parser.parse_args()
+
+    results = model_results(args.model, args.inputs)
+    if not os.path.isdir(args.out):
+        os.makedirs(args.out)
+
+    written = 0
+    for path in args.inputs:
+        with open(path, "rb") as in_file_handle:
+            data = bytearray(in_file_handle.read())
+        if len(data) < 2 + 14 or len(data) > 2 + MAX_FRAME:
+            print("%s: skipped, frame of %d bytes" % (path, len(data) - 2))
+            continue
+
+        # pv_hdr_parse as RX_WIRE calls it, see nic_model_parse_fuzz -d
+        rx_args = ((data[0] << 8) | data[1]) & ~ENCAP_BIT
+        frame = data[2:]
+        proto, hdr_stack, tx_flags = results[path]
+
+        test = TEMPLATE.format(name=os.path.basename(path),
+                               nn_init=nn_init(rx_args),
+                               ctm_init=ctm_init(frame),
+                               length=len(frame),
+                               offset=CTM_BASE + CTM_PAD,
+                               flags=tx_flags | FLAGS_WORD,
+                               proto=proto, hdr_stack=hdr_stack,
+                               rx_args=rx_args)
+        with open(os.path.join(args.out, test_name(path)), "w") as out_file:
+            out_file.write(test)
+        written += 1
+
+    print("%d tests written to %s" % (written, args.out))
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
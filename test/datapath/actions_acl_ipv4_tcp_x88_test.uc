@@ -0,0 +1,141 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Table 5 with up to queue 7, again, then up to queue 2 */
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0x0147
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_33=0x0
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_34=0x0147
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_35=0x0
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_36=0x0142
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_37=0x0
+
+#include "pkt_ipv4_tcp_x88.uc"
+
+#include <global.uc>
+#include "actions_harness.uc"
+#include <actions.uc>
+
+hashmap_alloc_fd(ACL_TID, NIC_ACL_KEY_SZ, NIC_ACL_VALUE_SZ, 2000, --, swap, BPF_MAP_TYPE_HASH)
+
+.alloc_mem LM_ACL_RULE_ADDR lmem me 128 128
+
+/* Add the rule for the 5-tuple of the packet, steering to queue 3 */
+#macro test_acl_rule_insert()
+.begin
+    .reg lm_key_offset
+    .reg lm_value_offset
+    .reg tid
+
+    move(lm_key_offset, LM_ACL_RULE_ADDR)
+    local_csr_wr[ACTIVE_LM_ADDR_0, lm_key_offset]
+    alu[lm_value_offset, lm_key_offset, +, 64]
+    alu[tid, --, B, ACL_TID]
+    nop
+
+    move(*l$index0++, ((5 << NIC_ACL_KEY_TABLE_shf) | NIC_ACL_PROTO_IPV4_TCP))
+    move(*l$index0++, 0xc0a80001)
+    move(*l$index0++, 0)
+    move(*l$index0++, 0)
+    move(*l$index0++, 0)
+    move(*l$index0++, 0xc0a80002)
+    move(*l$index0++, 0)
+    move(*l$index0++, 0)
+    move(*l$index0++, 0)
+    move(*l$index0++, 0x04000050)
+
+    local_csr_wr[ACTIVE_LM_ADDR_0, lm_value_offset]
+    nop
+    nop
+    nop
+    move(*l$index0++, ((NIC_ACL_ACT_STEER << NIC_ACL_ACT_shf) | 3))
+    move(*l$index0++, 0)
+
+    #define HASHMAP_RXFR_COUNT 16
+    #define MAP_RDXR $__pv_pkt_data
+
+    #define_eval HASHMAP_TXFR_COUNT 16
+    .reg write $__map_txfr[HASHMAP_TXFR_COUNT]
+    .xfer_order $__map_txfr
+    __hashmap_set($__map_txfr)
+    #define MAP_TXFR $__map_txfr
+
+    #define MAP_RXCAM $__pv_pkt_data[16]
+
+    hashmap_ops(tid,
+                lm_key_offset,
+                lm_value_offset,
+                HASHMAP_OP_ADD_ANY,
+                fail#,
+                fail#,
+                HASHMAP_RTN_LMEM,
+                --,
+                --,
+                --,
+                swap)
+    #undef MAP_RDXR
+    #undef HASHMAP_RXFR_COUNT
+    #undef HASHMAP_TXFR_COUNT
+    #undef MAP_TXFR
+    #undef MAP_RXCAM
+
+    pv_invalidate_cache(pkt_vec)
+.end
+#endm
+
+#macro test_read_cntr(out_cntr, in_idx)
+.begin
+    .reg addr_hi
+    .reg read $cntr[2]
+    .xfer_order $cntr
+    .sig sig_read
+
+    move(addr_hi, ((_nic_acl_cntrs >> 8) & 0xffffffff))
+    mem[read32, $cntr[0], addr_hi, <<8, (in_idx * 8), 2], ctx_swap[sig_read]
+    alu[out_cntr, --, B, $cntr[0]]
+.end
+#endm
+
+.reg cntr
+.reg queue
+.reg selected
+
+actions_init()
+test_action_reset()
+
+/* Miss, the packet passes untouched */
+__actions_acl(pkt_vec, fail#)
+test_assert_equal(__actions_t_idx, (34 * 4))
+bitfield_extract__sz1(selected, BF_AML(pkt_vec, PV_QUEUE_SELECTED_bf))
+test_assert_equal(selected, 0)
+
+test_acl_rule_insert()
+
+/* Hit, steered to queue 3 */
+__actions_acl(pkt_vec, fail#)
+test_assert_equal(__actions_t_idx, (36 * 4))
+bitfield_extract__sz1(queue, BF_AML(pkt_vec, PV_QUEUE_OFFSET_bf))
+test_assert_equal(queue, 3)
+bitfield_extract__sz1(selected, BF_AML(pkt_vec, PV_QUEUE_SELECTED_bf))
+test_assert_equal(selected, 1)
+
+/* Hit, but queue 3 is beyond the vNIC, left to RSS */
+bits_clr(BF_AL(pkt_vec, PV_QUEUE_SELECTED_bf), 1)
+__actions_acl(pkt_vec, fail#)
+test_assert_equal(__actions_t_idx, (38 * 4))
+bitfield_extract__sz1(selected, BF_AML(pkt_vec, PV_QUEUE_SELECTED_bf))
+test_assert_equal(selected, 0)
+
+test_read_cntr(cntr, NIC_ACL_ACT_STEER)
+test_assert_equal(cntr, 2)
+test_read_cntr(cntr, NIC_ACL_ACT_DROP)
+test_assert_equal(cntr, 0)
+
+test_pass()
+
+fail#:
+test_fail()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
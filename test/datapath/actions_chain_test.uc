@@ -0,0 +1,71 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Segment 0: CHAIN fetching the segment at CLS 0x7000, no join */
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0xc0ffee
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_39=0x267001
+
+/* Segment 1: CHAIN joining the fetch, no further fetch */
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_40=0xdeadbeef
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_41=0xfeedf00d
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_47=0x260002
+
+/* Segment 2 */
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_CFG_INSTR_TBL:0x7000 0x1000
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_CFG_INSTR_TBL:0x7004 0x1001
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_CFG_INSTR_TBL:0x7008 0x1002
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_CFG_INSTR_TBL:0x700c 0x1003
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_CFG_INSTR_TBL:0x7010 0x1004
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_CFG_INSTR_TBL:0x7014 0x1005
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_CFG_INSTR_TBL:0x7018 0x1006
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_CFG_INSTR_TBL:0x701c 0x1007
+
+#include <global.uc>
+#include "actions_harness.uc"
+#include <actions.uc>
+
+.reg pkt_vec[PV_SIZE_LW]
+aggregate_zero(pkt_vec, 8)
+
+actions_init()
+test_action_reset()
+
+/* Ensure the action list is setup for this test */
+test_assert_equal($__actions[0], 0xc0ffee)
+test_assert_equal($__actions[7], 0x267001)
+
+/* Execute the CHAIN ending segment 0 */
+immed[__actions_t_idx, ((32 + 7) * 4)]
+__actions_restore_t_idx()
+__actions_chain()
+
+/* The prefetch into the lower half is outstanding */
+test_assert_equal(__actions_chain_pending, 1)
+test_assert_equal(__actions_t_idx, (40 * 4))
+
+/* Execution continues with segment 1 */
+test_assert_equal(*$index++, 0xdeadbeef)
+test_assert_equal(*$index++, 0xfeedf00d)
+
+/* Execute the CHAIN ending segment 1 */
+immed[__actions_t_idx, ((40 + 7) * 4)]
+__actions_restore_t_idx()
+__actions_chain()
+
+test_assert_equal(__actions_chain_pending, 0)
+test_assert_equal(__actions_t_idx, (32 * 4))
+
+/* Execution continues with segment 2 */
+test_assert_equal(*$index++, 0x1000)
+test_assert_equal(*$index++, 0x1001)
+test_assert_equal($__actions[7], 0x1007)
+
+/* Segment 1 is untouched */
+test_assert_equal($__actions[8], 0xdeadbeef)
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
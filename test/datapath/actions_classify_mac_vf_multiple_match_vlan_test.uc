@@ -42,6 +42,7 @@ move(expected_pv_broadcast, 0x02a<<BF_L(PV_VLAN_ID_bf))
 	//modify packet to match modified key
 	move($mem_wr, key[1])
 	mem[write8, $mem_wr, BF_A(pkt_vec, PV_CTM_ADDR_bf), 2, 4], ctx_swap[wr_sig]
+	pv_invalidate_hdr_cache(pkt_vec)
 
 	veb_entry_insert(key, action, continue#)
 continue#:
@@ -0,0 +1,101 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0x11
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_33=0xdeadbeef
+
+#include "actions_harness.uc"
+
+#include "pkt_ipv4_sctp_csum_zero_202B_x88.uc"
+
+#include <single_ctx_test.uc>
+#include <global.uc>
+#include <bitfields.uc>
+
+#define SCTP_CSUM_OFFSET (14 + 20 + 8)
+
+#macro test_read_crc(out_crc)
+.begin
+    .reg addr
+    .reg read $crc
+    .sig sig_read
+
+    move(addr, 0x88)
+    mem[read8, $crc, addr, SCTP_CSUM_OFFSET, 4], ctx_swap[sig_read]
+    alu[out_crc, --, B, $crc]
+.end
+#endm
+
+
+#macro test_write_crc(in_crc)
+.begin
+    .reg addr
+    .reg write $crc
+    .sig sig_write
+
+    move(addr, 0x88)
+    alu[$crc, --, B, in_crc]
+    mem[write8, $crc, addr, SCTP_CSUM_OFFSET, 4], ctx_swap[sig_write]
+.end
+#endm
+
+
+/* The L4 flags of PV_TX_FLAGS, TCP down to CSUM_UDP_OK */
+#macro test_l4_flags(out_flags)
+    alu[out_flags, 0xf, AND, BF_A(pkt_vec, PV_TX_HOST_L4_bf), >>BF_L(PV_TX_HOST_L4_bf)]
+    bits_clr__sz1(BF_AL(pkt_vec, PV_TX_HOST_L4_bf), 0xf)
+#endm
+
+
+.reg crc
+.reg flags
+
+// CRC32c requested by the host (zero in packet)
+bits_clr__sz1(BF_AL(pkt_vec, PV_CSUM_OFFLOAD_bf), 0xf)
+bits_set__sz1(BF_AL(pkt_vec, PV_CSUM_OFFLOAD_OL4_bf), 1)
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_read_crc(crc)
+test_assert_equal(crc, 0x035c6c4e)
+test_l4_flags(flags)
+test_assert_equal(flags, 0)
+
+// CRC32c requested by the host (garbage in packet)
+move(crc, 0x12345678)
+test_write_crc(crc)
+pv_invalidate_cache(pkt_vec)
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_read_crc(crc)
+test_assert_equal(crc, 0x035c6c4e)
+
+// correct CRC32c validated, reported with the TCP flags
+bits_clr__sz1(BF_AL(pkt_vec, PV_CSUM_OFFLOAD_bf), 0xf)
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_l4_flags(flags)
+test_assert_equal(flags, 0xc)
+test_read_crc(crc)
+test_assert_equal(crc, 0x035c6c4e)
+
+// corrupt CRC32c: checked, not correct
+move(crc, 0x035c6c4f)
+test_write_crc(crc)
+pv_invalidate_cache(pkt_vec)
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_l4_flags(flags)
+test_assert_equal(flags, 0x8)
+test_read_crc(crc)
+test_assert_equal(crc, 0x035c6c4f)
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
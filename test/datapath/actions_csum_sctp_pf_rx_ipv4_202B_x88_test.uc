@@ -0,0 +1,66 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* The CHECKSUM of the wire list of a PF without VEB or CHECKSUM_COMPLETE,
+ * V only */
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0x10
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_33=0xdeadbeef
+
+#include "actions_harness.uc"
+
+#include "pkt_ipv4_sctp_csum_zero_202B_x88.uc"
+
+#include <single_ctx_test.uc>
+#include <global.uc>
+#include <bitfields.uc>
+
+#define SCTP_CSUM_OFFSET (14 + 20 + 8)
+
+#macro test_write_crc(in_crc)
+.begin
+    .reg addr
+    .reg write $crc
+    .sig sig_write
+
+    move(addr, 0x88)
+    alu[$crc, --, B, in_crc]
+    mem[write8, $crc, addr, SCTP_CSUM_OFFSET, 4], ctx_swap[sig_write]
+.end
+#endm
+
+
+/* The L4 flags of PV_TX_FLAGS, TCP down to CSUM_UDP_OK */
+#macro test_l4_flags(out_flags)
+    alu[out_flags, 0xf, AND, BF_A(pkt_vec, PV_TX_HOST_L4_bf), >>BF_L(PV_TX_HOST_L4_bf)]
+    bits_clr__sz1(BF_AL(pkt_vec, PV_TX_HOST_L4_bf), 0xf)
+#endm
+
+
+.reg crc
+.reg flags
+
+bits_clr__sz1(BF_AL(pkt_vec, PV_CSUM_OFFLOAD_bf), 0xf)
+
+// zero CRC32c: checked, not correct
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_l4_flags(flags)
+test_assert_equal(flags, 0x8)
+
+// correct CRC32c, reported with the TCP flags
+move(crc, 0x035c6c4e)
+test_write_crc(crc)
+pv_invalidate_cache(pkt_vec)
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_l4_flags(flags)
+test_assert_equal(flags, 0xc)
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
@@ -0,0 +1,108 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0x10
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_33=0xdeadbeef
+
+#include "actions_harness.uc"
+
+#include "pkt_ipv4_udp_vxlan_ipv4_tcp_csums_zero_140B_x88.uc"
+
+#include <single_ctx_test.uc>
+#include <global.uc>
+#include <bitfields.uc>
+
+#macro test_read_csum(out_csum, in_offset)
+.begin
+    .reg addr
+    .reg read $csum
+    .sig sig_read
+
+    move(addr, 0x88)
+    mem[read8, $csum, addr, in_offset, 2], ctx_swap[sig_read]
+    alu[out_csum, --, B, $csum, >>16]
+.end
+#endm
+
+
+#macro test_write_csum(in_offset, in_csum)
+.begin
+    .reg addr
+    .reg write $csum
+    .sig sig_write
+
+    move(addr, 0x88)
+    alu[$csum, --, B, in_csum, <<16]
+    mem[write8, $csum, addr, in_offset, 2], ctx_swap[sig_write]
+.end
+#endm
+
+
+/* The inner checksum flags of PV_TX_FLAGS, I_IP4 down to I_CSUM_UDP_OK */
+#macro test_inner_flags(out_flags)
+    alu[out_flags, 0x3f, AND, BF_A(pkt_vec, PV_TX_HOST_I_CSUM_UDP_OK_bf), >>BF_L(PV_TX_HOST_I_CSUM_UDP_OK_bf)]
+    bits_clr__sz1(BF_AL(pkt_vec, PV_TX_HOST_I_CSUM_UDP_OK_bf), 0x3f)
+#endm
+
+
+.reg csum
+.reg flags
+
+bits_clr__sz1(BF_AL(pkt_vec, PV_CSUM_OFFLOAD_bf), 0xf)
+
+// inner checksums zero in packet: checked, not correct
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_inner_flags(flags)
+test_assert_equal(flags, 0x28)
+test_read_csum(csum, 0x4a)
+test_assert_equal(csum, 0)
+test_read_csum(csum, 0x64)
+test_assert_equal(csum, 0)
+
+// correct inner IPv4 checksum
+immed[csum, 0x7492]
+test_write_csum(0x4a, csum)
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_inner_flags(flags)
+test_assert_equal(flags, 0x38)
+
+// correct inner TCP checksum
+immed[csum, 0x5106]
+test_write_csum(0x64, csum)
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_inner_flags(flags)
+test_assert_equal(flags, 0x3c)
+test_read_csum(csum, 0x4a)
+test_assert_equal(csum, 0x7492)
+test_read_csum(csum, 0x64)
+test_assert_equal(csum, 0x5106)
+
+// corrupt inner TCP checksum
+immed[csum, 0x5107]
+test_write_csum(0x64, csum)
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_inner_flags(flags)
+test_assert_equal(flags, 0x38)
+
+// packets that are not tunnelled are left to the MAC checksum flags
+move(pkt_vec[3], 0x02)
+test_action_reset()
+__actions_checksum(pkt_vec)
+test_assert_equal(*$index, 0xdeadbeef)
+test_inner_flags(flags)
+test_assert_equal(flags, 0)
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
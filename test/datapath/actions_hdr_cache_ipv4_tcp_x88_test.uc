@@ -0,0 +1,65 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0xf0bf
+
+#include "pkt_ipv4_tcp_x88.uc"
+
+#include "actions_rss.uc"
+
+.reg cached
+.reg hdr_addr
+.reg write $addrs[2]
+.xfer_order $addrs
+.sig sig_write
+
+/* The first action to need the headers copies them */
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, 0x3bf00e81)
+
+bitfield_extract__sz1(cached, BF_AML(pkt_vec, PV_HDR_CACHED_bf))
+test_assert_equal(cached, 1)
+
+immed[hdr_addr, __actions_hdr_cache]
+alu[hdr_addr, hdr_addr, OR, t_idx_ctx, >>2]
+local_csr_wr[ACTIVE_LM_ADDR_0, hdr_addr]
+nop
+nop
+nop
+
+test_assert_equal(*l$index0[1], 0xc0a80001)
+test_assert_equal(*l$index0[2], 0)
+test_assert_equal(*l$index0[3], 0)
+test_assert_equal(*l$index0[4], 0)
+test_assert_equal(*l$index0[5], 0xc0a80002)
+test_assert_equal(*l$index0[6], 0)
+test_assert_equal(*l$index0[7], 0)
+test_assert_equal(*l$index0[8], 0)
+test_assert_equal(*l$index0[9], 0x04000050)
+test_assert_equal(*l$index0[10], 0x00000088)
+test_assert_equal(*l$index0[11], 0x88889999)
+test_assert_equal(*l$index0[12], 0x9999aaaa)
+test_assert_equal(*l$index0[13], 0xaaaa0000)
+
+/* Later actions use the copy, not the packet */
+move($addrs[0], 0xc0a80002)
+move($addrs[1], 0xc0a80001)
+mem[write8, $addrs[0], BF_A(pkt_vec, PV_CTM_ADDR_bf), (14 + 12), 8], ctx_swap[sig_write]
+
+rss_reset_test(pkt_vec)
+bits_set__sz1(BF_AL(pkt_vec, PV_HDR_CACHED_bf), BF_MASK(PV_HDR_CACHED_bf))
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, 0x3bf00e81)
+
+/* Until the copy is invalidated */
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_unequal, 0x3bf00e81)
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
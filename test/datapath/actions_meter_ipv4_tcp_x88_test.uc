@@ -0,0 +1,93 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Entry 3, no marking, then marking to DSCP 10 */
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0x0003
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_33=0x0003
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_34=0x8a03
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_35=0x8a03
+
+/* Entry 3: empty buckets, PBS two packets, CBS one packet, no refill */
+;TEST_INIT_EXEC nfp-rtsym _nic_meter_tbl:0x60 0x0
+;TEST_INIT_EXEC nfp-rtsym _nic_meter_tbl:0x64 0x0
+;TEST_INIT_EXEC nfp-rtsym _nic_meter_tbl:0x68 0x0
+;TEST_INIT_EXEC nfp-rtsym _nic_meter_tbl:0x6c 0x0
+;TEST_INIT_EXEC nfp-rtsym _nic_meter_tbl:0x70 0x8400
+;TEST_INIT_EXEC nfp-rtsym _nic_meter_tbl:0x74 0x4200
+;TEST_INIT_EXEC nfp-rtsym _nic_meter_tbl:0x78 0x0
+;TEST_INIT_EXEC nfp-rtsym _nic_meter_tbl:0x7c 0x0
+
+#include "pkt_ipv4_tcp_x88.uc"
+
+#include <global.uc>
+#include "actions_harness.uc"
+#include <actions.uc>
+
+#macro test_read_deficits(out_dp, out_dc)
+.begin
+    .reg addr_hi
+    .reg read $deficit[2]
+    .xfer_order $deficit
+    .sig sig_read
+
+    move(addr_hi, ((_nic_meter_tbl >> 8) & 0xffffffff))
+    mem[read32, $deficit[0], addr_hi, <<8, (3 * NIC_METER_ENTRY_SZ), 2], ctx_swap[sig_read]
+    alu[out_dp, --, B, $deficit[0]]
+    alu[out_dc, --, B, $deficit[1]]
+.end
+#endm
+
+.reg dp
+.reg dc
+.reg addr
+.reg read $ip[4]
+.xfer_order $ip
+.sig sig_read
+
+actions_init()
+test_action_reset()
+
+/* Green, fills the committed bucket */
+__actions_meter(pkt_vec, fail#)
+test_read_deficits(dp, dc)
+test_assert_equal(dp, (66 << NIC_METER_FRAC_SHF))
+test_assert_equal(dc, (66 << NIC_METER_FRAC_SHF))
+
+/* Yellow without marking is dropped and leaves the buckets as they were */
+__actions_meter(pkt_vec, drop_yellow#)
+br[fail#]
+drop_yellow#:
+test_read_deficits(dp, dc)
+test_assert_equal(dp, (66 << NIC_METER_FRAC_SHF))
+test_assert_equal(dc, (66 << NIC_METER_FRAC_SHF))
+
+/* Yellow with marking fills the peak bucket and remarks the packet */
+__actions_meter(pkt_vec, fail#)
+test_read_deficits(dp, dc)
+test_assert_equal(dp, (132 << NIC_METER_FRAC_SHF))
+test_assert_equal(dc, (66 << NIC_METER_FRAC_SHF))
+
+move(addr, 0x94)
+mem[read32, $ip[0], addr, 0, 4], ctx_swap[sig_read]
+test_assert_equal($ip[0], 0x08004528)
+test_assert_equal($ip[1], 0x00340000)
+test_assert_equal($ip[2], 0x00004006)
+test_assert_equal($ip[3], 0xf948c0a8)
+
+/* Red */
+__actions_meter(pkt_vec, drop_red#)
+br[fail#]
+drop_red#:
+test_read_deficits(dp, dc)
+test_assert_equal(dp, (132 << NIC_METER_FRAC_SHF))
+test_assert_equal(dc, (66 << NIC_METER_FRAC_SHF))
+
+test_pass()
+
+fail#:
+test_fail()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
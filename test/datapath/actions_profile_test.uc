@@ -0,0 +1,81 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define ACTIONS_PROFILE_ENABLE
+
+#include <global.uc>
+#include "actions_harness.uc"
+#include <actions.uc>
+
+#macro test_lm_read(out_val, in_lm_addr)
+    local_csr_wr[ACTIVE_LM_ADDR_0, in_lm_addr]
+    nop
+    nop
+    nop
+    alu[out_val, --, B, *l$index0]
+#endm
+
+.reg pkt_vec[PV_SIZE_LW]
+.reg addr_hi
+.reg rss_cnt
+.reg tx_host_cnt
+.reg val
+.reg read $cntr[8]
+.xfer_order $cntr
+.sig sig_read
+
+actions_init()
+
+/* RSS and TX_HOST counters of this ME are adjacent */
+move(addr_hi, ((ACTIONS_PROFILE_ME_ADDR >> 8) & 0xffffffff))
+mem[read32, $cntr[0], addr_hi, <<8, (INSTR_RSS * 16), 8], ctx_swap[sig_read]
+alu[rss_cnt, $cntr[0], +, 1]
+alu[tx_host_cnt, $cntr[4], +, 1]
+
+/* RSS followed by TX_HOST */
+__actions_profile(INSTR_RSS)
+__actions_profile(INSTR_TX_HOST)
+actions_profile_end()
+
+test_lm_read(val, (_actions_profile_lm + (INSTR_RSS * 8)))
+test_assert_equal(val, 1)
+test_lm_read(val, (_actions_profile_lm + (INSTR_TX_HOST * 8)))
+test_assert_equal(val, 1)
+test_lm_read(val, (_actions_profile_lm + ACTIONS_PROFILE_LM_IDLE))
+test_assert_equal(val, 1)
+test_lm_read(val, (_actions_profile_lm + (INSTR_CHECKSUM * 8)))
+test_assert_equal(val, 0)
+
+/* Within the flush interval started by actions_init() */
+actions_profile_flush()
+
+test_lm_read(val, (_actions_profile_lm + (INSTR_RSS * 8)))
+test_assert_equal(val, 1)
+
+/* Expire the flush interval */
+local_csr_rd[TIMESTAMP_LOW]
+immed[val, 0]
+alu[val, val, -, 1, <<ACTIONS_PROFILE_FLUSH_SHF]
+local_csr_wr[ACTIVE_LM_ADDR_0, (_actions_profile_lm + ACTIONS_PROFILE_LM_FLUSH)]
+nop
+nop
+nop
+alu[*l$index0, --, B, val]
+
+actions_profile_flush()
+
+test_lm_read(val, (_actions_profile_lm + (INSTR_RSS * 8)))
+test_assert_equal(val, 0)
+test_lm_read(val, (_actions_profile_lm + (INSTR_TX_HOST * 8)))
+test_assert_equal(val, 0)
+
+mem[read32, $cntr[0], addr_hi, <<8, (INSTR_RSS * 16), 8], ctx_swap[sig_read]
+test_assert_equal($cntr[0], rss_cnt)
+test_assert_equal($cntr[4], tx_host_cnt)
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
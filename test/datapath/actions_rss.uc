@@ -4,7 +4,12 @@
  */
 
 ;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_33=0xc0ffee
-;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_34=0xdeadbeef
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_35=0xdeadbeef
+
+/* Tests of the Toeplitz and symmetric modes set word 2 themselves */
+#ifndef RSS_TEST_HASH_MODE
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_34=0x0
+#endif
 
 ;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_TBL:0   0
 ;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_TBL:4   0
@@ -83,12 +88,16 @@
 local_csr_wr[NN_GET, 96]
 
 test_assert_equal($__actions[1], 0xc0ffee)
-test_assert_equal($__actions[2], 0xdeadbeef)
+#ifndef RSS_TEST_HASH_MODE
+test_assert_equal($__actions[2], 0x0)
+#endif
+test_assert_equal($__actions[3], 0xdeadbeef)
 
 #macro rss_reset_test(in_pkt_vec)
     local_csr_wr[T_INDEX, (32 * 4)]
     immed[__actions_t_idx, (32 * 4)]
     pv_invalidate_cache(in_pkt_vec)
+    pv_invalidate_hdr_cache(in_pkt_vec)
     immed[BF_A(in_pkt_vec, PV_QUEUE_OFFSET_bf), 0]
     immed[BF_A(in_pkt_vec, PV_META_TYPES_bf), 0]
 #endm
@@ -0,0 +1,82 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0xf0bf
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_34=0x3
+
+/* Key of table 1, the verification key of the Microsoft RSS specification */
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:64  0x6d5a56da
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:68  0x255b0ec2
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:72  0x4167253d
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:76  0x43a38fb0
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:80  0xd0ca2bcb
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:84  0xae7b30b4
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:88  0x77cb2da3
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:92  0x8030f20c
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:96  0x6a42b73b
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:100 0xbeac01fa
+
+#define RSS_TEST_HASH_MODE
+
+#include "pkt_ipv4_tcp_x88.uc"
+
+#include "actions_rss.uc"
+
+/* Swap LEN bytes at OFFSET_A and OFFSET_B of the packet */
+#macro rss_swap_bytes(in_pkt_vec, OFFSET_A, OFFSET_B, LEN)
+.begin
+    .reg read $a
+    .reg read $b
+    .reg write $wa
+    .reg write $wb
+    .reg offset_a
+    .reg offset_b
+    .sig sig_a
+    .sig sig_b
+
+    move(offset_a, OFFSET_A)
+    move(offset_b, OFFSET_B)
+    mem[read8, $a, BF_A(in_pkt_vec, PV_CTM_ADDR_bf), offset_a, LEN], sig_done[sig_a]
+    mem[read8, $b, BF_A(in_pkt_vec, PV_CTM_ADDR_bf), offset_b, LEN], sig_done[sig_b]
+    ctx_arb[sig_a, sig_b]
+    alu[$wa, --, B, $b]
+    alu[$wb, --, B, $a]
+    mem[write8, $wa, BF_A(in_pkt_vec, PV_CTM_ADDR_bf), offset_a, LEN], sig_done[sig_a]
+    mem[write8, $wb, BF_A(in_pkt_vec, PV_CTM_ADDR_bf), offset_b, LEN], sig_done[sig_b]
+    ctx_arb[sig_a, sig_b]
+.end
+#endm
+
+test_assert_equal($__actions[2], 0x3)
+
+/* 192.168.0.1:1024 -> 192.168.0.2:80, hashed as 192.168.0.1:80 ->
+ * 192.168.0.2:1024 */
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, 0x1b85bd5a)
+
+/* The reply direction hashes the same */
+rss_swap_bytes(pkt_vec, (14 + 12), (14 + 16), 4)
+rss_swap_bytes(pkt_vec, (14 + 20), (14 + 22), 2)
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, 0x1b85bd5a)
+
+/* So do the addresses or the ports alone swapped */
+rss_swap_bytes(pkt_vec, (14 + 12), (14 + 16), 4)
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, 0x1b85bd5a)
+
+rss_swap_bytes(pkt_vec, (14 + 12), (14 + 16), 4)
+rss_swap_bytes(pkt_vec, (14 + 20), (14 + 22), 2)
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, 0x1b85bd5a)
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
@@ -0,0 +1,44 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0xf0bf
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_34=0x2
+
+/* Key of table 1, the verification key of the Microsoft RSS specification */
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:64  0x6d5a56da
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:68  0x255b0ec2
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:72  0x4167253d
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:76  0x43a38fb0
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:80  0xd0ca2bcb
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:84  0xae7b30b4
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:88  0x77cb2da3
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:92  0x8030f20c
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:96  0x6a42b73b
+;TEST_INIT_EXEC nfp-rtsym i32.NIC_RSS_KEY_TBL:100 0xbeac01fa
+
+#define RSS_TEST_HASH_MODE
+
+#include "pkt_ipv4_tcp_x88.uc"
+
+#include "actions_rss.uc"
+
+.reg pkt_len
+pv_get_length(pkt_len, pkt_vec)
+
+test_assert_equal($__actions[2], 0x2)
+
+/* 192.168.0.1:1024 -> 192.168.0.2:80 */
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, 0xf730a57b)
+
+rss_validate_range(pkt_vec, NFP_NET_RSS_IPV4_TCP, excl, 0, (14 + 12))
+rss_validate_range(pkt_vec, NFP_NET_RSS_IPV4_TCP, incl, (14 + 12), (14 + 12 + 8 + 4))
+rss_validate_range(pkt_vec, NFP_NET_RSS_IPV4_TCP, excl, (14 + 12 + 8 + 4), pkt_len)
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
@@ -0,0 +1,147 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Table 1, up to queue 0x3f, looked up in _nic_rfs_tbl */
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0xf0bf
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_34=0x80000000
+
+#define RSS_TEST_HASH_MODE
+
+#include "pkt_ipv4_tcp_x88.uc"
+
+#include "actions_rss.uc"
+
+#define TEST_HASH       0x3bf00e81
+#define TEST_WAY        1
+
+/* bitrev32(crc32c(~0, tuple, 36)) of 192.168.0.1:1024 > 192.168.0.2:80 */
+#define TEST_FLOW_ID    0xabfa6de0
+
+.reg now
+.reg queue
+.reg stamp
+.reg entry_addr
+.reg rfs_base
+
+/* Write way TEST_WAY of the bucket of TEST_HASH for table 1 */
+#macro test_rfs_write(in_hash, in_word1, in_flow_id)
+.begin
+    .reg write $entry[NIC_RFS_ENTRY_LW]
+    .xfer_order $entry
+    .sig sig_write
+
+    alu[$entry[0], --, B, in_hash]
+    alu[$entry[1], --, B, in_word1]
+    move($entry[2], in_flow_id)
+    immed[$entry[3], 0]
+    mem[write32, $entry[0], rfs_base, <<8, entry_addr, NIC_RFS_ENTRY_LW], ctx_swap[sig_write]
+.end
+#endm
+
+#macro test_rfs_write(in_hash, in_word1)
+    test_rfs_write(in_hash, in_word1, TEST_FLOW_ID)
+#endm
+
+#macro test_rfs_now()
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[now, 0]
+    alu[now, --, B, now, >>NIC_RFS_STAMP_SHF]
+#endm
+
+#macro test_rfs_check_queue(in_queue)
+.begin
+    .reg meta_type
+    .reg queue_offset
+
+    alu[meta_type, 0xf, AND, BF_A(pkt_vec, PV_META_TYPES_bf)]
+    test_assert_equal(meta_type, NFP_NET_META_HASH)
+    alu[queue_offset, 0xff, AND, BF_A(pkt_vec, PV_QUEUE_OFFSET_bf)]
+    test_assert_equal(queue_offset, in_queue)
+.end
+#endm
+
+test_assert_equal($__actions[2], 0x80000000)
+
+move(rfs_base, ((_nic_rfs_tbl >> 8) & 0xffffffff))
+move(entry_addr, ((((TEST_HASH ^ 1) & (NIC_RFS_BUCKETS - 1)) << NIC_RFS_BUCKET_SHF) + (TEST_WAY * NIC_RFS_ENTRY_SZ)))
+
+/* No entry, the RSS table selects the queue */
+test_rfs_write(0, 0)
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, TEST_HASH)
+
+/* Steered to queue 5 */
+test_rfs_now()
+alu[stamp, now, OR, ((1 << (NIC_RFS_VALID_bit - NIC_RFS_TBL_shf)) | 1), <<NIC_RFS_TBL_shf]
+alu[stamp, stamp, OR, 5, <<NIC_RFS_QUEUE_shf]
+test_rfs_write(TEST_HASH, stamp)
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+test_rfs_check_queue(5)
+
+/* The same hash with another flow ID is another flow */
+test_rfs_write(TEST_HASH, stamp, (TEST_FLOW_ID ^ 1))
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, TEST_HASH)
+
+/* The same hash of table 2 is another flow */
+alu[stamp, stamp, XOR, 3, <<NIC_RFS_TBL_shf]
+test_rfs_write(TEST_HASH, stamp)
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, TEST_HASH)
+
+/* Queue 0x40 is beyond the vNIC */
+test_rfs_now()
+alu[stamp, now, OR, ((1 << (NIC_RFS_VALID_bit - NIC_RFS_TBL_shf)) | 1), <<NIC_RFS_TBL_shf]
+alu[stamp, stamp, OR, 0x40, <<NIC_RFS_QUEUE_shf]
+test_rfs_write(TEST_HASH, stamp)
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, TEST_HASH)
+
+/* Expired */
+test_rfs_now()
+alu[stamp, now, -, 1, <<NIC_RFS_TIMEOUT_SHF]
+ld_field_w_clr[stamp, 0011, stamp]
+alu[stamp, stamp, OR, ((1 << (NIC_RFS_VALID_bit - NIC_RFS_TBL_shf)) | 1), <<NIC_RFS_TBL_shf]
+alu[stamp, stamp, OR, 5, <<NIC_RFS_QUEUE_shf]
+test_rfs_write(TEST_HASH, stamp)
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+rss_validate(pkt_vec, NFP_NET_RSS_IPV4_TCP, test_assert_equal, TEST_HASH)
+
+/* Due a refresh, steered and the stamp brought up to date */
+test_rfs_now()
+alu[stamp, now, -, 1, <<NIC_RFS_TOUCH_SHF]
+ld_field_w_clr[stamp, 0011, stamp]
+alu[stamp, stamp, OR, ((1 << (NIC_RFS_VALID_bit - NIC_RFS_TBL_shf)) | 1), <<NIC_RFS_TBL_shf]
+alu[stamp, stamp, OR, 7, <<NIC_RFS_QUEUE_shf]
+test_rfs_write(TEST_HASH, stamp)
+rss_reset_test(pkt_vec)
+__actions_rss(pkt_vec)
+test_rfs_check_queue(7)
+
+.begin
+    .reg read $entry[NIC_RFS_ENTRY_LW]
+    .xfer_order $entry
+    .sig sig_read
+
+    mem[read32, $entry[0], rfs_base, <<8, entry_addr, NIC_RFS_ENTRY_LW], ctx_swap[sig_read]
+    test_assert_equal($entry[0], TEST_HASH)
+    test_assert_equal($entry[NIC_RFS_FLOW_ID_wrd], TEST_FLOW_ID)
+    alu[stamp, --, B, $entry[1]]
+    ld_field_w_clr[stamp, 0011, stamp]
+    alu[stamp, now, -, stamp]
+    ld_field_w_clr[stamp, 0011, stamp]
+    test_assert(stamp < NIC_RFS_TOUCH)
+.end
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
@@ -0,0 +1,62 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Snap length 128, never sampled, then always sampled */
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0x0080
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_33=0x0
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_34=0x0080
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_35=0xffffffff
+
+#include "pkt_ipv4_tcp_x88.uc"
+
+#include <global.uc>
+#include "actions_harness.uc"
+#include <actions.uc>
+
+#macro test_read_cntr(out_cntr, in_idx)
+.begin
+    .reg addr_hi
+    .reg read $cntr[2]
+    .xfer_order $cntr
+    .sig sig_read
+
+    move(addr_hi, ((_nic_sample_cntrs >> 8) & 0xffffffff))
+    mem[read32, $cntr[0], addr_hi, <<8, (in_idx * 8), 2], ctx_swap[sig_read]
+    alu[out_cntr, --, B, $cntr[0]]
+.end
+#endm
+
+.reg cntr
+.reg addr
+.reg read $hdr[4]
+.xfer_order $hdr
+.sig sig_read
+
+actions_init()
+test_action_reset()
+
+/* Threshold 0 is below any PSEUDO_RANDOM_NUMBER, nothing is touched */
+__actions_sample(pkt_vec)
+test_assert_equal(__actions_t_idx, (34 * 4))
+
+move(addr, (0x88 - NIC_SAMPLE_HEADROOM))
+mem[read32, $hdr[0], addr, 0, 4], ctx_swap[sig_read]
+test_assert_equal($hdr[0], 0)
+test_assert_equal($hdr[1], 0)
+
+/* Always sampled, but too little headroom for the message */
+move(pkt_vec[2], (NIC_SAMPLE_MIN_OFFSET - 4))
+__actions_sample(pkt_vec)
+test_assert_equal(__actions_t_idx, (36 * 4))
+
+test_read_cntr(cntr, NIC_SAMPLE_CNTR_NO_ROOM)
+test_assert_equal(cntr, 1)
+test_read_cntr(cntr, NIC_SAMPLE_CNTR_TX)
+test_assert_equal(cntr, 0)
+
+test_pass()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
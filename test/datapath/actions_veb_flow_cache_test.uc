@@ -0,0 +1,71 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Resolved list in $__actions */
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_32=0xc0ffee
+;TEST_INIT_EXEC nfp-reg mereg:i32.me0.XferIn_33=0xdeadbeef
+
+/* Entry of another VLAN at the index of the key below */
+;TEST_INIT_EXEC nfp-rtsym i32._flow_cache:0x40 0x1000
+;TEST_INIT_EXEC nfp-rtsym i32._flow_cache:0x74 0x00680001
+;TEST_INIT_EXEC nfp-rtsym i32._flow_cache:0x78 0x02030405
+;TEST_INIT_EXEC nfp-rtsym i32._flow_cache:0x7c 0x0
+
+#define NIC_FLOW_CACHE
+
+#include <global.uc>
+#include "actions_harness.uc"
+#include <actions.uc>
+
+.reg pkt_vec[PV_SIZE_LW]
+.reg cache_addr
+.reg cache_key[2]
+.reg cache_tag[3]
+.reg gen_addr
+.reg write $gen
+.sig sig_gen
+
+actions_init()
+test_action_reset()
+
+/* VLAN 5, MAC 00:01:02:03:04:05 */
+immed32(cache_key[0], 0x00500001)
+immed32(cache_key[1], 0x02030405)
+
+flow_cache_lookup(cache_addr, cache_tag, cache_key, miss#, fail#)
+test_fail()
+
+miss#:
+test_assert_equal(cache_addr, 0x40)
+test_assert_equal(cache_tag[0], 0x00580001)
+test_assert_equal(cache_tag[1], 0x02030405)
+test_assert_equal(cache_tag[2], 0)
+test_assert_equal($__actions[0], 0xc0ffee)
+
+flow_cache_insert(cache_addr, cache_tag)
+
+flow_cache_lookup(cache_addr, cache_tag, cache_key, fail#, fail#)
+test_assert_equal($__actions[0], 0xc0ffee)
+test_assert_equal($__actions[1], 0xdeadbeef)
+test_assert_equal($__actions[13], 0x00580001)
+
+/* A new generation invalidates the entry */
+immed[$gen, 1]
+move(gen_addr, ((FLOW_CACHE_GEN >> 8) & 0xffffffff))
+mem[write32, $gen, gen_addr, <<8, (FLOW_CACHE_GEN & 0xff), 1], ctx_swap[sig_gen]
+
+flow_cache_lookup(cache_addr, cache_tag, cache_key, stale#, fail#)
+test_fail()
+
+stale#:
+test_assert_equal(cache_tag[2], 1)
+
+test_pass()
+
+fail#:
+test_fail()
+
+PV_SEEK_SUBROUTINE#:
+   pv_seek_subroutine(pkt_vec)
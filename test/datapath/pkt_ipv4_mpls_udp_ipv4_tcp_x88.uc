@@ -0,0 +1,30 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x080     0x00000000 0x00000000 0x00154d00 0x00010015
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x090     0x4d0000f0 0x08004500 0x00703333 0x40004011
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0a0     0xf3470a00 0x00010a00 0x0002c000 0x19eb005c
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0b0     0x00000006 0x41404500 0x00501111 0x40004006
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0c0     0xa643c0a8 0x0101c0a8 0x01020400 0x00501234
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0d0     0x56780000 0x00005018 0xffff0000 0x00002021
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0e0     0x22232425 0x26272829 0x2a2b2c2d 0x2e2f3031
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0f0     0x32333435 0x36373839 0x3a3b3c3d 0x3e3f4041
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x100     0x42434445 0x46470000 0x00000000 0x00000000
+
+
+#include <aggregate.uc>
+#include <stdmac.uc>
+
+#include <pv.uc>
+
+.reg pkt_vec[PV_SIZE_LW]
+aggregate_zero(pkt_vec, PV_SIZE_LW)
+move(pkt_vec[0], 0x7e)
+move(pkt_vec[2], 0x88)
+move(pkt_vec[3], 0x62)
+move(pkt_vec[4], 0x3fc0)
+move(pkt_vec[5], ((14 << 24) | ((14 + 20) << 16) |
+                 ((14 + 20 + 8 + 4) << 8) |
+                 (14 + 20 + 8 + 4 + 20)))
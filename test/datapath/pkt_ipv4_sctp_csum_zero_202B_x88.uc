@@ -0,0 +1,47 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x88  0x00154d0a 0x0d1a6805
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x90  0xca306ab8 0x08004500 0x00bc1234 0x40004084
+;TEST_INIT_EXEC nfp-mem i32.ctm:0xa0  0x13880a00 0x00010a00 0x00020b59 0x0b591234
+;TEST_INIT_EXEC nfp-mem i32.ctm:0xb0  0x56780000 0x00000003 0x009c0000 0x10000001
+;TEST_INIT_EXEC nfp-mem i32.ctm:0xc0  0x00000000 0x0003030a 0x11181f26 0x2d343b42
+;TEST_INIT_EXEC nfp-mem i32.ctm:0xd0  0x4950575e 0x656c737a 0x81888f96 0x9da4abb2
+;TEST_INIT_EXEC nfp-mem i32.ctm:0xe0  0xb9c0c7ce 0xd5dce3ea 0xf1f8ff06 0x0d141b22
+;TEST_INIT_EXEC nfp-mem i32.ctm:0xf0  0x2930373e 0x454c535a 0x61686f76 0x7d848b92
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x100 0x99a0a7ae 0xb5bcc3ca 0xd1d8dfe6 0xedf4fb02
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x110 0x0910171e 0x252c333a 0x41484f56 0x5d646b72
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x120 0x7980878e 0x959ca3aa 0xb1b8bfc6 0xcdd4dbe2
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x130 0xe9f0f7fe 0x050c131a 0x21282f36 0x3d444b52
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x140 0x5960676e 0x757c838a 0x91989fa6 0xadb4bbc2
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x150 0xc9d00000
+
+// Correct SCTP CRC32c: 0x035c6c4e (as read from the packet)
+
+#include <aggregate.uc>
+#include <stdmac.uc>
+
+#include <pv.uc>
+
+.reg pkt_num
+move(pkt_num, 0)
+.while(pkt_num < 0x100)
+    pkt_buf_free_ctm_buffer(--, pkt_num)
+    alu[pkt_num, pkt_num, +, 1]
+.endw
+pkt_buf_alloc_ctm(pkt_num, 3, --, test_fail)
+test_assert_equal(pkt_num, 0)
+
+.reg pkt_vec[PV_SIZE_LW]
+aggregate_zero(pkt_vec, PV_SIZE_LW)
+
+bits_set__sz1(BF_AL(pkt_vec, PV_CTM_ALLOCATED_bf), 1)
+bits_set__sz1(BF_AL(pkt_vec, PV_CBS_bf), 3)
+alu[BF_A(pkt_vec, PV_OFFSET_bf), BF_A(pkt_vec, PV_OFFSET_bf), OR, 0x88]
+
+move(pkt_vec[0], 202)
+move(pkt_vec[3], 0x06)
+move(pkt_vec[4], 0x3fc0)
+move(pkt_vec[5], 0x0e000e00)
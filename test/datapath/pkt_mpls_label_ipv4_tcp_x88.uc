@@ -0,0 +1,26 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x080     0x00000000 0x00000000 0x00154d00 0x00010015
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x090     0x4d0000f0 0x88470006 0x41404500 0x00501111
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0a0     0x40004006 0xa643c0a8 0x0101c0a8 0x01020400
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0b0     0x00501234 0x56780000 0x00005018 0xffff0000
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0c0     0x00002021 0x22232425 0x26272829 0x2a2b2c2d
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0d0     0x2e2f3031 0x32333435 0x36373839 0x3a3b3c3d
+;TEST_INIT_EXEC nfp-mem i32.ctm:0x0e0     0x3e3f4041 0x42434445 0x46470000 0x00000000
+
+
+#include <aggregate.uc>
+#include <stdmac.uc>
+
+#include <pv.uc>
+
+.reg pkt_vec[PV_SIZE_LW]
+aggregate_zero(pkt_vec, PV_SIZE_LW)
+move(pkt_vec[0], 0x62)
+move(pkt_vec[2], 0x88)
+move(pkt_vec[3], 0x42)
+move(pkt_vec[4], 0x3fc0)
+move(pkt_vec[5], (((14 + 4) << 24) | ((14 + 4 + 20) << 16) | ((14 + 4) << 8) | (14 + 4 + 20)))
@@ -43,7 +43,7 @@ mem[write32, $out_nfd_desc[0], 0, <<8, addrlo, NFD_IN_META_SIZE_LW], ctx_swap[s]
 mem[read32, $in_nfd_desc[0], 0, <<8, addrlo, NFD_IN_META_SIZE_LW], ctx_swap[s]
 
 
-// try PROTO_IPV4_UDP_VXLAN_IPV6_UDP, PROTO_IPV4_UDP_VXLAN_IPV6_UNKNOWN, PROTO_IPV4_UDP_VXLAN_IPV6_FRAGMENT
+// try PROTO_IPV4_UDP_VXLAN_IPV6_UNKNOWN, PROTO_IPV4_UDP_VXLAN_IPV6_FRAGMENT
 
 #define_eval _PV_OUTER_L3_OFFSET (14)
 #define_eval _PV_OUTER_L4_OFFSET (14 + 20)
@@ -52,18 +52,13 @@ mem[read32, $in_nfd_desc[0], 0, <<8, addrlo, NFD_IN_META_SIZE_LW], ctx_swap[s]
 
 move(addrhi, ((0x13000000 << 3) & 0xffffffff))
 
-move(loop_cnt, 0)
+move(loop_cnt, 1)
 
 .while (loop_cnt < 3)
 
     // pv_init_nfd() does this
     pv_seek(pkt_vec, ETH_MAC_SIZE, PV_SEEK_INIT)
-    .if (loop_cnt == 0)
-        move(pkt_vec[3], PROTO_IPV4_UDP_VXLAN_IPV6_UDP)
-        move(pkt_vec[5], ((_PV_OUTER_L3_OFFSET << 24) | (_PV_OUTER_L4_OFFSET << 16) | \
-                      (_PV_INNER_L3_OFFSET <<  8) | (_PV_INNER_L4_OFFSET <<  0)))
-
-    .elif (loop_cnt == 1)
+    .if (loop_cnt == 1)
         move(pkt_vec[3], PROTO_IPV4_UDP_VXLAN_IPV6_UNKNOWN)
         move(pkt_vec[5], ((_PV_OUTER_L3_OFFSET << 24) | (_PV_INNER_L3_OFFSET <<  8)))
     .else
@@ -85,12 +80,7 @@ error#:
     move(expected[0], 0xa0)
     move(expected[1], 0x13000000)
     move(expected[2], 0x80)
-    .if (loop_cnt == 0)
-        move(expected[3], PROTO_IPV4_UDP_VXLAN_IPV6_UDP)
-        move(expected[5], ((_PV_OUTER_L3_OFFSET << 24) | (_PV_OUTER_L4_OFFSET << 16) | \
-                       (_PV_INNER_L3_OFFSET <<  8) | (_PV_INNER_L4_OFFSET <<  0)))
-
-    .elif (loop_cnt == 1)
+    .if (loop_cnt == 1)
         move(expected[3], PROTO_IPV4_UDP_VXLAN_IPV6_UNKNOWN)
         move(expected[5], ((_PV_OUTER_L3_OFFSET << 24) | (_PV_INNER_L3_OFFSET <<  8)))
 
@@ -0,0 +1,125 @@
+/* Copyright (c) 2020  Netronome Systems, Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <single_ctx_test.uc>
+
+#include "pkt_inc_pat_9K_x88.uc"
+
+#include <config.h>
+#include <gro_cfg.uc>
+#include <global.uc>
+#include <pv.uc>
+#include <stdmac.uc>
+
+#macro fail_alloc_macro
+    br[fail#]
+#endm
+
+/* Offset of the first 64B chunk past the end of the packet data */
+#define END_OFFSET 9152
+
+.reg ahead
+.reg increment
+.reg offset
+.reg expected
+.reg tested
+.reg tibi
+.reg pkt_num
+.reg stamp
+.sig sig_half0
+.sig sig_half1
+
+#define PKT_NUM_i 0
+#while PKT_NUM_i < 0x100
+    move(pkt_num, PKT_NUM_i)
+    pkt_buf_free_ctm_buffer(--, pkt_num)
+    #define_eval PKT_NUM_i (PKT_NUM_i + 1)
+#endloop
+#undef PKT_NUM_i
+
+pkt_buf_alloc_ctm(pkt_num, 3, fail#, fail_alloc_macro)
+
+test_assert_equal(pkt_num, 0)
+
+move(pkt_vec[2], 0x80000088)
+
+/* Offsets include the 2B pad, the first aligned chunk starts at byte 62 */
+move(offset, 64)
+move(increment, 0x00020002)
+move(expected, 0x00200021)
+
+test_cycles_start(stamp)
+
+pv_invalidate_cache(pkt_vec)
+pv_read_ahead(pkt_vec, offset, 0, sig_half0, fail#)
+br[half0#]
+
+#define_eval _HALF (0)
+#while (_HALF < 2)
+    #define_eval _OTHER (1 - _HALF)
+half/**/_HALF#:
+    alu[ahead, offset, +, 64]
+    .if (ahead < END_OFFSET)
+        pv_read_ahead(pkt_vec, ahead, _OTHER, sig_half/**/_OTHER, straddle_half/**/_HALF#)
+    .else
+        immed[ahead, 0]
+    .endif
+    br[check_half/**/_HALF#]
+
+straddle_half/**/_HALF#:
+    immed[ahead, 0]
+
+check_half/**/_HALF#:
+    ctx_arb[sig_half/**/_HALF]
+    alu[tibi, t_idx_ctx, OR, (_HALF * 64)]
+    local_csr_wr[T_INDEX_BYTE_INDEX, tibi]
+    alu[offset, offset, +, 64]
+    nop
+    nop
+    #define_eval LOOP (0)
+    #while (LOOP < 16)
+        alu[tested, --, B, *$index++]
+        test_assert_equal(tested, expected)
+        alu[expected, expected, +, increment]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+
+    alu[--, --, B, ahead]
+    bne[half/**/_OTHER#]
+    br[straddle#]
+
+    #define_eval _HALF (_HALF + 1)
+#endloop
+#undef _OTHER
+#undef _HALF
+
+straddle#:
+    .if (offset >= END_OFFSET)
+        test_pass_cycles(stamp)
+    .endif
+
+    // the chunk straddling CTM and MU is read by pv_seek
+    pv_invalidate_cache(pkt_vec)
+    pv_seek(pkt_vec, offset, PV_SEEK_PAD_INCLUDED)
+    #define_eval LOOP (0)
+    #while (LOOP < 16)
+        alu[tested, --, B, *$index++]
+        test_assert_equal(tested, expected)
+        alu[expected, expected, +, increment]
+        #define_eval LOOP (LOOP + 1)
+    #endloop
+    #undef LOOP
+
+    alu[offset, offset, +, 64]
+    pv_invalidate_cache(pkt_vec)
+    pv_read_ahead(pkt_vec, offset, 0, sig_half0, fail#)
+    br[half0#]
+
+fail#:
+test_fail()
+
+PV_SEEK_SUBROUTINE#:
+    pv_seek_subroutine(pkt_vec)
@@ -22,6 +22,7 @@
 .reg expected
 .reg tested
 .reg pkt_num
+.reg stamp
 
 #define PKT_NUM_i 0
 #while PKT_NUM_i < 0x100
@@ -41,6 +42,7 @@ move(offset, 0)
 move(increment, 0x00020002)
 move(expected, 0x00010002)
 
+test_cycles_start(stamp)
 pv_seek(pkt_vec, 0)
 byte_align_be[--, *$index++]
 
@@ -55,7 +57,7 @@ byte_align_be[--, *$index++]
     .endif
 .endw
 
-test_pass()
+test_pass_cycles(stamp)
 
 fail#:
 test_fail()
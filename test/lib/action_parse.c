@@ -31,14 +31,19 @@
 
 volatile __shared __lmem union instruction_format _action_list[NIC_MAX_INSTR];
 
+/* From app_config_tables.c */
+extern __shared __lmem uint32_t cfg_act_bank;
+__intrinsic uint32_t cfg_act_bank_addr(uint32_t bank);
+
 __intrinsic void
 cfg_act_read_queue(uint32_t qid)
 {
     SIGNAL sig;
-    __gpr uint32_t addr = NIC_CFG_INSTR_TBL_ADDR;
+    __gpr uint32_t addr;
     __xread uint32_t xwr_instr[NIC_MAX_INSTR];
 
-    addr = addr + qid * NIC_MAX_INSTR * 4;
+    /* The bank not in use holds the latest lists, also after a commit */
+    addr = cfg_act_bank_addr(!cfg_act_bank) + qid * NIC_MAX_INSTR * 4;
 
     cls_read(&xwr_instr, (__cls void *)addr, sizeof(xwr_instr));
     reg_cp((void *)_action_list, xwr_instr, sizeof(xwr_instr));
@@ -95,8 +100,9 @@ static void parse_action_list(void)
                 break;
 
            case INSTR_RSS:
-                /* actions length: 2 words (note ++i below)*/
-                action_next = _action_list[++i];
+                /* actions length: 3 words */
+                i += 2;
+                action_next = _action_list[i];
                 if (action_next.pipeline)
                     test_assert_equal(action_next.op, INSTR_TX_HOST);
                 break;
@@ -18,6 +18,28 @@
 #endm
 
 
+/* TIMESTAMP_LOW counts in units of 16 ME cycles */
+#macro test_cycles_start(out_stamp)
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[out_stamp, 0]
+#endm
+
+
+/* Pass, reporting the cycles since test_cycles_start() */
+#macro test_pass_cycles(in_stamp)
+.begin
+    .reg cycles
+    local_csr_rd[TIMESTAMP_LOW]
+    immed[cycles, 0]
+    alu[cycles, cycles, -, in_stamp]
+    alu[cycles, --, B, cycles, <<4]
+    local_csr_wr[MAILBOX_2, cycles]
+    local_csr_wr[MAILBOX_0, 0x02]
+    ctx_arb[kill]
+.end
+#endm
+
+
 #macro test_fail(fail_type)
 .begin
     .reg sts